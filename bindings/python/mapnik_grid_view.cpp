@@ -35,6 +35,7 @@ using namespace boost::python;
 
 // help compiler see template definitions
 static dict (*encode)( mapnik::grid_view const&, std::string const& , bool, unsigned int) = mapnik::grid_encode;
+static PyObject* (*encode_json)( mapnik::grid_view const&, bool, unsigned int) = mapnik::grid_encode_json;
 
 void export_grid_view()
 {
@@ -47,5 +48,9 @@ void export_grid_view()
              ( boost::python::arg("encoding")="utf",boost::python::arg("add_features")=true,boost::python::arg("resolution")=4 ),
              "Encode the grid as as optimized json\n"
             )
+        .def("encode_json",encode_json,
+             ( boost::python::arg("add_features")=true,boost::python::arg("resolution")=4 ),
+             "Encode the grid as a utfgrid json string natively\n"
+            )
         ;
 }
@@ -29,6 +29,7 @@
 #include <mapnik/layer.hpp>
 #include <mapnik/datasource.hpp>
 #include <mapnik/datasource_cache.hpp>
+#include "mapnik_enumeration.hpp"
 
 using mapnik::layer;
 using mapnik::parameters;
@@ -110,6 +111,12 @@ void export_layer()
         .def(vector_indexing_suite<std::vector<std::string>,true >())
         ;
 
+    enumeration_<mapnik::reprojection_cache_e>("reprojection_cache")
+        .value("NONE",mapnik::REPROJECTION_CACHE_NONE)
+        .value("MEMORY",mapnik::REPROJECTION_CACHE_MEMORY)
+        .value("FILE",mapnik::REPROJECTION_CACHE_FILE)
+        ;
+
     class_<layer>("Layer", "A Mapnik map layer.", init<std::string const&,optional<std::string const&> >(
                       "Create a Layer with a named string and, optionally, an srs string.\n"
                       "\n"
@@ -210,6 +217,18 @@ void export_layer()
                       ">>> lyr.cache_features = True # set to True to enable feature caching\n"
             )
 
+        .add_property("reprojection_cache",
+                      &layer::reprojection_cache,
+                      &layer::set_reprojection_cache,
+                      "Get/Set whether geometries of a static, file based datasource are kept\n"
+                      "reprojected to the map srs between renders\n"
+                      "\n"
+                      "Usage:\n"
+                      ">>> lyr.reprojection_cache\n"
+                      "mapnik._mapnik.reprojection_cache.NONE # by default\n"
+                      ">>> lyr.reprojection_cache = mapnik.reprojection_cache.FILE # sidecar next to the data file\n"
+            )
+
         .add_property("datasource",
                       &layer::datasource,
                       &layer::set_datasource,
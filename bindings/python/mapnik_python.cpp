@@ -80,6 +80,7 @@ void export_logger();
 #endif
 #include <mapnik/graphics.hpp>
 #include <mapnik/image_util.hpp>
+#include <mapnik/metatile.hpp>
 #include <mapnik/load_map.hpp>
 #include <mapnik/config_error.hpp>
 #include <mapnik/scale_denominator.hpp>
@@ -263,6 +264,35 @@ void render_tile_to_file(const mapnik::Map& map,
     mapnik::save_to_file(image.data(),file,format);
 }
 
+boost::python::list render_metatile(const mapnik::Map& map,
+                                    unsigned tiles,
+                                    unsigned tile_size,
+                                    std::string const& format,
+                                    double scale_factor = 1.0)
+{
+    mapnik::metatile_renderer ren(tiles, tile_size);
+    std::vector<std::string> const* encoded_tiles = 0;
+    {
+        python_unblock_auto_block b;
+        ren.render(map, scale_factor);
+        encoded_tiles = &ren.encode(format);
+    }
+    boost::python::list result;
+    std::vector<std::string> const& buffers = *encoded_tiles;
+    for (std::size_t i = 0; i < buffers.size(); ++i)
+    {
+        boost::python::handle<> encoded(
+#if PY_VERSION_HEX >= 0x03000000
+            ::PyBytes_FromStringAndSize
+#else
+            ::PyString_FromStringAndSize
+#endif
+            (buffers[i].data(), buffers[i].size()));
+        result.append(boost::python::object(encoded));
+    }
+    return result;
+}
+
 void render_to_file1(const mapnik::Map& map,
                      std::string const& filename,
                      std::string const& format)
@@ -398,10 +428,12 @@ bool has_pycairo()
 
 BOOST_PYTHON_FUNCTION_OVERLOADS(load_map_overloads, load_map, 2, 3)
 BOOST_PYTHON_FUNCTION_OVERLOADS(load_map_string_overloads, load_map_string, 2, 4)
+BOOST_PYTHON_FUNCTION_OVERLOADS(load_map_cached_overloads, load_map_cached, 3, 4)
 BOOST_PYTHON_FUNCTION_OVERLOADS(save_map_overloads, save_map, 2, 3)
 BOOST_PYTHON_FUNCTION_OVERLOADS(save_map_to_string_overloads, save_map_to_string, 1, 2)
 BOOST_PYTHON_FUNCTION_OVERLOADS(render_overloads, render, 2, 5)
 BOOST_PYTHON_FUNCTION_OVERLOADS(render_with_detector_overloads, render_with_detector, 3, 6)
+BOOST_PYTHON_FUNCTION_OVERLOADS(render_metatile_overloads, render_metatile, 4, 5)
 
 BOOST_PYTHON_MODULE(_mapnik)
 {
@@ -410,6 +442,7 @@ BOOST_PYTHON_MODULE(_mapnik)
 
     using mapnik::load_map;
     using mapnik::load_map_string;
+    using mapnik::load_map_cached;
     using mapnik::save_map;
     using mapnik::save_map_to_string;
     using mapnik::render_grid;
@@ -528,6 +561,22 @@ BOOST_PYTHON_MODULE(_mapnik)
         );
 
 
+    def("render_metatile", &render_metatile, render_metatile_overloads(
+            "\n"
+            "Render an NxN metatile in a single pass and return the encoded\n"
+            "subtiles as a row-major list of strings. The map must be sized to\n"
+            "tiles * tile_size and zoomed to the metatile extent. Paletted\n"
+            "formats share one palette computed over the whole metatile.\n"
+            "\n"
+            "Usage:\n"
+            ">>> from mapnik import Map, render_metatile, load_map\n"
+            ">>> m = Map(1024,1024)\n"
+            ">>> load_map(m,'mapfile.xml')\n"
+            ">>> m.zoom_to_box(metatile_extent)\n"
+            ">>> tiles = render_metatile(m,4,256,'png256')\n"
+            "\n"
+            ));
+
     def("render", &render, render_overloads(
             "\n"
             "Render Map to an AGG image_32 using offsets\n"
@@ -701,6 +750,8 @@ BOOST_PYTHON_MODULE(_mapnik)
 
     def("load_map_from_string", &load_map_string, load_map_string_overloads());
 
+    def("load_map_cached", &load_map_cached, load_map_cached_overloads());
+
     def("save_map", &save_map, save_map_overloads());
 /*
   "\n"
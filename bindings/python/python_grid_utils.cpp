@@ -33,11 +33,13 @@
 #include <mapnik/grid/grid.hpp>
 #include <mapnik/grid/grid_util.hpp>
 #include <mapnik/grid/grid_view.hpp>
+#include <mapnik/grid/grid_utf.hpp>
 #include <mapnik/value_error.hpp>
 #include <mapnik/feature.hpp>
 #include <mapnik/feature_kv_iterator.hpp>
 #include "mapnik_value_converter.hpp"
 #include "python_grid_utils.hpp"
+#include "mapnik_threads.hpp"
 
 namespace mapnik {
 
@@ -287,6 +289,8 @@ void grid_encode_utf(T const& grid_type,
     boost::python::list l;
     std::vector<typename T::lookup_type> key_order;
 
+    // grids rendered at reduced resolution need less (or no) resampling
+    resolution = mapnik::grid_sample_step(grid_type.get_resolution(), resolution);
     if (resolution != 1) {
         // resample on the fly - faster, less accurate
         mapnik::grid2utf<T>(grid_type,l,key_order,resolution);
@@ -337,6 +341,25 @@ boost::python::dict grid_encode( T const& grid, std::string const& format, bool
 template boost::python::dict grid_encode( mapnik::grid const& grid, std::string const& format, bool add_features, unsigned int resolution);
 template boost::python::dict grid_encode( mapnik::grid_view const& grid, std::string const& format, bool add_features, unsigned int resolution);
 
+template <typename T>
+PyObject* grid_encode_json(T const& grid, bool add_features, unsigned int resolution)
+{
+    std::string json;
+    {
+        python_unblock_auto_block b;
+        mapnik::grid_encode_utf_json(grid, json, add_features, resolution);
+    }
+    return
+#if PY_VERSION_HEX >= 0x03000000
+        ::PyUnicode_DecodeUTF8(json.data(), json.size(), 0);
+#else
+        ::PyString_FromStringAndSize(json.data(), json.size());
+#endif
+}
+
+template PyObject* grid_encode_json( mapnik::grid const& grid, bool add_features, unsigned int resolution);
+template PyObject* grid_encode_json( mapnik::grid_view const& grid, bool add_features, unsigned int resolution);
+
 /* new approach: key comes from grid object
  * grid size should be same as the map
  * encoding, resizing handled as method on grid object
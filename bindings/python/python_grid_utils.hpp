@@ -66,6 +66,10 @@ void grid_encode_utf(T const& grid_type,
 template <typename T>
 boost::python::dict grid_encode( T const& grid, std::string const& format, bool add_features, unsigned int resolution);
 
+// utfgrid JSON encoded natively, without building python objects per row
+template <typename T>
+PyObject* grid_encode_json(T const& grid, bool add_features, unsigned int resolution);
+
 /* new approach: key comes from grid object
  * grid size should be same as the map
  * encoding, resizing handled as method on grid object
@@ -44,6 +44,9 @@
 #include <GL/glew.h>
 #include <GL/glxew.h>
 #include <mapnik/nvpr_init.hpp>
+#include <mapnik/nvpr_path_buffer.hpp>
+#include <mapnik/building_extrusion.hpp>
+#include <mapnik/stroke_outline.hpp>
 #include <GL/glut.h>
 #include <GL/glx.h>
 #include <GL/glext.h>
@@ -88,8 +91,9 @@ public:
     void start_style_processing(feature_type_style const& st);
     void end_style_processing(feature_type_style const& st);
 
+    // vector markers with a uri are blitted from marker_sprite_cache
     void render_marker(pixel_position const& pos, marker const& marker, agg::trans_affine const& tr,
-                       double opacity, composite_mode_e comp_op);
+                       double opacity, composite_mode_e comp_op, std::string const& uri = std::string());
 
     void process(point_symbolizer const& sym,
                  mapnik::feature_impl & feature,
@@ -137,15 +141,22 @@ public:
 
     void setCacheFeatures(std::list<feature_ptr> *featureList);
 
-    void extractVerticesInCurrentPathStorage(GLfloat vertices[][2], unsigned int &numberOfVertices, GLubyte commands[], unsigned int &numberOfCommands);
-    void extractVerticesInCurrentPathStorage(GLfloat vertices[][2], unsigned int &numberOfVertices, GLubyte commands[], unsigned int &numberOfCommands
-                                            , double &minX, double &maxX
-                                            , double &minY, double &maxY);
-
-    void setJoinCaps(stroke const& stroke);
-    void setMiterLimit(stroke const& stroke);
-    void setWidth(stroke const& stroke, double scale_factor);
-    void setDash(stroke const& stroke, double scale_factor);
+    // Sets the commands of pathObject_ to the path in pathStorage_, going
+    // through pathBuffer_, whose bounds() are then the path's extent.
+    void specifyPathFromCurrentPathStorage();
+
+    // Sets the commands of the path objects from pathObject_ on, one for
+    // each path appended to paths, and fills them all with one instanced
+    // stencil and cover call. The paths must not overlap, since the cover
+    // of one would clear the stencil of the next.
+    void fillPathsInstanced(nvpr_path_buffer const& paths);
+    // draws the marker quads in pathBuffer_ textured with image
+    void drawMarkerBatch(image_data_32 const& image);
+
+    void setJoinCaps(stroke_params const& stroke);
+    void setMiterLimit(stroke_params const& stroke);
+    void setWidth(stroke_params const& stroke);
+    void setDash(stroke_params const& stroke);
     void render_text(int textSize, char text[], double posX, double posY,color textColor, double opacity);
     void render_text(int textSize, char text[], double posX, double posY,color textColor, color strokeColor, double opacity);
 
@@ -165,6 +176,7 @@ private:
     boost::shared_ptr<buffer_type> internal_buffer_;
     mutable buffer_type * current_buffer_;
     mutable bool style_level_compositing_;
+    unsigned filter_threads_;
     unsigned width_;
     unsigned height_;
     double scale_factor_;
@@ -188,6 +200,14 @@ private:
     // OpenGL implementation starts here
     agg::path_storage pathStorage_;
     unsigned int pathObject_;
+    // scratch space reused by every feature and symbolizer
+    nvpr_path_buffer pathBuffer_;
+    nvpr_path_buffer roofBuffer_;
+    building_extrusion extrusion_;
+    stroke_outline frameOutline_;
+    std::vector<GLfloat> dashArray_;
+    // 0..n-1, the offsets from pathObject_ of an instanced draw
+    std::vector<GLuint> pathInstances_;
 
     // For OpenGL
     GLuint frameBuffer_;
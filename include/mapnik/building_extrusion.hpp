@@ -0,0 +1,255 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_BUILDING_EXTRUSION_HPP
+#define MAPNIK_BUILDING_EXTRUSION_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/segment.hpp>
+#include <mapnik/vertex.hpp>
+
+// boost
+#include <boost/utility.hpp>
+
+// stl
+#include <algorithm>
+#include <vector>
+
+namespace mapnik {
+
+// Extrudes building footprints for the building symbolizer. The wall
+// faces, frame and roof of every footprint added are generated into one
+// flat vertex buffer, faces back to front, so nothing is allocated per
+// face and the buffer is reused from one batch of features to the next.
+// Coordinates stay in the footprint's space; height is added to y.
+class building_extrusion : private boost::noncopyable
+{
+    struct node
+    {
+        double x;
+        double y;
+        unsigned cmd;
+    };
+
+    struct building
+    {
+        std::size_t index;
+        std::size_t faces;
+        std::size_t frame;
+        std::size_t roof;
+        std::size_t end;
+        double miny;
+        box2d<double> extent;
+    };
+
+    // further buildings first, ties in the order they were added
+    static bool depth_order(building const& first, building const& second)
+    {
+        if (first.miny != second.miny) return first.miny > second.miny;
+        return first.index < second.index;
+    }
+
+public:
+    // One part of a building as a vertex source. It points into the
+    // buffer, so it is only good until the next add() or clear().
+    class path
+    {
+    public:
+        path(std::vector<node> const& nodes, std::size_t begin, std::size_t end)
+            : nodes_(&nodes),
+              begin_(begin),
+              end_(end),
+              pos_(begin) {}
+
+        void rewind(unsigned) const { pos_ = begin_; }
+
+        unsigned vertex(double* x, double* y) const
+        {
+            if (pos_ == end_) return SEG_END;
+            node const& n = (*nodes_)[pos_++];
+            *x = n.x;
+            *y = n.y;
+            return n.cmd;
+        }
+
+        std::size_t size() const { return end_ - begin_; }
+
+    private:
+        std::vector<node> const* nodes_;
+        std::size_t begin_;
+        std::size_t end_;
+        mutable std::size_t pos_;
+    };
+
+    building_extrusion() {}
+
+    // forgets the buildings, keeping the storage
+    void clear()
+    {
+        nodes_.clear();
+        buildings_.clear();
+    }
+
+    // Extrudes a footprint by height. The faces are quads on each edge,
+    // ordered by y_order like the renderers always drew them; the frame
+    // has the ground and top outlines and a vertical edge at the start of
+    // every face; the roof is the top outline. Footprints with fewer than
+    // three vertices are skipped and false returned.
+    template <typename Geometry>
+    bool add(Geometry & footprint, double height)
+    {
+        segments_.clear();
+        building b;
+        b.index = buildings_.size();
+
+        std::size_t count = 0;
+        double x0 = 0, y0 = 0, x, y;
+        footprint.rewind(0);
+        for (unsigned cm = footprint.vertex(&x, &y); cm != SEG_END;
+             cm = footprint.vertex(&x, &y))
+        {
+            if (cm == SEG_LINETO || cm == SEG_CLOSE)
+            {
+                segments_.push_back(segment_t(x0, y0, x, y));
+            }
+            if (count++ == 0)
+            {
+                b.extent.init(x, y, x, y);
+            }
+            else
+            {
+                b.extent.expand_to_include(x, y);
+            }
+            x0 = x;
+            y0 = y;
+        }
+        if (count < 3) return false;
+
+        b.miny = b.extent.miny();
+        b.extent.expand_to_include(b.extent.minx(), b.extent.miny() + height);
+        b.extent.expand_to_include(b.extent.maxx(), b.extent.maxy() + height);
+
+        std::size_t faces = segments_.size();
+        reserve(4 * faces + 2 * count + 2 * faces);
+        std::sort(segments_.begin(), segments_.end(), y_order);
+
+        b.faces = nodes_.size();
+        std::vector<segment_t>::const_iterator itr = segments_.begin();
+        std::vector<segment_t>::const_iterator end = segments_.end();
+        for (; itr != end; ++itr)
+        {
+            push(SEG_MOVETO, itr->get<0>(), itr->get<1>());
+            push(SEG_LINETO, itr->get<2>(), itr->get<3>());
+            push(SEG_LINETO, itr->get<2>(), itr->get<3>() + height);
+            push(SEG_LINETO, itr->get<0>(), itr->get<1>() + height);
+        }
+
+        b.frame = nodes_.size();
+        outline(footprint, 0);
+        for (itr = segments_.begin(); itr != end; ++itr)
+        {
+            push(SEG_MOVETO, itr->get<0>(), itr->get<1>());
+            push(SEG_LINETO, itr->get<0>(), itr->get<1>() + height);
+        }
+        // the top outline ends the frame and is the roof as well
+        b.roof = nodes_.size();
+        outline(footprint, height);
+        b.end = nodes_.size();
+
+        buildings_.push_back(b);
+        return true;
+    }
+
+    // Orders the buildings added so far back to front by their lowest y,
+    // the way faces are ordered within one building, so a whole batch of
+    // features can be drawn in painter's order.
+    void depth_sort()
+    {
+        std::sort(buildings_.begin(), buildings_.end(), depth_order);
+    }
+
+    std::size_t size() const { return buildings_.size(); }
+    bool empty() const { return buildings_.empty(); }
+
+    path faces(std::size_t i) const
+    {
+        return path(nodes_, buildings_[i].faces, buildings_[i].frame);
+    }
+
+    path frame(std::size_t i) const
+    {
+        return path(nodes_, buildings_[i].frame, buildings_[i].end);
+    }
+
+    path roof(std::size_t i) const
+    {
+        return path(nodes_, buildings_[i].roof, buildings_[i].end);
+    }
+
+    // the footprint extent grown to take in the height
+    box2d<double> const& extent(std::size_t i) const { return buildings_[i].extent; }
+
+    // the number of vertices generated for all buildings
+    std::size_t vertices() const { return nodes_.size(); }
+
+private:
+    template <typename Geometry>
+    void outline(Geometry & footprint, double height)
+    {
+        double x, y;
+        footprint.rewind(0);
+        for (unsigned cm = footprint.vertex(&x, &y); cm != SEG_END;
+             cm = footprint.vertex(&x, &y))
+        {
+            push(cm == SEG_MOVETO ? SEG_MOVETO : SEG_LINETO, x, y + height);
+        }
+    }
+
+    void push(unsigned cmd, double x, double y)
+    {
+        node n;
+        n.x = x;
+        n.y = y;
+        n.cmd = cmd;
+        nodes_.push_back(n);
+    }
+
+    // grows the buffer geometrically rather than to the exact size, as
+    // reserve() alone would for every building
+    void reserve(std::size_t size)
+    {
+        std::size_t needed = nodes_.size() + size;
+        if (nodes_.capacity() < needed)
+        {
+            nodes_.reserve(std::max(needed, 2 * nodes_.capacity()));
+        }
+    }
+
+    std::vector<node> nodes_;
+    std::vector<building> buildings_;
+    std::vector<segment_t> segments_;
+};
+
+}
+
+#endif // MAPNIK_BUILDING_EXTRUSION_HPP
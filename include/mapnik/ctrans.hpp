@@ -31,6 +31,7 @@
 
 // stl
 #include <algorithm>
+#include <cmath>
 
 namespace mapnik
 {
@@ -65,12 +66,18 @@ struct MAPNIK_DECL coord_transform
                      proj_transform const& prj_trans)
         : t_(&t),
         geom_(geom),
-        prj_trans_(&prj_trans)  {}
+        prj_trans_(&prj_trans),
+        count_(0),
+        pos_(0),
+        done_(false) {}
 
     explicit coord_transform(Geometry & geom)
         : t_(0),
         geom_(geom),
-        prj_trans_(0)  {}
+        prj_trans_(0),
+        count_(0),
+        pos_(0),
+        done_(false) {}
 
     void set_proj_trans(proj_transform const& prj_trans)
     {
@@ -84,13 +91,11 @@ struct MAPNIK_DECL coord_transform
 
     unsigned vertex(double *x, double *y) const
     {
-        unsigned command = geom_.vertex(x, y);
-        if ( command != SEG_END)
-        {
-            double z = 0;
-            if (!prj_trans_->backward(*x, *y, z))
-                return SEG_END;
-        }
+        if (pos_ == count_ && !fill())
+            return SEG_END;
+        *x = coords_[pos_ * 2];
+        *y = coords_[pos_ * 2 + 1];
+        unsigned command = commands_[pos_++];
         t_->forward(x, y);
         return command;
     }
@@ -98,6 +103,9 @@ struct MAPNIK_DECL coord_transform
     void rewind(unsigned pos) const
     {
         geom_.rewind(pos);
+        count_ = 0;
+        pos_ = 0;
+        done_ = false;
     }
 
     Geometry const& geom() const
@@ -106,9 +114,60 @@ struct MAPNIK_DECL coord_transform
     }
 
 private:
+    // Reads the next batch of vertices and reprojects them in one call.
+    // A vertex that fails to reproject comes back as SEG_END, just as
+    // when every vertex was transformed on its own.
+    bool fill() const
+    {
+        count_ = 0;
+        pos_ = 0;
+        while (!done_ && count_ < batch_size)
+        {
+            unsigned command = geom_.vertex(&coords_[count_ * 2], &coords_[count_ * 2 + 1]);
+            if (command == SEG_END)
+            {
+                done_ = true;
+                break;
+            }
+            commands_[count_++] = command;
+        }
+        if (count_ == 0)
+            return false;
+        if (prj_trans_->equal())
+            return true;
+
+        double source[batch_size * 2];
+        std::copy(coords_, coords_ + count_ * 2, source);
+        if (prj_trans_->backward(coords_, coords_ + 1, 0, count_, 2))
+        {
+            for (unsigned i = 0; i < count_; ++i)
+            {
+                if (coords_[i * 2] == HUGE_VAL || coords_[i * 2 + 1] == HUGE_VAL)
+                    commands_[i] = SEG_END;
+            }
+            return true;
+        }
+        // the batch failed as a whole, find the vertices that caused it
+        std::copy(source, source + count_ * 2, coords_);
+        for (unsigned i = 0; i < count_; ++i)
+        {
+            double z = 0;
+            if (!prj_trans_->backward(coords_[i * 2], coords_[i * 2 + 1], z))
+                commands_[i] = SEG_END;
+        }
+        return true;
+    }
+
+    enum { batch_size = 64 };
+
     Transform const* t_;
     Geometry & geom_;
     proj_transform const* prj_trans_;
+    mutable double coords_[batch_size * 2];
+    mutable unsigned commands_[batch_size];
+    mutable unsigned count_;
+    mutable unsigned pos_;
+    mutable bool done_;
 };
 
 class CoordTransform
@@ -128,6 +128,7 @@ protected:
 typedef const char * datasource_name();
 typedef datasource* create_ds(parameters const& params, bool bind);
 typedef void destroy_ds(datasource *ds);
+typedef bool datasource_thread_safe();
 
 class datasource_deleter
 {
@@ -154,6 +155,14 @@ typedef boost::shared_ptr<datasource> datasource_ptr;
         delete ds;                                                      \
     }
 
+// declares that the plugin can be constructed (and bound) on several
+// threads at once, so datasource_cache::create need not serialize it
+#define DATASOURCE_PLUGIN_THREAD_SAFE                                   \
+    extern "C" MAPNIK_EXP bool datasource_thread_safe()                 \
+    {                                                                   \
+        return true;                                                    \
+    }
+
 }
 
 #endif // MAPNIK_DATASOURCE_HPP
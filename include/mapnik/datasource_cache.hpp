@@ -48,7 +48,10 @@ public:
     std::string plugin_directories();
     void register_datasources(std::string const& path);
     bool register_datasource(std::string const& path);
-    boost::shared_ptr<datasource> create(parameters const& params, bool bind=true);
+    // with concurrent set, plugins declared DATASOURCE_PLUGIN_THREAD_SAFE are
+    // constructed (and bound) outside the lock, alongside others; all other
+    // plugins are still created one at a time
+    boost::shared_ptr<datasource> create(parameters const& params, bool bind=true, bool concurrent=false);
 private:
     datasource_cache();
     ~datasource_cache();
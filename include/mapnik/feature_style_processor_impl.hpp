@@ -39,6 +39,7 @@
 #include <mapnik/scale_denominator.hpp>
 #include <mapnik/projection.hpp>
 #include <mapnik/proj_transform.hpp>
+#include <mapnik/reprojection_cache.hpp>
 
 // boost
 #include <boost/foreach.hpp>
@@ -489,11 +490,28 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
 
         bool cache_features = lay.cache_features() && active_styles.size() > 1;
 
+        // With a reprojection cache the features arrive in the map srs, so
+        // styles see them through an identity transform and in-memory
+        // feature caches are queried with the map extent.
+        reprojected_geometries_ptr reprojected = reprojection_cache::instance().get(lay, prj_trans);
+        proj_transform identity_trans(proj0, proj0);
+        proj_transform const& style_trans = reprojected ? identity_trans : prj_trans;
+        query cache_q(q);
+        if (reprojected)
+        {
+            box2d<double> map_query_ext = m_.get_buffered_extent();
+            if (maximum_extent)
+            {
+                map_query_ext.clip(*maximum_extent);
+            }
+            cache_q = query(map_query_ext, res, scale_denom, m_.get_current_extent());
+        }
+
         // Render incrementally when the column that we group by
         // changes value.
         if (group_by != "")
         {
-            featureset_ptr features = ds->features(q);
+            featureset_ptr features = reprojected_features(ds, q, reprojected, prj_trans);
             if (features) {
                 // Cache all features into the memory_datasource before rendering.
                 memory_datasource cache;
@@ -509,7 +527,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
                         BOOST_FOREACH (feature_type_style * style, active_styles)
                         {
                             render_style(lay, p, style, style_names[i++],
-                                         cache.features(q), prj_trans, scale_denom);
+                                         cache.features(cache_q), style_trans, scale_denom);
                         }
                         cache.clear();
                     }
@@ -521,14 +539,14 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
                 BOOST_FOREACH (feature_type_style * style, active_styles)
                 {
                     render_style(lay, p, style, style_names[i++],
-                                 cache.features(q), prj_trans, scale_denom);
+                                 cache.features(cache_q), style_trans, scale_denom);
                 }
             }
         }
         else if (cache_features)
         {
             memory_datasource cache(ds->type());
-            featureset_ptr features = ds->features(q);
+            featureset_ptr features = reprojected_features(ds, q, reprojected, prj_trans);
             if (features) {
                 // Cache all features into the memory_datasource before rendering.
                 feature_ptr feature;
@@ -541,7 +559,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
             BOOST_FOREACH (feature_type_style * style, active_styles)
             {
                 render_style(lay, p, style, style_names[i++],
-                             cache.features(q), prj_trans, scale_denom);
+                             cache.features(cache_q), style_trans, scale_denom);
             }
         }
         // We only have a single style and no grouping.
@@ -551,7 +569,7 @@ void feature_style_processor<Processor>::apply_to_layer(layer const& lay, Proces
             BOOST_FOREACH (feature_type_style * style, active_styles)
             {
                 render_style(lay, p, style, style_names[i++],
-                             ds->features(q), prj_trans, scale_denom);
+                             reprojected_features(ds, q, reprojected, prj_trans), style_trans, scale_denom);
             }
         }
     }
@@ -96,8 +96,9 @@ typedef boost::shared_ptr<font_glyph> glyph_ptr;
 class font_face : boost::noncopyable
 {
 public:
-    font_face(FT_Face face)
-        : face_(face) {}
+    font_face(FT_Face face, std::string const& file_name)
+        : face_(face),
+          file_name_(file_name) {}
 
     std::string  family_name() const
     {
@@ -109,6 +110,16 @@ public:
         return std::string(face_->style_name);
     }
 
+    std::string const& file_name() const
+    {
+        return file_name_;
+    }
+
+    long face_index() const
+    {
+        return face_->face_index;
+    }
+
     FT_GlyphSlot glyph() const
     {
         return face_->glyph;
@@ -147,19 +158,24 @@ public:
 
 private:
     FT_Face face_;
+    std::string file_name_;
 };
 
+struct shaped_text;
+
 class MAPNIK_DECL font_face_set : private boost::noncopyable
 {
 public:
     font_face_set(void)
         : faces_(),
-        dimension_cache_() {}
+        dimension_cache_(),
+        size_(0.0) {}
 
     void add(face_ptr face)
     {
         faces_.push_back(face);
         dimension_cache_.clear(); //Make sure we don't use old cached data
+        faces_key_.clear();
     }
 
     unsigned size() const
@@ -189,6 +205,7 @@ public:
         {
             face->set_pixel_sizes(size);
         }
+        size_ = -static_cast<double>(size);
     }
 
     void set_character_sizes(double size)
@@ -197,10 +214,20 @@ public:
         {
             face->set_character_sizes(size);
         }
+        size_ = size;
     }
+
+    // identifies the faces (file and index within it, as well as family and
+    // style) and current size, for text_shaping_cache keys
+    std::string key();
 private:
+    void shape_string(shaped_text & text, UnicodeString const& ustr);
+
     std::vector<face_ptr> faces_;
     std::map<unsigned, char_info> dimension_cache_;
+    // character size, or negated pixel size
+    double size_;
+    std::string faces_key_;
 };
 
 // FT_Stroker wrapper
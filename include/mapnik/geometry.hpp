@@ -80,6 +80,11 @@ public:
         return cont_;
     }
 
+    container_type & data()
+    {
+        return cont_;
+    }
+
     size_type size() const
     {
         return cont_.size();
@@ -106,6 +111,11 @@ public:
         return result;
     }
 
+    void reserve(size_type n)
+    {
+        cont_.reserve(n);
+    }
+
     void push_vertex(coord_type x, coord_type y, CommandType c)
     {
         cont_.push_back(x,y,c);
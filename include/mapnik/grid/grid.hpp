@@ -37,6 +37,7 @@
 
 // boost
 #include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
 
 // stl
 #include <map>
@@ -57,8 +58,8 @@ public:
     typedef mapnik::ImageData<value_type> data_type;
     typedef std::string lookup_type;
     // mapping between pixel id and key
-    typedef std::map<value_type, lookup_type> feature_key_type;
-    typedef std::map<lookup_type, mapnik::feature_ptr> feature_type;
+    typedef boost::unordered_map<value_type, lookup_type> feature_key_type;
+    typedef boost::unordered_map<lookup_type, mapnik::feature_ptr> feature_type;
     static const value_type base_mask;
 
 private:
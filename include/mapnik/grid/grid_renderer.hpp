@@ -49,6 +49,7 @@ namespace mapnik {
 class marker;
 
 struct grid_rasterizer;
+class stroke_outline;
 
 template <typename T>
 class MAPNIK_DECL grid_renderer : public feature_style_processor<grid_renderer<T> >,
@@ -124,6 +125,7 @@ private:
     face_manager<freetype_engine> font_manager_;
     boost::shared_ptr<label_collision_detector4> detector_;
     boost::scoped_ptr<grid_rasterizer> ras_ptr;
+    boost::scoped_ptr<stroke_outline> outline_ptr;
     box2d<double> query_extent_;
     void setup(Map const& m);
 };
@@ -0,0 +1,49 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_GRID_UTF_HPP
+#define MAPNIK_GRID_UTF_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// stl
+#include <string>
+
+namespace mapnik {
+
+// Encodes a hit grid (or grid view) as UTFGrid JSON,
+// {"grid":[...],"keys":[...],"data":{...}}, appending to `json`.
+// Keys are assigned codepoints in order of first appearance (starting at 32
+// and skipping '"' and '\'), exactly like the python `Grid.encode('utf')`.
+// Every `resolution`th map pixel is sampled; grids rendered at reduced
+// resolution are sampled relative to their own resolution.
+template <typename T>
+MAPNIK_DECL void grid_encode_utf_json(T const& grid,
+                                      std::string & json,
+                                      bool add_features = true,
+                                      unsigned int resolution = 4);
+
+}
+
+#endif // MAPNIK_GRID_UTF_HPP
@@ -31,6 +31,19 @@
 
 namespace mapnik {
 
+/*
+ * Pixel step used when encoding a grid at the requested resolution.
+ * Grids rendered natively at reduced resolution (grid resolution > 1)
+ * already hold one pixel per `grid_resolution` map pixels.
+ */
+
+static inline unsigned grid_sample_step(unsigned grid_resolution,
+                                        unsigned requested_resolution)
+{
+    unsigned step = requested_resolution / (grid_resolution > 1 ? grid_resolution : 1);
+    return step > 0 ? step : 1;
+}
+
 /*
  * Nearest neighbor resampling for grids
  */
@@ -32,6 +32,7 @@
 
 // boost
 #include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
 
 // stl
 #include <map>
@@ -52,8 +53,8 @@ public:
     typedef typename T::pixel_type value_type;
     typedef typename T::pixel_type pixel_type;
     typedef std::string lookup_type;
-    typedef std::map<value_type, lookup_type> feature_key_type;
-    typedef std::map<std::string, mapnik::feature_ptr> feature_type;
+    typedef boost::unordered_map<value_type, lookup_type> feature_key_type;
+    typedef boost::unordered_map<std::string, mapnik::feature_ptr> feature_type;
 
     hit_grid_view(unsigned x, unsigned y,
                   unsigned width, unsigned height,
@@ -81,6 +81,8 @@ enum composite_mode_e
 MAPNIK_DECL boost::optional<composite_mode_e> comp_op_from_string(std::string const& name);
 MAPNIK_DECL boost::optional<std::string> comp_op_to_string(composite_mode_e comp_op);
 
+// Blends premultiplied `src` onto `dst` at dx,dy. With premultiply_src the
+// whole of `src` is premultiplied in place first.
 template <typename T1, typename T2>
 MAPNIK_DECL void composite(T1 & dst, T2 & src,
                            composite_mode_e mode,
@@ -29,12 +29,15 @@
 // boost
 #include <boost/gil/gil_all.hpp>
 #include <boost/concept_check.hpp>
+#include <boost/thread/thread.hpp>
 // agg
 #include "agg_basics.h"
 #include "agg_rendering_buffer.h"
 #include "agg_pixfmt_rgba.h"
 #include "agg_scanline_u.h"
 #include "agg_blur.h"
+// stl
+#include <algorithm>
 
 
 // 8-bit YUV
@@ -220,203 +223,216 @@ void process_channel (Src const& src, Dst & dst, mapnik::filter::sobel)
 
 
 
+// rows outside the image are mirrored (row -1 is row 1), columns are clamped
 template <typename Src, typename Dst, typename Filter>
-void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& filter)
+void apply_convolution_3x3(Src const& src_view, Dst const& dst_view, Filter const& filter,
+                           int y0, int y1)
 {
     using boost::gil::bits32f;
-    using boost::gil::point2;
 
     // p0 p1 p2
     // p3 p4 p5
     // p6 p7 p8
 
-    typename Src::xy_locator src_loc = src_view.xy_at(0,0);
-    typename Src::xy_locator::cached_location_t loc00 = src_loc.cache_location(-1,-1);
-    typename Src::xy_locator::cached_location_t loc10 = src_loc.cache_location( 0,-1);
-    typename Src::xy_locator::cached_location_t loc20 = src_loc.cache_location( 1,-1);
-    typename Src::xy_locator::cached_location_t loc01 = src_loc.cache_location(-1, 0);
-    typename Src::xy_locator::cached_location_t loc11 = src_loc.cache_location( 0, 0);
-    typename Src::xy_locator::cached_location_t loc21 = src_loc.cache_location( 1, 0);
-    typename Src::xy_locator::cached_location_t loc02 = src_loc.cache_location(-1, 1);
-    typename Src::xy_locator::cached_location_t loc12 = src_loc.cache_location( 0, 1);
-    typename Src::xy_locator::cached_location_t loc22 = src_loc.cache_location( 1, 1);
-
-    typename Src::x_iterator dst_it = dst_view.row_begin(0);
-
-    // top row
-    for (int x = 0 ; x < src_view.width(); ++x)
+    int width = src_view.width();
+    int height = src_view.height();
+    for (int y = y0; y < y1; ++y)
     {
-        *dst_it = src_loc[loc11];
-        for (int i = 0; i < 3; ++i)
+        int above = y > 0 ? y - 1 : (height > 1 ? 1 : 0);
+        int below = y < height - 1 ? y + 1 : (height > 1 ? height - 2 : 0);
+        typename Src::x_iterator r0 = src_view.row_begin(above);
+        typename Src::x_iterator r1 = src_view.row_begin(y);
+        typename Src::x_iterator r2 = src_view.row_begin(below);
+        typename Dst::x_iterator dst_it = dst_view.row_begin(y);
+        for (int x = 0; x < width; ++x)
         {
-            bits32f p[9];
-
-            p[4] = src_loc[loc11][i];
-            p[7] = src_loc[loc12][i];
-
-            if (x == 0)
-            {
-                p[3] = p[4];
-                p[6] = p[7];
-            }
-            else
+            int left = x > 0 ? x - 1 : x;
+            int right = x < width - 1 ? x + 1 : x;
+            dst_it[x] = r1[x];
+            for (int i = 0; i < 3; ++i)
             {
-                p[3] = src_loc[loc01][i];
-                p[6] = src_loc[loc02][i];
+                bits32f p[9];
+                p[0] = r0[left][i];
+                p[1] = r0[x][i];
+                p[2] = r0[right][i];
+                p[3] = r1[left][i];
+                p[4] = r1[x][i];
+                p[5] = r1[right][i];
+                p[6] = r2[left][i];
+                p[7] = r2[x][i];
+                p[8] = r2[right][i];
+                process_channel(p, dst_it[x][i], filter);
             }
+        }
+    }
+}
 
-            if ( x == src_view.width()-1)
-            {
-                p[5] = p[4];
-                p[8] = p[7];
-            }
-            else
-            {
-                p[5] = src_loc[loc21][i];
-                p[8] = src_loc[loc22][i];
-            }
+template <typename Src, typename Dst, typename Filter>
+void apply_convolution_3x3(Src const& src_view, Dst & dst_view, Filter const& filter)
+{
+    apply_convolution_3x3(src_view, dst_view, filter, 0, src_view.height());
+}
 
+namespace detail {
 
-            p[0] = p[6];
-            p[1] = p[7];
-            p[2] = p[8];
+template <typename Func>
+struct band_task
+{
+    band_task(Func const& func, int y0, int y1)
+        : func_(func), y0_(y0), y1_(y1) {}
 
-            process_channel(p, (*dst_it)[i], filter);
-        }
-        ++src_loc.x();
-        ++dst_it;
+    void operator() () const
+    {
+        func_(y0_, y1_);
     }
-    // carrige-return
-    src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
 
-    // 1... height-1 rows
-    for (int y = 1; y<src_view.height()-1; ++y)
-    {
-        for (int x = 0; x < src_view.width(); ++x)
-        {
-            *dst_it = src_loc[loc11];
-            for (int i = 0; i < 3; ++i)
-            {
-                bits32f p[9];
+    Func const& func_;
+    int y0_;
+    int y1_;
+};
 
-                p[1] = src_loc[loc10][i];
-                p[4] = src_loc[loc11][i];
-                p[7] = src_loc[loc12][i];
-
-                if (x == 0)
-                {
-                    p[0] = p[1];
-                    p[3] = p[4];
-                    p[6] = p[7];
-                }
-                else
-                {
-                    p[0] = src_loc[loc00][i];
-                    p[3] = src_loc[loc01][i];
-                    p[6] = src_loc[loc02][i];
-                }
-
-                if ( x == src_view.width() - 1)
-                {
-                    p[2] = p[1];
-                    p[5] = p[4];
-                    p[8] = p[7];
-                }
-                else
-                {
-                    p[2] = src_loc[loc20][i];
-                    p[5] = src_loc[loc21][i];
-                    p[8] = src_loc[loc22][i];
-                }
-                process_channel(p, (*dst_it)[i], filter);
-            }
-            ++dst_it;
-            ++src_loc.x();
-        }
-        // carrige-return
-        src_loc += point2<std::ptrdiff_t>(-src_view.width(),1);
+// Calls func(y0, y1) on consecutive, non-overlapping bands of rows, using up
+// to `threads` threads. Filters which look at neighbouring rows must read them
+// from an unmodified copy of the image.
+template <typename Func>
+void for_each_band(int height, unsigned threads, Func const& func)
+{
+    static const int min_band_rows = 32;
+    int bands = std::min(static_cast<int>(threads), height / min_band_rows);
+    if (bands <= 1)
+    {
+        func(0, height);
+        return;
     }
-
-    // bottom row
-    //src_loc = src_view.xy_at(0,src_view.height()-1);
-    for (int x = 0 ; x < src_view.width(); ++x)
+    int rows = (height + bands - 1) / bands;
+    boost::thread_group workers;
+    for (int y = rows; y < height; y += rows)
     {
-        *dst_it = src_loc[loc11];
-        for (int i = 0; i < 3; ++i)
-        {
-            bits32f p[9];
-
-            p[1] = src_loc[loc10][i];
-            p[4] = src_loc[loc11][i];
+        workers.create_thread(band_task<Func>(func, y, std::min(height, y + rows)));
+    }
+    func(0, rows);
+    workers.join_all();
+}
 
-            if (x == 0)
-            {
-                p[0] = p[1];
-                p[3] = p[4];
-            }
-            else
-            {
-                p[0] = src_loc[loc00][i];
-                p[3] = src_loc[loc01][i];
-            }
+template <typename Src, typename Dst, typename Filter>
+struct convolution_band
+{
+    convolution_band(Src const& src_view, Dst const& dst_view, Filter const& filter)
+        : src_view_(src_view), dst_view_(dst_view), filter_(filter) {}
 
-            if ( x == src_view.width()-1)
-            {
-                p[2] = p[1];
-                p[5] = p[4];
+    void operator() (int y0, int y1) const
+    {
+        apply_convolution_3x3(src_view_, dst_view_, filter_, y0, y1);
+    }
 
-            }
-            else
-            {
-                p[2] = src_loc[loc20][i];
-                p[5] = src_loc[loc21][i];
-            }
+    Src const& src_view_;
+    Dst const& dst_view_;
+    Filter const& filter_;
+};
 
-            p[6] = p[0];
-            p[7] = p[1];
-            p[8] = p[2];
+// stack blur is separable: rows are blurred independently, then columns
+struct stack_blur_band
+{
+    stack_blur_band(agg::int8u * data, int width, int height, unsigned radius, bool columns)
+        : data_(data), width_(width), height_(height), radius_(radius), columns_(columns) {}
 
-            process_channel(p, (*dst_it)[i], filter);
+    void operator() (int i0, int i1) const
+    {
+        agg::rendering_buffer buf;
+        if (columns_)
+        {
+            buf.attach(data_ + i0 * 4, i1 - i0, height_, width_ * 4);
+            agg::pixfmt_rgba32 pixf(buf);
+            agg::stack_blur_rgba32(pixf, 0, radius_);
+        }
+        else
+        {
+            buf.attach(data_ + i0 * width_ * 4, width_, i1 - i0, width_ * 4);
+            agg::pixfmt_rgba32 pixf(buf);
+            agg::stack_blur_rgba32(pixf, radius_, 0);
         }
-        ++src_loc.x();
-        ++dst_it;
     }
+
+    agg::int8u * data_;
+    int width_;
+    int height_;
+    unsigned radius_;
+    bool columns_;
+};
+
 }
 
 template <typename Src, typename Filter>
-void apply_filter(Src & src, Filter const& filter)
+void apply_filter(Src & src, Filter const& filter, unsigned threads = 1)
 {
     double_buffer<Src> tb(src);
-    apply_convolution_3x3(tb.src_view, tb.dst_view, filter);
+    detail::for_each_band(tb.src_view.height(), threads,
+                          detail::convolution_band<rgba8_view_t, rgba8_view_t, Filter>(tb.src_view, tb.dst_view, filter));
 }
 
 template <typename Src>
-void apply_filter(Src & src, agg_stack_blur const& op)
+void apply_filter(Src & src, agg_stack_blur const& op, unsigned threads = 1)
 {
-    agg::rendering_buffer buf(src.raw_data(),src.width(),src.height(), src.width() * 4);
-    agg::pixfmt_rgba32 pixf(buf);
-    agg::stack_blur_rgba32(pixf,op.rx,op.ry);
+    agg::int8u * data = reinterpret_cast<agg::int8u*>(src.raw_data());
+    int width = src.width();
+    int height = src.height();
+    if (threads <= 1)
+    {
+        agg::rendering_buffer buf(data, width, height, width * 4);
+        agg::pixfmt_rgba32 pixf(buf);
+        agg::stack_blur_rgba32(pixf,op.rx,op.ry);
+        return;
+    }
+    if (op.rx > 0)
+    {
+        detail::for_each_band(height, threads, detail::stack_blur_band(data, width, height, op.rx, false));
+    }
+    if (op.ry > 0)
+    {
+        detail::for_each_band(width, threads, detail::stack_blur_band(data, width, height, op.ry, true));
+    }
 }
 
-template <typename Src>
-void apply_filter(Src & src, gray const& op)
+// per pixel filters, applied to a single row
+
+inline void filter_row(boost::gil::rgba8_pixel_t * row, int width, gray const&)
 {
     using namespace boost::gil;
+    for (int x = 0; x < width; ++x)
+    {
+        // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
+        uint8_t & r = get_color(row[x], red_t());
+        uint8_t & g = get_color(row[x], green_t());
+        uint8_t & b = get_color(row[x], blue_t());
+        uint8_t   v = uint8_t((4915 * r + 9667 * g + 1802 * b + 8192) >> 14);
+        r = g = b = v;
+    }
+}
 
-    rgba8_view_t src_view = rgba8_view(src);
+inline void filter_row(boost::gil::rgba8_pixel_t * row, int width, invert const&)
+{
+    using namespace boost::gil;
+    for (int x = 0; x < width; ++x)
+    {
+        // we only work with premultiplied source,
+        // thus all color values must be <= alpha
+        uint8_t   a = get_color(row[x], alpha_t());
+        uint8_t & r = get_color(row[x], red_t());
+        uint8_t & g = get_color(row[x], green_t());
+        uint8_t & b = get_color(row[x], blue_t());
+        r = a - r;
+        g = a - g;
+        b = a - b;
+    }
+}
 
+template <typename Src>
+void apply_filter(Src & src, gray const& op, unsigned threads = 1)
+{
+    rgba8_view_t src_view = rgba8_view(src);
     for (int y=0; y<src_view.height(); ++y)
     {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-        for (int x=0; x<src_view.width(); ++x)
-        {
-            // formula taken from boost/gil/color_convert.hpp:rgb_to_luminance
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            uint8_t   v = uint8_t((4915 * r + 9667 * g + 1802 * b + 8192) >> 14);
-            r = g = b = v;
-        }
+        filter_row(&src_view.row_begin(y)[0], src_view.width(), op);
     }
 }
 
@@ -449,14 +465,14 @@ void x_gradient_impl(Src const& src_view, Dst const& dst_view)
 }
 
 template <typename Src>
-void apply_filter(Src & src, x_gradient const& op)
+void apply_filter(Src & src, x_gradient const& op, unsigned threads = 1)
 {
     double_buffer<Src> tb(src);
     x_gradient_impl(tb.src_view, tb.dst_view);
 }
 
 template <typename Src>
-void apply_filter(Src & src, y_gradient const& op)
+void apply_filter(Src & src, y_gradient const& op, unsigned threads = 1)
 {
     double_buffer<Src> tb(src);
     x_gradient_impl(rotated90ccw_view(tb.src_view),
@@ -464,45 +480,115 @@ void apply_filter(Src & src, y_gradient const& op)
 }
 
 template <typename Src>
-void apply_filter(Src & src, invert const& op)
+void apply_filter(Src & src, invert const& op, unsigned threads = 1)
 {
-    using namespace boost::gil;
-
     rgba8_view_t src_view = rgba8_view(src);
-
     for (int y=0; y<src_view.height(); ++y)
     {
-        rgba8_view_t::x_iterator src_it = src_view.row_begin(y);
-        for (int x=0; x<src_view.width(); ++x)
-        {
-            // we only work with premultiplied source,
-            // thus all color values must be <= alpha
-            uint8_t   a = get_color(src_it[x], alpha_t());
-            uint8_t & r = get_color(src_it[x], red_t());
-            uint8_t & g = get_color(src_it[x], green_t());
-            uint8_t & b = get_color(src_it[x], blue_t());
-            r = a - r;
-            g = a - g;
-            b = a - b;
-        }
+        filter_row(&src_view.row_begin(y)[0], src_view.width(), op);
     }
 }
 
 template <typename Src>
 struct filter_visitor : boost::static_visitor<void>
 {
-    filter_visitor(Src & src)
-    : src_(src) {}
+    filter_visitor(Src & src, unsigned threads = 1)
+    : src_(src),
+      threads_(threads) {}
 
     template <typename T>
     void operator () (T const& filter)
     {
-        apply_filter(src_, filter);
+        apply_filter(src_, filter, threads_);
     }
 
     Src & src_;
+    unsigned threads_;
+};
+
+namespace detail {
+
+struct is_row_filter : boost::static_visitor<bool>
+{
+    template <typename T>
+    bool operator() (T const&) const { return false; }
+    bool operator() (gray const&) const { return true; }
+    bool operator() (invert const&) const { return true; }
+};
+
+struct row_filter_visitor : boost::static_visitor<void>
+{
+    row_filter_visitor(boost::gil::rgba8_pixel_t * row, int width)
+        : row_(row), width_(width) {}
+
+    template <typename T>
+    void operator() (T const&) const {}
+    void operator() (gray const& op) const { filter_row(row_, width_, op); }
+    void operator() (invert const& op) const { filter_row(row_, width_, op); }
+
+    boost::gil::rgba8_pixel_t * row_;
+    int width_;
+};
+
+// a run of per pixel filters, applied row by row while the row is in cache
+template <typename Iterator>
+struct row_filters_band
+{
+    row_filters_band(rgba8_view_t const& view, Iterator begin, Iterator end)
+        : view_(view), begin_(begin), end_(end) {}
+
+    void operator() (int y0, int y1) const
+    {
+        for (int y = y0; y < y1; ++y)
+        {
+            row_filter_visitor visitor(&view_.row_begin(y)[0], view_.width());
+            for (Iterator itr = begin_; itr != end_; ++itr)
+            {
+                boost::apply_visitor(visitor, *itr);
+            }
+        }
+    }
+
+    rgba8_view_t const& view_;
+    Iterator begin_;
+    Iterator end_;
 };
 
+}
+
+// Applies a list of filters in order. Consecutive per pixel filters (gray,
+// invert) are fused into a single pass and bands of rows are processed on up
+// to `threads` threads; the result is identical to applying each filter in
+// turn with filter_visitor.
+template <typename Src, typename Container>
+void apply_filters(Src & src, Container const& filters, unsigned threads = 1)
+{
+    typedef typename Container::const_iterator iterator;
+    rgba8_view_t src_view = rgba8_view(src);
+    filter_visitor<Src> visitor(src, threads);
+    iterator itr = filters.begin();
+    iterator end = filters.end();
+    while (itr != end)
+    {
+        if (boost::apply_visitor(detail::is_row_filter(), *itr))
+        {
+            iterator run_end = itr;
+            while (run_end != end && boost::apply_visitor(detail::is_row_filter(), *run_end))
+            {
+                ++run_end;
+            }
+            detail::for_each_band(src_view.height(), threads,
+                                  detail::row_filters_band<iterator>(src_view, itr, run_end));
+            itr = run_end;
+        }
+        else
+        {
+            boost::apply_visitor(visitor, *itr);
+            ++itr;
+        }
+    }
+}
+
 }}
 
 #endif // MAPNIK_IMAGE_FILTER_HPP
@@ -94,6 +94,18 @@ MAPNIK_DECL std::string save_to_string(T const& image,
                                        std::string const& type,
                                        rgba_palette const& palette);
 
+// encode into a caller supplied buffer, appending to its current contents
+template <typename T>
+MAPNIK_DECL void save_to_buffer(T const& image,
+                                std::string const& type,
+                                std::string & buffer);
+
+template <typename T>
+MAPNIK_DECL void save_to_buffer(T const& image,
+                                std::string const& type,
+                                rgba_palette const& palette,
+                                std::string & buffer);
+
 template <typename T>
 void save_as_png(T const& image,
                  std::string const& filename,
@@ -212,6 +224,15 @@ MAPNIK_DECL std::string save_to_string(image_32 const& image,
                                        std::string const& type,
                                        rgba_palette const& palette);
 
+MAPNIK_DECL void save_to_buffer(image_32 const& image,
+                                std::string const& type,
+                                std::string & buffer);
+
+MAPNIK_DECL void save_to_buffer(image_32 const& image,
+                                std::string const& type,
+                                rgba_palette const& palette,
+                                std::string & buffer);
+
 ///////////////////////////////////////////////////////////////////////////
 
 #ifdef _MSC_VER
@@ -259,6 +280,14 @@ template MAPNIK_DECL std::string save_to_string<image_view<image_data_32> > (ima
 template MAPNIK_DECL std::string save_to_string<image_view<image_data_32> > (image_view<image_data_32> const&,
                                                                              std::string const&,
                                                                              rgba_palette const&);
+
+template MAPNIK_DECL void save_to_buffer<image_data_32>(image_data_32 const&,
+                                                        std::string const&,
+                                                        std::string &);
+
+template MAPNIK_DECL void save_to_buffer<image_view<image_data_32> > (image_view<image_data_32> const&,
+                                                                      std::string const&,
+                                                                      std::string &);
 #endif
 
 }
@@ -62,6 +62,20 @@ private:
     label_placements labels_;
 };
 
+// predicate for quad_tree::any_in_box over plain boxes
+struct intersects_box
+{
+    explicit intersects_box(box2d<double> const& box)
+        : box_(box) {}
+
+    bool operator() (box2d<double> const& other) const
+    {
+        return other.intersects(box_);
+    }
+
+    box2d<double> const& box_;
+};
+
 // quad_tree based label collision detector
 class label_collision_detector2 : boost::noncopyable
 {
@@ -74,15 +88,9 @@ public:
 
     bool has_placement(box2d<double> const& box)
     {
-        tree_t::query_iterator itr = tree_.query_in_box(box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for ( ;itr != end; ++itr)
+        if (tree_.any_in_box(box, intersects_box(box)))
         {
-            if (itr->intersects(box))
-            {
-                return false;
-            }
+            return false;
         }
 
         tree_.insert(box,box);
@@ -108,18 +116,7 @@ public:
 
     bool has_placement(box2d<double> const& box)
     {
-        tree_t::query_iterator itr = tree_.query_in_box(box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for ( ;itr != end; ++itr)
-        {
-            if (itr->intersects(box))
-            {
-                return false;
-            }
-        }
-
-        return true;
+        return !tree_.any_in_box(box, intersects_box(box));
     }
 
     void insert(box2d<double> const& box)
@@ -151,6 +148,37 @@ private:
     typedef quad_tree< label > tree_t;
     tree_t tree_;
 
+    struct label_intersects
+    {
+        explicit label_intersects(box2d<double> const& box)
+            : box_(box) {}
+
+        bool operator() (label const& lbl) const
+        {
+            return lbl.box.intersects(box_);
+        }
+
+        box2d<double> const& box_;
+    };
+
+    // collides with box, or repeats text within the distance margin
+    struct label_too_close
+    {
+        label_too_close(box2d<double> const& box, box2d<double> const& bigger_box, UnicodeString const& text)
+            : box_(box),
+              bigger_box_(bigger_box),
+              text_(text) {}
+
+        bool operator() (label const& lbl) const
+        {
+            return lbl.box.intersects(box_) || (text_ == lbl.text && lbl.box.intersects(bigger_box_));
+        }
+
+        box2d<double> const& box_;
+        box2d<double> const& bigger_box_;
+        UnicodeString const& text_;
+    };
+
 public:
     typedef tree_t::query_iterator query_iterator;
 
@@ -159,52 +187,19 @@ public:
 
     bool has_placement(box2d<double> const& box)
     {
-        tree_t::query_iterator itr = tree_.query_in_box(box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for ( ;itr != end; ++itr)
-        {
-            if (itr->box.intersects(box))
-            {
-                return false;
-            }
-        }
-
-        return true;
+        return !tree_.any_in_box(box, label_intersects(box));
     }
 
     bool has_placement(box2d<double> const& box, UnicodeString const& text, double distance)
     {
         box2d<double> bigger_box(box.minx() - distance, box.miny() - distance, box.maxx() + distance, box.maxy() + distance);
-        tree_t::query_iterator itr = tree_.query_in_box(bigger_box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for ( ;itr != end; ++itr)
-        {
-            if (itr->box.intersects(box) || (text == itr->text && itr->box.intersects(bigger_box)))
-            {
-                return false;
-            }
-        }
-
-        return true;
+        return !tree_.any_in_box(bigger_box, label_too_close(box, bigger_box, text));
     }
 
     bool has_point_placement(box2d<double> const& box, double distance)
     {
         box2d<double> bigger_box(box.minx() - distance, box.miny() - distance, box.maxx() + distance, box.maxy() + distance);
-        tree_t::query_iterator itr = tree_.query_in_box(bigger_box);
-        tree_t::query_iterator end = tree_.query_end();
-
-        for ( ;itr != end; ++itr)
-        {
-            if (itr->box.intersects(bigger_box))
-            {
-                return false;
-            }
-        }
-
-        return true;
+        return !tree_.any_in_box(bigger_box, label_intersects(bigger_box));
     }
 
     void insert(box2d<double> const& box)
@@ -26,12 +26,23 @@
 // mapnik
 #include <mapnik/feature.hpp>
 #include <mapnik/datasource.hpp>
+#include <mapnik/enumeration.hpp>
 
 // stl
 #include <vector>
 
 namespace mapnik
 {
+
+enum reprojection_cache_enum {
+    REPROJECTION_CACHE_NONE,
+    REPROJECTION_CACHE_MEMORY,
+    REPROJECTION_CACHE_FILE,
+    reprojection_cache_enum_MAX
+};
+
+DEFINE_ENUM( reprojection_cache_e, reprojection_cache_enum );
+
 /*!
  * @brief A Mapnik map layer.
  *
@@ -163,6 +174,18 @@ public:
      */
     bool cache_features() const;
 
+    /*!
+     * @param mode Set whether geometries of this layer's (file based, static)
+     *        datasource are kept reprojected to the map srs, in memory or in
+     *        a memory mapped sidecar file next to the data.
+     */
+    void set_reprojection_cache(reprojection_cache_e mode);
+
+    /*!
+     * @return where reprojected geometries of this layer are cached.
+     */
+    reprojection_cache_e reprojection_cache() const;
+
     /*!
      * @param group_by Set the field rendering of this layer is grouped by.
      */
@@ -208,6 +231,7 @@ private:
     bool queryable_;
     bool clear_label_cache_;
     bool cache_features_;
+    reprojection_cache_e reprojection_cache_;
     std::string group_by_;
     std::vector<std::string> styles_;
     datasource_ptr ds_;
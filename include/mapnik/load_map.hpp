@@ -34,6 +34,11 @@ namespace mapnik
 {
 MAPNIK_DECL void load_map(Map & map, std::string const& filename, bool strict = false);
 MAPNIK_DECL void load_map_string(Map & map, std::string const& str, bool strict = false, std::string base_path="");
+/** Like load_map, but reads the parsed XML tree from cache_filename when it was
+ * written by the same mapnik version and neither filename nor any file it includes
+ * changed since, and (re)writes it after parsing the XML otherwise. Only the XML
+ * parse is skipped, the map objects are built from the tree as usual. */
+MAPNIK_DECL void load_map_cached(Map & map, std::string const& filename, std::string const& cache_filename, bool strict = false);
 }
 
 #endif // MAPNIK_LOAD_MAP_HPP
@@ -49,6 +49,8 @@ struct MAPNIK_DECL mapped_memory_cache :
     boost::unordered_map<std::string,mapped_region_ptr> cache_;
     bool insert(std::string const& key, mapped_region_ptr);
     boost::optional<mapped_region_ptr> find(std::string const& key, bool update_cache = false);
+    // forgets key, so that the next find maps the file again
+    bool remove(std::string const& key);
     void clear();
 };
 
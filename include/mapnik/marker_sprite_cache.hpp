@@ -0,0 +1,121 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_MARKER_SPRITE_CACHE_HPP
+#define MAPNIK_MARKER_SPRITE_CACHE_HPP
+
+// mapnik
+#include <mapnik/utils.hpp>
+#include <mapnik/config.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/marker.hpp>
+
+// boost
+#include <boost/utility.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+
+// agg
+#include "agg_trans_affine.h"
+
+// stl
+#include <list>
+#include <string>
+
+namespace mapnik
+{
+
+// A vector marker rasterized once into a premultiplied bitmap. The marker
+// anchor sits at pixel (-x, -y) of image, so the sprite for an anchor at
+// pos is composited at (round(pos.x) + x, round(pos.y) + y).
+struct marker_sprite
+{
+    marker_sprite(unsigned width, unsigned height, int x_, int y_)
+        : image(width, height),
+          x(x_),
+          y(y_) {}
+    image_data_32 image;
+    int x;
+    int y;
+};
+
+typedef boost::shared_ptr<marker_sprite> marker_sprite_ptr;
+
+// Process wide cache of rasterized vector markers, keyed by marker uri,
+// style overrides and the marker transform. Rotation is quantized to
+// rotation_step degrees and placement snapped to whole pixels, so icons
+// repeated across a tile (POIs, arrows along lines) are rasterized once and
+// then only blitted. Sprites are dropped least recently used first once
+// their pixels exceed max_bytes().
+class MAPNIK_DECL marker_sprite_cache :
+        public singleton <marker_sprite_cache, CreateUsingNew>,
+        private boost::noncopyable
+{
+    friend class CreateUsingNew<marker_sprite_cache>;
+public:
+    struct stats
+    {
+        std::size_t hits;
+        std::size_t misses;
+        std::size_t entries;
+        std::size_t bytes;
+        std::size_t evictions;
+    };
+
+    static const double rotation_step;
+
+    // The sprite of vector marker mark drawn with mtx, which must already
+    // center the marker on 0,0 (translation is kept, as is any image
+    // transform). attributes overrides the marker's own svg attributes and
+    // style_key must then identify them. Returns nothing for non vector
+    // markers, which callers render directly. Sprites larger than the
+    // cache itself are rasterized and returned without being kept.
+    marker_sprite_ptr get(std::string const& uri,
+                          marker const& mark,
+                          agg::trans_affine const& mtx,
+                          attr_storage const* attributes = 0,
+                          std::string const& style_key = std::string());
+
+    // 0 disables caching
+    void set_max_bytes(std::size_t max_bytes);
+    std::size_t max_bytes() const;
+    stats get_stats() const;
+    void clear();
+
+private:
+    marker_sprite_cache();
+    ~marker_sprite_cache();
+
+    typedef std::list<std::string> order_type;
+    typedef boost::unordered_map<std::string, std::pair<marker_sprite_ptr, order_type::iterator> > map_type;
+
+    void trim(std::size_t max_bytes);
+
+    map_type sprites_;
+    order_type order_;
+    std::size_t max_bytes_;
+    stats stats_;
+};
+
+}
+
+#endif // MAPNIK_MARKER_SPRITE_CACHE_HPP
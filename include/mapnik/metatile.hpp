@@ -0,0 +1,82 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+#ifndef MAPNIK_METATILE_HPP
+#define MAPNIK_METATILE_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+#include <mapnik/graphics.hpp>
+#include <mapnik/image_data.hpp>
+#include <mapnik/image_view.hpp>
+#include <mapnik/palette.hpp>
+
+// boost
+#include <boost/utility.hpp>
+
+// stl
+#include <string>
+#include <vector>
+
+namespace mapnik {
+
+class Map;
+
+// Renders a tiles x tiles metatile in a single pass, so that label placement
+// and collision detection see the whole area, and slices the result into
+// tile_size x tile_size subtiles which are all encoded in one go.
+//
+// The Map passed to render() must be sized to tiles * tile_size pixels and
+// zoomed to the metatile extent. Subtiles are stored row-major, and encoded
+// buffers are kept between calls so that a renderer reused across metatiles
+// does not reallocate them.
+class MAPNIK_DECL metatile_renderer : private boost::noncopyable
+{
+public:
+    metatile_renderer(unsigned tiles, unsigned tile_size);
+
+    unsigned tiles() const { return tiles_; }
+    unsigned tile_size() const { return tile_size_; }
+    image_32 const& image() const { return image_; }
+
+    void render(Map const& map, double scale_factor = 1.0);
+
+    // subtile at column x, row y
+    image_view<image_data_32> view(unsigned x, unsigned y) const;
+
+    // paletted formats (png8/png256) are quantized once over the whole
+    // metatile so that all subtiles share the same palette
+    std::vector<std::string> const& encode(std::string const& format);
+    std::vector<std::string> const& encode(std::string const& format,
+                                           rgba_palette const& palette);
+
+private:
+    unsigned tiles_;
+    unsigned tile_size_;
+    image_32 image_;
+    std::vector<std::string> buffers_;
+};
+
+}
+
+#endif // MAPNIK_METATILE_HPP
@@ -0,0 +1,221 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_NVPR_PATH_BUFFER_HPP
+#define MAPNIK_NVPR_PATH_BUFFER_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/nvpr_init.hpp>
+
+// boost
+#include <boost/utility.hpp>
+
+// agg
+#include "agg_basics.h"
+
+// stl
+#include <algorithm>
+#include <vector>
+
+namespace mapnik {
+
+// Path commands and coordinates in the layout glPathCommandsNV takes.
+// A renderer keeps one buffer and refills it for every path, so the
+// storage only grows while paths get bigger than any seen before and
+// extracting a path does not allocate after that.
+//
+// The buffer can also hold a run of paths back to back, one for each
+// feature of a rule batch, so they can be specified as consecutive path
+// objects from a single stream and drawn with one instanced stencil and
+// cover call.
+class nvpr_path_buffer : private boost::noncopyable
+{
+public:
+    // where one path of the stream lives
+    struct span
+    {
+        GLsizei first_command;
+        GLsizei num_commands;
+        GLsizei first_coord;
+        GLsizei num_coords;
+        box2d<double> bounds;
+    };
+
+    nvpr_path_buffer()
+        : num_commands_(0),
+          num_coords_(0)
+    {
+        reserve(0);
+    }
+
+    // Replaces the contents with the path. Move and line vertices become
+    // GL_MOVE_TO_NV and GL_LINE_TO_NV, closing a polygon after a line
+    // becomes GL_CLOSE_PATH_NV, other commands are dropped. size is an
+    // upper bound on the vertices path yields, like total_vertices().
+    template <typename VertexSource>
+    void assign(VertexSource & path, unsigned size)
+    {
+        clear();
+        append(path, size);
+    }
+
+    // Adds the path after the ones already in the buffer, converted as
+    // for assign(). Paths without any vertices are skipped.
+    template <typename VertexSource>
+    void append(VertexSource & path, unsigned size)
+    {
+        reserve(size);
+        span s;
+        s.first_command = num_commands_;
+        s.first_coord = num_coords_;
+
+        bool first = true;
+        unsigned status = agg::path_cmd_stop;
+        double x = 0, y = 0;
+        unsigned cmd;
+        while (!agg::is_stop(cmd = path.vertex(&x, &y)))
+        {
+            if (agg::is_end_poly(cmd))
+            {
+                if (agg::is_closed(cmd) && status == agg::path_cmd_line_to)
+                {
+                    commands_[num_commands_++] = GL_CLOSE_PATH_NV;
+                    status = cmd;
+                }
+                continue;
+            }
+            if (cmd == agg::path_cmd_move_to)
+            {
+                commands_[num_commands_++] = GL_MOVE_TO_NV;
+            }
+            else if (cmd == agg::path_cmd_line_to)
+            {
+                commands_[num_commands_++] = GL_LINE_TO_NV;
+            }
+            else
+            {
+                continue;
+            }
+            status = cmd;
+            coords_[num_coords_++] = static_cast<GLfloat>(x);
+            coords_[num_coords_++] = static_cast<GLfloat>(y);
+            if (first)
+            {
+                s.bounds.init(x, y, x, y);
+                first = false;
+            }
+            else
+            {
+                s.bounds.expand_to_include(x, y);
+            }
+        }
+        add_span(s);
+    }
+
+    // Adds a closed rectangle, the quad a marker image is drawn into.
+    void append(box2d<double> const& box)
+    {
+        reserve(5);
+        span s;
+        s.first_command = num_commands_;
+        s.first_coord = num_coords_;
+        s.bounds = box;
+        add_vertex(GL_MOVE_TO_NV, box.minx(), box.miny());
+        add_vertex(GL_LINE_TO_NV, box.maxx(), box.miny());
+        add_vertex(GL_LINE_TO_NV, box.maxx(), box.maxy());
+        add_vertex(GL_LINE_TO_NV, box.minx(), box.maxy());
+        commands_[num_commands_++] = GL_CLOSE_PATH_NV;
+        add_span(s);
+    }
+
+    // empties the buffer, keeping its storage
+    void clear()
+    {
+        num_commands_ = 0;
+        num_coords_ = 0;
+        bounds_.init(0, 0, 0, 0);
+        paths_.clear();
+    }
+
+    // makes room for size more vertices
+    void reserve(unsigned size)
+    {
+        std::size_t needed = num_commands_ + size + 1;
+        if (commands_.size() < needed)
+        {
+            needed = std::max(needed, 2 * commands_.size());
+            commands_.resize(needed);
+            coords_.resize(2 * needed);
+        }
+    }
+
+    GLsizei num_commands() const { return num_commands_; }
+    GLubyte const* commands() const { return &commands_[0]; }
+    // the number of coordinates, two for each vertex
+    GLsizei num_coords() const { return num_coords_; }
+    GLfloat const* coords() const { return &coords_[0]; }
+    // the extent of all the vertices, all zero for an empty buffer
+    box2d<double> const& bounds() const { return bounds_; }
+    // how many vertices fit without growing
+    std::size_t capacity() const { return commands_.size(); }
+
+    // the number of paths in the stream and where each one lives
+    std::size_t size() const { return paths_.size(); }
+    bool empty() const { return paths_.empty(); }
+    span const& path(std::size_t index) const { return paths_[index]; }
+
+private:
+    void add_vertex(GLubyte cmd, double x, double y)
+    {
+        commands_[num_commands_++] = cmd;
+        coords_[num_coords_++] = static_cast<GLfloat>(x);
+        coords_[num_coords_++] = static_cast<GLfloat>(y);
+    }
+
+    void add_span(span & s)
+    {
+        s.num_commands = num_commands_ - s.first_command;
+        s.num_coords = num_coords_ - s.first_coord;
+        if (s.num_commands == 0) return;
+        if (paths_.empty())
+        {
+            bounds_ = s.bounds;
+        }
+        else
+        {
+            bounds_.expand_to_include(s.bounds);
+        }
+        paths_.push_back(s);
+    }
+
+    std::vector<GLubyte> commands_;
+    std::vector<GLfloat> coords_;
+    GLsizei num_commands_;
+    GLsizei num_coords_;
+    box2d<double> bounds_;
+    std::vector<span> paths_;
+};
+
+}
+
+#endif // MAPNIK_NVPR_PATH_BUFFER_HPP
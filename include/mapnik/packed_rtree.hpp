@@ -0,0 +1,199 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_PACKED_RTREE_HPP
+#define MAPNIK_PACKED_RTREE_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+
+// boost
+#include <boost/cstdint.hpp>
+
+// stl
+#include <vector>
+#include <algorithm>
+#include <cmath>
+
+namespace mapnik
+{
+
+// A leaf holds the box and value of an item, an inner node the union of
+// its children and the position of the first of them.
+struct packed_rtree_node
+{
+    double minx;
+    double miny;
+    double maxx;
+    double maxy;
+    boost::uint64_t value;
+};
+
+// Static R-tree, bulk loaded with Sort-Tile-Recursive packing. Nodes live in
+// one flat array, leaves first and the root last, and refer to each other by
+// position, so the array can be written out as is and queried straight from
+// a memory mapped file. The layout follows from the leaf count and node size
+// alone.
+class packed_rtree
+{
+public:
+    typedef packed_rtree_node node;
+
+    packed_rtree(node const* nodes, std::size_t leaf_count, unsigned node_size)
+        : nodes_(nodes),
+          node_size_(node_size)
+    {
+        level_bounds(leaf_count, node_size, levels_);
+    }
+
+    // Packs items (leaves, in any order) and appends the inner levels.
+    static void build(std::vector<node> & items, unsigned node_size)
+    {
+        std::size_t leaf_count = items.size();
+        if (leaf_count == 0) return;
+        str_sort(items.begin(), items.end(), node_size);
+        std::vector<std::size_t> levels;
+        level_bounds(leaf_count, node_size, levels);
+        items.reserve(levels.back());
+        for (std::size_t level = 0; level + 2 < levels.size(); ++level)
+        {
+            for (std::size_t first = levels[level]; first < levels[level + 1]; first += node_size)
+            {
+                std::size_t last = std::min<std::size_t>(first + node_size, levels[level + 1]);
+                node parent = items[first];
+                for (std::size_t i = first + 1; i < last; ++i)
+                {
+                    parent.minx = std::min(parent.minx, items[i].minx);
+                    parent.miny = std::min(parent.miny, items[i].miny);
+                    parent.maxx = std::max(parent.maxx, items[i].maxx);
+                    parent.maxy = std::max(parent.maxy, items[i].maxy);
+                }
+                parent.value = first;
+                items.push_back(parent);
+            }
+        }
+    }
+
+    // Orders items as build packs them, for loading them one at a time into
+    // an index that is not packed (such as an sqlite rtree).
+    static void str_order(std::vector<node> & items, unsigned node_size)
+    {
+        str_sort(items.begin(), items.end(), node_size);
+    }
+
+    static std::size_t node_count(std::size_t leaf_count, unsigned node_size)
+    {
+        std::vector<std::size_t> levels;
+        level_bounds(leaf_count, node_size, levels);
+        return levels.back();
+    }
+
+    // calls visitor(value) for every leaf intersecting box
+    template <typename Visitor>
+    void query(box2d<double> const& box, Visitor & visitor) const
+    {
+        if (levels_.back() == 0) return;
+        std::vector<std::pair<std::size_t, std::size_t> > stack; // node, level
+        stack.push_back(std::make_pair(levels_.back() - 1, levels_.size() - 2));
+        while (!stack.empty())
+        {
+            std::size_t index = stack.back().first;
+            std::size_t level = stack.back().second;
+            stack.pop_back();
+            node const& n = nodes_[index];
+            if (n.maxx < box.minx() || n.minx > box.maxx() ||
+                n.maxy < box.miny() || n.miny > box.maxy())
+            {
+                continue;
+            }
+            if (level == 0)
+            {
+                visitor(n.value);
+            }
+            else
+            {
+                std::size_t first = static_cast<std::size_t>(n.value);
+                std::size_t last = std::min<std::size_t>(first + node_size_, levels_[level]);
+                for (std::size_t child = last; child > first; --child)
+                {
+                    stack.push_back(std::make_pair(child - 1, level - 1));
+                }
+            }
+        }
+    }
+
+private:
+    // start of each level in the flat array, with the total node count last
+    static void level_bounds(std::size_t leaf_count, unsigned node_size, std::vector<std::size_t> & levels)
+    {
+        levels.clear();
+        levels.push_back(0);
+        std::size_t count = leaf_count;
+        std::size_t total = 0;
+        for (;;)
+        {
+            total += count;
+            levels.push_back(total);
+            if (count <= 1) break;
+            count = (count + node_size - 1) / node_size;
+        }
+    }
+
+    struct less_x
+    {
+        bool operator()(node const& a, node const& b) const
+        {
+            return a.minx + a.maxx < b.minx + b.maxx;
+        }
+    };
+
+    struct less_y
+    {
+        bool operator()(node const& a, node const& b) const
+        {
+            return a.miny + a.maxy < b.miny + b.maxy;
+        }
+    };
+
+    // sorts by x into vertical slices, then each slice by y
+    template <typename Iterator>
+    static void str_sort(Iterator begin, Iterator end, unsigned node_size)
+    {
+        std::size_t count = end - begin;
+        std::size_t leaf_nodes = (count + node_size - 1) / node_size;
+        std::size_t slices = static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(leaf_nodes))));
+        std::size_t slice_size = slices * node_size;
+        std::sort(begin, end, less_x());
+        for (std::size_t first = 0; first < count; first += slice_size)
+        {
+            std::sort(begin + first, begin + std::min(first + slice_size, count), less_y());
+        }
+    }
+
+    node const* nodes_;
+    unsigned node_size_;
+    std::vector<std::size_t> levels_;
+};
+
+}
+
+#endif // MAPNIK_PACKED_RTREE_HPP
@@ -93,7 +93,8 @@ public:
 private:
     ///Helpers for find_line_placement
 
-    ///Returns a possible placement on the given line, does not test for collisions
+    ///Computes a possible placement on the given line into current_placement, does not test for collisions
+    //path_offsets: cumulative distance from the first node to node x, used to locate the start by binary search
     //index: index of the node the current line ends on
     //distance: distance along the given index that the placement should start at, this includes the offset,
     //          as such it may be > or < the length of the current line, so this must be checked for
@@ -101,14 +102,18 @@ private:
     //             otherwise it will autodetect the orientation.
     //             If >= 50% of the characters end up upside down, it will be retried the other way.
     //             RETURN: 1/-1 depending which way up the string ends up being.
-    std::auto_ptr<text_path> get_placement_offset(std::vector<vertex2d> const& path_positions,
-                                                  std::vector<double> const& path_distances,
-                                                  int & orientation, unsigned index, double distance);
+    //current_placement is reset and refilled, so one text_path can be reused for all candidates.
+    //Returns false if no placement is possible at this offset.
+    bool get_placement_offset(std::vector<vertex2d> const& path_positions,
+                              std::vector<double> const& path_distances,
+                              std::vector<double> const& path_offsets,
+                              text_path & current_placement,
+                              int & orientation, unsigned index, double distance);
 
     ///Tests whether the given text_path be placed without a collision
     // Returns true if it can
     // NOTE: This edits p.envelopes so it can be used afterwards (you must clear it otherwise)
-    bool test_placement(std::auto_ptr<text_path> const& current_placement, int orientation);
+    bool test_placement(text_path const& current_placement, int orientation);
 
     ///Does a line-circle intersect calculation
     // NOTE: Follow the strict pre conditions
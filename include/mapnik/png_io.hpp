@@ -30,9 +30,20 @@
 #include <mapnik/hextree.hpp>
 #include <mapnik/miniz_png.hpp>
 #include <mapnik/image_data.hpp>
+
+// boost
+#include <boost/thread.hpp>
+#include <boost/ref.hpp>
+
 // zlib
 #include <zlib.h>
 
+// stl
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
 extern "C"
 {
 #include <png.h>
@@ -128,6 +139,243 @@ void save_as_png(T1 & file,
     png_destroy_write_struct(&png_ptr, &info_ptr);
 }
 
+// Parallel truecolor encoder (pigz style): rows are split into bands which are
+// deflated concurrently as raw streams, each primed with the last 32k of the
+// preceding band as dictionary, and then stitched into one zlib stream.
+template <typename T>
+struct png_band_encoder
+{
+    T const* image;
+    unsigned y0;
+    unsigned y1;
+    int level;
+    int strategy;
+    bool strip_alpha;
+    bool last;
+    uLong adler;
+    uLong length;
+    bool failed;
+    std::vector<unsigned char> output;
+
+    png_band_encoder(T const& _image, unsigned _y0, unsigned _y1,
+                     int _level, int _strategy, bool _strip_alpha, bool _last)
+        : image(&_image),
+          y0(_y0),
+          y1(_y1),
+          level(_level),
+          strategy(_strategy),
+          strip_alpha(_strip_alpha),
+          last(_last),
+          adler(adler32(0L, Z_NULL, 0)),
+          length(0),
+          failed(false) {}
+
+    unsigned stride() const
+    {
+        return image->width() * (strip_alpha ? 3 : 4);
+    }
+
+    // filter byte (always PNG_FILTER_NONE) followed by the row's samples
+    void scanline(unsigned y, std::vector<unsigned char> & row) const
+    {
+        unsigned const width = image->width();
+        row.resize(stride() + 1);
+        row[0] = 0;
+        unsigned char const* src = reinterpret_cast<unsigned char const*>(image->getRow(y));
+        if (strip_alpha)
+        {
+            for (unsigned i = 0, j = 1; i < width * 4; i += 4, j += 3)
+            {
+                row[j] = src[i];
+                row[j + 1] = src[i + 1];
+                row[j + 2] = src[i + 2];
+            }
+        }
+        else
+        {
+            std::memcpy(&row[1], src, width * 4);
+        }
+    }
+
+    // last (up to) 32k of uncompressed data preceding this band
+    void dictionary(std::vector<unsigned char> & dict) const
+    {
+        dict.clear();
+        if (y0 == 0) return;
+        std::vector<unsigned char> row;
+        unsigned y = y0;
+        while (y > 0 && dict.size() < 32768)
+        {
+            scanline(--y, row);
+            dict.insert(dict.begin(), row.begin(), row.end());
+        }
+        if (dict.size() > 32768)
+        {
+            dict.erase(dict.begin(), dict.end() - 32768);
+        }
+    }
+
+    void operator() ()
+    {
+        z_stream strm;
+        std::memset(&strm, 0, sizeof(strm));
+        if (deflateInit2(&strm, level, Z_DEFLATED, -15, 8, strategy) != Z_OK)
+        {
+            failed = true;
+            return;
+        }
+        std::vector<unsigned char> dict;
+        dictionary(dict);
+        if (!dict.empty())
+        {
+            deflateSetDictionary(&strm, &dict[0], dict.size());
+        }
+        uLong const raw_size = static_cast<uLong>(stride() + 1) * (y1 - y0);
+        output.resize(deflateBound(&strm, raw_size) + 16);
+        strm.next_out = &output[0];
+        strm.avail_out = output.size();
+
+        std::vector<unsigned char> row;
+        for (unsigned y = y0; y < y1 && !failed; ++y)
+        {
+            scanline(y, row);
+            adler = ::adler32(adler, &row[0], row.size());
+            length += row.size();
+            strm.next_in = &row[0];
+            strm.avail_in = row.size();
+            int flush = (y + 1 == y1) ? (last ? Z_FINISH : Z_SYNC_FLUSH) : Z_NO_FLUSH;
+            do
+            {
+                if (strm.avail_out == 0)
+                {
+                    std::size_t used = output.size();
+                    output.resize(used * 2);
+                    strm.next_out = &output[used];
+                    strm.avail_out = output.size() - used;
+                }
+                int ret = deflate(&strm, flush);
+                if (ret == Z_STREAM_ERROR)
+                {
+                    failed = true;
+                    break;
+                }
+            }
+            while (strm.avail_out == 0);
+        }
+        output.resize(output.size() - strm.avail_out);
+        deflateEnd(&strm);
+    }
+};
+
+template <typename T>
+void write_png_chunk(T & file, char const* tag, unsigned char const* data, std::size_t size)
+{
+    unsigned char header[8] = { static_cast<unsigned char>((size >> 24) & 0xff),
+                                static_cast<unsigned char>((size >> 16) & 0xff),
+                                static_cast<unsigned char>((size >> 8) & 0xff),
+                                static_cast<unsigned char>(size & 0xff),
+                                static_cast<unsigned char>(tag[0]), static_cast<unsigned char>(tag[1]),
+                                static_cast<unsigned char>(tag[2]), static_cast<unsigned char>(tag[3]) };
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, header + 4, 4);
+    if (size > 0) crc = crc32(crc, data, size);
+    unsigned char footer[4] = { static_cast<unsigned char>((crc >> 24) & 0xff),
+                                static_cast<unsigned char>((crc >> 16) & 0xff),
+                                static_cast<unsigned char>((crc >> 8) & 0xff),
+                                static_cast<unsigned char>(crc & 0xff) };
+    file.write(reinterpret_cast<char const*>(header), 8);
+    if (size > 0) file.write(reinterpret_cast<char const*>(data), size);
+    file.write(reinterpret_cast<char const*>(footer), 4);
+}
+
+template <typename T1, typename T2>
+void save_as_png_parallel(T1 & file,
+                          T2 const& image,
+                          unsigned threads,
+                          int compression = Z_DEFAULT_COMPRESSION,
+                          int strategy = Z_DEFAULT_STRATEGY,
+                          int trans_mode = -1)
+{
+    unsigned const width = image.width();
+    unsigned const height = image.height();
+    unsigned bands = std::min(std::max(threads, 1u), height);
+    bool strip_alpha = (trans_mode == 0);
+
+    std::vector<png_band_encoder<T2> > encoders;
+    encoders.reserve(bands);
+    for (unsigned i = 0; i < bands; ++i)
+    {
+        unsigned y0 = static_cast<unsigned>((static_cast<unsigned long long>(height) * i) / bands);
+        unsigned y1 = static_cast<unsigned>((static_cast<unsigned long long>(height) * (i + 1)) / bands);
+        encoders.push_back(png_band_encoder<T2>(image, y0, y1, compression, strategy,
+                                                strip_alpha, i + 1 == bands));
+    }
+    boost::thread_group group;
+    std::vector<boost::thread*> workers;
+    workers.reserve(bands);
+    for (unsigned i = 0; i < bands; ++i)
+    {
+        workers.push_back(group.create_thread(boost::ref(encoders[i])));
+    }
+
+    static unsigned char const signature[8] = { 0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a };
+    file.write(reinterpret_cast<char const*>(signature), 8);
+    unsigned char ihdr[13] = { static_cast<unsigned char>((width >> 24) & 0xff),
+                               static_cast<unsigned char>((width >> 16) & 0xff),
+                               static_cast<unsigned char>((width >> 8) & 0xff),
+                               static_cast<unsigned char>(width & 0xff),
+                               static_cast<unsigned char>((height >> 24) & 0xff),
+                               static_cast<unsigned char>((height >> 16) & 0xff),
+                               static_cast<unsigned char>((height >> 8) & 0xff),
+                               static_cast<unsigned char>(height & 0xff),
+                               8, // bit depth
+                               static_cast<unsigned char>(strip_alpha ? 2 : 6), // color type
+                               0, 0, 0 };
+    write_png_chunk(file, "IHDR", ihdr, 13);
+
+    // zlib header: deflate with 32k window, FLEVEL derived from compression level
+    unsigned flevel = (compression == Z_DEFAULT_COMPRESSION || compression == 6) ? 2
+        : (compression < 2) ? 0 : (compression < 6) ? 1 : 3;
+    unsigned cmf_flg = (0x78 << 8) | (flevel << 6);
+    cmf_flg += 31 - (cmf_flg % 31);
+
+    // each band becomes its own IDAT chunk, written as soon as it is ready
+    uLong adler = adler32(0L, Z_NULL, 0);
+    bool failed = false;
+    for (unsigned i = 0; i < bands; ++i)
+    {
+        workers[i]->join();
+        png_band_encoder<T2> & band = encoders[i];
+        if (failed || band.failed)
+        {
+            failed = true;
+            continue;
+        }
+        std::vector<unsigned char> & data = band.output;
+        if (i == 0)
+        {
+            unsigned char zheader[2] = { static_cast<unsigned char>(cmf_flg >> 8),
+                                         static_cast<unsigned char>(cmf_flg & 0xff) };
+            data.insert(data.begin(), zheader, zheader + 2);
+        }
+        adler = adler32_combine(adler, band.adler, band.length);
+        if (band.last)
+        {
+            data.push_back(static_cast<unsigned char>((adler >> 24) & 0xff));
+            data.push_back(static_cast<unsigned char>((adler >> 16) & 0xff));
+            data.push_back(static_cast<unsigned char>((adler >> 8) & 0xff));
+            data.push_back(static_cast<unsigned char>(adler & 0xff));
+        }
+        write_png_chunk(file, "IDAT", data.empty() ? 0 : &data[0], data.size());
+        std::vector<unsigned char>().swap(data);
+    }
+    if (failed)
+    {
+        throw std::runtime_error("failed to compress image");
+    }
+    write_png_chunk(file, "IEND", 0, 0);
+}
+
 template <typename T>
 void reduce_8(T const& in,
               image_data_8 & out,
@@ -26,6 +26,7 @@
 // mapnik
 #include <mapnik/projection.hpp>
 #include <mapnik/box2d.hpp>
+#include <mapnik/geometry.hpp>
 
 // boost
 #include <boost/utility.hpp>
@@ -41,8 +42,14 @@ public:
     bool equal() const;
     bool forward (double& x, double& y , double& z) const;
     bool backward (double& x, double& y , double& z) const;
-    bool forward (double *x, double *y , double *z, int point_count) const;
-    bool backward (double *x, double *y , double *z, int point_count) const;
+    // x, y and z (which may be null) hold point_count values, offset
+    // doubles apart
+    bool forward (double *x, double *y , double *z, int point_count, int offset = 1) const;
+    bool backward (double *x, double *y , double *z, int point_count, int offset = 1) const;
+    // reprojects every vertex of geom in place, one storage block per call;
+    // on failure geom is left partially transformed
+    bool forward (geometry_type & geom) const;
+    bool backward (geometry_type & geom) const;
     bool forward (box2d<double> & box) const;
     bool backward (box2d<double> & box) const;
     bool forward (box2d<double> & box, int points) const;
@@ -57,6 +64,7 @@ private:
     bool is_dest_longlat_;
     bool is_source_equal_dest_;
     bool wgs84_to_merc_;
+    bool merc_to_wgs84_;
 };
 }
 
@@ -52,6 +52,7 @@ public:
 class MAPNIK_DECL projection
 {
     friend class proj_transform;
+    friend class proj_cache;
 public:
     explicit projection(std::string const& params = "+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs");
     projection(projection const& rhs);
@@ -72,14 +73,13 @@ public:
 private:
     void init();
     void swap (projection& rhs);
+    // the calling thread's proj4 handle for params_
+    projPJ proj() const;
 
 private:
     std::string params_;
-    projPJ proj_;
     bool is_geographic_;
-#if PJ_VERSION >= 480
-    projCtx proj_ctx_;
-#elif defined(MAPNIK_THREADSAFE)
+#if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
     static boost::mutex mutex_;
 #endif
 };
@@ -32,59 +32,51 @@
 
 // stl
 #include <vector>
-#include <cstring>
 
 namespace mapnik
 {
+
+// Flat quad tree: nodes and items live in two contiguous arenas and refer
+// to each other by index, so inserting never allocates once the arenas have
+// grown and clear() keeps their capacity for reuse across tiles.
 template <typename T>
 class quad_tree : boost::noncopyable
 {
+    static const unsigned npos = static_cast<unsigned>(-1);
+
     struct node
     {
-        typedef T value_t;
-        typedef std::vector<T> cont_t;
-        typedef typename cont_t::iterator iterator;
-        typedef typename cont_t::const_iterator const_iterator;
         box2d<double> extent_;
-        cont_t cont_;
-        node * children_[4];
+        unsigned children_[4];
+        unsigned first_;
+        unsigned last_;
 
         explicit node(box2d<double> const& ext)
-            : extent_(ext)
+            : extent_(ext),
+              first_(npos),
+              last_(npos)
         {
-            std::memset(children_,0,4*sizeof(node*));
+            children_[0] = children_[1] = children_[2] = children_[3] = npos;
         }
 
         box2d<double> const& extent() const
         {
             return extent_;
         }
+    };
 
-        iterator begin()
-        {
-            return cont_.begin();
-        }
-
-        const_iterator begin() const
-        {
-            return cont_.begin();
-        }
-
-        iterator end()
-        {
-            return cont_.end();
-        }
+    struct item
+    {
+        T data_;
+        unsigned next_;
 
-        const_iterator end() const
-        {
-            return cont_.end();
-        }
-        ~node () {}
+        item(T const& data)
+            : data_(data),
+              next_(npos) {}
     };
 
-    typedef boost::ptr_vector<node> nodes_t;
-    typedef typename node::cont_t cont_t;
-    typedef typename cont_t::iterator node_data_iterator;
+    typedef std::vector<node> nodes_t;
+    typedef std::vector<item> items_t;
 
 public:
     typedef typename nodes_t::iterator iterator;
@@ -99,22 +91,23 @@ public:
         : max_depth_(max_depth),
           ratio_(ratio),
           query_result_(),
-          nodes_()
+          nodes_(),
+          items_()
     {
-        nodes_.push_back(new node(ext));
-        root_ = &nodes_[0];
+        nodes_.push_back(node(ext));
     }
 
     void insert(T data, box2d<double> const& box)
     {
         unsigned int depth=0;
-        do_insert_data(data,box,root_,depth);
+        do_insert_data(data,box,0,depth);
     }
 
+    // materializes all items of the nodes intersecting box
     query_iterator query_in_box(box2d<double> const& box)
     {
         query_result_.clear();
-        query_node(box,query_result_,root_);
+        query_node(box,query_result_,0);
         return query_result_.begin();
     }
 
@@ -123,6 +116,14 @@ public:
         return query_result_.end();
     }
 
+    // true as soon as pred(item) holds for an item of a node intersecting
+    // box, without collecting results
+    template <typename Predicate>
+    bool any_in_box(box2d<double> const& box, Predicate const& pred) const
+    {
+        return any_in_node(box,pred,0);
+    }
+
     const_iterator begin() const
     {
         return nodes_.begin();
@@ -136,66 +137,106 @@ public:
 
     void clear ()
     {
-        box2d<double> ext = root_->extent_;
+        box2d<double> ext = nodes_[0].extent_;
         nodes_.clear();
-        nodes_.push_back(new node(ext));
-        root_ = &nodes_[0];
+        items_.clear();
+        query_result_.clear();
+        nodes_.push_back(node(ext));
     }
 
     box2d<double> const& extent() const
     {
-        return root_->extent_;
+        return nodes_[0].extent_;
     }
 
 private:
 
-    void query_node(box2d<double> const& box, result_t & result, node * node_) const
+    void query_node(box2d<double> const& box, result_t & result, unsigned index)
     {
-        if (node_)
+        node const& n = nodes_[index];
+        if (box.intersects(n.extent()))
         {
-            box2d<double> const& node_extent = node_->extent();
-            if (box.intersects(node_extent))
+            for (unsigned i = n.first_; i != npos; i = items_[i].next_)
             {
-                node_data_iterator i=node_->begin();
-                node_data_iterator end=node_->end();
-                while ( i!=end)
-                {
-                    result.push_back(&(*i));
-                    ++i;
-                }
-                for (int k = 0; k < 4; ++k)
+                result.push_back(&items_[i].data_);
+            }
+            for (int k = 0; k < 4; ++k)
+            {
+                if (n.children_[k] != npos)
                 {
-                    query_node(box,result,node_->children_[k]);
+                    query_node(box,result,n.children_[k]);
                 }
             }
         }
     }
 
-    void do_insert_data(T data, box2d<double> const& box, node * n, unsigned int& depth)
+    template <typename Predicate>
+    bool any_in_node(box2d<double> const& box, Predicate const& pred, unsigned index) const
+    {
+        node const& n = nodes_[index];
+        if (!box.intersects(n.extent()))
+        {
+            return false;
+        }
+        for (unsigned i = n.first_; i != npos; i = items_[i].next_)
+        {
+            if (pred(items_[i].data_))
+            {
+                return true;
+            }
+        }
+        for (int k = 0; k < 4; ++k)
+        {
+            if (n.children_[k] != npos && any_in_node(box,pred,n.children_[k]))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void append_item(T const& data, unsigned index)
+    {
+        unsigned pos = items_.size();
+        items_.push_back(item(data));
+        node & n = nodes_[index];
+        if (n.last_ == npos)
+        {
+            n.first_ = pos;
+        }
+        else
+        {
+            items_[n.last_].next_ = pos;
+        }
+        n.last_ = pos;
+    }
+
+    void do_insert_data(T const& data, box2d<double> const& box, unsigned index, unsigned int& depth)
     {
         if (++depth >= max_depth_)
         {
-            n->cont_.push_back(data);
+            append_item(data,index);
         }
         else
         {
-            box2d<double> const& node_extent = n->extent();
             box2d<double> ext[4];
-            split_box(node_extent,ext);
+            split_box(nodes_[index].extent(),ext);
             for (int i=0;i<4;++i)
             {
                 if (ext[i].contains(box))
                 {
-                    if (!n->children_[i])
+                    unsigned child = nodes_[index].children_[i];
+                    if (child == npos)
                     {
-                        nodes_.push_back(new node(ext[i]));
-                        n->children_[i]=&nodes_.back();
+                        child = nodes_.size();
+                        nodes_.push_back(node(ext[i]));
+                        nodes_[index].children_[i] = child;
                     }
-                    do_insert_data(data,box,n->children_[i],depth);
+                    do_insert_data(data,box,child,depth);
                     return;
                 }
             }
-            n->cont_.push_back(data);
+            append_item(data,index);
         }
     }
 
@@ -221,9 +262,12 @@ private:
     const double ratio_;
     result_t query_result_;
     nodes_t nodes_;
-    node * root_;
-
+    items_t items_;
 };
+
+template <typename T>
+const unsigned quad_tree<T>::npos;
+
 }
 
 #endif // MAPNIK_QUAD_TREE_HPP
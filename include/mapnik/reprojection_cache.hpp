@@ -0,0 +1,140 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_REPROJECTION_CACHE_HPP
+#define MAPNIK_REPROJECTION_CACHE_HPP
+
+// mapnik
+#include <mapnik/utils.hpp>
+#include <mapnik/config.hpp>
+#include <mapnik/datasource.hpp>
+#include <mapnik/layer.hpp>
+#include <mapnik/proj_transform.hpp>
+
+// boost
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/cstdint.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/unordered_set.hpp>
+#include <boost/thread/condition_variable.hpp>
+#endif
+
+// stl
+#include <string>
+
+namespace mapnik
+{
+
+// Geometries of one file backed datasource, already reprojected from the
+// layer srs to a map srs and stored per feature id.
+class MAPNIK_DECL reprojected_geometries : private boost::noncopyable
+{
+public:
+    virtual ~reprojected_geometries() {}
+    // replaces the geometries of feature with the cached ones, returns
+    // false when the feature id is not cached
+    virtual bool restore(feature_impl & feature) const = 0;
+    // caches the (already reprojected) geometries of feature
+    virtual void store(feature_impl const& feature) = 0;
+    virtual std::size_t size() const = 0;
+};
+
+typedef boost::shared_ptr<reprojected_geometries> reprojected_geometries_ptr;
+
+// Process wide registry of reprojected geometries for layers with
+// reprojection-cache set. Memory caches fill as features are rendered.
+// File caches are built once, from every feature of the datasource, into
+// a sidecar next to the data file and memory mapped from then on. Both are
+// dropped when the size or mtime of the data file changes.
+//
+// Feature ids must be stable across queries, as they are for the
+// shape, sqlite, csv, geojson and ogr plugins.
+class MAPNIK_DECL reprojection_cache :
+        public singleton <reprojection_cache, CreateUsingNew>,
+        private boost::noncopyable
+{
+    friend class CreateUsingNew<reprojection_cache>;
+public:
+    // returns nothing when the layer does not ask for caching, needs no
+    // reprojection or its datasource is not backed by a file
+    reprojected_geometries_ptr get(layer const& lay, proj_transform const& prj_trans);
+    std::size_t size() const;
+    void clear();
+
+private:
+    reprojection_cache();
+    ~reprojection_cache();
+
+    struct entry
+    {
+        reprojected_geometries_ptr geometries;
+        boost::uint64_t size;
+        boost::int64_t mtime;
+    };
+
+    // stores e (if any) under entry_key and wakes threads waiting for it
+    void publish(std::string const& entry_key, entry const* e);
+
+    boost::unordered_map<std::string, entry> entries_;
+#ifdef MAPNIK_THREADSAFE
+    // keys some thread is building right now, guarded by mutex_
+    boost::unordered_set<std::string> building_;
+    boost::condition_variable built_;
+#endif
+};
+
+// Hands out the features of fs with their geometries in the map srs,
+// restored from geometries where possible and reprojected (and stored)
+// otherwise. Render them with an identity transform.
+class MAPNIK_DECL reprojected_featureset : public Featureset
+{
+public:
+    reprojected_featureset(featureset_ptr const& fs,
+                           reprojected_geometries_ptr const& geometries,
+                           proj_transform const& prj_trans);
+    feature_ptr next();
+
+private:
+    featureset_ptr fs_;
+    reprojected_geometries_ptr geometries_;
+    proj_transform const& prj_trans_;
+};
+
+// the features of ds for q, passed through geometries when there are any
+inline featureset_ptr reprojected_features(datasource_ptr const& ds, query const& q,
+                                           reprojected_geometries_ptr const& geometries,
+                                           proj_transform const& prj_trans)
+{
+    featureset_ptr features = ds->features(q);
+    if (!features || !geometries)
+    {
+        return features;
+    }
+    return boost::make_shared<reprojected_featureset>(features, geometries, prj_trans);
+}
+
+}
+
+#endif // MAPNIK_REPROJECTION_CACHE_HPP
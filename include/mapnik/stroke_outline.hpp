@@ -0,0 +1,156 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_STROKE_OUTLINE_HPP
+#define MAPNIK_STROKE_OUTLINE_HPP
+
+// mapnik
+#include <mapnik/agg_helpers.hpp>
+#include <mapnik/stroke.hpp>
+
+// boost
+#include <boost/utility.hpp>
+
+// agg
+#include "agg_path_storage.h"
+#include "agg_conv_dash.h"
+#include "agg_conv_stroke.h"
+
+// stl
+#include <utility>
+
+namespace mapnik {
+
+// The parts of a stroke that shape its outline, with the scale factor
+// applied, worked out once per symbolizer instead of for every feature.
+class stroke_params
+{
+public:
+    stroke_params(stroke const& s, double scale_factor)
+        : width_(s.get_width() * scale_factor),
+          line_cap_(s.get_line_cap()),
+          line_join_(s.get_line_join()),
+          miterlimit_(s.get_miterlimit())
+    {
+        dash_array const& d = s.get_dash_array();
+        dash_array::const_iterator itr = d.begin();
+        dash_array::const_iterator end = d.end();
+        for (; itr != end; ++itr)
+        {
+            dash_.push_back(std::make_pair(itr->first * scale_factor,
+                                           itr->second * scale_factor));
+        }
+    }
+
+    double get_width() const { return width_; }
+    line_cap_e get_line_cap() const { return line_cap_; }
+    line_join_e get_line_join() const { return line_join_; }
+    double get_miterlimit() const { return miterlimit_; }
+    bool has_dash() const { return !dash_.empty(); }
+    // dash and gap lengths, scaled
+    dash_array const& get_dash_array() const { return dash_; }
+
+private:
+    double width_;
+    line_cap_e line_cap_;
+    line_join_e line_join_;
+    double miterlimit_;
+    dash_array dash_;
+};
+
+// Strokes a batch of paths, dashed first when the stroke has a dash
+// array. Paths are collected with add_path(), so the outline can be the
+// end of a vertex_converter in place of its dash_tag and stroke_tag, and
+// the outline of the whole batch is then read as one vertex source. The
+// agg generators are set up once per stroke and keep their storage from
+// one batch to the next, where converters build new ones for each path.
+class stroke_outline : private boost::noncopyable
+{
+public:
+    stroke_outline()
+        : dash_(input_),
+          stroke_(input_),
+          dashed_stroke_(dash_),
+          dashed_(false) {}
+
+    // configures the generators and empties the batch
+    void setup(stroke_params const& params)
+    {
+        dash_.remove_all_dashes();
+        dash_array const& d = params.get_dash_array();
+        dash_array::const_iterator itr = d.begin();
+        dash_array::const_iterator end = d.end();
+        for (; itr != end; ++itr)
+        {
+            dash_.add_dash(itr->first, itr->second);
+        }
+        dashed_ = params.has_dash();
+        configure(stroke_, params);
+        configure(dashed_stroke_, params);
+        clear();
+    }
+
+    // empties the batch, keeping the storage
+    void clear()
+    {
+        input_.remove_all();
+    }
+
+    template <typename VertexSource>
+    void add_path(VertexSource & path)
+    {
+        input_.concat_path(path);
+    }
+
+    // the number of vertices collected
+    unsigned size() const { return input_.total_vertices(); }
+
+    void rewind(unsigned path_id)
+    {
+        if (dashed_) dashed_stroke_.rewind(path_id);
+        else stroke_.rewind(path_id);
+    }
+
+    unsigned vertex(double* x, double* y)
+    {
+        return dashed_ ? dashed_stroke_.vertex(x, y) : stroke_.vertex(x, y);
+    }
+
+private:
+    template <typename Stroke>
+    static void configure(Stroke & s, stroke_params const& params)
+    {
+        set_join_caps(params, s);
+        s.generator().miter_limit(params.get_miterlimit());
+        s.generator().width(params.get_width());
+    }
+
+    agg::path_storage input_;
+    agg::conv_dash<agg::path_storage> dash_;
+    agg::conv_stroke<agg::path_storage> stroke_;
+    agg::conv_stroke<agg::conv_dash<agg::path_storage> > dashed_stroke_;
+    bool dashed_;
+};
+
+}
+
+#endif // MAPNIK_STROKE_OUTLINE_HPP
@@ -28,6 +28,7 @@
 #include <mapnik/pixel_position.hpp>
 
 //stl
+#include <string>
 #include <vector>
 
 // boost
@@ -47,6 +48,7 @@ protected:
     characters_t characters_;
     UnicodeString text_;
     bool is_rtl;
+    std::string layout_key_;
 public:
     string_info(UnicodeString const& text)
         : characters_(),
@@ -110,11 +112,23 @@ public:
         return (text_.indexOf(break_char) >= 0);
     }
 
+    /** Identifies glyphs and formats for text_shaping_cache, empty if unknown. */
+    std::string const& layout_key() const
+    {
+        return layout_key_;
+    }
+
+    std::string & layout_key()
+    {
+        return layout_key_;
+    }
+
     /** Resets object to initial state. */
     void clear(void)
     {
         text_ = "";
         characters_.clear();
+        layout_key_.clear();
     }
 };
 
@@ -194,6 +208,15 @@ public:
     {
         nodes_.clear();
     }
+
+    /** Move to a new center and delete all nodes, keeping allocated storage. */
+    void reset(double x, double y)
+    {
+        itr_ = 0;
+        center.x = x;
+        center.y = y;
+        nodes_.clear();
+    }
 };
 
 typedef boost::shared_ptr<text_path> text_path_ptr;
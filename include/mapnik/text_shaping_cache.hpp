@@ -0,0 +1,134 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_TEXT_SHAPING_CACHE_HPP
+#define MAPNIK_TEXT_SHAPING_CACHE_HPP
+
+// mapnik
+#include <mapnik/utils.hpp>
+#include <mapnik/config.hpp>
+#include <mapnik/char_info.hpp>
+
+// boost
+#include <boost/utility.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/shared_ptr.hpp>
+
+// stl
+#include <list>
+#include <string>
+#include <vector>
+
+namespace mapnik
+{
+
+// Glyph metrics of a bidi-reordered, shaped string in one face set at one
+// size. The format of each char_info is left unset.
+struct shaped_text
+{
+    std::vector<char_info> glyphs;
+    bool rtl;
+};
+
+// Line breaks and sizes placement_finder computed for a string_info.
+struct text_layout
+{
+    std::vector<unsigned> line_breaks;
+    std::vector<std::pair<double, double> > line_sizes;
+    double width;
+    double height;
+    double first_line_space;
+};
+
+typedef boost::shared_ptr<shaped_text const> shaped_text_ptr;
+typedef boost::shared_ptr<text_layout const> text_layout_ptr;
+
+// Process wide cache of shaped text and line layouts, so labels that repeat
+// across features and renders (road names, place names) are shaped and
+// wrapped once. Each table keeps at most max_entries() items and drops the
+// least recently used one when full.
+class MAPNIK_DECL text_shaping_cache :
+        public singleton <text_shaping_cache, CreateUsingNew>,
+        private boost::noncopyable
+{
+    friend class CreateUsingNew<text_shaping_cache>;
+public:
+    struct stats
+    {
+        std::size_t shaped_hits;
+        std::size_t shaped_misses;
+        std::size_t shaped_entries;
+        std::size_t layout_hits;
+        std::size_t layout_misses;
+        std::size_t layout_entries;
+        std::size_t evictions;
+    };
+
+    shaped_text_ptr find_shaped(std::string const& key);
+    void insert_shaped(std::string const& key, shaped_text_ptr const& text);
+    text_layout_ptr find_layout(std::string const& key);
+    void insert_layout(std::string const& key, text_layout_ptr const& layout);
+
+    // 0 disables caching
+    void set_max_entries(std::size_t max_entries);
+    std::size_t max_entries() const;
+    stats get_stats() const;
+    void clear();
+
+    template <typename T>
+    class lru_table
+    {
+    public:
+        typedef std::list<std::string> order_type;
+        typedef boost::unordered_map<std::string, std::pair<T, order_type::iterator> > map_type;
+
+        bool find(std::string const& key, T & value);
+        // returns the number of entries evicted
+        std::size_t insert(std::string const& key, T const& value, std::size_t max_entries);
+        std::size_t trim(std::size_t max_entries);
+        std::size_t size() const { return map_.size(); }
+        void clear() { map_.clear(); order_.clear(); }
+    private:
+        map_type map_;
+        order_type order_;
+    };
+
+private:
+    text_shaping_cache();
+    ~text_shaping_cache();
+
+    lru_table<shaped_text_ptr> shaped_;
+    lru_table<text_layout_ptr> layouts_;
+    std::size_t max_entries_;
+    stats stats_;
+};
+
+// appends the raw bytes of a value to a cache key
+template <typename T>
+inline void append_key(std::string & key, T const& value)
+{
+    key.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+}
+
+#endif // MAPNIK_TEXT_SHAPING_CACHE_HPP
@@ -34,6 +34,7 @@
 #include <boost/utility.hpp>
 #include <boost/tuple/tuple.hpp>
 
+#include <algorithm>
 #include <cstring>  // required for memcpy with linux/g++
 
 namespace mapnik
@@ -115,6 +116,33 @@ public:
         return commands_[block] [pos & block_mask];
     }
 
+    // allocates storage for at least n vertices in total
+    void reserve(size_type n)
+    {
+        while ((size_type(num_blocks_) << block_shift) < n)
+        {
+            allocate_block(num_blocks_);
+        }
+    }
+
+    // Appends count vertices, all with command, from packed x,y pairs of
+    // coord_type in native byte order. src need not be aligned.
+    void append_packed(char const* src, size_type count, unsigned command)
+    {
+        reserve(pos_ + count);
+        while (count > 0)
+        {
+            unsigned block = pos_ >> block_shift;
+            unsigned offset = pos_ & block_mask;
+            size_type n = std::min(count, size_type(block_size - offset));
+            std::memcpy(vertices_[block] + (offset << 1), src, n * 2 * sizeof(coord_type));
+            std::memset(commands_[block] + offset, command, n);
+            src += n * 2 * sizeof(coord_type);
+            pos_ += n;
+            count -= n;
+        }
+    }
+
     void set_command(unsigned pos, unsigned command)
     {
         if (pos < pos_)
@@ -123,6 +151,25 @@ public:
             commands_[block] [pos & block_mask] = command;
         }
     }
+
+    // Calls op(xy, count) for each block holding vertices, in order, where xy
+    // holds count interleaved x,y pairs. Blocks allocated by reserve() but not
+    // used yet are skipped. Stops at the first block op rejects.
+    template <typename Op>
+    bool transform_blocks(Op const& op)
+    {
+        unsigned used_blocks = static_cast<unsigned>((pos_ + block_mask) >> block_shift);
+        for (unsigned block = 0; block < used_blocks; ++block)
+        {
+            size_type count = block_size;
+            if (block + 1 == used_blocks && (pos_ & block_mask) != 0)
+            {
+                count = pos_ & block_mask;
+            }
+            if (!op(vertices_[block], static_cast<unsigned>(count))) return false;
+        }
+        return true;
+    }
 private:
     void allocate_block(unsigned block)
     {
@@ -0,0 +1,56 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef MAPNIK_WELL_KNOWN_SRS_HPP
+#define MAPNIK_WELL_KNOWN_SRS_HPP
+
+// mapnik
+#include <mapnik/config.hpp>
+
+// boost
+#include <boost/optional.hpp>
+
+// stl
+#include <string>
+
+namespace mapnik {
+
+enum well_known_srs_enum {
+    WGS_84,    // geographic coordinates on the WGS84 datum, epsg:4326
+    G_MERC     // spherical (web) mercator, epsg:3857 and epsg:900913
+};
+
+/** Classifies a proj4 definition by its parameters rather than its spelling,
+ * so "+init=epsg:3857" and an equivalent "+proj=merc +a=6378137 ..." match.
+ * Returns nothing for anything that needs proj4 to transform. */
+MAPNIK_DECL boost::optional<well_known_srs_enum> is_well_known_srs(std::string const& srs);
+
+/** Batched in place conversions between WGS84 degrees and spherical mercator
+ * meters. x and y hold point_count values, offset doubles apart, so
+ * interleaved x,y storage can be converted with offset 2. Results are
+ * clamped to the valid mercator extent. */
+MAPNIK_DECL bool lonlat2merc(double * x, double * y, int point_count, int offset = 1);
+MAPNIK_DECL bool merc2lonlat(double * x, double * y, int point_count, int offset = 1);
+
+}
+
+#endif // MAPNIK_WELL_KNOWN_SRS_HPP
@@ -47,7 +47,8 @@ enum wkbFormat
 {
     wkbAuto=1,
     wkbGeneric=2,
-    wkbSpatiaLite=3
+    wkbSpatiaLite=3,
+    wkbTWKB=4 // Tiny WKB: varint, delta encoded coordinates (never auto detected)
 };
 
 class MAPNIK_DECL geometry_utils : private boost::noncopyable
@@ -25,12 +25,31 @@
 
 // stl
 #include <string>
+#include <vector>
 
 namespace mapnik
 {
 class xml_node;
-void read_xml(std::string const & filename, xml_node &node);
+/** Parses filename into node. If files is given, every other file the parser
+ * read (external DTD, entities, XIncludes) is appended to it.
+ */
+void read_xml(std::string const & filename, xml_node &node, std::vector<std::string> * files = 0);
 void read_xml_string(std::string const & str, xml_node &node, std::string const & base_path="");
+
+/** Stores an already parsed tree in mapnik's binary stylesheet format.
+ * The size and modification time of every file in sources (the stylesheet
+ * first, then whatever it included) are recorded, so read_compiled_xml()
+ * can tell when the cache is stale.
+ */
+void write_compiled_xml(std::string const & filename, xml_node const& node,
+                        std::vector<std::string> const& sources = std::vector<std::string>());
+
+/** Memory maps a file written by write_compiled_xml() and adds its nodes to node.
+ * Returns false, leaving node untouched, if the file is missing, corrupt,
+ * written by another mapnik version, compiled from another stylesheet than
+ * source or if any of the files it was compiled from changed since.
+ */
+bool read_compiled_xml(std::string const & filename, xml_node &node, std::string const & source="");
 }
 
 #endif // MAPNIK_LIBXML2_LOADER_HPP
@@ -38,6 +38,8 @@ else:
       """
       geojson_datasource.cpp
       geojson_featureset.cpp
+      geojson_index.cpp
+      geojson_index_featureset.cpp
       """
             )
     libraries = []
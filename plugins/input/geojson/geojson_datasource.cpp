@@ -22,6 +22,7 @@
 
 #include "geojson_datasource.hpp"
 #include "geojson_featureset.hpp"
+#include "geojson_index_featureset.hpp"
 
 #include <fstream>
 #include <iostream>
@@ -44,6 +45,8 @@
 #include <mapnik/projection.hpp>
 #include <mapnik/util/geometry_to_ds_type.hpp>
 #include <mapnik/json/feature_collection_parser.hpp>
+#include <mapnik/json/feature_parser.hpp>
+#include <mapnik/feature_factory.hpp>
 
 using mapnik::datasource;
 using mapnik::parameters;
@@ -59,7 +62,11 @@ geojson_datasource::geojson_datasource(parameters const& params, bool bind)
     extent_(),
     tr_(new mapnik::transcoder(*params_.get<std::string>("encoding","utf-8"))),
     features_(),
-    tree_(16,1)
+    tree_(16,1),
+    cache_features_(*params_.get<mapnik::boolean>("cache_features", true)),
+    index_(),
+    parser_(),
+    ctx_(boost::make_shared<mapnik::context_type>())
 {
     if (file_.empty()) throw mapnik::datasource_exception("GeoJSON Plugin: missing <file> parameter");
     if (bind)
@@ -110,6 +117,37 @@ void geojson_datasource::bind() const
 {
     if (is_bound_) return;
 
+    if (!cache_features_)
+    {
+        // index the file (or reuse its index) and parse a sample of
+        // features for the descriptor, the rest is parsed on demand
+        index_ = boost::make_shared<geojson_index>(file_);
+        extent_ = index_->extent();
+        // the grammar is costly to build, all featuresets share this one
+        parser_ = boost::make_shared<mapnik::json::feature_parser<char const*> >(*tr_);
+        for (std::size_t i = 0; i < index_->size() && features_.size() < 5; ++i)
+        {
+            char const* json_begin;
+            char const* json_end;
+            index_->feature(i, json_begin, json_end);
+            mapnik::feature_ptr f(mapnik::feature_factory::create(ctx_, i + 1));
+            if (!parser_->parse(json_begin, json_end, *f)) continue;
+            if (features_.empty())
+            {
+                mapnik::feature_kv_iterator itr = f->begin();
+                mapnik::feature_kv_iterator end = f->end();
+                for ( ;itr!=end; ++itr)
+                {
+                    desc_.add_descriptor(mapnik::attribute_descriptor(boost::get<0>(*itr),
+                        boost::apply_visitor(attr_value_converter(),boost::get<1>(*itr).base())));
+                }
+            }
+            features_.push_back(f);
+        }
+        is_bound_ = true;
+        return;
+    }
+
     typedef std::istreambuf_iterator<char> base_iterator_type;    
     
     std::ifstream is(file_.c_str());
@@ -119,8 +157,7 @@ void geojson_datasource::bind() const
     boost::spirit::multi_pass<base_iterator_type> end = 
         boost::spirit::make_default_multi_pass(base_iterator_type());
     
-    mapnik::context_ptr ctx = boost::make_shared<mapnik::context_type>();
-    mapnik::json::feature_collection_parser<boost::spirit::multi_pass<base_iterator_type> > p(ctx,*tr_);
+    mapnik::json::feature_collection_parser<boost::spirit::multi_pass<base_iterator_type> > p(ctx_,*tr_);
     bool result = p.parse(begin,end, features_);
     if (!result) 
     {
@@ -208,6 +245,19 @@ mapnik::featureset_ptr geojson_datasource::features(mapnik::query const& q) cons
     mapnik::box2d<double> const& b = q.get_bbox();
     if (extent_.intersects(b))
     {
+        if (index_)
+        {
+            std::vector<std::size_t> numbers;
+            index_->query(b, numbers);
+            // features parsed on demand may carry keys the sample in bind() did not
+            // see, so every featureset grows its own copy of the shared context
+            mapnik::context_ptr ctx = boost::make_shared<mapnik::context_type>();
+            for (mapnik::context_type::const_iterator itr = ctx_->begin(); itr != ctx_->end(); ++itr)
+            {
+                ctx->add(itr->first, itr->second);
+            }
+            return boost::make_shared<geojson_index_featureset>(index_, numbers, ctx, parser_);
+        }
         box_type box(point_type(b.minx(),b.miny()),point_type(b.maxx(),b.maxy()));
         index_array_ = tree_.find(box);
         return boost::make_shared<geojson_featureset>(features_, index_array_.begin(), index_array_.end());
@@ -31,6 +31,7 @@
 #include <mapnik/box2d.hpp>
 #include <mapnik/coord.hpp>
 #include <mapnik/feature_layer_desc.hpp>
+#include <mapnik/json/feature_parser.hpp>
 
 // boost
 #include <boost/optional.hpp>
@@ -47,6 +48,8 @@
 #include <map>
 #include <deque>
 
+#include "geojson_index.hpp"
+
 class geojson_datasource : public mapnik::datasource
 {
 public:
@@ -72,9 +75,14 @@ private:
     mutable std::string file_;
     mutable mapnik::box2d<double> extent_;
     boost::shared_ptr<mapnik::transcoder> tr_;
+    // with cache_features=false only the first few features, for the descriptor
     mutable std::vector<mapnik::feature_ptr> features_;
     mutable spatial_index_type tree_;
     mutable std::deque<std::size_t> index_array_;
+    bool cache_features_;
+    mutable geojson_index_ptr index_;
+    mutable boost::shared_ptr<mapnik::json::feature_parser<char const*> > parser_;
+    mapnik::context_ptr ctx_;
 };
 
 
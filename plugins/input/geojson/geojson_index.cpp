@@ -0,0 +1,533 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#include "geojson_index.hpp"
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/datasource.hpp>
+
+// boost
+#include <boost/filesystem/operations.hpp>
+
+// stl
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <algorithm>
+
+/* Layout of a .index file, all integers in native byte order:
+ *
+ *   header: magic[8] format_version:u32 byte_order:u32
+ *           source_size:u64 source_mtime:i64
+ *           feature_count:u64 leaf_count:u64 node_size:u32 reserved:u32
+ *           extent:f64[4]
+ *   ranges: (offset:u64 size:u64)*   one per feature, in document order
+ *   nodes:  packed_rtree_node*       leaf values are feature numbers
+ */
+
+namespace {
+
+char const index_magic[8] = { 'M', 'A', 'P', 'N', 'I', 'K', 'J', '\0' };
+boost::uint32_t const index_format = 1;
+boost::uint32_t const index_byte_order = 0x01020304;
+unsigned const node_size = 16;
+// nested arrays deeper than this are not GeoJSON coordinates
+unsigned const max_depth = 32;
+
+template <typename T>
+void append(std::string & out, T value)
+{
+    out.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool read(char const*& pos, char const* end, T & value)
+{
+    if (static_cast<std::size_t>(end - pos) < sizeof(T)) return false;
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+// Single pass, non-backtracking JSON scanner: values the index does not
+// need are skipped by bracket counting, only coordinates are converted.
+class scanner
+{
+public:
+    scanner(char const* begin, char const* end)
+        : begin_(begin),
+          pos_(begin),
+          end_(end) {}
+
+    bool collection(std::vector<geojson_index::range> & ranges,
+                    std::vector<mapnik::packed_rtree_node> & nodes)
+    {
+        if (!consume('{')) return false;
+        bool found = false;
+        for (;;)
+        {
+            char const* key_begin;
+            char const* key_end;
+            if (!string(key_begin, key_end) || !consume(':')) return false;
+            if (key_is(key_begin, key_end, "features"))
+            {
+                if (!features(ranges, nodes)) return false;
+                found = true;
+            }
+            else if (!skip_value())
+            {
+                return false;
+            }
+            if (consume(',')) continue;
+            return consume('}') && found;
+        }
+    }
+
+private:
+    struct bbox
+    {
+        bbox()
+            : minx(0), miny(0), maxx(0), maxy(0), valid(false) {}
+
+        void expand(double x, double y)
+        {
+            if (!valid)
+            {
+                minx = maxx = x;
+                miny = maxy = y;
+                valid = true;
+            }
+            else
+            {
+                minx = std::min(minx, x);
+                miny = std::min(miny, y);
+                maxx = std::max(maxx, x);
+                maxy = std::max(maxy, y);
+            }
+        }
+
+        double minx, miny, maxx, maxy;
+        bool valid;
+    };
+
+    bool features(std::vector<geojson_index::range> & ranges,
+                  std::vector<mapnik::packed_rtree_node> & nodes)
+    {
+        if (!consume('[')) return false;
+        if (consume(']')) return true;
+        for (;;)
+        {
+            skip_ws();
+            char const* start = pos_;
+            bbox box;
+            if (!feature(box)) return false;
+            geojson_index::range r;
+            r.offset = start - begin_;
+            r.size = pos_ - start;
+            if (box.valid)
+            {
+                mapnik::packed_rtree_node n = { box.minx, box.miny, box.maxx, box.maxy, ranges.size() };
+                nodes.push_back(n);
+            }
+            ranges.push_back(r);
+            if (consume(',')) continue;
+            return consume(']');
+        }
+    }
+
+    bool feature(bbox & box)
+    {
+        if (!consume('{')) return false;
+        if (consume('}')) return true;
+        for (;;)
+        {
+            char const* key_begin;
+            char const* key_end;
+            if (!string(key_begin, key_end) || !consume(':')) return false;
+            if (key_is(key_begin, key_end, "geometry"))
+            {
+                if (!geometry(box, 0)) return false;
+            }
+            else if (!skip_value())
+            {
+                return false;
+            }
+            if (consume(',')) continue;
+            return consume('}');
+        }
+    }
+
+    bool geometry(bbox & box, unsigned depth)
+    {
+        if (!peek('{')) return skip_value(); // null
+        if (depth > max_depth) return false;
+        ++pos_;
+        if (consume('}')) return true;
+        for (;;)
+        {
+            char const* key_begin;
+            char const* key_end;
+            if (!string(key_begin, key_end) || !consume(':')) return false;
+            if (key_is(key_begin, key_end, "coordinates"))
+            {
+                if (!coordinates(box, 0)) return false;
+            }
+            else if (key_is(key_begin, key_end, "geometries"))
+            {
+                if (!consume('[')) return false;
+                if (!consume(']'))
+                {
+                    do
+                    {
+                        if (!geometry(box, depth + 1)) return false;
+                    }
+                    while (consume(','));
+                    if (!consume(']')) return false;
+                }
+            }
+            else if (!skip_value())
+            {
+                return false;
+            }
+            if (consume(',')) continue;
+            return consume('}');
+        }
+    }
+
+    // a position is an array of numbers, anything else nests positions
+    bool coordinates(bbox & box, unsigned depth)
+    {
+        if (depth > max_depth || !consume('[')) return false;
+        if (consume(']')) return true;
+        if (peek('['))
+        {
+            do
+            {
+                if (!coordinates(box, depth + 1)) return false;
+            }
+            while (consume(','));
+            return consume(']');
+        }
+        double x, y;
+        if (!number(x) || !consume(',') || !number(y)) return false;
+        box.expand(x, y);
+        while (consume(','))
+        {
+            if (!skip_value()) return false; // z, m
+        }
+        return consume(']');
+    }
+
+    void skip_ws()
+    {
+        while (pos_ < end_ && (*pos_ == ' ' || *pos_ == '\n' || *pos_ == '\r' || *pos_ == '\t')) ++pos_;
+    }
+
+    bool peek(char c)
+    {
+        skip_ws();
+        return pos_ < end_ && *pos_ == c;
+    }
+
+    bool consume(char c)
+    {
+        if (!peek(c)) return false;
+        ++pos_;
+        return true;
+    }
+
+    // the raw (still escaped) text between the quotes
+    bool string(char const*& begin, char const*& end)
+    {
+        if (!consume('"')) return false;
+        begin = pos_;
+        while (pos_ < end_ && *pos_ != '"')
+        {
+            if (*pos_ == '\\') ++pos_;
+            ++pos_;
+        }
+        if (pos_ >= end_) return false;
+        end = pos_++;
+        return true;
+    }
+
+    static bool key_is(char const* begin, char const* end, char const* key)
+    {
+        std::size_t length = std::strlen(key);
+        return static_cast<std::size_t>(end - begin) == length && std::memcmp(begin, key, length) == 0;
+    }
+
+    bool number(double & value)
+    {
+        skip_ws();
+        char buffer[64];
+        std::size_t length = 0;
+        while (pos_ + length < end_ && length < sizeof(buffer) - 1 &&
+               std::strchr("+-.0123456789eE", pos_[length]) && pos_[length] != '\0')
+        {
+            buffer[length] = pos_[length];
+            ++length;
+        }
+        if (length == 0) return false;
+        buffer[length] = '\0';
+        char * parsed;
+        value = std::strtod(buffer, &parsed);
+        if (parsed != buffer + length) return false;
+        pos_ += length;
+        return true;
+    }
+
+    bool skip_value()
+    {
+        skip_ws();
+        if (pos_ >= end_) return false;
+        if (*pos_ == '"')
+        {
+            char const* begin;
+            char const* end;
+            return string(begin, end);
+        }
+        if (*pos_ == '{' || *pos_ == '[')
+        {
+            std::size_t depth = 0;
+            while (pos_ < end_)
+            {
+                char c = *pos_;
+                if (c == '"')
+                {
+                    char const* begin;
+                    char const* end;
+                    if (!string(begin, end)) return false;
+                    continue;
+                }
+                ++pos_;
+                if (c == '{' || c == '[')
+                {
+                    ++depth;
+                }
+                else if (c == '}' || c == ']')
+                {
+                    if (--depth == 0) return true;
+                }
+            }
+            return false;
+        }
+        // number, true, false or null
+        char const* start = pos_;
+        while (pos_ < end_ && !std::strchr(",}] \t\r\n", *pos_)) ++pos_;
+        return pos_ > start;
+    }
+
+    char const* begin_;
+    char const* pos_;
+    char const* end_;
+};
+
+struct collect_values
+{
+    collect_values(std::vector<std::size_t> & values)
+        : values_(values) {}
+
+    void operator()(boost::uint64_t value)
+    {
+        values_.push_back(static_cast<std::size_t>(value));
+    }
+
+    std::vector<std::size_t> & values_;
+};
+
+}
+
+bool geojson_index::scan(char const* begin, char const* end,
+                         std::vector<range> & ranges,
+                         std::vector<mapnik::packed_rtree_node> & nodes)
+{
+    scanner s(begin, end);
+    return s.collection(ranges, nodes);
+}
+
+geojson_index::geojson_index(std::string const& file)
+    : ranges_(0),
+      nodes_(0),
+      count_(0),
+      leaf_count_(0),
+      extent_()
+{
+    boost::optional<mapnik::mapped_region_ptr> data = mapnik::mapped_memory_cache::instance().find(file, false);
+    if (!data)
+    {
+        throw mapnik::datasource_exception("GeoJSON Plugin: could not open: '" + file + "'");
+    }
+    data_ = *data;
+
+    boost::system::error_code ec;
+    boost::uint64_t size = static_cast<boost::uint64_t>(boost::filesystem::file_size(file, ec));
+    boost::int64_t mtime = static_cast<boost::int64_t>(boost::filesystem::last_write_time(file, ec));
+    std::string index_file = file + ".index";
+    if (!load(index_file, size, mtime))
+    {
+        char const* begin = static_cast<char const*>(data_->get_address());
+        if (!scan(begin, begin + data_->get_size(), owned_ranges_, owned_nodes_))
+        {
+            throw mapnik::datasource_exception("GeoJSON Plugin: failed to index GeoJSON file '" + file + "'");
+        }
+        leaf_count_ = owned_nodes_.size();
+        for (std::size_t i = 0; i < leaf_count_; ++i)
+        {
+            mapnik::packed_rtree_node const& n = owned_nodes_[i];
+            mapnik::box2d<double> box(n.minx, n.miny, n.maxx, n.maxy);
+            if (i == 0) extent_ = box;
+            else extent_.expand_to_include(box);
+        }
+        mapnik::packed_rtree::build(owned_nodes_, node_size);
+        count_ = owned_ranges_.size();
+        ranges_ = owned_ranges_.empty() ? 0 : &owned_ranges_[0];
+        nodes_ = owned_nodes_.empty() ? 0 : &owned_nodes_[0];
+        if (!save(index_file, size, mtime))
+        {
+            MAPNIK_LOG_WARN(geojson) << "geojson_index: could not write '" << index_file << "', keeping the index in memory";
+        }
+    }
+    tree_.reset(new mapnik::packed_rtree(nodes_, leaf_count_, node_size));
+}
+
+std::size_t geojson_index::size() const
+{
+    return count_;
+}
+
+mapnik::box2d<double> const& geojson_index::extent() const
+{
+    return extent_;
+}
+
+void geojson_index::query(mapnik::box2d<double> const& box, std::vector<std::size_t> & result) const
+{
+    result.clear();
+    collect_values visitor(result);
+    tree_->query(box, visitor);
+    // render in document order, as when all features are cached
+    std::sort(result.begin(), result.end());
+}
+
+void geojson_index::feature(std::size_t number, char const*& begin, char const*& end) const
+{
+    char const* data = static_cast<char const*>(data_->get_address());
+    boost::uint64_t data_size = data_->get_size();
+    if (number >= count_ || ranges_[number].offset > data_size ||
+        ranges_[number].size > data_size - ranges_[number].offset)
+    {
+        begin = end = data;
+        return;
+    }
+    begin = data + ranges_[number].offset;
+    end = begin + ranges_[number].size;
+}
+
+bool geojson_index::load(std::string const& filename, boost::uint64_t size, boost::int64_t mtime)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(filename, ec)) return false;
+    try
+    {
+        boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+        index_region_.reset(new boost::interprocess::mapped_region(mapping, boost::interprocess::read_only));
+    }
+    catch (...)
+    {
+        MAPNIK_LOG_ERROR(geojson) << "geojson_index: could not map '" << filename << "'";
+        return false;
+    }
+    char const* pos = static_cast<char const*>(index_region_->get_address());
+    char const* end = pos + index_region_->get_size();
+    boost::uint32_t format, byte_order, file_node_size, reserved;
+    boost::uint64_t file_size, count, leaf_count;
+    boost::int64_t file_mtime;
+    double extent[4];
+    if (static_cast<std::size_t>(end - pos) < sizeof(index_magic) ||
+        std::memcmp(pos, index_magic, sizeof(index_magic)) != 0) return false;
+    pos += sizeof(index_magic);
+    if (!read(pos, end, format) || !read(pos, end, byte_order) ||
+        format != index_format || byte_order != index_byte_order) return false;
+    if (!read(pos, end, file_size) || !read(pos, end, file_mtime) ||
+        file_size != size || file_mtime != mtime) return false;
+    if (!read(pos, end, count) || !read(pos, end, leaf_count) ||
+        !read(pos, end, file_node_size) || !read(pos, end, reserved) ||
+        file_node_size != node_size || leaf_count > count) return false;
+    for (unsigned i = 0; i < 4; ++i)
+    {
+        if (!read(pos, end, extent[i])) return false;
+    }
+    boost::uint64_t available = static_cast<boost::uint64_t>(end - pos);
+    boost::uint64_t node_count = mapnik::packed_rtree::node_count(static_cast<std::size_t>(leaf_count), node_size);
+    if (available / sizeof(range) < count ||
+        (available - count * sizeof(range)) / sizeof(mapnik::packed_rtree_node) < node_count) return false;
+    ranges_ = reinterpret_cast<range const*>(pos);
+    nodes_ = reinterpret_cast<mapnik::packed_rtree_node const*>(pos + count * sizeof(range));
+    count_ = static_cast<std::size_t>(count);
+    leaf_count_ = static_cast<std::size_t>(leaf_count);
+    extent_.init(extent[0], extent[1], extent[2], extent[3]);
+    return true;
+}
+
+bool geojson_index::save(std::string const& filename, boost::uint64_t size, boost::int64_t mtime) const
+{
+    // several processes may open the same unindexed file at once, a private
+    // temporary name keeps their writes apart until the atomic rename
+    std::string tmp_filename = boost::filesystem::unique_path(filename + ".%%%%-%%%%-%%%%.tmp").string();
+    {
+        std::ofstream out(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        std::string header(index_magic, sizeof(index_magic));
+        append(header, index_format);
+        append(header, index_byte_order);
+        append(header, size);
+        append(header, mtime);
+        append(header, static_cast<boost::uint64_t>(count_));
+        append(header, static_cast<boost::uint64_t>(leaf_count_));
+        append(header, static_cast<boost::uint32_t>(node_size));
+        append(header, static_cast<boost::uint32_t>(0));
+        append(header, extent_.minx());
+        append(header, extent_.miny());
+        append(header, extent_.maxx());
+        append(header, extent_.maxy());
+        out.write(header.data(), header.size());
+        out.write(reinterpret_cast<char const*>(ranges_), count_ * sizeof(range));
+        out.write(reinterpret_cast<char const*>(nodes_),
+                  mapnik::packed_rtree::node_count(leaf_count_, node_size) * sizeof(mapnik::packed_rtree_node));
+        out.flush();
+        if (!out)
+        {
+            out.close();
+            std::remove(tmp_filename.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tmp_filename.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef GEOJSON_INDEX_HPP
+#define GEOJSON_INDEX_HPP
+
+// mapnik
+#include <mapnik/box2d.hpp>
+#include <mapnik/packed_rtree.hpp>
+#include <mapnik/mapped_memory_cache.hpp>
+
+// boost
+#include <boost/utility.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/scoped_ptr.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// stl
+#include <string>
+#include <vector>
+
+// Byte range and bounding box of every feature of a GeoJSON
+// FeatureCollection, found by one scan of the file and kept in a packed
+// R-tree. The index is saved next to the data (<file>.index) and reused
+// until the size or mtime of the data file changes, so only the features a
+// query hits are ever parsed.
+class geojson_index : private boost::noncopyable
+{
+public:
+    // scans or reloads the index of file, throws datasource_exception when
+    // the file cannot be read or is not a FeatureCollection
+    explicit geojson_index(std::string const& file);
+
+    std::size_t size() const;
+    mapnik::box2d<double> const& extent() const;
+    // numbers (document order, from 0) of the features whose bbox intersects box
+    void query(mapnik::box2d<double> const& box, std::vector<std::size_t> & result) const;
+    // the JSON text of feature number
+    void feature(std::size_t number, char const*& begin, char const*& end) const;
+
+    struct range
+    {
+        boost::uint64_t offset;
+        boost::uint64_t size;
+    };
+
+    // Finds every feature of the FeatureCollection in [begin, end) in one
+    // pass without parsing properties. Features without coordinates get no
+    // node. Returns false on malformed input.
+    static bool scan(char const* begin, char const* end,
+                     std::vector<range> & ranges,
+                     std::vector<mapnik::packed_rtree_node> & nodes);
+
+private:
+    bool load(std::string const& filename, boost::uint64_t size, boost::int64_t mtime);
+    bool save(std::string const& filename, boost::uint64_t size, boost::int64_t mtime) const;
+
+    mapnik::mapped_region_ptr data_;
+    boost::scoped_ptr<boost::interprocess::mapped_region> index_region_;
+    // either owned (freshly scanned) or pointing into index_region_
+    std::vector<range> owned_ranges_;
+    std::vector<mapnik::packed_rtree_node> owned_nodes_;
+    range const* ranges_;
+    mapnik::packed_rtree_node const* nodes_;
+    std::size_t count_;
+    std::size_t leaf_count_;
+    mapnik::box2d<double> extent_;
+    boost::scoped_ptr<mapnik::packed_rtree> tree_;
+};
+
+typedef boost::shared_ptr<geojson_index> geojson_index_ptr;
+
+#endif // GEOJSON_INDEX_HPP
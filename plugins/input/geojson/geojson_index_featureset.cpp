@@ -0,0 +1,62 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+
+#include "geojson_index_featureset.hpp"
+
+geojson_index_featureset::geojson_index_featureset(geojson_index_ptr const& index,
+                                                   std::vector<std::size_t> & numbers,
+                                                   mapnik::context_ptr const& ctx,
+                                                   boost::shared_ptr<mapnik::json::feature_parser<char const*> > const& parser)
+    : index_(index),
+      numbers_(),
+      ctx_(ctx),
+      parser_(parser)
+{
+    numbers_.swap(numbers);
+    itr_ = numbers_.begin();
+}
+
+geojson_index_featureset::~geojson_index_featureset() {}
+
+mapnik::feature_ptr geojson_index_featureset::next()
+{
+    while (itr_ != numbers_.end())
+    {
+        std::size_t number = *itr_++;
+        char const* begin;
+        char const* end;
+        index_->feature(number, begin, end);
+        // ids match the ones given when all features are cached
+        mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx_, number + 1));
+        if (parser_->parse(begin, end, *feature))
+        {
+            return feature;
+        }
+        MAPNIK_LOG_WARN(geojson) << "geojson_index_featureset: failed to parse feature " << number + 1;
+    }
+    return mapnik::feature_ptr();
+}
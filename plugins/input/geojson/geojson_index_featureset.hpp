@@ -0,0 +1,59 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef GEOJSON_INDEX_FEATURESET_HPP
+#define GEOJSON_INDEX_FEATURESET_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/json/feature_parser.hpp>
+
+// boost
+#include <boost/shared_ptr.hpp>
+
+#include "geojson_index.hpp"
+
+// stl
+#include <vector>
+
+// Parses the features an index query hit, one at a time, straight from the
+// memory mapped file.
+class geojson_index_featureset : public mapnik::Featureset
+{
+public:
+    // takes the contents of numbers, ctx must not be shared with other featuresets
+    geojson_index_featureset(geojson_index_ptr const& index,
+                             std::vector<std::size_t> & numbers,
+                             mapnik::context_ptr const& ctx,
+                             boost::shared_ptr<mapnik::json::feature_parser<char const*> > const& parser);
+    virtual ~geojson_index_featureset();
+    mapnik::feature_ptr next();
+
+private:
+    geojson_index_ptr index_;
+    std::vector<std::size_t> numbers_;
+    std::vector<std::size_t>::const_iterator itr_;
+    mapnik::context_ptr ctx_;
+    boost::shared_ptr<mapnik::json::feature_parser<char const*> > parser_;
+};
+
+#endif // GEOJSON_INDEX_FEATURESET_HPP
@@ -31,11 +31,15 @@ ogr_src = Split(
   """
       ogr_converter.cpp
       ogr_datasource.cpp
+      ogr_feature_batch.cpp
       ogr_featureset.cpp      
       ogr_index_featureset.cpp
   """
         )
 
+# the .ogrindex quadtree is shared with the index utilities
+plugin_env.Append(CPPPATH = ['#utils/shapeindex'])
+
 plugin_env['LIBS'] = [env['PLUGINS']['ogr']['lib']]
 
 # Link Library to Dependencies
@@ -23,6 +23,7 @@
 #include "ogr_datasource.hpp"
 #include "ogr_featureset.hpp"
 #include "ogr_index_featureset.hpp"
+#include "quadtree.hpp"
 
 #include <gdal_version.h>
 
@@ -30,13 +31,17 @@
 #include <mapnik/debug.hpp>
 #include <mapnik/boolean.hpp>
 #include <mapnik/geom_util.hpp>
+#include <mapnik/mapped_memory_cache.hpp>
 #include <mapnik/timer.hpp>
 
 // boost
 #include <boost/algorithm/string.hpp>
+#include <boost/filesystem/operations.hpp>
 #include <boost/make_shared.hpp>
 
 // stl
+#include <algorithm>
+#include <ctime>
 #include <iostream>
 #include <fstream>
 #include <stdexcept>
@@ -62,7 +67,8 @@ ogr_datasource::ogr_datasource(parameters const& params, bool bind)
       extent_(),
       type_(datasource::Vector),
       desc_(*params_.get<std::string>("type"), *params_.get<std::string>("encoding", "utf-8")),
-      indexed_(false)
+      indexed_(false),
+      batch_size_(std::max(1, *params.get<int>("batch_size", 256)))
 {
     boost::optional<std::string> file = params.get<std::string>("file");
     boost::optional<std::string> string = params.get<std::string>("string");
@@ -256,31 +262,51 @@ void ogr_datasource::bind() const
     layer->GetExtent(&envelope);
     extent_.init(envelope.MinX, envelope.MinY, envelope.MaxX, envelope.MaxY);
 
-    // scan for index file
-    // TODO - layer names don't match dataset name, so this will break for
-    // any layer types of ogr than shapefiles, etc
-    // fix here and in ogrindex
+    // scan for index file, named after the layer too when the dataset has
+    // more than one. Results of sql queries are never indexed.
     size_t breakpoint = dataset_name_.find_last_of(".");
     if (breakpoint == std::string::npos)
     {
         breakpoint = dataset_name_.length();
     }
-    index_name_ = dataset_name_.substr(0, breakpoint) + ".ogrindex";
-
-    std::ifstream index_file(index_name_.c_str(), std::ios::in | std::ios::binary);
-    if (index_file)
+    index_name_ = dataset_name_.substr(0, breakpoint);
+    if (dataset_->GetLayerCount() > 1)
     {
-        indexed_ = true;
-        index_file.close();
+        index_name_ += "." + layer_name_;
     }
-#if 0
-    // TODO - enable this warning once the ogrindex tool is a bit more stable/mature
-    else
+    index_name_ += ".ogrindex";
+
+    if (! layer_by_sql && params_.get<std::string>("file"))
     {
-        MAPNIK_LOG_DEBUG(ogr) << "ogr_datasource: no ogrindex file found for " << dataset_name_
-                              << ", use the 'ogrindex' program to build an index for faster rendering";
+        bool auto_index = *params_.get<mapnik::boolean>("auto_index", true);
+        boost::system::error_code ec;
+        bool index_exists = boost::filesystem::exists(index_name_, ec);
+        if (index_exists && boost::filesystem::exists(dataset_name_, ec))
+        {
+            std::time_t index_time = boost::filesystem::last_write_time(index_name_, ec);
+            std::time_t data_time = boost::filesystem::last_write_time(dataset_name_, ec);
+            // mtimes only have one second resolution and the quadtree has no
+            // room to record the source, so an index written in the same
+            // second as the data may predate the last write and is rebuilt
+            if (! ec && index_time <= data_time)
+            {
+                MAPNIK_LOG_WARN(ogr) << "ogr_datasource: " << index_name_ << " is older than "
+                                     << dataset_name_ << (auto_index ? ", rebuilding it" : ", ignoring it");
+                index_exists = false;
+            }
+        }
+
+        if (index_exists)
+        {
+            indexed_ = true;
+        }
+        else if (auto_index && ! layer->TestCapability(OLCFastSpatialFilter))
+        {
+            // drivers with their own spatial index filter faster than the
+            // quadtree, so only the others get one
+            indexed_ = build_index();
+        }
     }
-#endif
 
 #ifdef MAPNIK_STATS
     mapnik::progress_timer __stats2__(std::clog, "ogr_datasource::bind(get_column_description)");
@@ -337,6 +363,100 @@ void ogr_datasource::bind() const
     is_bound_ = true;
 }
 
+bool ogr_datasource::build_index(unsigned depth, double ratio) const
+{
+#ifdef MAPNIK_STATS
+    mapnik::progress_timer __stats__(std::clog, "ogr_datasource::build_index");
+#endif
+
+    OGRLayer* layer = layer_.layer();
+
+#if GDAL_VERSION_NUM >= 1800
+    // only the geometries are needed
+    std::vector<char const*> ignored;
+    OGRFeatureDefn* def = layer->GetLayerDefn();
+    for (int i = 0; i < def->GetFieldCount(); ++i)
+    {
+        ignored.push_back(def->GetFieldDefn(i)->GetNameRef());
+    }
+    ignored.push_back("OGR_STYLE");
+    ignored.push_back(NULL);
+    layer->SetIgnoredFields(&ignored[0]);
+#endif
+
+    // positions count every feature, like ogr_index_featureset reads them
+    std::vector<std::pair<int, box2d<double> > > items;
+    box2d<double> extent;
+    layer->SetSpatialFilter(NULL);
+    layer->ResetReading();
+    int position = 0;
+    OGRFeature *poFeature;
+    while ((poFeature = layer->GetNextFeature()) != NULL)
+    {
+        OGRGeometry* geom = poFeature->GetGeometryRef();
+        if (geom && ! geom->IsEmpty())
+        {
+            OGREnvelope envelope;
+            geom->getEnvelope(&envelope);
+            box2d<double> item_ext(envelope.MinX, envelope.MinY, envelope.MaxX, envelope.MaxY);
+            if (items.empty()) extent = item_ext;
+            else extent.expand_to_include(item_ext);
+            items.push_back(std::make_pair(position, item_ext));
+        }
+        OGRFeature::DestroyFeature(poFeature);
+        ++position;
+    }
+
+#if GDAL_VERSION_NUM >= 1800
+    layer->SetIgnoredFields(NULL);
+#endif
+
+    // the layer extent may be an estimate, items outside the root are lost
+    quadtree<int> tree(extent, depth, ratio);
+    for (std::size_t i = 0; i < items.size(); ++i)
+    {
+        tree.insert(items[i].first, items[i].second);
+    }
+    tree.trim();
+
+    // written aside and renamed over the old index, which queries running
+    // elsewhere may still have mapped. bind() indexes by default, so other
+    // processes opening the same dataset may be doing this too and each
+    // needs a file of its own
+    std::string const tmp_name = boost::filesystem::unique_path(index_name_ + ".%%%%-%%%%-%%%%.tmp").string();
+    {
+        std::ofstream file(tmp_name.c_str(), std::ios::out | std::ios::trunc | std::ios::binary);
+        if (file)
+        {
+            tree.write(file);
+            file.flush();
+        }
+        if (! file)
+        {
+            MAPNIK_LOG_WARN(ogr) << "ogr_datasource: cannot write " << index_name_
+                                 << ", reading " << dataset_name_ << " without an index";
+            file.close();
+            boost::system::error_code ec;
+            boost::filesystem::remove(tmp_name, ec);
+            return false;
+        }
+    }
+
+    boost::system::error_code ec;
+    boost::filesystem::rename(tmp_name, index_name_, ec);
+    if (ec)
+    {
+        MAPNIK_LOG_WARN(ogr) << "ogr_datasource: cannot write " << index_name_ << ": " << ec.message();
+        boost::filesystem::remove(tmp_name, ec);
+        return false;
+    }
+    mapnik::mapped_memory_cache::instance().remove(index_name_);
+
+    MAPNIK_LOG_DEBUG(ogr) << "ogr_datasource: indexed " << items.size() << " of " << position
+                          << " features in " << index_name_;
+    return true;
+}
+
 const char * ogr_datasource::name()
 {
     return "ogr";
@@ -497,10 +617,18 @@ featureset_ptr ogr_datasource::features(query const& q) const
         std::vector<attribute_descriptor>::const_iterator itr = desc_ar.begin();
         std::vector<attribute_descriptor>::const_iterator end = desc_ar.end();
 
-        for (; itr!=end; ++itr) ctx->push(itr->get_name()); // TODO only push query attributes
-
         validate_attribute_names(q, desc_ar);
 
+        // queries naming no attributes get all of them
+        std::set<std::string> const& names = q.property_names();
+        for (; itr!=end; ++itr)
+        {
+            if (names.empty() || names.count(itr->get_name()))
+            {
+                ctx->push(itr->get_name());
+            }
+        }
+
         OGRLayer* layer = layer_.layer();
 
         if (indexed_)
@@ -511,14 +639,18 @@ featureset_ptr ogr_datasource::features(query const& q) const
                                                                           *layer,
                                                                           filter,
                                                                           index_name_,
-                                                                          desc_.get_encoding()));
+                                                                          q.property_names(),
+                                                                          desc_.get_encoding(),
+                                                                          batch_size_));
         }
         else
         {
             return featureset_ptr(new ogr_featureset(ctx,
                                                       *layer,
                                                       q.get_bbox(),
-                                                      desc_.get_encoding()));
+                                                      q.property_names(),
+                                                      desc_.get_encoding(),
+                                                      batch_size_));
         }
     }
 
@@ -553,7 +685,9 @@ featureset_ptr ogr_datasource::features_at_point(coord2d const& pt, double tol)
                                                                              *layer,
                                                                              filter,
                                                                              index_name_,
-                                                                             desc_.get_encoding()));
+                                                                             std::set<std::string>(),
+                                                                             desc_.get_encoding(),
+                                                                             batch_size_));
         }
         else
         {
@@ -564,7 +698,9 @@ featureset_ptr ogr_datasource::features_at_point(coord2d const& pt, double tol)
             return featureset_ptr(new ogr_featureset (ctx,
                                                       *layer,
                                                       point,
-                                                      desc_.get_encoding()));
+                                                      std::set<std::string>(),
+                                                      desc_.get_encoding(),
+                                                      batch_size_));
         }
     }
 
@@ -58,6 +58,12 @@ public:
     mapnik::layer_descriptor get_descriptor() const;
     void bind() const;
 
+    // Writes a quadtree of the layer's feature extents to index_name(),
+    // the .ogrindex file queries use when it exists. Returns false when
+    // the file cannot be written.
+    bool build_index(unsigned depth = 8, double ratio = 0.55) const;
+    std::string const& index_name() const { return index_name_; }
+
 private:
     mutable mapnik::box2d<double> extent_;
     mapnik::datasource::datasource_t type_;
@@ -68,6 +74,7 @@ private:
     mutable std::string layer_name_;
     mutable mapnik::layer_descriptor desc_;
     mutable bool indexed_;
+    std::size_t batch_size_;
 };
 
 #endif // OGR_DATASOURCE_HPP
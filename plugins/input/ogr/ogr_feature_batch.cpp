@@ -0,0 +1,184 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+
+// ogr
+#include <gdal_version.h>
+#include "ogr_feature_batch.hpp"
+#include "ogr_converter.hpp"
+
+using mapnik::feature_ptr;
+using mapnik::feature_factory;
+using mapnik::transcoder;
+
+ogr_feature_batch::ogr_feature_batch(mapnik::context_ptr const& ctx,
+                                     OGRLayer & layer,
+                                     std::set<std::string> const& names,
+                                     std::string const& encoding,
+                                     std::size_t capacity)
+    : ctx_(ctx),
+      tr_(new transcoder(encoding)),
+      capacity_(capacity > 0 ? capacity : 1)
+{
+    OGRFeatureDefn* layerdef = layer.GetLayerDefn();
+    std::vector<char const*> ignored;
+
+    int fld_count = layerdef->GetFieldCount();
+    for (int i = 0; i < fld_count; i++)
+    {
+        OGRFieldDefn* fld = layerdef->GetFieldDefn(i);
+        field f;
+        f.index = i;
+        f.name = fld->GetNameRef();
+        f.type = fld->GetType();
+
+        if (! names.empty() && names.find(f.name) == names.end())
+        {
+            ignored.push_back(fld->GetNameRef());
+            continue;
+        }
+
+        switch (f.type)
+        {
+        case OFTInteger:
+        case OFTReal:
+        case OFTString:
+        case OFTWideString:     // deprecated !
+            fields_.push_back(f);
+            break;
+
+        case OFTIntegerList:
+        case OFTRealList:
+        case OFTStringList:
+        case OFTWideStringList: // deprecated !
+        case OFTBinary:
+        case OFTDate:
+        case OFTTime:
+        case OFTDateTime:       // unhandled !
+        {
+            MAPNIK_LOG_WARN(ogr) << "ogr_feature_batch: Unhandled type_oid=" << f.type;
+            break;
+        }
+
+        default: // unknown
+        {
+            MAPNIK_LOG_WARN(ogr) << "ogr_feature_batch: Unknown type_oid=" << f.type;
+            break;
+        }
+        }
+    }
+
+#if GDAL_VERSION_NUM >= 1800
+    if (ignored.empty())
+    {
+        layer.SetIgnoredFields(NULL);
+    }
+    else
+    {
+        ignored.push_back("OGR_STYLE");
+        ignored.push_back(NULL);
+        layer.SetIgnoredFields(&ignored[0]);
+    }
+#endif
+
+    features_.reserve(capacity_);
+    converted_.reserve(capacity_);
+}
+
+ogr_feature_batch::~ogr_feature_batch()
+{
+    clear();
+}
+
+void ogr_feature_batch::add(OGRFeature* feature)
+{
+    features_.push_back(feature);
+}
+
+void ogr_feature_batch::convert(std::deque<feature_ptr> & out)
+{
+    std::size_t size = features_.size();
+    for (std::size_t j = 0; j < size; ++j)
+    {
+        // ogr feature ids start at 0, so add one to stay
+        // consistent with other mapnik datasources that start at 1
+        const int feature_id = (features_[j]->GetFID() + 1);
+        feature_ptr feature(feature_factory::create(ctx_, feature_id));
+        ogr_converter::convert_geometry(features_[j]->GetGeometryRef(), feature);
+        converted_.push_back(feature);
+    }
+
+    std::vector<field>::const_iterator itr = fields_.begin();
+    std::vector<field>::const_iterator end = fields_.end();
+    for (; itr != end; ++itr)
+    {
+        switch (itr->type)
+        {
+        case OFTInteger:
+        {
+            for (std::size_t j = 0; j < size; ++j)
+            {
+                converted_[j]->put(itr->name, features_[j]->GetFieldAsInteger(itr->index));
+            }
+            break;
+        }
+
+        case OFTReal:
+        {
+            for (std::size_t j = 0; j < size; ++j)
+            {
+                converted_[j]->put(itr->name, features_[j]->GetFieldAsDouble(itr->index));
+            }
+            break;
+        }
+
+        default: // OFTString and OFTWideString
+        {
+            for (std::size_t j = 0; j < size; ++j)
+            {
+                UnicodeString ustr = tr_->transcode(features_[j]->GetFieldAsString(itr->index));
+                converted_[j]->put(itr->name, ustr);
+            }
+            break;
+        }
+        }
+    }
+
+    out.insert(out.end(), converted_.begin(), converted_.end());
+    converted_.clear();
+    clear();
+}
+
+void ogr_feature_batch::clear()
+{
+    std::vector<OGRFeature*>::iterator itr = features_.begin();
+    std::vector<OGRFeature*>::iterator end = features_.end();
+    for (; itr != end; ++itr)
+    {
+        OGRFeature::DestroyFeature(*itr);
+    }
+    features_.clear();
+}
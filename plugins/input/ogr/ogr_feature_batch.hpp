@@ -0,0 +1,84 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef OGR_FEATURE_BATCH_HPP
+#define OGR_FEATURE_BATCH_HPP
+
+// mapnik
+#include <mapnik/datasource.hpp>
+#include <mapnik/unicode.hpp>
+
+// boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/utility.hpp>
+
+// stl
+#include <deque>
+#include <set>
+#include <string>
+#include <vector>
+
+// ogr
+#include <ogrsf_frmts.h>
+
+// A block of ogr features converted to mapnik features together: all the
+// geometries first, then the attributes one field at a time, so the field
+// lookups and type dispatch happen once per block instead of per feature.
+class ogr_feature_batch : private boost::noncopyable
+{
+public:
+    // Converts the fields named in names, or every field when names is
+    // empty, and tells the layer to skip reading the others.
+    ogr_feature_batch(mapnik::context_ptr const& ctx,
+                      OGRLayer & layer,
+                      std::set<std::string> const& names,
+                      std::string const& encoding,
+                      std::size_t capacity);
+    ~ogr_feature_batch();
+
+    // takes ownership of a feature that has a geometry
+    void add(OGRFeature* feature);
+    bool full() const { return features_.size() >= capacity_; }
+    bool empty() const { return features_.empty(); }
+
+    // appends the converted features to out and releases the ogr ones
+    void convert(std::deque<mapnik::feature_ptr> & out);
+
+private:
+    struct field
+    {
+        int index;
+        std::string name;
+        OGRFieldType type;
+    };
+
+    void clear();
+
+    mapnik::context_ptr ctx_;
+    std::vector<field> fields_;
+    boost::scoped_ptr<mapnik::transcoder> tr_;
+    std::size_t capacity_;
+    std::vector<OGRFeature*> features_;
+    std::vector<mapnik::feature_ptr> converted_;
+};
+
+#endif // OGR_FEATURE_BATCH_HPP
@@ -48,12 +48,11 @@ using mapnik::feature_factory;
 ogr_featureset::ogr_featureset(mapnik::context_ptr const & ctx,
                                OGRLayer & layer,
                                OGRGeometry & extent,
-                               std::string const& encoding)
-    : ctx_(ctx),
-      layer_(layer),
-      layerdef_(layer.GetLayerDefn()),
-      tr_(new transcoder(encoding)),
-      fidcolumn_(layer_.GetFIDColumn ()),
+                               std::set<std::string> const& names,
+                               std::string const& encoding,
+                               std::size_t batch_size)
+    : layer_(layer),
+      batch_(ctx, layer, names, encoding, batch_size),
       count_(0)
 
 {
@@ -63,12 +62,11 @@ ogr_featureset::ogr_featureset(mapnik::context_ptr const & ctx,
 ogr_featureset::ogr_featureset(mapnik::context_ptr const& ctx,
                                OGRLayer & layer,
                                mapnik::box2d<double> const& extent,
-                               std::string const& encoding)
-    : ctx_(ctx),
-      layer_(layer),
-      layerdef_(layer.GetLayerDefn()),
-      tr_(new transcoder(encoding)),
-      fidcolumn_(layer_.GetFIDColumn()),
+                               std::set<std::string> const& names,
+                               std::string const& encoding,
+                               std::size_t batch_size)
+    : layer_(layer),
+      batch_(ctx, layer, names, encoding, batch_size),
       count_(0)
 {
     layer_.SetSpatialFilterRect (extent.minx(),
@@ -83,90 +81,31 @@ ogr_featureset::~ogr_featureset()
 
 feature_ptr ogr_featureset::next()
 {
-    OGRFeature *poFeature;
-    while ((poFeature = layer_.GetNextFeature()) != NULL)
+    if (features_.empty())
     {
-        // ogr feature ids start at 0, so add one to stay
-        // consistent with other mapnik datasources that start at 1
-        const int feature_id = (poFeature->GetFID() + 1);
-        feature_ptr feature(feature_factory::create(ctx_,feature_id));
-
-        OGRGeometry* geom = poFeature->GetGeometryRef();
-        if (geom && ! geom->IsEmpty())
-        {
-            ogr_converter::convert_geometry(geom, feature);
-        }
-        else
-        {
-            MAPNIK_LOG_DEBUG(ogr) << "ogr_featureset: Feature with null geometry="
-                << poFeature->GetFID();
-            OGRFeature::DestroyFeature( poFeature );
-            continue;
-        }
-
-        ++count_;
-
-        int fld_count = layerdef_->GetFieldCount();
-        for (int i = 0; i < fld_count; i++)
+        OGRFeature *poFeature;
+        while (! batch_.full() && (poFeature = layer_.GetNextFeature()) != NULL)
         {
-            OGRFieldDefn* fld = layerdef_->GetFieldDefn(i);
-            const OGRFieldType type_oid = fld->GetType();
-            const std::string fld_name = fld->GetNameRef();
-
-            switch (type_oid)
-            {
-            case OFTInteger:
-            {
-                feature->put( fld_name, poFeature->GetFieldAsInteger(i));
-                break;
-            }
-
-            case OFTReal:
+            OGRGeometry* geom = poFeature->GetGeometryRef();
+            if (geom && ! geom->IsEmpty())
             {
-                feature->put( fld_name, poFeature->GetFieldAsDouble(i));
-                break;
+                batch_.add(poFeature);
             }
-
-            case OFTString:
-            case OFTWideString:     // deprecated !
+            else
             {
-                UnicodeString ustr = tr_->transcode(poFeature->GetFieldAsString(i));
-                feature->put( fld_name, ustr);
-                break;
-            }
-
-            case OFTIntegerList:
-            case OFTRealList:
-            case OFTStringList:
-            case OFTWideStringList: // deprecated !
-            {
-                MAPNIK_LOG_WARN(ogr) << "ogr_featureset: Unhandled type_oid=" << type_oid;
-                break;
-            }
-
-            case OFTBinary:
-            {
-                MAPNIK_LOG_WARN(ogr) << "ogr_featureset: Unhandled type_oid=" << type_oid;
-                //feature->put(name,feat->GetFieldAsBinary (i, size));
-                break;
-            }
-
-            case OFTDate:
-            case OFTTime:
-            case OFTDateTime:       // unhandled !
-            {
-                MAPNIK_LOG_WARN(ogr) << "ogr_featureset: Unhandled type_oid=" << type_oid;
-                break;
-            }
-
-            default: // unknown
-            {
-                MAPNIK_LOG_WARN(ogr) << "ogr_featureset: Unknown type_oid=" << type_oid;
-                break;
-            }
+                MAPNIK_LOG_DEBUG(ogr) << "ogr_featureset: Feature with null geometry="
+                    << poFeature->GetFID();
+                OGRFeature::DestroyFeature( poFeature );
             }
         }
-        OGRFeature::DestroyFeature( poFeature );
+        batch_.convert(features_);
+    }
+
+    if (! features_.empty())
+    {
+        feature_ptr feature = features_.front();
+        features_.pop_front();
+        ++count_;
         return feature;
     }
 
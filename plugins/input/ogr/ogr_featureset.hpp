@@ -28,11 +28,13 @@
 #include <mapnik/unicode.hpp>
 #include <mapnik/geom_util.hpp>
 
-// boost
-#include <boost/scoped_ptr.hpp>
+// stl
+#include <deque>
+#include <set>
 
 // ogr
 #include <ogrsf_frmts.h>
+#include "ogr_feature_batch.hpp"
 
 class ogr_featureset : public mapnik::Featureset
 {
@@ -40,21 +42,23 @@ public:
     ogr_featureset(mapnik::context_ptr const& ctx,
                    OGRLayer & layer,
                    OGRGeometry & extent,
-                   std::string const& encoding);
+                   std::set<std::string> const& names,
+                   std::string const& encoding,
+                   std::size_t batch_size);
 
     ogr_featureset(mapnik::context_ptr const& ctx,
                    OGRLayer & layer,
                    mapnik::box2d<double> const& extent,
-                   std::string const& encoding);
+                   std::set<std::string> const& names,
+                   std::string const& encoding,
+                   std::size_t batch_size);
 
     virtual ~ogr_featureset();
     mapnik::feature_ptr next();
 private:
-    mapnik::context_ptr ctx_;
     OGRLayer& layer_;
-    OGRFeatureDefn* layerdef_;
-    boost::scoped_ptr<mapnik::transcoder> tr_;
-    const char* fidcolumn_;
+    ogr_feature_batch batch_;
+    std::deque<mapnik::feature_ptr> features_;
     mutable int count_;
 };
 
@@ -49,18 +49,54 @@ using mapnik::geometry_utils;
 using mapnik::transcoder;
 using mapnik::feature_factory;
 
+namespace {
+
+// the geometries ogr filters an unindexed read with
+OGRGeometry* filter_geometry(mapnik::filter_in_box const& filter)
+{
+    box2d<double> const& box = filter.box_;
+    OGRLinearRing ring;
+    ring.addPoint(box.minx(), box.miny());
+    ring.addPoint(box.minx(), box.maxy());
+    ring.addPoint(box.maxx(), box.maxy());
+    ring.addPoint(box.maxx(), box.miny());
+    ring.addPoint(box.minx(), box.miny());
+    OGRPolygon* polygon = new OGRPolygon();
+    polygon->addRing(&ring);
+    return polygon;
+}
+
+OGRGeometry* filter_geometry(mapnik::filter_at_point const& filter)
+{
+    return new OGRPoint(filter.pt_.x, filter.pt_.y);
+}
+
+bool within(mapnik::filter_in_box const& filter, box2d<double> const& extent)
+{
+    return filter.box_.contains(extent);
+}
+
+bool within(mapnik::filter_at_point const&, box2d<double> const&)
+{
+    return false;
+}
+
+}
+
 template <typename filterT>
 ogr_index_featureset<filterT>::ogr_index_featureset(mapnik::context_ptr const & ctx,
                                                     OGRLayer & layer,
                                                     filterT const& filter,
                                                     std::string const& index_file,
-                                                    std::string const& encoding)
-    : ctx_(ctx),
-      layer_(layer),
-      layerdef_(layer.GetLayerDefn()),
+                                                    std::set<std::string> const& names,
+                                                    std::string const& encoding,
+                                                    std::size_t batch_size)
+    : layer_(layer),
       filter_(filter),
-      tr_(new transcoder(encoding)),
-      fidcolumn_(layer_.GetFIDColumn())
+      filter_geom_(filter_geometry(filter)),
+      next_pos_(0),
+      fast_seek_(layer.TestCapability(OLCFastSetNextByIndex)),
+      batch_(ctx, layer, names, encoding, batch_size)
 {
 
     boost::optional<mapnik::mapped_region_ptr> memory = mapnik::mapped_memory_cache::instance().find(index_file.c_str(),true);
@@ -76,7 +112,8 @@ ogr_index_featureset<filterT>::ogr_index_featureset(mapnik::context_ptr const &
 
     itr_ = ids_.begin();
 
-    // reset reading
+    // index positions count every feature of the layer
+    layer_.SetSpatialFilter(NULL);
     layer_.ResetReading();
 }
 
@@ -86,94 +123,92 @@ ogr_index_featureset<filterT>::~ogr_index_featureset() {}
 template <typename filterT>
 feature_ptr ogr_index_featureset<filterT>::next()
 {
-    while (itr_ != ids_.end())
+    if (features_.empty())
     {
-        int pos = *itr_++;
-        layer_.SetNextByIndex (pos);
-
-        OGRFeature *poFeature = layer_.GetNextFeature();
-        if (poFeature == NULL)
+        while (! batch_.full() && itr_ != ids_.end())
         {
-            return feature_ptr();
-        }
-
-        // ogr feature ids start at 0, so add one to stay
-        // consistent with other mapnik datasources that start at 1
-        int feature_id = (poFeature->GetFID() + 1);
-        feature_ptr feature(feature_factory::create(ctx_,feature_id));
-
-        OGRGeometry* geom=poFeature->GetGeometryRef();
-        if (geom && !geom->IsEmpty())
-        {
-            ogr_converter::convert_geometry (geom, feature);
-        }
-        else
-        {
-            MAPNIK_LOG_DEBUG(ogr) << "ogr_index_featureset: Feature with null geometry="
-                << poFeature->GetFID();
-            OGRFeature::DestroyFeature( poFeature );
-            continue;
-        }
-
-        int fld_count = layerdef_->GetFieldCount();
-        for (int i = 0; i < fld_count; i++)
-        {
-            OGRFieldDefn* fld = layerdef_->GetFieldDefn (i);
-            OGRFieldType type_oid = fld->GetType ();
-            std::string fld_name = fld->GetNameRef ();
-
-            switch (type_oid)
+            OGRFeature *poFeature = read(*itr_++);
+            if (poFeature == NULL)
             {
-            case OFTInteger:
-            {
-                feature->put(fld_name,poFeature->GetFieldAsInteger (i));
+                itr_ = ids_.end();
                 break;
             }
 
-            case OFTReal:
+            OGRGeometry* geom = poFeature->GetGeometryRef();
+            if (geom && ! geom->IsEmpty())
             {
-                feature->put(fld_name,poFeature->GetFieldAsDouble (i));
-                break;
+                if (pass(geom))
+                {
+                    batch_.add(poFeature);
+                    continue;
+                }
             }
-
-            case OFTString:
-            case OFTWideString:     // deprecated !
+            else
             {
-                UnicodeString ustr = tr_->transcode(poFeature->GetFieldAsString (i));
-                feature->put(fld_name,ustr);
-                break;
+                MAPNIK_LOG_DEBUG(ogr) << "ogr_index_featureset: Feature with null geometry="
+                    << poFeature->GetFID();
             }
+            OGRFeature::DestroyFeature( poFeature );
+        }
+        batch_.convert(features_);
+    }
 
-            case OFTIntegerList:
-            case OFTRealList:
-            case OFTStringList:
-            case OFTWideStringList: // deprecated !
-            {
-                MAPNIK_LOG_WARN(ogr) << "ogr_index_featureset: Unhandled type_oid=" << type_oid;
-                break;
-            }
+    if (! features_.empty())
+    {
+        feature_ptr feature = features_.front();
+        features_.pop_front();
+        return feature;
+    }
 
-            case OFTBinary:
-            {
-                MAPNIK_LOG_WARN(ogr) << "ogr_index_featureset: Unhandled type_oid=" << type_oid;
-                //feature->put(name,feat->GetFieldAsBinary (i, size));
-                break;
-            }
+    return feature_ptr();
+}
 
-            case OFTDate:
-            case OFTTime:
-            case OFTDateTime:       // unhandled !
+template <typename filterT>
+OGRFeature* ogr_index_featureset<filterT>::read(int pos)
+{
+    if (pos != next_pos_)
+    {
+        if (fast_seek_ || pos < next_pos_)
+        {
+            layer_.SetNextByIndex(pos);
+        }
+        else
+        {
+            // drivers without fast seeking restart the read to seek,
+            // so read forward to the position instead
+            while (next_pos_ < pos)
             {
-                MAPNIK_LOG_WARN(ogr) << "ogr_index_featureset: Unhandled type_oid=" << type_oid;
-                break;
-            }
+                OGRFeature* skipped = layer_.GetNextFeature();
+                if (skipped == NULL)
+                {
+                    return NULL;
+                }
+                OGRFeature::DestroyFeature(skipped);
+                ++next_pos_;
             }
         }
-        OGRFeature::DestroyFeature( poFeature );
-        return feature;
     }
+    next_pos_ = pos + 1;
+    return layer_.GetNextFeature();
+}
 
-    return feature_ptr();
+template <typename filterT>
+bool ogr_index_featureset<filterT>::pass(OGRGeometry* geom) const
+{
+    // the index only narrows the read down to tree nodes, so test
+    // each feature the way ogr would without the index
+    OGREnvelope envelope;
+    geom->getEnvelope(&envelope);
+    box2d<double> extent(envelope.MinX, envelope.MinY, envelope.MaxX, envelope.MaxY);
+    if (! filter_.pass(extent))
+    {
+        return false;
+    }
+    if (within(filter_, extent) || ! OGRGeometryFactory::haveGEOS())
+    {
+        return true;
+    }
+    return filter_geom_->Intersects(geom);
 }
 
 template class ogr_index_featureset<mapnik::filter_in_box>;
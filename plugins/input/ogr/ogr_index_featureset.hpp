@@ -23,10 +23,12 @@
 #ifndef OGR_INDEX_FEATURESET_HPP
 #define OGR_INDEX_FEATURESET_HPP
 
+#include <deque>
 #include <set>
 #include <vector>
 #include <boost/scoped_ptr.hpp>
 #include "ogr_featureset.hpp"
+#include "ogr_feature_batch.hpp"
 
 template <typename filterT>
 class ogr_index_featureset : public mapnik::Featureset
@@ -36,19 +38,27 @@ public:
                          OGRLayer& layer,
                          filterT const& filter,
                          std::string const& index_file,
-                         std::string const& encoding);
+                         std::set<std::string> const& names,
+                         std::string const& encoding,
+                         std::size_t batch_size);
 
     virtual ~ogr_index_featureset();
     mapnik::feature_ptr next();
 private:
-    mapnik::context_ptr ctx_;
+    OGRFeature* read(int pos);
+    bool pass(OGRGeometry* geom) const;
+
     OGRLayer& layer_;
-    OGRFeatureDefn* layerdef_;
     filterT filter_;
+    // what ogr itself tests features against in an unindexed read
+    boost::scoped_ptr<OGRGeometry> filter_geom_;
     std::vector<int> ids_;
     std::vector<int>::iterator itr_;
-    boost::scoped_ptr<mapnik::transcoder> tr_;
-    const char* fidcolumn_;
+    // the position GetNextFeature reads next
+    int next_pos_;
+    bool fast_seek_;
+    ogr_feature_batch batch_;
+    std::deque<mapnik::feature_ptr> features_;
 };
 
 #endif // OGR_INDEX_FEATURESET_HPP
@@ -32,6 +32,8 @@ osm_src = Split(
   osm.cpp
   osm_datasource.cpp
   osm_featureset.cpp 
+  osm_pbf.cpp
+  osm_pbf_featureset.cpp
   dataset_deliverer.cpp
   basiccurl.cpp
   """
@@ -39,6 +41,7 @@ osm_src = Split(
 
 libraries = [ 'xml2' ]
 libraries.append('curl')
+libraries.append('z')
 libraries.append('mapnik')
 libraries.append(env['ICU_LIB_NAME'])
 libraries.append('boost_system%s' % env['BOOST_APPEND'])
@@ -35,9 +35,12 @@
 
 // boost
 #include <boost/make_shared.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/algorithm/string/predicate.hpp>
 
 #include "osm_datasource.hpp"
 #include "osm_featureset.hpp"
+#include "osm_pbf_featureset.hpp"
 #include "dataset_deliverer.h"
 #include "osmtagtypes.h"
 #include "osmparser.h"
@@ -75,6 +78,31 @@ void osm_datasource::bind() const
     std::string bbox = *params_.get<std::string>("bbox", "");
 
 
+    osm_tag_types tagtypes;
+    tagtypes.add_type("maxspeed", mapnik::Integer);
+    tagtypes.add_type("z_order", mapnik::Integer);
+
+    // pbf extracts are held in the compact dataset
+    if (osm_filename != "" && (parser == "pbf" || boost::algorithm::iends_with(osm_filename, ".pbf")))
+    {
+        if (!boost::filesystem::exists(osm_filename))
+        {
+            throw datasource_exception("OSM Plugin: '" + osm_filename + "' does not exist");
+        }
+        boost::shared_ptr<osm_pbf_dataset> data = boost::make_shared<osm_pbf_dataset>();
+        data->load(osm_filename);
+
+        std::set<std::string> keys = data->keys();
+        for (std::set<std::string>::iterator i = keys.begin(); i != keys.end(); i++)
+        {
+            desc_.add_descriptor(attribute_descriptor(*i, tagtypes.get_type(*i)));
+        }
+        extent_ = data->extent();
+        pbf_data_ = data;
+        is_bound_ = true;
+        return;
+    }
+
     // load the data
     if (url != "" && bbox != "")
     {
@@ -101,11 +129,6 @@ void osm_datasource::bind() const
         throw datasource_exception("OSM Plugin: Neither 'file' nor 'url' and 'bbox' specified");
     }
 
-
-    osm_tag_types tagtypes;
-    tagtypes.add_type("maxspeed", mapnik::Integer);
-    tagtypes.add_type("z_order", mapnik::Integer);
-
     osm_data_->rewind();
 
     // Need code to get the attributes of all the data
@@ -152,6 +175,14 @@ featureset_ptr osm_datasource::features(const query& q) const
     filter_in_box filter(q.get_bbox());
     // so we need to filter osm features by bbox here...
 
+    if (pbf_data_)
+    {
+        return boost::make_shared<osm_pbf_featureset<filter_in_box> >(filter,
+                                                                      pbf_data_,
+                                                                      q.property_names(),
+                                                                      desc_.get_encoding());
+    }
+
     return boost::make_shared<osm_featureset<filter_in_box> >(filter,
                                                               osm_data_,
                                                               q.property_names(),
@@ -175,6 +206,14 @@ featureset_ptr osm_datasource::features_at_point(coord2d const& pt, double tol)
         ++itr;
     }
 
+    if (pbf_data_)
+    {
+        return boost::make_shared<osm_pbf_featureset<filter_at_point> >(filter,
+                                                                        pbf_data_,
+                                                                        names,
+                                                                        desc_.get_encoding());
+    }
+
     return boost::make_shared<osm_featureset<filter_at_point> >(filter,
                                                                 osm_data_,
                                                                 names,
@@ -41,6 +41,7 @@
 #include <string>
 
 #include "osm.h"
+#include "osm_pbf.h"
 
 using mapnik::datasource;
 using mapnik::parameters;
@@ -67,6 +68,7 @@ public:
 private:
     mutable box2d<double> extent_;
     mutable osm_dataset* osm_data_;
+    mutable boost::shared_ptr<osm_pbf_dataset const> pbf_data_;
     mapnik::datasource::datasource_t type_;
     mutable layer_descriptor desc_;
 };
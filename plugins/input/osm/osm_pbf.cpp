@@ -0,0 +1,679 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/debug.hpp>
+#include <mapnik/datasource.hpp>
+
+// stl
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+// zlib
+#include <zlib.h>
+
+#include "osm.h"
+#include "osm_pbf.h"
+
+namespace {
+
+// the largest blob the format allows
+std::size_t const max_blob_size = 32 * 1024 * 1024;
+
+void pbf_error(std::string const& what)
+{
+    throw mapnik::datasource_exception("OSM Plugin: invalid pbf data, " + what);
+}
+
+// Reads the fields of one protocol buffers message in order. After next()
+// the value of the field is read with one of varint, svarint, bytes or skip.
+class pbf_message
+{
+public:
+    pbf_message(char const* data, std::size_t size)
+        : pos_(data),
+          end_(data + size),
+          tag_(0),
+          type_(0)
+    {
+    }
+
+    bool next()
+    {
+        if (pos_ >= end_) return false;
+        boost::uint64_t key = read_varint();
+        tag_ = static_cast<unsigned>(key >> 3);
+        type_ = static_cast<unsigned>(key & 0x7);
+        return true;
+    }
+
+    unsigned tag() const { return tag_; }
+
+    bool at_end() const { return pos_ >= end_; }
+
+    boost::uint64_t varint()
+    {
+        if (type_ != 0) pbf_error("expected a varint");
+        return read_varint();
+    }
+
+    boost::int64_t svarint()
+    {
+        return zigzag(varint());
+    }
+
+    // the raw value of a length delimited field
+    std::pair<char const*, std::size_t> bytes()
+    {
+        if (type_ != 2) pbf_error("expected a length delimited field");
+        std::size_t size = static_cast<std::size_t>(read_varint());
+        if (size > static_cast<std::size_t>(end_ - pos_)) pbf_error("field past end of message");
+        std::pair<char const*, std::size_t> result(pos_, size);
+        pos_ += size;
+        return result;
+    }
+
+    pbf_message message()
+    {
+        std::pair<char const*, std::size_t> data = bytes();
+        return pbf_message(data.first, data.second);
+    }
+
+    std::string string()
+    {
+        std::pair<char const*, std::size_t> data = bytes();
+        return std::string(data.first, data.second);
+    }
+
+    void skip()
+    {
+        switch (type_)
+        {
+        case 0: read_varint(); break;
+        case 1: advance(8); break;
+        case 2: bytes(); break;
+        case 5: advance(4); break;
+        default: pbf_error("unsupported wire type");
+        }
+    }
+
+    // values of a packed repeated field, as a message of bare varints
+    boost::uint64_t read_varint()
+    {
+        boost::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (pos_ >= end_) pbf_error("truncated varint");
+            boost::uint8_t byte = static_cast<boost::uint8_t>(*pos_++);
+            value |= static_cast<boost::uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0) return value;
+        }
+        pbf_error("varint too long");
+        return 0;
+    }
+
+    boost::int64_t read_svarint()
+    {
+        return zigzag(read_varint());
+    }
+
+private:
+    static boost::int64_t zigzag(boost::uint64_t value)
+    {
+        return static_cast<boost::int64_t>(value >> 1) ^ -static_cast<boost::int64_t>(value & 1);
+    }
+
+    void advance(std::size_t count)
+    {
+        if (count > static_cast<std::size_t>(end_ - pos_)) pbf_error("field past end of message");
+        pos_ += count;
+    }
+
+    char const* pos_;
+    char const* end_;
+    unsigned tag_;
+    unsigned type_;
+};
+
+// reads the next blob of the file into data, decompressed, and its type
+bool read_blob(std::ifstream & file, std::string & type,
+               std::vector<char> & buffer, std::vector<char> & data)
+{
+    unsigned char size_bytes[4];
+    if (!file.read(reinterpret_cast<char*>(size_bytes), 4))
+    {
+        return false;
+    }
+    std::size_t header_size = (size_bytes[0] << 24) | (size_bytes[1] << 16) | (size_bytes[2] << 8) | size_bytes[3];
+    if (header_size > 64 * 1024) pbf_error("blob header too large");
+
+    buffer.resize(header_size);
+    if (header_size > 0 && !file.read(&buffer[0], header_size)) pbf_error("truncated blob header");
+
+    std::size_t blob_size = 0;
+    type.clear();
+    pbf_message header(header_size > 0 ? &buffer[0] : 0, header_size);
+    while (header.next())
+    {
+        switch (header.tag())
+        {
+        case 1: type = header.string(); break;
+        case 3: blob_size = static_cast<std::size_t>(header.varint()); break;
+        default: header.skip();
+        }
+    }
+    if (blob_size > max_blob_size) pbf_error("blob too large");
+
+    buffer.resize(blob_size);
+    if (blob_size > 0 && !file.read(&buffer[0], blob_size)) pbf_error("truncated blob");
+
+    std::pair<char const*, std::size_t> raw(0, 0);
+    std::pair<char const*, std::size_t> zlib_data(0, 0);
+    std::size_t raw_size = 0;
+    pbf_message blob(blob_size > 0 ? &buffer[0] : 0, blob_size);
+    while (blob.next())
+    {
+        switch (blob.tag())
+        {
+        case 1: raw = blob.bytes(); break;
+        case 2: raw_size = static_cast<std::size_t>(blob.varint()); break;
+        case 3: zlib_data = blob.bytes(); break;
+        case 4:
+        case 5:
+            throw mapnik::datasource_exception("OSM Plugin: only raw and zlib compressed pbf blobs are supported");
+        default: blob.skip();
+        }
+    }
+
+    if (raw.first)
+    {
+        data.assign(raw.first, raw.first + raw.second);
+    }
+    else if (zlib_data.first)
+    {
+        if (raw_size > max_blob_size) pbf_error("blob too large");
+        data.resize(raw_size);
+        uLongf size = static_cast<uLongf>(raw_size);
+        if (uncompress(reinterpret_cast<Bytef*>(raw_size > 0 ? &data[0] : 0), &size,
+                       reinterpret_cast<Bytef const*>(zlib_data.first),
+                       static_cast<uLong>(zlib_data.second)) != Z_OK || size != raw_size)
+        {
+            pbf_error("cannot decompress blob");
+        }
+    }
+    else
+    {
+        data.clear();
+    }
+    return true;
+}
+
+double to_degrees(boost::int64_t nanodegrees)
+{
+    return nanodegrees * 1e-9;
+}
+
+struct less_id
+{
+    std::vector<boost::int64_t> const& ids;
+    explicit less_id(std::vector<boost::int64_t> const& ids_) : ids(ids_) {}
+    bool operator()(unsigned a, unsigned b) const { return ids[a] < ids[b]; }
+};
+
+}
+
+unsigned osm_string_table::intern(std::string const& str)
+{
+    boost::unordered_map<std::string, unsigned>::const_iterator itr = ids_.find(str);
+    if (itr != ids_.end())
+    {
+        return itr->second;
+    }
+    unsigned id = static_cast<unsigned>(strings_.size());
+    strings_.push_back(str);
+    ids_.insert(std::make_pair(str, id));
+    return id;
+}
+
+int osm_string_table::find(std::string const& str) const
+{
+    boost::unordered_map<std::string, unsigned>::const_iterator itr = ids_.find(str);
+    return itr != ids_.end() ? static_cast<int>(itr->second) : -1;
+}
+
+// A primitive block: its string table, interned on first use, and how its
+// coordinates are scaled.
+struct osm_pbf_dataset::block
+{
+    std::vector<std::pair<char const*, std::size_t> > strings;
+    std::vector<int> ids;
+    boost::int64_t granularity;
+    boost::int64_t lat_offset;
+    boost::int64_t lon_offset;
+    osm_string_table & table;
+
+    explicit block(osm_string_table & table_)
+        : granularity(100),
+          lat_offset(0),
+          lon_offset(0),
+          table(table_)
+    {
+    }
+
+    unsigned string(boost::uint64_t index)
+    {
+        if (index >= strings.size()) pbf_error("string index out of range");
+        int & id = ids[index];
+        if (id < 0)
+        {
+            id = static_cast<int>(table.intern(std::string(strings[index].first, strings[index].second)));
+        }
+        return static_cast<unsigned>(id);
+    }
+
+    // coordinates are kept in 1e-7 degrees, as the default granularity gives
+    boost::int32_t lat(boost::int64_t value) const
+    {
+        return static_cast<boost::int32_t>((lat_offset + granularity * value) / 100);
+    }
+
+    boost::int32_t lon(boost::int64_t value) const
+    {
+        return static_cast<boost::int32_t>((lon_offset + granularity * value) / 100);
+    }
+};
+
+osm_pbf_dataset::osm_pbf_dataset()
+{
+}
+
+void osm_pbf_dataset::load(std::string const& filename)
+{
+    std::ifstream file(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!file)
+    {
+        throw mapnik::datasource_exception("OSM Plugin: cannot open '" + filename + "'");
+    }
+
+    std::string type;
+    std::vector<char> buffer;
+    std::vector<char> data;
+    bool header = false;
+    while (read_blob(file, type, buffer, data))
+    {
+        char const* begin = data.empty() ? 0 : &data[0];
+        if (type == "OSMHeader")
+        {
+            read_header(begin, data.size());
+            header = true;
+        }
+        else if (type == "OSMData")
+        {
+            if (!header) pbf_error("data before the header");
+            read_block(begin, data.size());
+        }
+        // other blob types are to be skipped
+    }
+    if (!header) pbf_error("no header");
+    finish();
+
+    MAPNIK_LOG_DEBUG(osm) << "osm_pbf_dataset: Loaded " << ids_.size() << " nodes ("
+                          << nodes_.size() << " tagged), " << ways_.size() << " ways, "
+                          << strings_.size() << " strings from " << filename;
+}
+
+void osm_pbf_dataset::read_header(char const* data, std::size_t size)
+{
+    pbf_message header(data, size);
+    while (header.next())
+    {
+        switch (header.tag())
+        {
+        case 1:
+        {
+            boost::int64_t left = 0, right = 0, top = 0, bottom = 0;
+            pbf_message bbox = header.message();
+            while (bbox.next())
+            {
+                switch (bbox.tag())
+                {
+                case 1: left = bbox.svarint(); break;
+                case 2: right = bbox.svarint(); break;
+                case 3: top = bbox.svarint(); break;
+                case 4: bottom = bbox.svarint(); break;
+                default: bbox.skip();
+                }
+            }
+            extent_.init(to_degrees(left), to_degrees(bottom), to_degrees(right), to_degrees(top));
+            break;
+        }
+        case 4:
+        {
+            std::string feature = header.string();
+            if (feature != "OsmSchema-V0.6" && feature != "DenseNodes")
+            {
+                throw mapnik::datasource_exception("OSM Plugin: unsupported pbf feature '" + feature + "'");
+            }
+            break;
+        }
+        default:
+            header.skip();
+        }
+    }
+}
+
+void osm_pbf_dataset::read_block(char const* data, std::size_t size)
+{
+    // the groups may come before the string table and scaling
+    block blk(strings_);
+    std::vector<std::pair<char const*, std::size_t> > groups;
+    pbf_message msg(data, size);
+    while (msg.next())
+    {
+        switch (msg.tag())
+        {
+        case 1:
+        {
+            pbf_message table = msg.message();
+            while (table.next())
+            {
+                if (table.tag() == 1) blk.strings.push_back(table.bytes());
+                else table.skip();
+            }
+            break;
+        }
+        case 2: groups.push_back(msg.bytes()); break;
+        case 17: blk.granularity = static_cast<boost::int64_t>(msg.varint()); break;
+        case 19: blk.lat_offset = static_cast<boost::int64_t>(msg.varint()); break;
+        case 20: blk.lon_offset = static_cast<boost::int64_t>(msg.varint()); break;
+        default: msg.skip();
+        }
+    }
+    blk.ids.assign(blk.strings.size(), -1);
+
+    for (std::size_t i = 0; i < groups.size(); ++i)
+    {
+        pbf_message group(groups[i].first, groups[i].second);
+        while (group.next())
+        {
+            std::pair<char const*, std::size_t> item;
+            switch (group.tag())
+            {
+            case 1: item = group.bytes(); read_node(blk, item.first, item.second); break;
+            case 2: item = group.bytes(); read_dense_nodes(blk, item.first, item.second); break;
+            case 3: item = group.bytes(); read_way(blk, item.first, item.second); break;
+            default: group.skip();
+            }
+        }
+    }
+}
+
+void osm_pbf_dataset::read_dense_nodes(block & blk, char const* data, std::size_t size)
+{
+    std::pair<char const*, std::size_t> ids(0, 0), lats(0, 0), lons(0, 0), keys_vals(0, 0);
+    pbf_message dense(data, size);
+    while (dense.next())
+    {
+        switch (dense.tag())
+        {
+        case 1: ids = dense.bytes(); break;
+        case 8: lats = dense.bytes(); break;
+        case 9: lons = dense.bytes(); break;
+        case 10: keys_vals = dense.bytes(); break;
+        default: dense.skip();
+        }
+    }
+
+    pbf_message id_values(ids.first, ids.second);
+    pbf_message lat_values(lats.first, lats.second);
+    pbf_message lon_values(lons.first, lons.second);
+    pbf_message tag_values(keys_vals.first, keys_vals.second);
+    boost::int64_t id = 0, lat = 0, lon = 0;
+    while (!id_values.at_end())
+    {
+        id += id_values.read_svarint();
+        lat += lat_values.read_svarint();
+        lon += lon_values.read_svarint();
+        unsigned position = static_cast<unsigned>(ids_.size());
+        ids_.push_back(id);
+        lats_.push_back(blk.lat(lat));
+        lons_.push_back(blk.lon(lon));
+
+        // keys and values of each node, ended by a 0
+        if (!tag_values.at_end())
+        {
+            unsigned first_tag = static_cast<unsigned>(tags_.size());
+            for (;;)
+            {
+                boost::uint64_t key = tag_values.read_varint();
+                if (key == 0) break;
+                osm_tag t;
+                t.key = blk.string(key);
+                t.value = blk.string(tag_values.read_varint());
+                tags_.push_back(t);
+            }
+            if (tags_.size() > first_tag)
+            {
+                node n;
+                n.id = id;
+                n.position = position;
+                n.first_tag = first_tag;
+                n.tag_count = static_cast<unsigned>(tags_.size()) - first_tag;
+                nodes_.push_back(n);
+            }
+        }
+    }
+}
+
+void osm_pbf_dataset::read_node(block & blk, char const* data, std::size_t size)
+{
+    boost::int64_t id = 0, lat = 0, lon = 0;
+    std::pair<char const*, std::size_t> keys(0, 0), vals(0, 0);
+    pbf_message msg(data, size);
+    while (msg.next())
+    {
+        switch (msg.tag())
+        {
+        case 1: id = msg.svarint(); break;
+        case 2: keys = msg.bytes(); break;
+        case 3: vals = msg.bytes(); break;
+        case 8: lat = msg.svarint(); break;
+        case 9: lon = msg.svarint(); break;
+        default: msg.skip();
+        }
+    }
+
+    unsigned position = static_cast<unsigned>(ids_.size());
+    ids_.push_back(id);
+    lats_.push_back(blk.lat(lat));
+    lons_.push_back(blk.lon(lon));
+
+    unsigned first_tag = static_cast<unsigned>(tags_.size());
+    pbf_message key_values(keys.first, keys.second);
+    pbf_message val_values(vals.first, vals.second);
+    while (!key_values.at_end())
+    {
+        osm_tag t;
+        t.key = blk.string(key_values.read_varint());
+        t.value = blk.string(val_values.read_varint());
+        tags_.push_back(t);
+    }
+    if (tags_.size() > first_tag)
+    {
+        node n;
+        n.id = id;
+        n.position = position;
+        n.first_tag = first_tag;
+        n.tag_count = static_cast<unsigned>(tags_.size()) - first_tag;
+        nodes_.push_back(n);
+    }
+}
+
+void osm_pbf_dataset::read_way(block & blk, char const* data, std::size_t size)
+{
+    way w;
+    w.id = 0;
+    w.polygon = false;
+    std::pair<char const*, std::size_t> keys(0, 0), vals(0, 0), refs(0, 0);
+    pbf_message msg(data, size);
+    while (msg.next())
+    {
+        switch (msg.tag())
+        {
+        case 1: w.id = static_cast<boost::int64_t>(msg.varint()); break;
+        case 2: keys = msg.bytes(); break;
+        case 3: vals = msg.bytes(); break;
+        case 8: refs = msg.bytes(); break;
+        default: msg.skip();
+        }
+    }
+
+    w.first_tag = static_cast<unsigned>(tags_.size());
+    pbf_message key_values(keys.first, keys.second);
+    pbf_message val_values(vals.first, vals.second);
+    while (!key_values.at_end())
+    {
+        osm_tag t;
+        t.key = blk.string(key_values.read_varint());
+        t.value = blk.string(val_values.read_varint());
+        tags_.push_back(t);
+    }
+    w.tag_count = static_cast<unsigned>(tags_.size()) - w.first_tag;
+
+    // node ids for now, positions once every node is read
+    w.first_node = static_cast<unsigned>(way_refs_.size());
+    pbf_message ref_values(refs.first, refs.second);
+    boost::int64_t ref = 0;
+    while (!ref_values.at_end())
+    {
+        ref += ref_values.read_svarint();
+        way_refs_.push_back(ref);
+    }
+    w.node_count = static_cast<unsigned>(way_refs_.size()) - w.first_node;
+    ways_.push_back(w);
+}
+
+void osm_pbf_dataset::finish()
+{
+    // files are usually sorted by id already, otherwise sort the
+    // coordinates and move the tagged nodes along
+    std::size_t count = ids_.size();
+    bool sorted = true;
+    for (std::size_t i = 1; i < count && sorted; ++i)
+    {
+        sorted = ids_[i - 1] <= ids_[i];
+    }
+    if (!sorted)
+    {
+        std::vector<unsigned> order(count);
+        for (std::size_t i = 0; i < count; ++i) order[i] = static_cast<unsigned>(i);
+        std::stable_sort(order.begin(), order.end(), less_id(ids_));
+        std::vector<unsigned> moved_to(count);
+        std::vector<boost::int64_t> ids(count);
+        std::vector<boost::int32_t> lons(count), lats(count);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            ids[i] = ids_[order[i]];
+            lons[i] = lons_[order[i]];
+            lats[i] = lats_[order[i]];
+            moved_to[order[i]] = static_cast<unsigned>(i);
+        }
+        ids_.swap(ids);
+        lons_.swap(lons);
+        lats_.swap(lats);
+        for (std::size_t i = 0; i < nodes_.size(); ++i)
+        {
+            nodes_[i].position = moved_to[nodes_[i].position];
+        }
+    }
+
+    // resolve way nodes, dropping those not in the extract
+    polygon_types const& ptypes = osm_way::ptypes;
+    int building = strings_.find("building");
+    way_nodes_.clear();
+    way_nodes_.reserve(way_refs_.size());
+    for (std::size_t i = 0; i < ways_.size(); ++i)
+    {
+        way & w = ways_[i];
+        unsigned first = static_cast<unsigned>(way_nodes_.size());
+        for (unsigned j = 0; j < w.node_count; ++j)
+        {
+            boost::int64_t ref = way_refs_[w.first_node + j];
+            std::vector<boost::int64_t>::const_iterator pos = std::lower_bound(ids_.begin(), ids_.end(), ref);
+            if (pos == ids_.end() || *pos != ref) continue;
+            unsigned position = static_cast<unsigned>(pos - ids_.begin());
+            double x = lon(position);
+            double y = lat(position);
+            if (way_nodes_.size() == first) w.bbox.init(x, y, x, y);
+            else w.bbox.expand_to_include(x, y);
+            way_nodes_.push_back(position);
+        }
+        w.first_node = first;
+        w.node_count = static_cast<unsigned>(way_nodes_.size()) - first;
+
+        // same rules as osm_way::is_polygon
+        for (unsigned j = 0; j < w.tag_count && !w.polygon; ++j)
+        {
+            osm_tag const& t = tags_[w.first_tag + j];
+            if (building >= 0 && t.key == static_cast<unsigned>(building))
+            {
+                w.polygon = true;
+                break;
+            }
+            std::string const& key = strings_.get(t.key);
+            for (std::size_t k = 0; k < ptypes.ptypes.size(); ++k)
+            {
+                if (ptypes.ptypes[k].first == key && ptypes.ptypes[k].second == strings_.get(t.value))
+                {
+                    w.polygon = true;
+                    break;
+                }
+            }
+        }
+    }
+    std::vector<boost::int64_t>().swap(way_refs_);
+
+    if (!extent_.valid() || (extent_.width() == 0 && extent_.height() == 0))
+    {
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            if (i == 0) extent_.init(lon(0), lat(0), lon(0), lat(0));
+            else extent_.expand_to_include(lon(i), lat(i));
+        }
+    }
+}
+
+std::set<std::string> osm_pbf_dataset::keys() const
+{
+    std::set<unsigned> ids;
+    for (std::size_t i = 0; i < tags_.size(); ++i)
+    {
+        ids.insert(tags_[i].key);
+    }
+    std::set<std::string> result;
+    for (std::set<unsigned>::const_iterator itr = ids.begin(); itr != ids.end(); ++itr)
+    {
+        result.insert(strings_.get(*itr));
+    }
+    return result;
+}
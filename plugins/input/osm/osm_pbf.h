@@ -0,0 +1,129 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef OSM_PBF_H
+#define OSM_PBF_H
+
+// mapnik
+#include <mapnik/box2d.hpp>
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/utility.hpp>
+
+// stl
+#include <vector>
+#include <string>
+#include <set>
+
+// Strings of a dataset, each stored once and referred to by position.
+class osm_string_table
+{
+public:
+    unsigned intern(std::string const& str);
+    // the position of str, or -1 when it is not in the table
+    int find(std::string const& str) const;
+    std::string const& get(unsigned id) const { return strings_[id]; }
+    std::size_t size() const { return strings_.size(); }
+
+private:
+    std::vector<std::string> strings_;
+    boost::unordered_map<std::string, unsigned> ids_;
+};
+
+struct osm_tag
+{
+    unsigned key;
+    unsigned value;
+};
+
+// An OpenStreetMap extract read from the PBF format and held compactly.
+// Node coordinates live in arrays sorted by node id, tags are pairs of
+// interned strings and ways are runs of node positions, turned into
+// geometries only for the ways a query extent touches. Only tagged nodes
+// are features. Relations are skipped.
+class osm_pbf_dataset : private boost::noncopyable
+{
+public:
+    struct node
+    {
+        boost::int64_t id;
+        unsigned position; // in the coordinate arrays
+        unsigned first_tag;
+        unsigned tag_count;
+    };
+
+    struct way
+    {
+        boost::int64_t id;
+        unsigned first_node; // in the way node positions
+        unsigned node_count;
+        unsigned first_tag;
+        unsigned tag_count;
+        bool polygon;
+        mapnik::box2d<double> bbox;
+    };
+
+    osm_pbf_dataset();
+
+    // throws mapnik::datasource_exception on malformed or unsupported input
+    void load(std::string const& filename);
+
+    mapnik::box2d<double> const& extent() const { return extent_; }
+    std::set<std::string> keys() const;
+
+    std::vector<node> const& nodes() const { return nodes_; }
+    std::vector<way> const& ways() const { return ways_; }
+    std::size_t node_count() const { return ids_.size(); }
+
+    double lon(unsigned position) const { return lons_[position] * 1e-7; }
+    double lat(unsigned position) const { return lats_[position] * 1e-7; }
+    unsigned way_node(unsigned index) const { return way_nodes_[index]; }
+    osm_tag const& tag(unsigned index) const { return tags_[index]; }
+    osm_string_table const& strings() const { return strings_; }
+
+private:
+    struct block;
+
+    void read_header(char const* data, std::size_t size);
+    void read_block(char const* data, std::size_t size);
+    void read_dense_nodes(block & blk, char const* data, std::size_t size);
+    void read_node(block & blk, char const* data, std::size_t size);
+    void read_way(block & blk, char const* data, std::size_t size);
+    void finish();
+
+    // all nodes, by id once loaded, coordinates in 1e-7 degrees
+    std::vector<boost::int64_t> ids_;
+    std::vector<boost::int32_t> lons_;
+    std::vector<boost::int32_t> lats_;
+    std::vector<node> nodes_;
+    std::vector<way> ways_;
+    std::vector<unsigned> way_nodes_;
+    // node ids of the ways, until every node is read
+    std::vector<boost::int64_t> way_refs_;
+    std::vector<osm_tag> tags_;
+    osm_string_table strings_;
+    mapnik::box2d<double> extent_;
+};
+
+#endif // OSM_PBF_H
@@ -0,0 +1,128 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/geometry.hpp>
+#include <mapnik/feature_factory.hpp>
+
+// boost
+#include <boost/make_shared.hpp>
+
+#include "osm_pbf_featureset.hpp"
+
+using mapnik::feature_ptr;
+using mapnik::geometry_type;
+using mapnik::feature_factory;
+
+template <typename filterT>
+osm_pbf_featureset<filterT>::osm_pbf_featureset(filterT const& filter,
+                                                boost::shared_ptr<osm_pbf_dataset const> const& dataset,
+                                                std::set<std::string> const& attribute_names,
+                                                std::string const& encoding)
+    : filter_(filter),
+      dataset_(dataset),
+      tr_(new mapnik::transcoder(encoding)),
+      ctx_(boost::make_shared<mapnik::context_type>()),
+      node_index_(0),
+      way_index_(0)
+{
+    std::set<std::string>::const_iterator itr = attribute_names.begin();
+    std::set<std::string>::const_iterator end = attribute_names.end();
+    for (; itr != end; ++itr)
+    {
+        attributes_.push_back(std::make_pair(*itr, dataset_->strings().find(*itr)));
+    }
+}
+
+template <typename filterT>
+osm_pbf_featureset<filterT>::~osm_pbf_featureset() {}
+
+template <typename filterT>
+template <typename Item>
+void osm_pbf_featureset<filterT>::put_attributes(feature_ptr const& feature, Item const& item) const
+{
+    for (std::size_t i = 0; i < attributes_.size(); ++i)
+    {
+        std::string const& name = attributes_[i].first;
+        int key = attributes_[i].second;
+        bool found = false;
+        for (unsigned j = 0; key >= 0 && j < item.tag_count; ++j)
+        {
+            osm_tag const& t = dataset_->tag(item.first_tag + j);
+            if (t.key == static_cast<unsigned>(key))
+            {
+                feature->put_new(name, tr_->transcode(dataset_->strings().get(t.value).c_str()));
+                found = true;
+                break;
+            }
+        }
+        if (!found)
+        {
+            feature->put_new(name, tr_->transcode(""));
+        }
+    }
+}
+
+template <typename filterT>
+feature_ptr osm_pbf_featureset<filterT>::next()
+{
+    std::vector<osm_pbf_dataset::node> const& nodes = dataset_->nodes();
+    while (node_index_ < nodes.size())
+    {
+        osm_pbf_dataset::node const& n = nodes[node_index_++];
+        double x = dataset_->lon(n.position);
+        double y = dataset_->lat(n.position);
+        if (!filter_.pass(mapnik::box2d<double>(x, y, x, y))) continue;
+
+        feature_ptr feature = feature_factory::create(ctx_, n.id);
+        geometry_type* point = new geometry_type(mapnik::Point);
+        point->move_to(x, y);
+        feature->add_geometry(point);
+        put_attributes(feature, n);
+        return feature;
+    }
+
+    // ways become geometries only once they pass the filter
+    std::vector<osm_pbf_dataset::way> const& ways = dataset_->ways();
+    while (way_index_ < ways.size())
+    {
+        osm_pbf_dataset::way const& w = ways[way_index_++];
+        if (w.node_count == 0 || !filter_.pass(w.bbox)) continue;
+
+        feature_ptr feature = feature_factory::create(ctx_, w.id);
+        geometry_type* geom = new geometry_type(w.polygon ? mapnik::Polygon : mapnik::LineString);
+        geom->reserve(w.node_count);
+        for (unsigned i = 0; i < w.node_count; ++i)
+        {
+            unsigned position = dataset_->way_node(w.first_node + i);
+            if (i == 0) geom->move_to(dataset_->lon(position), dataset_->lat(position));
+            else geom->line_to(dataset_->lon(position), dataset_->lat(position));
+        }
+        feature->add_geometry(geom);
+        put_attributes(feature, w);
+        return feature;
+    }
+    return feature_ptr();
+}
+
+template class osm_pbf_featureset<mapnik::filter_in_box>;
+template class osm_pbf_featureset<mapnik::filter_at_point>;
@@ -0,0 +1,70 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+#ifndef OSM_PBF_FEATURESET_HPP
+#define OSM_PBF_FEATURESET_HPP
+
+// stl
+#include <set>
+#include <vector>
+#include <string>
+
+// boost
+#include <boost/scoped_ptr.hpp>
+#include <boost/shared_ptr.hpp>
+
+// mapnik
+#include <mapnik/geom_util.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/unicode.hpp>
+#include <mapnik/datasource.hpp>
+
+#include "osm_pbf.h"
+
+// Features of an osm_pbf_dataset passing filter: tagged nodes, then ways.
+template <typename filterT>
+class osm_pbf_featureset : public mapnik::Featureset
+{
+public:
+    osm_pbf_featureset(filterT const& filter,
+                       boost::shared_ptr<osm_pbf_dataset const> const& dataset,
+                       std::set<std::string> const& attribute_names,
+                       std::string const& encoding);
+    virtual ~osm_pbf_featureset();
+    mapnik::feature_ptr next();
+
+private:
+    template <typename Item>
+    void put_attributes(mapnik::feature_ptr const& feature, Item const& item) const;
+
+    filterT filter_;
+    boost::shared_ptr<osm_pbf_dataset const> dataset_;
+    boost::scoped_ptr<mapnik::transcoder> tr_;
+    mapnik::context_ptr ctx_;
+    // names of the requested attributes with their string ids, -1 when no
+    // tag of the dataset has that key
+    std::vector<std::pair<std::string, int> > attributes_;
+    std::size_t node_index_;
+    std::size_t way_index_;
+};
+
+#endif // OSM_PBF_FEATURESET_HPP
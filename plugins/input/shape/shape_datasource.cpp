@@ -46,6 +46,7 @@
 #include <stdexcept>
 
 DATASOURCE_PLUGIN(shape_datasource)
+DATASOURCE_PLUGIN_THREAD_SAFE
 
 using mapnik::String;
 using mapnik::Double;
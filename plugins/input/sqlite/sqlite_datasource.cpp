@@ -126,6 +126,10 @@ void sqlite_datasource::bind() const
         {
             format_ = mapnik::wkbGeneric;
         }
+        else if (*wkb == "twkb")
+        {
+            format_ = mapnik::wkbTWKB;
+        }
         else
         {
             format_ = mapnik::wkbAuto;
@@ -153,6 +157,7 @@ void sqlite_datasource::bind() const
 
     // now actually create the connection and start executing setup sql
     dataset_ = boost::make_shared<sqlite_connection>(dataset_name_);
+    statements_ = boost::make_shared<sqlite_statement_pool>(dataset_);
 
     boost::optional<unsigned> table_by_index = params_.get<unsigned>("table_by_index");
 
@@ -294,7 +299,26 @@ void sqlite_datasource::bind() const
 
         if (boost::filesystem::exists(index_db))
         {
-            dataset_->execute("attach database '" + index_db + "' as " + index_table_);
+            // a stat and one lookup, rather than trusting an index that
+            // was built before the data changed
+            std::string error;
+            switch (sqlite_utils::spatial_index_state(index_db, index_table_, dataset_name_, error))
+            {
+            case sqlite_utils::index_current:
+                dataset_->execute("attach database '" + index_db + "' as " + index_table_);
+                break;
+            case sqlite_utils::index_stale:
+                MAPNIK_LOG_WARN(sqlite) << "sqlite_datasource: Spatial index " << index_db
+                                        << " is older than " << dataset_name_ << ", not using it";
+                break;
+            case sqlite_utils::index_unreadable:
+                // rebuilding would most likely fail the same way, and would
+                // be tried again by every bind, so leave the file to the user
+                MAPNIK_LOG_ERROR(sqlite) << "sqlite_datasource: Could not read spatial index " << index_db
+                                         << " (" << error << "), not using or rebuilding it";
+                auto_index = false;
+                break;
+            }
         }
         has_spatial_index_ = sqlite_utils::has_rtree(index_table_,dataset_);
 
@@ -325,8 +349,11 @@ void sqlite_datasource::bind() const
                   }
                   }
                 */
+                MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: Building spatial index " << index_db
+                                         << " (run sqliteindex beforehand to avoid this on first use)";
+
                 boost::shared_ptr<sqlite_resultset> rs = dataset_->execute_query(query.str());
-                if (sqlite_utils::create_spatial_index(index_db,index_table_,rs))
+                if (sqlite_utils::create_spatial_index(index_db,index_table_,rs,dataset_name_))
                 {
                     //extent_initialized_ = true;
                     has_spatial_index_ = true;
@@ -388,6 +415,65 @@ std::string sqlite_datasource::populate_tokens(std::string const& sql) const
     return populated_sql;
 }
 
+sqlite_datasource::prepared_query sqlite_datasource::prepare_query(std::vector<std::string> const& fields) const
+{
+    std::ostringstream s;
+    s << "SELECT " << geometry_field_;
+    if (!key_field_.empty())
+    {
+        s << "," << key_field_;
+    }
+    for (std::vector<std::string>::const_iterator pos = fields.begin(); pos != fields.end(); ++pos)
+    {
+        s << ",[" << *pos << "]";
+    }
+
+#ifdef MAPNIK_THREADSAFE
+    mapnik::mutex::scoped_lock lock(queries_mutex_);
+#endif
+    std::string const columns = s.str();
+    std::map<std::string, prepared_query>::const_iterator itr = queries_.find(columns);
+    if (itr != queries_.end())
+    {
+        return itr->second;
+    }
+
+    prepared_query result;
+    result.spatial = false;
+    s << " FROM ";
+    if (! key_field_.empty() && has_spatial_index_)
+    {
+        // the extent is bound per query, so that the statement can be reused.
+        // sqlite runs the subquery as rtree lookups on the key, in key order
+        std::string query(table_);
+        // TODO - debug warn if fails
+        result.spatial = sqlite_utils::apply_spatial_filter(query,
+                                                            sqlite_utils::spatial_filter_params(key_field_, index_table_),
+                                                            table_,
+                                                            geometry_table_,
+                                                            intersects_token_);
+        s << query;
+    }
+    else
+    {
+        s << populate_tokens(table_);
+    }
+
+    if (row_limit_ > 0)
+    {
+        s << " LIMIT " << row_limit_;
+    }
+
+    if (row_offset_ > 0)
+    {
+        s << " OFFSET " << row_offset_;
+    }
+
+    result.sql = s.str();
+    queries_.insert(std::make_pair(columns, result));
+    return result;
+}
+
 sqlite_datasource::~sqlite_datasource()
 {
 }
@@ -564,15 +650,13 @@ featureset_ptr sqlite_datasource::features(query const& q) const
     {
         mapnik::box2d<double> const& e = q.get_bbox();
 
-        std::ostringstream s;
         mapnik::context_ptr ctx = boost::make_shared<mapnik::context_type>();
-
-        s << "SELECT " << geometry_field_;
         if (!key_field_.empty())
         {
-            s << "," << key_field_;
             ctx->push(key_field_);
         }
+
+        std::vector<std::string> fields;
         std::set<std::string> const& props = q.property_names();
         std::set<std::string>::const_iterator pos = props.begin();
         std::set<std::string>::const_iterator end = props.end();
@@ -581,45 +665,20 @@ featureset_ptr sqlite_datasource::features(query const& q) const
         {
             // TODO - should we restrict duplicate key query?
             //if (*pos != key_field_)
-            s << ",[" << *pos << "]";
+            fields.push_back(*pos);
             ctx->push(*pos);
         }
-        s << " FROM ";
 
-        std::string query(table_);
+        prepared_query const query = prepare_query(fields);
 
-        if (! key_field_.empty() && has_spatial_index_)
-        {
-            // TODO - debug warn if fails
-            sqlite_utils::apply_spatial_filter(query,
-                                               e,
-                                               table_,
-                                               key_field_,
-                                               index_table_,
-                                               geometry_table_,
-                                               intersects_token_);
-        }
-        else
-        {
-            query = populate_tokens(table_);
-        }
-
-        s << query ;
-
-        if (row_limit_ > 0)
-        {
-            s << " LIMIT " << row_limit_;
-        }
+        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << query.sql;
 
-        if (row_offset_ > 0)
+        boost::shared_ptr<sqlite_resultset> rs(statements_->execute_query(query.sql));
+        if (query.spatial)
         {
-            s << " OFFSET " << row_offset_;
+            rs->bind(e);
         }
 
-        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
-
-        boost::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
-
         return boost::make_shared<sqlite_featureset>(rs,
                                                      ctx,
                                                      desc_.get_encoding(),
@@ -645,16 +704,13 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
         // TODO - need tolerance
         mapnik::box2d<double> const e(pt.x, pt.y, pt.x, pt.y);
 
-        std::ostringstream s;
         mapnik::context_ptr ctx = boost::make_shared<mapnik::context_type>();
-
-        s << "SELECT " << geometry_field_;
         if (!key_field_.empty())
         {
-            s << "," << key_field_;
             ctx->push(key_field_);
         }
 
+        std::vector<std::string> fields;
         std::vector<attribute_descriptor>::const_iterator itr = desc_.get_descriptors().begin();
         std::vector<attribute_descriptor>::const_iterator end = desc_.get_descriptors().end();
 
@@ -663,47 +719,21 @@ featureset_ptr sqlite_datasource::features_at_point(coord2d const& pt, double to
             std::string fld_name = itr->get_name();
             if (fld_name != key_field_)
             {
-                s << ",[" << itr->get_name() << "]";
-                ctx->push(itr->get_name());
+                fields.push_back(fld_name);
+                ctx->push(fld_name);
             }
         }
 
-        s << " FROM ";
-
-        std::string query(table_);
-
-        if (! key_field_.empty() && has_spatial_index_)
-        {
-            // TODO - debug warn if fails
-            sqlite_utils::apply_spatial_filter(query,
-                                               e,
-                                               table_,
-                                               key_field_,
-                                               index_table_,
-                                               geometry_table_,
-                                               intersects_token_);
-        }
-        else
-        {
-            query = populate_tokens(table_);
-        }
-
-        s << query ;
+        prepared_query const query = prepare_query(fields);
 
-        if (row_limit_ > 0)
-        {
-            s << " LIMIT " << row_limit_;
-        }
+        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << query.sql;
 
-        if (row_offset_ > 0)
+        boost::shared_ptr<sqlite_resultset> rs(statements_->execute_query(query.sql));
+        if (query.spatial)
         {
-            s << " OFFSET " << row_offset_;
+            rs->bind(e);
         }
 
-        MAPNIK_LOG_DEBUG(sqlite) << "sqlite_datasource: " << s.str();
-
-        boost::shared_ptr<sqlite_resultset> rs(dataset_->execute_query(s.str()));
-
         return boost::make_shared<sqlite_featureset>(rs,
                                                      ctx,
                                                      desc_.get_encoding(),
@@ -32,6 +32,7 @@
 #include <mapnik/coord.hpp>
 #include <mapnik/feature_layer_desc.hpp>
 #include <mapnik/wkb.hpp>
+#include <mapnik/utils.hpp>
 
 // boost
 #include <boost/optional.hpp>
@@ -41,9 +42,11 @@
 // stl
 #include <vector>
 #include <string>
+#include <map>
 
 // sqlite
 #include "sqlite_connection.hpp"
+#include "sqlite_prepared.hpp"
 
 class sqlite_datasource : public mapnik::datasource
 {
@@ -65,6 +68,17 @@ private:
     void parse_attachdb(std::string const& attachdb) const;
     std::string populate_tokens(std::string const& sql) const;
 
+    struct prepared_query
+    {
+        std::string sql;
+        // whether the query extent is to be bound to ?1 to ?4
+        bool spatial;
+    };
+
+    // the sql selecting fields (after the geometry and key) from the
+    // features in the query extent, built once per list of fields
+    prepared_query prepare_query(std::vector<std::string> const& fields) const;
+
     // FIXME: remove mutable qualifier from data members
     //        by factoring out bind() logic out from
     //        datasource impl !!!
@@ -90,6 +104,11 @@ private:
     mutable bool has_spatial_index_;
     mutable bool using_subquery_;
     mutable std::vector<std::string> init_statements_;
+    mutable boost::shared_ptr<sqlite_statement_pool> statements_;
+    mutable std::map<std::string, prepared_query> queries_;
+#ifdef MAPNIK_THREADSAFE
+    mutable mapnik::mutex queries_mutex_;
+#endif
 };
 
 #endif // MAPNIK_SQLITE_DATASOURCE_HPP
@@ -57,7 +57,8 @@ sqlite_featureset::sqlite_featureset(boost::shared_ptr<sqlite_resultset> rs,
       bbox_(bbox),
       format_(format),
       spatial_index_(spatial_index),
-      using_subquery_(using_subquery)
+      using_subquery_(using_subquery),
+      names_initialized_(false)
 {}
 
 sqlite_featureset::~sqlite_featureset() {}
@@ -84,40 +85,54 @@ feature_ptr sqlite_featureset::next()
                 continue;
         }
 
-        for (int i = 2; i < rs_->column_count(); ++i)
+        if (! names_initialized_)
         {
-            const int type_oid = rs_->column_type(i);
-            const char* fld_name = rs_->column_name(i);
-
-            if (! fld_name)
-                continue;
+            int const count = rs_->column_count();
+            names_.resize(count > 2 ? count - 2 : 0);
+            for (int i = 2; i < count; ++i)
+            {
+                const char* fld_name = rs_->column_name(i);
+                if (! fld_name)
+                    continue;
 
-            std::string fld_name_str(fld_name);
+                names_[i - 2] = fld_name;
 
-            // subqueries in sqlite lead to field double quoting which we need to strip
-            if (using_subquery_)
-            {
-                sqlite_utils::dequote(fld_name_str);
+                // subqueries in sqlite lead to field double quoting which we need to strip
+                if (using_subquery_)
+                {
+                    sqlite_utils::dequote(names_[i - 2]);
+                }
             }
+            names_initialized_ = true;
+        }
+
+        for (std::size_t i = 0; i < names_.size(); ++i)
+        {
+            std::string const& fld_name_str = names_[i];
+            if (fld_name_str.empty())
+                continue;
+
+            const int col = static_cast<int>(i) + 2;
+            const int type_oid = rs_->column_type(col);
 
             switch (type_oid)
             {
             case SQLITE_INTEGER:
             {
-                feature->put(fld_name_str, rs_->column_integer(i));
+                feature->put(fld_name_str, rs_->column_integer(col));
                 break;
             }
 
             case SQLITE_FLOAT:
             {
-                feature->put(fld_name_str, rs_->column_double(i));
+                feature->put(fld_name_str, rs_->column_double(col));
                 break;
             }
 
             case SQLITE_TEXT:
             {
                 int text_col_size;
-                const char * data = rs_->column_text(i, text_col_size);
+                const char * data = rs_->column_text(col, text_col_size);
                 UnicodeString ustr = tr_->transcode(data, text_col_size);
                 feature->put(fld_name_str, ustr);
                 break;
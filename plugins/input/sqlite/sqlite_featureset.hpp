@@ -32,6 +32,10 @@
 #include <boost/scoped_ptr.hpp>
 #include <boost/shared_ptr.hpp>
 
+// stl
+#include <vector>
+#include <string>
+
 // sqlite
 #include "sqlite_resultset.hpp"
 
@@ -53,10 +57,13 @@ private:
     boost::shared_ptr<sqlite_resultset> rs_;
     mapnik::context_ptr ctx_;
     boost::scoped_ptr<mapnik::transcoder> tr_;
-    mapnik::box2d<double> const& bbox_;
+    mapnik::box2d<double> bbox_;
     mapnik::wkbFormat format_;
     bool spatial_index_;
     bool using_subquery_;
+    // attribute names by column, looked up once on the first row
+    std::vector<std::string> names_;
+    bool names_initialized_;
 
 };
 
@@ -28,12 +28,18 @@
 #include <mapnik/params.hpp>
 #include <mapnik/box2d.hpp>
 
+#include <mapnik/utils.hpp>
+
 // boost
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
+#include <boost/enable_shared_from_this.hpp>
+#include <boost/bind.hpp>
 #include <boost/utility.hpp>
 
 // stl
 #include <string.h>
+#include <map>
 
 #include "sqlite_connection.hpp"
 
@@ -134,4 +140,87 @@ private:
     sqlite3_stmt * stmt_;
 };
 
+// Prepared statements of one connection, kept by sql text. A statement is
+// checked out for the lifetime of its resultset and reset and put back
+// afterwards, so concurrent queries of the same shape each get their own.
+class sqlite_statement_pool : public boost::enable_shared_from_this<sqlite_statement_pool>,
+                              private boost::noncopyable
+{
+public:
+    explicit sqlite_statement_pool(boost::shared_ptr<sqlite_connection> const& ds)
+        : ds_(ds)
+    {
+    }
+
+    ~sqlite_statement_pool()
+    {
+        for (statements::iterator itr = idle_.begin(); itr != idle_.end(); ++itr)
+        {
+            sqlite3_finalize(itr->second);
+        }
+    }
+
+    boost::shared_ptr<sqlite_resultset> execute_query(std::string const& sql)
+    {
+        sqlite3_stmt* stmt = 0;
+        {
+#ifdef MAPNIK_THREADSAFE
+            mapnik::mutex::scoped_lock lock(mutex_);
+#endif
+            statements::iterator itr = idle_.find(sql);
+            if (itr != idle_.end())
+            {
+                stmt = itr->second;
+                idle_.erase(itr);
+            }
+        }
+
+        if (! stmt)
+        {
+#ifdef MAPNIK_STATS
+            mapnik::progress_timer __stats__(std::clog, std::string("sqlite_statement_pool::prepare ") + sql);
+#endif
+            const int rc = sqlite3_prepare_v2(*(*ds_), sql.c_str(), -1, &stmt, 0);
+            if (rc != SQLITE_OK)
+            {
+                ds_->throw_sqlite_error(sql);
+            }
+        }
+
+        return boost::make_shared<sqlite_resultset>(
+            stmt, boost::bind(&sqlite_statement_pool::release, shared_from_this(), sql, _1));
+    }
+
+    std::size_t size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        mapnik::mutex::scoped_lock lock(mutex_);
+#endif
+        return idle_.size();
+    }
+
+private:
+    void release(std::string const& sql, sqlite3_stmt* stmt)
+    {
+        if (sqlite3_reset(stmt) != SQLITE_OK || sqlite3_clear_bindings(stmt) != SQLITE_OK)
+        {
+            // a failed step leaves the error on the statement, start afresh
+            sqlite3_finalize(stmt);
+            return;
+        }
+#ifdef MAPNIK_THREADSAFE
+        mapnik::mutex::scoped_lock lock(mutex_);
+#endif
+        idle_.insert(std::make_pair(sql, stmt));
+    }
+
+    typedef std::multimap<std::string, sqlite3_stmt*> statements;
+
+    boost::shared_ptr<sqlite_connection> ds_;
+    statements idle_;
+#ifdef MAPNIK_THREADSAFE
+    mutable mapnik::mutex mutex_;
+#endif
+};
+
 #endif // MAPNIK_SQLITE_PREPARED_HPP
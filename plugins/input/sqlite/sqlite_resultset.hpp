@@ -26,6 +26,10 @@
 // mapnik
 #include <mapnik/datasource.hpp>
 #include <mapnik/params.hpp>
+#include <mapnik/box2d.hpp>
+
+// boost
+#include <boost/function.hpp>
 
 // stl
 #include <string.h>
@@ -42,17 +46,33 @@ extern "C" {
 class sqlite_resultset
 {
 public:
+    typedef boost::function<void (sqlite3_stmt*)> release_type;
 
     sqlite_resultset (sqlite3_stmt* stmt)
         : stmt_(stmt)
     {
     }
 
+    // the statement is handed to release instead of being finalized,
+    // so that it can be reused (see sqlite_statement_pool)
+    sqlite_resultset (sqlite3_stmt* stmt, release_type const& release)
+        : stmt_(stmt),
+          release_(release)
+    {
+    }
+
     ~sqlite_resultset ()
     {
         if (stmt_)
         {
-            sqlite3_finalize (stmt_);
+            if (release_)
+            {
+                release_(stmt_);
+            }
+            else
+            {
+                sqlite3_finalize (stmt_);
+            }
         }
     }
 
@@ -61,6 +81,18 @@ public:
         return stmt_ != 0;
     }
 
+    // binds the bbox to parameters ?1 to ?4 as minx, maxx, miny, maxy
+    void bind (mapnik::box2d<double> const& bbox)
+    {
+        if ((sqlite3_bind_double(stmt_, 1, bbox.minx()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt_, 2, bbox.maxx()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt_, 3, bbox.miny()) != SQLITE_OK) ||
+            (sqlite3_bind_double(stmt_, 4, bbox.maxy()) != SQLITE_OK))
+        {
+            throw mapnik::datasource_exception("SQLite Plugin: binding the query extent failed");
+        }
+    }
+
     bool step_next ()
     {
         const int status = sqlite3_step (stmt_);
@@ -139,6 +171,7 @@ public:
 private:
 
     sqlite3_stmt* stmt_;
+    release_type release_;
 };
 
 #endif // MAPNIK_SQLITE_RESULTSET_HPP
@@ -31,14 +31,16 @@
 #include <mapnik/datasource.hpp>
 #include <mapnik/params.hpp>
 #include <mapnik/geometry.hpp>
+#include <mapnik/wkb.hpp>
 #include <mapnik/sql_utils.hpp>
-
+#include <mapnik/packed_rtree.hpp>
 
 // boost
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/cstdint.hpp>
 
 // sqlite
 extern "C" {
@@ -121,9 +123,27 @@ public:
         spatial_sql << key_field << " IN (SELECT pkid FROM " << index_table;
         spatial_sql << " WHERE xmax>=" << e.minx() << " AND xmin<=" << e.maxx() ;
         spatial_sql << " AND ymax>=" << e.miny() << " AND ymin<=" << e.maxy() << ")";
+        return apply_spatial_filter(query, spatial_sql.str(), table, geometry_table, intersects_token);
+    }
+
+    // the spatial filter with the extent left as parameters ?1 to ?4
+    // (minx, maxx, miny, maxy), see sqlite_resultset::bind
+    static std::string spatial_filter_params(std::string const& key_field,
+                                             std::string const& index_table)
+    {
+        return key_field + " IN (SELECT pkid FROM " + index_table
+            + " WHERE xmax>=?1 AND xmin<=?2 AND ymax>=?3 AND ymin<=?4)";
+    }
+
+    static bool apply_spatial_filter(std::string & query,
+                                     std::string const& spatial_sql,
+                                     std::string const& table,
+                                     std::string const& geometry_table,
+                                     std::string const& intersects_token)
+    {
         if (boost::algorithm::ifind_first(query,  intersects_token))
         {
-            boost::algorithm::ireplace_all(query, intersects_token, spatial_sql.str());
+            boost::algorithm::ireplace_all(query, intersects_token, spatial_sql);
             return true;
         }
         // substitute first WHERE found if not using JOIN
@@ -131,14 +151,14 @@ public:
         else if (boost::algorithm::ifind_first(query, "WHERE")
                  && !boost::algorithm::ifind_first(query, "JOIN"))
         {
-            std::string replace(" WHERE " + spatial_sql.str() + " AND ");
+            std::string replace(" WHERE " + spatial_sql + " AND ");
             boost::algorithm::ireplace_first(query, "WHERE", replace);
             return true;
         }
         // fallback to appending spatial filter at end of query
         else if (boost::algorithm::ifind_first(query, geometry_table))
         {
-            query = table + " WHERE " + spatial_sql.str();
+            query = table + " WHERE " + spatial_sql;
             return true;
         }
         return false;
@@ -214,19 +234,74 @@ public:
         }
     }
 
+    // Builds index_table in index_db from the geometry (first column) and
+    // key (second column) of every row of rs. The boxes are read first and
+    // inserted in STR packing order: an rtree fed spatially sorted entries
+    // splits fewer nodes and touches fewer pages than one fed table order.
+    // When source is given its size and modification time are recorded so
+    // that spatial_index_current can tell when the index is out of date.
     static bool create_spatial_index(std::string const& index_db,
                                      std::string const& index_table,
-                                     boost::shared_ptr<sqlite_resultset> rs)
+                                     boost::shared_ptr<sqlite_resultset> rs,
+                                     std::string const& source = std::string())
     {
-        /* TODO
-           - speedups
-           - return early/recover from failure
-           - allow either in db or in separate
-        */
-
         if (!rs->is_valid())
             return false;
 
+        std::vector<mapnik::packed_rtree_node> entries;
+        while (rs->is_valid() && rs->step_next())
+        {
+            int size;
+            const char* data = (const char*) rs->column_blob(0, size);
+            if (data)
+            {
+                boost::ptr_vector<mapnik::geometry_type> paths;
+                mapnik::box2d<double> bbox;
+                if (mapnik::geometry_utils::from_wkb(paths, data, size, mapnik::wkbAuto))
+                {
+                    for (unsigned i=0; i<paths.size(); ++i)
+                    {
+                        if (i==0)
+                        {
+                            bbox = paths[i].envelope();
+                        }
+                        else
+                        {
+                            bbox.expand_to_include(paths[i].envelope());
+                        }
+                    }
+                }
+                if (! bbox.valid())
+                {
+                    std::ostringstream error_msg;
+                    error_msg << "SQLite Plugin: encountered invalid bbox at '"
+                              << rs->column_name(1) << "' == " << rs->column_integer64(1);
+                    throw mapnik::datasource_exception(error_msg.str());
+                }
+                const int type_oid = rs->column_type(1);
+                if (type_oid != SQLITE_INTEGER)
+                {
+                    std::ostringstream error_msg;
+                    error_msg << "Sqlite Plugin: invalid type for key field '"
+                              << rs->column_name(1) << "' when creating index '" << index_table
+                              << "' type was: " << type_oid << "";
+                    throw mapnik::datasource_exception(error_msg.str());
+                }
+                mapnik::packed_rtree_node entry;
+                entry.minx = bbox.minx();
+                entry.miny = bbox.miny();
+                entry.maxx = bbox.maxx();
+                entry.maxy = bbox.maxy();
+                entry.value = static_cast<boost::uint64_t>(rs->column_integer64(1));
+                entries.push_back(entry);
+            }
+        }
+
+        if (entries.empty())
+            return false;
+
+        mapnik::packed_rtree::str_order(entries, rtree_node_size);
+
 #if SQLITE_VERSION_NUMBER >= 3005000
         int flags = SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE | SQLITE_OPEN_FULLMUTEX;
 #else
@@ -236,20 +311,11 @@ public:
         bool existed = boost::filesystem::exists(index_db);
         boost::shared_ptr<sqlite_connection> ds = boost::make_shared<sqlite_connection>(index_db,flags);
 
-        bool one_success = false;
         try
         {
-
             ds->execute("PRAGMA synchronous=OFF");
             ds->execute("BEGIN IMMEDIATE TRANSACTION");
 
-            /*
-              ds->execute("PRAGMA journal_mode=WAL");
-              ds->execute("PRAGMA fullfsync=1");
-              ds->execute("PRAGMA locking_mode = EXCLUSIVE");
-              ds->execute("BEGIN EXCLUSIVE TRANSACTION");
-            */
-
             // first drop the index if it already exists
             std::ostringstream spatial_index_drop_sql;
             spatial_index_drop_sql << "DROP TABLE IF EXISTS " << index_table;
@@ -269,56 +335,22 @@ public:
 
             ds->execute(create_idx.str());
 
-            prepared_index_statement ps(ds,insert_idx.str());
-
-            while (rs->is_valid() && rs->step_next())
             {
-                int size;
-                const char* data = (const char*) rs->column_blob(0, size);
-                if (data)
+                prepared_index_statement ps(ds,insert_idx.str());
+                std::vector<mapnik::packed_rtree_node>::const_iterator itr = entries.begin();
+                std::vector<mapnik::packed_rtree_node>::const_iterator end = entries.end();
+                for ( ; itr != end; ++itr)
                 {
-                    boost::ptr_vector<mapnik::geometry_type> paths;
-                    mapnik::box2d<double> bbox;
-                    if (mapnik::geometry_utils::from_wkb(paths, data, size, mapnik::wkbAuto))
-                    {
-                        for (unsigned i=0; i<paths.size(); ++i)
-                        {
-                            if (i==0)
-                            {
-                                bbox = paths[i].envelope();
-                            }
-                            else
-                            {
-                                bbox.expand_to_include(paths[i].envelope());
-                            }
-                        }
-                    }
-                    if (bbox.valid())
-                    {
-                        ps.bind(bbox);
-                        const int type_oid = rs->column_type(1);
-                        if (type_oid != SQLITE_INTEGER)
-                        {
-                            std::ostringstream error_msg;
-                            error_msg << "Sqlite Plugin: invalid type for key field '"
-                                      << rs->column_name(1) << "' when creating index '" << index_table
-                                      << "' type was: " << type_oid << "";
-                            throw mapnik::datasource_exception(error_msg.str());
-                        }
-                        const sqlite_int64 pkid = rs->column_integer64(1);
-                        ps.bind(pkid);
-                    }
-                    else
-                    {
-                        std::ostringstream error_msg;
-                        error_msg << "SQLite Plugin: encountered invalid bbox at '"
-                                  << rs->column_name(1) << "' == " << rs->column_integer64(1);
-                        throw mapnik::datasource_exception(error_msg.str());
-                    }
+                    ps.bind(mapnik::box2d<double>(itr->minx, itr->miny, itr->maxx, itr->maxy));
+                    ps.bind(static_cast<sqlite_int64>(itr->value));
                     ps.step_next();
-                    one_success = true;
                 }
             }
+
+            if (! source.empty())
+            {
+                store_index_source(ds, index_table, source);
+            }
         }
         catch (mapnik::datasource_exception const& ex)
         {
@@ -333,20 +365,78 @@ public:
             throw mapnik::datasource_exception(ex.what());
         }
 
-        if (one_success)
-        {
-            ds->execute("COMMIT");
-            return true;
-        }
-        else if (!existed)
+        ds->execute("COMMIT");
+        return true;
+    }
+
+    enum index_state
+    {
+        index_current,
+        index_stale,
+        index_unreadable
+    };
+
+    // whether the index_table in index_db was built from source as it is
+    // now. Indexes that did not record their source are taken as current.
+    // When index_db cannot be opened or is not a database the reason is
+    // left in error.
+    static index_state spatial_index_state(std::string const& index_db,
+                                           std::string const& index_table,
+                                           std::string const& source,
+                                           std::string & error)
+    {
+        sqlite_int64 size = 0;
+        sqlite_int64 mtime = 0;
+        bool stamped = source_stamp(source, size, mtime);
+
+        index_state state = index_current;
+        try
         {
-            try
+#if SQLITE_VERSION_NUMBER >= 3005000
+            sqlite_connection ds(index_db, SQLITE_OPEN_READONLY);
+#else
+            sqlite_connection ds(index_db);
+#endif
+            // opening is lazy, a damaged or foreign file only fails once read
+            sqlite3_stmt* stmt = 0;
+            if (sqlite3_prepare_v2(*ds,
+                                   "SELECT count(*) FROM sqlite_master WHERE type='table' AND name='mapnik_index_source'",
+                                   -1, &stmt, 0) != SQLITE_OK)
             {
-                boost::filesystem::remove(index_db);
+                error = sqlite3_errmsg(*ds);
+                return index_unreadable;
+            }
+            bool has_source_table = false;
+            {
+                sqlite_resultset rs(stmt);
+                has_source_table = rs.step_next() && rs.column_integer(0) > 0;
+            }
+            // without a source table the index predates source stamps
+            if (! stamped || ! has_source_table)
+                return index_current;
+
+            stmt = 0;
+            if (sqlite3_prepare_v2(*ds,
+                                   "SELECT size, mtime FROM mapnik_index_source WHERE index_table=?",
+                                   -1, &stmt, 0) != SQLITE_OK)
+            {
+                error = sqlite3_errmsg(*ds);
+                return index_unreadable;
+            }
+            sqlite_resultset rs(stmt);
+            sqlite3_bind_text(stmt, 1, index_table.c_str(), -1, SQLITE_TRANSIENT);
+            if (rs.step_next())
+            {
+                bool current = rs.column_integer64(0) == size && rs.column_integer64(1) == mtime;
+                state = current ? index_current : index_stale;
             }
-            catch (...) {};
         }
-        return false;
+        catch (mapnik::datasource_exception const& ex)
+        {
+            error = ex.what();
+            return index_unreadable;
+        }
+        return state;
     }
 
     typedef struct {
@@ -709,6 +799,51 @@ public:
 
         return found_table;
     }
+
+private:
+    // leaf size the index entries are ordered for, near the fanout of an
+    // sqlite rtree node on a default page
+    static const unsigned rtree_node_size = 50;
+
+    static bool source_stamp(std::string const& file, sqlite_int64 & size, sqlite_int64 & mtime)
+    {
+        try
+        {
+            if (! boost::filesystem::is_regular_file(file))
+                return false;
+            size = static_cast<sqlite_int64>(boost::filesystem::file_size(file));
+            mtime = static_cast<sqlite_int64>(boost::filesystem::last_write_time(file));
+            return true;
+        }
+        catch (...)
+        {
+            return false;
+        }
+    }
+
+    static void store_index_source(boost::shared_ptr<sqlite_connection> ds,
+                                   std::string const& index_table,
+                                   std::string const& source)
+    {
+        sqlite_int64 size = 0;
+        sqlite_int64 mtime = 0;
+        if (! source_stamp(source, size, mtime))
+            return;
+
+        ds->execute("CREATE TABLE IF NOT EXISTS mapnik_index_source"
+                    " (index_table TEXT PRIMARY KEY, size INTEGER, mtime INTEGER)");
+        std::string const sql("INSERT OR REPLACE INTO mapnik_index_source VALUES (?,?,?)");
+        sqlite3_stmt* stmt = 0;
+        if (sqlite3_prepare_v2(*(*ds), sql.c_str(), -1, &stmt, 0) != SQLITE_OK)
+        {
+            ds->throw_sqlite_error(sql);
+        }
+        sqlite_resultset rs(stmt);
+        sqlite3_bind_text(stmt, 1, index_table.c_str(), -1, SQLITE_TRANSIENT);
+        sqlite3_bind_int64(stmt, 2, size);
+        sqlite3_bind_int64(stmt, 3, mtime);
+        rs.step_next();
+    }
 };
 
 #endif // MAPNIK_SQLITE_UTILS_HPP
@@ -31,6 +31,7 @@
 #include <mapnik/feature_type_style.hpp>
 #include <mapnik/marker.hpp>
 #include <mapnik/marker_cache.hpp>
+#include <mapnik/marker_sprite_cache.hpp>
 #include <mapnik/unicode.hpp>
 #include <mapnik/font_set.hpp>
 #include <mapnik/parse_path.hpp>
@@ -60,6 +61,7 @@
 
 // stl
 #include <cmath>
+#include <algorithm>
 
 // Shader
 #include <mapnik/shader_program.hpp>
@@ -76,6 +78,7 @@ agg_renderer<T>::agg_renderer(Map const& m, T & pixmap, double scale_factor, uns
       internal_buffer_(),
       current_buffer_(&pixmap),
       style_level_compositing_(false),
+      filter_threads_(1),
       width_(pixmap_.width()),
       height_(pixmap_.height()),
       scale_factor_(scale_factor),
@@ -103,6 +106,7 @@ agg_renderer<T>::agg_renderer(Map const& m, T & pixmap, boost::shared_ptr<label_
       internal_buffer_(),
       current_buffer_(&pixmap),
       style_level_compositing_(false),
+      filter_threads_(1),
       width_(pixmap_.width()),
       height_(pixmap_.height()),
       scale_factor_(scale_factor),
@@ -165,6 +169,12 @@ void agg_renderer<T>::setup(Map const &m)
             }
         }
     }
+    // optional <Parameter name="image-filter-threads">, 0 for one thread per core
+    boost::optional<int> filter_threads = m.get_extra_parameters().get<int>("image-filter-threads");
+    if (filter_threads && *filter_threads >= 0)
+    {
+        filter_threads_ = *filter_threads > 0 ? *filter_threads : std::max(1u, boost::thread::hardware_concurrency());
+    }
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: Scale=" << m.scale();
 }
 
@@ -531,11 +541,7 @@ void agg_renderer<T>::end_style_processing(feature_type_style const& st)
         if (st.image_filters().size() > 0)
         {
             blend_from = true;
-            mapnik::filter::filter_visitor<image_32> visitor(*current_buffer_);
-            BOOST_FOREACH(mapnik::filter::filter_type const& filter_tag, st.image_filters())
-            {
-                boost::apply_visitor(visitor, filter_tag);
-            }
+            mapnik::filter::apply_filters(*current_buffer_, st.image_filters(), filter_threads_);
         }
 
         if (st.comp_op())
@@ -550,11 +556,7 @@ void agg_renderer<T>::end_style_processing(feature_type_style const& st)
         }
 
         // apply any 'direct' image filters
-        mapnik::filter::filter_visitor<image_32> visitor(pixmap_);
-        BOOST_FOREACH(mapnik::filter::filter_type const& filter_tag, st.direct_image_filters())
-        {
-            boost::apply_visitor(visitor, filter_tag);
-        }
+        mapnik::filter::apply_filters(pixmap_, st.direct_image_filters(), filter_threads_);
     }
 
     MAPNIK_LOG_DEBUG(agg_renderer) << "agg_renderer: End processing style";
@@ -562,7 +564,7 @@ void agg_renderer<T>::end_style_processing(feature_type_style const& st)
 
 template <typename T>
 void agg_renderer<T>::render_marker(pixel_position const& pos, marker const& marker, agg::trans_affine const& tr,
-                                    double opacity, composite_mode_e comp_op)
+                                    double opacity, composite_mode_e comp_op, std::string const& uri)
 {
     typedef agg::rgba8 color_type;
     typedef agg::order_rgba order_type;
@@ -590,6 +592,19 @@ void agg_renderer<T>::render_marker(pixel_position const& pos, marker const& mar
         // apply symbol transformation to get to map space
         mtx *= tr;
         mtx *= agg::trans_affine_scaling(scale_factor_);
+        if (!uri.empty())
+        {
+            marker_sprite_ptr sprite = marker_sprite_cache::instance().get(uri, marker, mtx);
+            if (sprite)
+            {
+                composite(current_buffer_->data(), sprite->image,
+                          comp_op, opacity,
+                          boost::math::iround(pos.x) + sprite->x,
+                          boost::math::iround(pos.y) + sprite->y,
+                          false);
+                return;
+            }
+        }
         // render the marker at the center of the marker box
         mtx.translate(pos.x, pos.y);
         using namespace mapnik::svg;
@@ -866,126 +881,41 @@ const int numChars = 256;
 }
 
 template <typename T>
-void agg_renderer<T>::extractVerticesInCurrentPathStorage(GLfloat vertices[][2], unsigned int &numberOfVertices, GLubyte commands[], unsigned int &numberOfCommands
-                                            , double &minX, double &maxX
-                                            , double &minY, double &maxY){
-
-        numberOfVertices = 0;
-    numberOfCommands = 0;
-    minX = 0.0;
-    maxX = 0.0;
-    minY = 0.0;
-    maxY = 0.0;
-
-    double x = 0, y = 0;
-    double startX = 0, startY = 0;
-    unsigned int currentStatus = 0;
-    unsigned int cmd;
-    bool initialMin = false;
-
-    // Extract vertices and commands
-    while (!agg::is_stop(cmd = pathStorage_.vertex(&x, &y))) {
-
-        if(!initialMin){
-            minX = (GLfloat)x;
-            minY = (GLfloat)y;
-            initialMin = true;
-        }
-
-
-        if (cmd == 79) {
-            if (currentStatus == agg::path_cmd_line_to) {
-                commands[numberOfCommands++] = GL_CLOSE_PATH_NV;
-                currentStatus = cmd;
-            }
-        } else {
-            switch (cmd) {
-                case agg::path_cmd_move_to:
-                    commands[numberOfCommands++] = GL_MOVE_TO_NV;
-                    startX = x;
-                    startY = y;
-                    currentStatus = agg::path_cmd_move_to;
-                    break;
-                case agg::path_cmd_line_to:
-                    commands[numberOfCommands++] = GL_LINE_TO_NV;
-                    currentStatus = agg::path_cmd_line_to;
-                    break;
-                default:
-                    break;
-                    // To do for other types
-            }
-
-            vertices[numberOfVertices][0] = (GLfloat)x;
-            vertices[numberOfVertices][1] = (GLfloat)y;
-            numberOfVertices++;
-
-            if(minX > (GLfloat)x){
-                minX = (GLfloat)x;
-            }
-            if(minY > (GLfloat)y){
-                minY = (GLfloat)y;
-            }
-            if(maxX < (GLfloat)x){
-                maxX = (GLfloat)x;
-            }
-            if(maxY < (GLfloat)y){
-                maxY = (GLfloat)y;
-            }
-
-        }
-
-    }
+void agg_renderer<T>::specifyPathFromCurrentPathStorage() {
 
+    pathStorage_.rewind(0);
+    pathBuffer_.assign(pathStorage_, pathStorage_.total_vertices());
 
+    glPathCommandsNV(pathObject_, pathBuffer_.num_commands(), pathBuffer_.commands(),
+                     pathBuffer_.num_coords(), GL_FLOAT, pathBuffer_.coords());
 }
 
-
-
-
 template <typename T>
-void agg_renderer<T>::extractVerticesInCurrentPathStorage(GLfloat vertices[][2], unsigned int &numberOfVertices, GLubyte commands[], unsigned int &numberOfCommands) {
-
-    numberOfVertices = 0;
-    numberOfCommands = 0;
-    double x = 0, y = 0;
-    double startX = 0, startY = 0;
-    unsigned int currentStatus = 0;
-    unsigned int cmd;
-
-    // Extract vertices and commands
-    while (!agg::is_stop(cmd = pathStorage_.vertex(&x, &y))) {
+void agg_renderer<T>::fillPathsInstanced(nvpr_path_buffer const& paths) {
 
+    GLsizei count = static_cast<GLsizei>(paths.size());
+    if (count == 0) return;
 
-        if (cmd == 79) {
-            if (currentStatus == agg::path_cmd_line_to) {
-                commands[numberOfCommands++] = GL_CLOSE_PATH_NV;
-                currentStatus = cmd;
-            }
-        } else {
-            switch (cmd) {
-                case agg::path_cmd_move_to:
-                    commands[numberOfCommands++] = GL_MOVE_TO_NV;
-                    startX = x;
-                    startY = y;
-                    currentStatus = agg::path_cmd_move_to;
-                    break;
-                case agg::path_cmd_line_to:
-                    commands[numberOfCommands++] = GL_LINE_TO_NV;
-                    currentStatus = agg::path_cmd_line_to;
-                    break;
-                default:
-                    break;
-                    // To do for other types
-            }
-
-            vertices[numberOfVertices][0] = (GLfloat)x;
-            vertices[numberOfVertices][1] = (GLfloat)y;
-            numberOfVertices++;
-
-        }
+    while (pathInstances_.size() < paths.size())
+    {
+        pathInstances_.push_back(static_cast<GLuint>(pathInstances_.size()));
+    }
 
+    GLubyte const* commands = paths.commands();
+    GLfloat const* coords = paths.coords();
+    for (GLsizei i = 0; i < count; ++i)
+    {
+        nvpr_path_buffer::span const& path = paths.path(i);
+        glPathCommandsNV(pathObject_ + i, path.num_commands, commands + path.first_command,
+                         path.num_coords, GL_FLOAT, coords + path.first_coord);
     }
 
+    glStencilFillPathInstancedNV(count, GL_UNSIGNED_INT, &pathInstances_[0], pathObject_,
+                                 GL_COUNT_UP_NV, 0x1F, GL_NONE, NULL);
+    glCoverFillPathInstancedNV(count, GL_UNSIGNED_INT, &pathInstances_[0], pathObject_,
+                               GL_BOUNDING_BOX_NV, GL_NONE, NULL);
+
+    pathObject_ += count;
 }
 
 template <typename T>
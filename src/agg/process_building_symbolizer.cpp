@@ -24,15 +24,10 @@
 #include <mapnik/graphics.hpp>
 #include <mapnik/agg_renderer.hpp>
 #include <mapnik/agg_rasterizer.hpp>
-#include <mapnik/segment.hpp>
+#include <mapnik/building_extrusion.hpp>
+#include <mapnik/stroke_outline.hpp>
 #include <mapnik/expression_evaluator.hpp>
 
-// boost
-#include <boost/scoped_ptr.hpp>
-
-// stl
-#include <deque>
-
 // agg
 #include "agg_basics.h"
 #include "agg_rendering_buffer.h"
@@ -40,7 +35,7 @@
 #include "agg_rasterizer_scanline_aa.h"
 #include "agg_scanline_u.h"
 #include "agg_renderer_scanline.h"
-#include "agg_conv_stroke.h"
+#include "agg_bounding_rect.h"
 
 namespace mapnik
 {
@@ -50,215 +45,96 @@ void agg_renderer<T>::process(building_symbolizer const& sym,
                               mapnik::feature_impl & feature,
                               proj_transform const& prj_trans)
 {
+    typedef coord_transform<CoordTransform,building_extrusion::path> extrusion_path_type;
 
-
-    typedef coord_transform<CoordTransform,geometry_type> path_type;
-    // typedef agg::renderer_base<agg::pixfmt_rgba32> ren_base;
-    // typedef agg::renderer_scanline_aa_solid<ren_base> renderer;
-
-   for (std::list<feature_ptr>::iterator f = featureList_->begin(); f != featureList_->end(); f++) {
-        feature_ptr featurePtr = *f;
-
-        mapnik::feature_impl &feature_ = *featurePtr;
-
-
-    // agg::rendering_buffer buf(current_buffer_->raw_data(),width_,height_, width_ * 4);
-    // agg::pixfmt_rgba32 pixf(buf);
-    // ren_base renb(pixf);
-
-    // color const& fill_  = sym.get_fill();
-    // unsigned r=fill_.red();
-    // unsigned g=fill_.green();
-    // unsigned b=fill_.blue();
-    // unsigned a=fill_.alpha();
-    // renderer ren(renb);
-    // agg::scanline_u8 sl;
-
-    // ras_ptr->reset();
-    // ras_ptr->gamma(agg::gamma_power());
-
-    double height = 0.0;
-    expression_ptr height_expr = sym.height();
-    if (height_expr)
+    // extrude the whole batch first, so buildings of different features
+    // can be drawn back to front
+    extrusion_.clear();
+    for (std::list<feature_ptr>::iterator f = featureList_->begin(); f != featureList_->end(); f++)
     {
-        value_type result = boost::apply_visitor(evaluate<Feature,value_type>(feature_), *height_expr);
-        height = result.to_double() * scale_factor_;
-    }
-
+        mapnik::feature_impl &feature_ = **f;
 
-
-    for (unsigned i=0;i<feature_.num_geometries();++i)
-    {
-
-        geometry_type const& geom = feature_.get_geometry(i);
-        
-
-
-        if (geom.size() > 2)
+        double height = 0.0;
+        expression_ptr height_expr = sym.height();
+        if (height_expr)
         {
+            value_type result = boost::apply_visitor(evaluate<Feature,value_type>(feature_), *height_expr);
+            height = result.to_double() * scale_factor_;
+        }
 
-            boost::scoped_ptr<geometry_type> frame(new geometry_type(LineString));
-            boost::scoped_ptr<geometry_type> roof(new geometry_type(Polygon));
-            std::deque<segment_t> face_segments;
-            double x0 = 0;
-            double y0 = 0;
-            double x,y;
-            geom.rewind(0);
-            for (unsigned cm = geom.vertex(&x, &y); cm != SEG_END;
-                 cm = geom.vertex(&x, &y))
-            {
-                if (cm == SEG_MOVETO)
-                {
-                    frame->move_to(x,y);
-
-                }
-                else if (cm == SEG_LINETO || cm == SEG_CLOSE)
-                {
-                    frame->line_to(x,y);
-                    face_segments.push_back(segment_t(x0,y0,x,y));
-                }
-                x0 = x;
-                y0 = y;
-            }
-
-
-            std::sort(face_segments.begin(),face_segments.end(), y_order);
-            std::deque<segment_t>::const_iterator itr=face_segments.begin();
-            std::deque<segment_t>::const_iterator end=face_segments.end();
-
-            for (; itr!=end; ++itr)
-            {
-   
-
-                boost::scoped_ptr<geometry_type> faces(new geometry_type(Polygon));
-                faces->move_to(itr->get<0>(),itr->get<1>());
-                faces->line_to(itr->get<2>(),itr->get<3>());
-                faces->line_to(itr->get<2>(),itr->get<3>() + height);
-                faces->line_to(itr->get<0>(),itr->get<1>() + height);
-
-                path_type faces_path (t_,*faces,prj_trans);
-                pathStorage_.concat_path(faces_path);
-                // ras_ptr->add_path(faces_path);
-                // ren.color(agg::rgba8(int(r*0.8), int(g*0.8), int(b*0.8), int(a * sym.get_opacity())));
-                // agg::render_scanlines(*ras_ptr, sl, ren);
-                // ras_ptr->reset();
-
-              
-                //
-                frame->move_to(itr->get<0>(),itr->get<1>());
-                frame->line_to(itr->get<0>(),itr->get<1>()+height);
-
-
-            }
-
-                 unsigned int size_face = pathStorage_.total_vertices() * 2;
-
-                GLfloat pathCoords_face[size_face][2];
-                GLubyte pathCommands_face[size_face];
-
-                unsigned int numberOfVertices_face = 0;
-                unsigned int numberOfCommands_face = 0;
-
-                extractVerticesInCurrentPathStorage(pathCoords_face, numberOfVertices_face, pathCommands_face, numberOfCommands_face);
-
-                color const& fill = sym.get_fill();
-                
-                glPathCommandsNV(pathObject_, numberOfCommands_face, pathCommands_face, numberOfVertices_face * 2, GL_FLOAT, pathCoords_face);
-
-
-                glStencilFillPathNV(pathObject_, GL_COUNT_UP_NV, 0x1F);
-                agg::rgba8 color_face = agg::rgba8_pre(fill.red()*0.8, fill.green()*0.8, fill.blue()*0.8, int(fill.alpha() * sym.get_opacity()));
-                glColor4ub(color_face.r, color_face.g, color_face.b, color_face.a);
-                glCoverFillPathNV(pathObject_, GL_BOUNDING_BOX_NV);
-
-
-                pathObject_++; 
-                pathStorage_.remove_all();
-
-
-            geom.rewind(0);
-            for (unsigned cm = geom.vertex(&x, &y); cm != SEG_END;
-                 cm = geom.vertex(&x, &y))
+        for (unsigned i=0;i<feature_.num_geometries();++i)
+        {
+            geometry_type const& geom = feature_.get_geometry(i);
+            if (geom.size() > 2)
             {
-                if (cm == SEG_MOVETO)
-                {
-                    frame->move_to(x,y+height);
-                    roof->move_to(x,y+height);
-
-                }
-                else if (cm == SEG_LINETO || cm == SEG_CLOSE)
-                {
-                    frame->line_to(x,y+height);
-                    roof->line_to(x,y+height);
-                }
+                extrusion_.add(geom, height);
             }
-
-            path_type path(t_,*frame,prj_trans);
-            agg::conv_stroke<path_type> stroke(path);
-            stroke.width(scale_factor_);
-            pathStorage_.concat_path(stroke);
-            // ras_ptr->add_path(stroke);
-            // ren.color(agg::rgba8(int(r*0.8), int(g*0.8), int(b*0.8), int(255 * sym.get_opacity())));
-            // agg::render_scanlines(*ras_ptr, sl, ren);
-            // ras_ptr->reset();
-
-            unsigned int size_frame = pathStorage_.total_vertices() * 2;
-
-            GLfloat pathCoords_frame[size_frame][2];
-            GLubyte pathCommands_frame[size_frame];
-
-            unsigned int numberOfVertices_frame = 0;
-            unsigned int numberOfCommands_frame = 0;
-
-            extractVerticesInCurrentPathStorage(pathCoords_frame, numberOfVertices_frame, pathCommands_frame, numberOfCommands_frame);
-                
-            glPathCommandsNV(pathObject_, numberOfCommands_frame, pathCommands_frame, numberOfVertices_frame * 2, GL_FLOAT, pathCoords_frame);
-
-
-            glStencilFillPathNV(pathObject_, GL_COUNT_UP_NV, 0x1F);
-            agg::rgba8 color_frame = agg::rgba8_pre(fill.red()*0.8, fill.green()*0.8, fill.blue()*0.8, int(fill.alpha() * sym.get_opacity()));
-            glColor4ub(color_frame.r, color_frame.g, color_frame.b, color_frame.a);
-            glCoverFillPathNV(pathObject_, GL_BOUNDING_BOX_NV);
-
-
-            pathObject_++; 
-            pathStorage_.remove_all();
-
-
-            path_type roof_path (t_,*roof,prj_trans);
-            pathStorage_.concat_path(roof_path);
-
-            // ras_ptr->add_path(roof_path);
-            // ren.color(agg::rgba8(r, g, b, int(a * sym.get_opacity())));
-            // agg::render_scanlines(*ras_ptr, sl, ren);
-
-
-            unsigned int size_roof = pathStorage_.total_vertices() * 2;
-
-            GLfloat pathCoords_roof[size_roof][2];
-            GLubyte pathCommands_roof[size_roof];
-
-            unsigned int numberOfVertices_roof = 0;
-            unsigned int numberOfCommands_roof = 0;
-
-            extractVerticesInCurrentPathStorage(pathCoords_roof, numberOfVertices_roof, pathCommands_roof, numberOfCommands_roof);
-                
-            glPathCommandsNV(pathObject_, numberOfCommands_roof, pathCommands_roof, numberOfVertices_roof * 2, GL_FLOAT, pathCoords_roof);
-
-
-            glStencilFillPathNV(pathObject_, GL_COUNT_UP_NV, 0x1F);
-            agg::rgba8 color_roof = agg::rgba8_pre(fill.red(), fill.green(), fill.blue(), int(fill.alpha() * sym.get_opacity()));
+        }
+    }
+    extrusion_.depth_sort();
+
+    color const& fill = sym.get_fill();
+    agg::rgba8 color_face = agg::rgba8_pre(fill.red()*0.8, fill.green()*0.8, fill.blue()*0.8, int(fill.alpha() * sym.get_opacity()));
+    agg::rgba8 color_roof = agg::rgba8_pre(fill.red(), fill.green(), fill.blue(), int(fill.alpha() * sym.get_opacity()));
+
+    // Walls (faces and frame, which share a color) and roofs are drawn in
+    // runs of buildings that do not overlap on screen, one instanced fill
+    // for the walls of a run and one for its roofs. Overlapping buildings
+    // start a new run, keeping them in painter's order.
+    label_collision_detector4 run_extents(box2d<double>(0, 0, width_, height_));
+    frameOutline_.setup(stroke_params(stroke(), scale_factor_));
+    pathBuffer_.clear();
+    roofBuffer_.clear();
+
+    for (std::size_t i = 0; i < extrusion_.size(); ++i)
+    {
+        building_extrusion::path faces = extrusion_.faces(i);
+        extrusion_path_type faces_path(t_, faces, prj_trans);
+        pathStorage_.remove_all();
+        pathStorage_.concat_path(faces_path);
+
+        building_extrusion::path frame = extrusion_.frame(i);
+        extrusion_path_type frame_path(t_, frame, prj_trans);
+        frameOutline_.clear();
+        frameOutline_.add_path(frame_path);
+        pathStorage_.concat_path(frameOutline_);
+
+        double x1, y1, x2, y2;
+        if (!agg::bounding_rect_single(pathStorage_, 0, &x1, &y1, &x2, &y2))
+        {
+            continue;
+        }
+        box2d<double> walls_extent(x1, y1, x2, y2);
+        if (!run_extents.has_placement(walls_extent))
+        {
+            glColor4ub(color_face.r, color_face.g, color_face.b, color_face.a);
+            fillPathsInstanced(pathBuffer_);
             glColor4ub(color_roof.r, color_roof.g, color_roof.b, color_roof.a);
-            glCoverFillPathNV(pathObject_, GL_BOUNDING_BOX_NV);
-
-            pathObject_++; 
-            pathStorage_.remove_all();
+            fillPathsInstanced(roofBuffer_);
+            pathBuffer_.clear();
+            roofBuffer_.clear();
+            run_extents.clear();
+        }
+        run_extents.insert(walls_extent);
 
+        pathStorage_.rewind(0);
+        pathBuffer_.append(pathStorage_, pathStorage_.total_vertices());
 
-        }
+        building_extrusion::path roof = extrusion_.roof(i);
+        extrusion_path_type roof_path(t_, roof, prj_trans);
+        pathStorage_.remove_all();
+        pathStorage_.concat_path(roof_path);
+        pathStorage_.rewind(0);
+        roofBuffer_.append(pathStorage_, pathStorage_.total_vertices());
     }
 
-  }
+    glColor4ub(color_face.r, color_face.g, color_face.b, color_face.a);
+    fillPathsInstanced(pathBuffer_);
+    glColor4ub(color_roof.r, color_roof.g, color_roof.b, color_roof.a);
+    fillPathsInstanced(roofBuffer_);
+    pathBuffer_.clear();
+    roofBuffer_.clear();
+    pathStorage_.remove_all();
 }
 
 template void agg_renderer<image_32>::process(building_symbolizer const&,
@@ -28,6 +28,7 @@
 
 #include <mapnik/line_symbolizer.hpp>
 #include <mapnik/vertex_converters.hpp>
+#include <mapnik/stroke_outline.hpp>
 
 // agg
 #include "agg_basics.h"
@@ -51,7 +52,7 @@
 namespace mapnik {
 
 template <typename T>
-void agg_renderer<T>::setJoinCaps(stroke const& stroke) {
+void agg_renderer<T>::setJoinCaps(stroke_params const& stroke) {
 
     line_join_e join=stroke.get_line_join();
     switch (join) {
@@ -92,34 +93,32 @@ void agg_renderer<T>::setJoinCaps(stroke const& stroke) {
 }
 
 template <typename T>
-void agg_renderer<T>::setMiterLimit(stroke const& stroke) {
+void agg_renderer<T>::setMiterLimit(stroke_params const& stroke) {
     glPathParameterfNV(pathObject_, GL_PATH_MITER_LIMIT_NV, stroke.get_miterlimit());
 }
 
 template <typename T>
-void agg_renderer<T>::setWidth(stroke const& stroke, double scale_factor) {
-    glPathParameterfNV(pathObject_, GL_PATH_STROKE_WIDTH_NV, stroke.get_width() * scale_factor);
+void agg_renderer<T>::setWidth(stroke_params const& stroke) {
+    glPathParameterfNV(pathObject_, GL_PATH_STROKE_WIDTH_NV, stroke.get_width());
 }
 
 template <typename T>
-void agg_renderer<T>::setDash(stroke const& stroke, double scale_factor) {
+void agg_renderer<T>::setDash(stroke_params const& stroke) {
     dash_array const& d = stroke.get_dash_array();
     dash_array::const_iterator itr = d.begin();
     dash_array::const_iterator end = d.end();
 
-    GLfloat *dashArray = (float *)calloc(d.size() * 2, sizeof(GLfloat *));
-    unsigned int i = 0;
+    dashArray_.clear();
     for (;itr != end;++itr)
     {
-        dashArray[i] = (GLfloat)(itr->first * scale_factor);
-        i++;
-        dashArray[i] = (GLfloat)(itr->second * scale_factor);
-        i++;
+        dashArray_.push_back((GLfloat)itr->first);
+        dashArray_.push_back((GLfloat)itr->second);
     }
 
-    glPathDashArrayNV(pathObject_, i, dashArray);
-
-    free(dashArray);
+    if (! dashArray_.empty())
+    {
+        glPathDashArrayNV(pathObject_, dashArray_.size(), &dashArray_[0]);
+    }
 }
 
 // template <typename T>
@@ -328,6 +327,7 @@ void agg_renderer<T>::process(line_symbolizer const& sym,
 {
 
     stroke const& stroke_ = sym.get_stroke();
+    stroke_params const params(stroke_, scale_factor_);
 
     // ras_ptr->reset();
     // set_gamma_method(stroke_, ras_ptr);
@@ -388,24 +388,16 @@ void agg_renderer<T>::process(line_symbolizer const& sym,
 
         if(size >= 900000){
 
-    GLfloat pathCoords[size][2];
-    GLubyte pathCommands[size];
-
-    unsigned int numberOfVertices = 0;
-    unsigned int numberOfCommands = 0;
-
-    extractVerticesInCurrentPathStorage(pathCoords, numberOfVertices, pathCommands, numberOfCommands);
-
-    glPathCommandsNV(pathObject_, numberOfCommands, pathCommands, numberOfVertices * 2, GL_FLOAT, pathCoords);
+    specifyPathFromCurrentPathStorage();
 
     // Parameters
     color const& fill = stroke_.get_color();
 
-    setJoinCaps(stroke_);
-    setMiterLimit(stroke_);
-    setWidth(stroke_, scale_factor_);
-    if (stroke_.has_dash()) {
-        setDash(stroke_, scale_factor_);
+    setJoinCaps(params);
+    setMiterLimit(params);
+    setWidth(params);
+    if (params.has_dash()) {
+        setDash(params);
     }
 
     boost::timer t2;
@@ -434,26 +426,16 @@ void agg_renderer<T>::process(line_symbolizer const& sym,
     }
 
 
-    unsigned int size = pathStorage_.total_vertices() * 2;
-
-    GLfloat pathCoords[size][2];
-    GLubyte pathCommands[size];
-
-    unsigned int numberOfVertices = 0;
-    unsigned int numberOfCommands = 0;
-
-    extractVerticesInCurrentPathStorage(pathCoords, numberOfVertices, pathCommands, numberOfCommands);
-
-    glPathCommandsNV(pathObject_, numberOfCommands, pathCommands, numberOfVertices * 2, GL_FLOAT, pathCoords);
+    specifyPathFromCurrentPathStorage();
 
     // Parameters
     color const& fill = stroke_.get_color();
 
-    setJoinCaps(stroke_);
-    setMiterLimit(stroke_);
-    setWidth(stroke_, scale_factor_);
-    if (stroke_.has_dash()) {
-        setDash(stroke_, scale_factor_);
+    setJoinCaps(params);
+    setMiterLimit(params);
+    setWidth(params);
+    if (params.has_dash()) {
+        setDash(params);
     }
 
     boost::timer t2;
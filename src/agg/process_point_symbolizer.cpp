@@ -30,6 +30,7 @@
 #include <mapnik/expression_evaluator.hpp>
 #include <mapnik/marker.hpp>
 #include <mapnik/marker_cache.hpp>
+#include <mapnik/marker_sprite_cache.hpp>
 
 // agg
 #include "agg_trans_affine.h"
@@ -39,16 +40,61 @@
 
 // boost
 #include <boost/make_shared.hpp>
+#include <boost/math/special_functions/round.hpp>
 
 namespace mapnik {
 
+template <typename T>
+void agg_renderer<T>::drawMarkerBatch(image_data_32 const& image)
+{
+    if (pathBuffer_.empty()) return;
+
+    glMatrixLoadIdentityEXT(GL_PROJECTION);
+    glMatrixOrthoEXT(GL_PROJECTION, 0, width_, height_, 0, -1, 1);
+    glMatrixLoadIdentityEXT(GL_MODELVIEW);
+
+    GLuint texName;
+    glGenTextures(1, &texName);
+    glBindTexture(GL_TEXTURE_2D, texName);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, image.width(), image.height(), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, (unsigned char *)image.getBytes());
+
+    glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
+
+    GLfloat data[2][3] = { { 1,0,0 },    /* s = 1*x + 0*y + 0 */
+                           { 0,1,0 } };  /* t = 0*x + 1*y + 0 */
+
+    // the texture coordinates follow the bounding box of each instance
+    glEnable(GL_TEXTURE_2D);
+    glPathTexGenNV(GL_TEXTURE0, GL_PATH_OBJECT_BOUNDING_BOX_NV, 2, &data[0][0]);
+    fillPathsInstanced(pathBuffer_);
+    glDisable(GL_TEXTURE_2D);
+
+    glDeleteTextures(1, &texName);
+    pathBuffer_.clear();
+}
+
 template <typename T>
 void agg_renderer<T>::process(point_symbolizer const& sym,
                               mapnik::feature_impl & feature,
                               proj_transform const& prj_trans)
 {
-
-   for (std::list<feature_ptr>::iterator f = featureList_->begin(); f != featureList_->end(); f++) {
+    // Markers are drawn in runs sharing one image: the texture is uploaded
+    // once per run and the quads filled with one instanced call. A run ends
+    // when the image changes or a quad would overlap one already in it, so
+    // the markers still come out in feature order.
+    image_data_32 const* batch_image = 0;
+    marker_sprite_ptr batch_sprite;
+    boost::optional<mapnik::marker_ptr> batch_marker;
+    label_collision_detector4 batch_extents(box2d<double>(0, 0, width_, height_));
+    pathBuffer_.clear();
+
+    for (std::list<feature_ptr>::iterator f = featureList_->begin(); f != featureList_->end(); f++) {
         feature_ptr featurePtr = *f;
 
         mapnik::feature_impl &feature_ = *featurePtr;
@@ -85,12 +131,12 @@ void agg_renderer<T>::process(point_symbolizer const& sym,
             if (sym.get_point_placement() == CENTROID_POINT_PLACEMENT)
             {
                 if (!label::centroid(geom, x, y))
-                    return;
+                    continue;
             }
             else
             {
                 if (!label::interior_position(geom ,x, y))
-                    return;
+                    continue;
             }
 
             prj_trans.backward(x,y,z);
@@ -103,69 +149,39 @@ void agg_renderer<T>::process(point_symbolizer const& sym,
 
                     marker const& marker_ = **markerPtr;
 
-                    image_data_32 const& src = **marker_.get_bitmap_data();
+                    // vector markers are rasterized once per size and
+                    // rotation and the sprite uploaded in place of a bitmap
+                    marker_sprite_ptr sprite;
+                    if (marker_.is_vector())
+                    {
+                        agg::trans_affine sprite_tr = recenter_tr * agg::trans_affine_scaling(scale_factor_);
+                        sprite = marker_sprite_cache::instance().get(filename, marker_, sprite_tr);
+                    }
+
+                    image_data_32 const& src = sprite ? sprite->image : **marker_.get_bitmap_data();
           double width =  src.width();
           double height =  src.height();
 
           const double shifted = 0;
           double markerX = x + shifted - width/2, markerY = height_ - y - shifted - height/2;
-
-
-                  glMatrixLoadIdentityEXT(GL_PROJECTION);
-                  glMatrixOrthoEXT(GL_PROJECTION, 0, width_, height_, 0, -1, 1);
-                  glMatrixLoadIdentityEXT(GL_MODELVIEW);
-
-
-                  GLubyte cmd[5];  
-                  GLfloat coord[8];
-                  int m = 0, n = 0;
-
-                  cmd[m++] = GL_MOVE_TO_NV;
-                  coord[n++] = markerX;
-                  coord[n++] = markerY;
-                  cmd[m++] = GL_LINE_TO_NV;
-                  coord[n++] = markerX + width;
-                  coord[n++] = markerY;
-                  cmd[m++] = GL_LINE_TO_NV;
-                  coord[n++] = markerX + width;
-                  coord[n++] = markerY + height;
-                  cmd[m++] = GL_LINE_TO_NV;
-                  coord[n++] = markerX;
-                  coord[n++] = markerY + height;
-                  cmd[m++] = GL_CLOSE_PATH_NV;
-
-                  glPathCommandsNV(pathObject_, m, cmd, n, GL_FLOAT, coord);
-                
-                  static GLuint texName;
-                  glGenTextures(1, &texName);
-                  glBindTexture(GL_TEXTURE_2D, texName);
-                  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-                  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-                  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-                  glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_TRUE);
-                  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0,
-                    GL_RGBA, GL_UNSIGNED_BYTE, (unsigned char *)src.getBytes());
-
-
-                  glTexEnvi(GL_TEXTURE_ENV, GL_TEXTURE_ENV_MODE, GL_REPLACE);
-
-
-
-
-                  GLfloat data[2][3] = { { 1,0,0 },    /* s = 1*x + 0*y + 0 */
-                                         { 0,1,0 } };  /* t = 0*x + 1*y + 0 */
-                  
-                    glEnable(GL_TEXTURE_2D);
-                    glPathTexGenNV(GL_TEXTURE0, GL_PATH_OBJECT_BOUNDING_BOX_NV, 2, &data[0][0]);
-                    glStencilFillPathNV(pathObject_, GL_COUNT_UP_NV, 0x1F);
-                    glCoverFillPathNV(pathObject_, GL_BOUNDING_BOX_NV);
-                    glDisable(GL_TEXTURE_2D);
-
-                    pathObject_++;
-
-
-          
+          if (sprite)
+          {
+              markerX = boost::math::iround(x) + sprite->x;
+              markerY = height_ - boost::math::iround(y) - sprite->y - height;
+          }
+
+                  box2d<double> quad(markerX, markerY, markerX + width, markerY + height);
+                  if (&src != batch_image || !batch_extents.has_placement(quad))
+                  {
+                      if (batch_image) drawMarkerBatch(*batch_image);
+                      batch_extents.clear();
+                      batch_image = &src;
+                      // keep the image alive until the run is drawn
+                      batch_sprite = sprite;
+                      batch_marker = markerPtr;
+                  }
+                  pathBuffer_.append(quad);
+                  batch_extents.insert(quad);
 
                 // render_marker(pixel_position(x, y),
                 //               **marker,
@@ -185,6 +201,8 @@ void agg_renderer<T>::process(point_symbolizer const& sym,
     }
 
   }
+
+    if (batch_image) drawMarkerBatch(*batch_image);
 }
 
 template void agg_renderer<image_32>::process(point_symbolizer const&,
@@ -130,24 +130,12 @@ void agg_renderer<T>::process(polygon_pattern_symbolizer const& sym,
     unsigned int size = pathStorage_.total_vertices() * 2;
 
     if(size >= 900000){
-    GLfloat pathCoords[size][2];
-    GLubyte pathCommands[size];
 
-    unsigned int numberOfVertices = 0;
-    unsigned int numberOfCommands = 0;
-    double minX = 0.0;
-    double maxX = 0.0;
-    double minY = 0.0;
-    double maxY = 0.0;
+    specifyPathFromCurrentPathStorage();
 
-    extractVerticesInCurrentPathStorage(pathCoords, numberOfVertices, pathCommands, numberOfCommands,minX,maxX,minY,maxY);
-
-    
-    glPathCommandsNV(pathObject_, numberOfCommands, pathCommands, numberOfVertices * 2, GL_FLOAT, pathCoords);
-
-
-    int numOfTextureCol = (maxX - minX) / markerWidth;
-    int numOfTextureRow = (maxY - minY) / markerHeight;
+    box2d<double> const& bounds = pathBuffer_.bounds();
+    int numOfTextureCol = bounds.width() / markerWidth;
+    int numOfTextureRow = bounds.height() / markerHeight;
 
 
     GLfloat data[2][3] = { { numOfTextureCol,0,0 },    /* s = 1*x + 0*y + 0 */
@@ -174,26 +162,11 @@ void agg_renderer<T>::process(polygon_pattern_symbolizer const& sym,
   
 
 
-    unsigned int size = pathStorage_.total_vertices() * 2;
-
-    GLfloat pathCoords[size][2];
-    GLubyte pathCommands[size];
-
-    unsigned int numberOfVertices = 0;
-    unsigned int numberOfCommands = 0;
-    double minX = 0.0;
-    double maxX = 0.0;
-    double minY = 0.0;
-    double maxY = 0.0;
-
-    extractVerticesInCurrentPathStorage(pathCoords, numberOfVertices, pathCommands, numberOfCommands,minX,maxX,minY,maxY);
-
-
-    glPathCommandsNV(pathObject_, numberOfCommands, pathCommands, numberOfVertices * 2, GL_FLOAT, pathCoords);
-
+    specifyPathFromCurrentPathStorage();
 
-    int numOfTextureCol = (maxX - minX) / markerWidth;
-    int numOfTextureRow = (maxY - minY) / markerHeight;
+    box2d<double> const& bounds = pathBuffer_.bounds();
+    int numOfTextureCol = bounds.width() / markerWidth;
+    int numOfTextureRow = bounds.height() / markerHeight;
 
 
     GLfloat data[2][3] = { { numOfTextureCol,0,0 },    /* s = 1*x + 0*y + 0 */
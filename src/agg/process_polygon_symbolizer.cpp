@@ -200,18 +200,11 @@ void agg_renderer<T>::process(polygon_symbolizer const& sym,
          unsigned int size = pathStorage_.total_vertices() * 2;
 
     if(size >= 900000){
-        GLfloat pathCoords[size][2];
-    GLubyte pathCommands[size];
 
-    unsigned int numberOfVertices = 0;
-    unsigned int numberOfCommands = 0;
-
-    extractVerticesInCurrentPathStorage(pathCoords, numberOfVertices, pathCommands, numberOfCommands);
+    specifyPathFromCurrentPathStorage();
 
     color const& fill = sym.get_fill();
     
-    glPathCommandsNV(pathObject_, numberOfCommands, pathCommands, numberOfVertices * 2, GL_FLOAT, pathCoords);
-
     boost::timer t2;
 
     glStencilFillPathNV(pathObject_, GL_COUNT_UP_NV, 0x1F);
@@ -239,20 +232,10 @@ void agg_renderer<T>::process(polygon_symbolizer const& sym,
     }
 
 
-    unsigned int size = pathStorage_.total_vertices() * 2;
-
-    GLfloat pathCoords[size][2];
-    GLubyte pathCommands[size];
-
-    unsigned int numberOfVertices = 0;
-    unsigned int numberOfCommands = 0;
-
-    extractVerticesInCurrentPathStorage(pathCoords, numberOfVertices, pathCommands, numberOfCommands);
+    specifyPathFromCurrentPathStorage();
 
     color const& fill = sym.get_fill();
     
-    glPathCommandsNV(pathObject_, numberOfCommands, pathCommands, numberOfVertices * 2, GL_FLOAT, pathCoords);
-
     boost::timer t2;
 
     glStencilFillPathNV(pathObject_, GL_COUNT_UP_NV, 0x1F);
@@ -131,6 +131,7 @@ source = Split(
     line_symbolizer.cpp
     line_pattern_symbolizer.cpp
     map.cpp
+    metatile.cpp
     load_map.cpp
     memory.cpp
     parse_path.cpp
@@ -138,6 +139,7 @@ source = Split(
     palette.cpp
     path_expression_grammar.cpp
     placement_finder.cpp
+    text_shaping_cache.cpp
     plugin.cpp
     png_reader.cpp
     point_symbolizer.cpp
@@ -151,6 +153,8 @@ source = Split(
     wkb.cpp
     projection.cpp
     proj_transform.cpp
+    well_known_srs.cpp
+    reprojection_cache.cpp
     distance.cpp
     scale_denominator.cpp
     simplify.cpp
@@ -166,6 +170,7 @@ source = Split(
     wkt/wkt_generator.cpp
     mapped_memory_cache.cpp
     marker_cache.cpp
+    marker_sprite_cache.cpp
     svg/svg_parser.cpp
     svg/svg_path_parser.cpp
     svg/svg_points_parser.cpp
@@ -175,6 +180,7 @@ source = Split(
     json/geometry_parser.cpp
     json/feature_grammar.cpp
     json/feature_collection_parser.cpp
+    json/feature_parser.cpp
     json/geojson_generator.cpp
     processed_text.cpp
     formatting/base.cpp
@@ -190,6 +196,7 @@ source = Split(
     text_placements/simple.cpp
     text_properties.cpp
     xml_tree.cpp
+    compiled_xml.cpp
     config_error.cpp
     color_factory.cpp
     nvpr_init.cpp
@@ -275,6 +282,7 @@ source += Split(
     """
     grid/grid.cpp
     grid/grid_renderer.cpp
+    grid/grid_utf.cpp
     grid/process_building_symbolizer.cpp
     grid/process_line_pattern_symbolizer.cpp
     grid/process_line_symbolizer.cpp
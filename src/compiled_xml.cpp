@@ -0,0 +1,303 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/xml_loader.hpp>
+#include <mapnik/xml_node.hpp>
+#include <mapnik/config_error.hpp>
+#include <mapnik/version.hpp>
+#include <mapnik/debug.hpp>
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// stl
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+namespace mapnik
+{
+
+/* Layout of a compiled stylesheet, all integers in native byte order:
+ *
+ *   header: magic[8] format_version:u32 mapnik_version:u32 byte_order:u32 reserved:u32
+ *           source_count:u32 (path:str size:u64 mtime:i64)*
+ *   body:   child_count:u32 node*
+ *   node:   name:str line:u32 is_text:u8 attribute_count:u32 (name:str value:str)*
+ *           child_count:u32 node*
+ *   str:    length:u32 bytes
+ *
+ * Text nodes store their text as name. Bump compiled_xml_format whenever
+ * the layout or the meaning of the tree changes.
+ */
+
+namespace {
+
+char const compiled_xml_magic[8] = { 'M', 'A', 'P', 'N', 'I', 'K', 'X', '\0' };
+boost::uint32_t const compiled_xml_format = 2;
+boost::uint32_t const compiled_xml_byte_order = 0x01020304;
+
+struct source_stamp
+{
+    boost::uint64_t size;
+    boost::int64_t mtime;
+};
+
+source_stamp stamp_of(std::string const& source)
+{
+    source_stamp stamp = { 0, 0 };
+    if (source.empty()) return stamp;
+    boost::filesystem::path path(source);
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(path, ec)) return stamp;
+    stamp.size = static_cast<boost::uint64_t>(boost::filesystem::file_size(path, ec));
+    stamp.mtime = static_cast<boost::int64_t>(boost::filesystem::last_write_time(path, ec));
+    return stamp;
+}
+
+class compiled_xml_writer
+{
+public:
+    explicit compiled_xml_writer(std::ostream & out)
+        : out_(out) {}
+
+    template <typename T>
+    void write(T value)
+    {
+        out_.write(reinterpret_cast<char const*>(&value), sizeof(T));
+    }
+
+    void write(std::string const& str)
+    {
+        write(static_cast<boost::uint32_t>(str.size()));
+        out_.write(str.data(), str.size());
+    }
+
+    void write_children(xml_node const& node)
+    {
+        boost::uint32_t count = static_cast<boost::uint32_t>(std::distance(node.begin(), node.end()));
+        write(count);
+        for (xml_node::const_iterator itr = node.begin(); itr != node.end(); ++itr)
+        {
+            write_node(*itr);
+        }
+    }
+
+    void write_node(xml_node const& node)
+    {
+        write(node.is_text() ? node.text() : node.name());
+        write(static_cast<boost::uint32_t>(node.line()));
+        write(static_cast<boost::uint8_t>(node.is_text() ? 1 : 0));
+        xml_node::attribute_map const& attrs = node.get_attributes();
+        write(static_cast<boost::uint32_t>(attrs.size()));
+        for (xml_node::attribute_map::const_iterator itr = attrs.begin(); itr != attrs.end(); ++itr)
+        {
+            write(itr->first);
+            write(itr->second.value);
+        }
+        write_children(node);
+    }
+
+private:
+    std::ostream & out_;
+};
+
+// Bounds checked cursor over the mapped file. With a NULL parent the body
+// is only validated, so a corrupt file never leaves a half built tree behind.
+class compiled_xml_reader
+{
+public:
+    compiled_xml_reader(char const* data, std::size_t size)
+        : pos_(data),
+          end_(data + size) {}
+
+    template <typename T>
+    bool read(T & value)
+    {
+        if (static_cast<std::size_t>(end_ - pos_) < sizeof(T)) return false;
+        std::memcpy(&value, pos_, sizeof(T));
+        pos_ += sizeof(T);
+        return true;
+    }
+
+    bool read(std::string & str)
+    {
+        boost::uint32_t length;
+        if (!read(length) || static_cast<std::size_t>(end_ - pos_) < length) return false;
+        str.assign(pos_, length);
+        pos_ += length;
+        return true;
+    }
+
+    bool read_children(xml_node * parent, unsigned depth)
+    {
+        boost::uint32_t count;
+        if (!read(count) || depth > 1024) return false;
+        for (boost::uint32_t i = 0; i < count; ++i)
+        {
+            if (!read_node(parent, depth)) return false;
+        }
+        return true;
+    }
+
+    bool read_node(xml_node * parent, unsigned depth)
+    {
+        std::string name;
+        boost::uint32_t line;
+        boost::uint8_t is_text;
+        boost::uint32_t attr_count;
+        if (!read(name) || !read(line) || !read(is_text) || !read(attr_count)) return false;
+        xml_node * node = parent ? &parent->add_child(name, line, is_text != 0) : 0;
+        std::string attr_name;
+        std::string attr_value;
+        for (boost::uint32_t i = 0; i < attr_count; ++i)
+        {
+            if (!read(attr_name) || !read(attr_value)) return false;
+            if (node) node->add_attribute(attr_name, attr_value);
+        }
+        return read_children(node, depth + 1);
+    }
+
+    bool at_end() const
+    {
+        return pos_ == end_;
+    }
+
+private:
+    char const* pos_;
+    char const* end_;
+};
+
+}
+
+void write_compiled_xml(std::string const & filename, xml_node const& node, std::vector<std::string> const& sources)
+{
+    // each writer gets its own temporary file next to the target, the rename then
+    // swaps in a complete stylesheet no matter how many processes compile at once
+    std::string tmp_filename = boost::filesystem::unique_path(filename + ".%%%%-%%%%-%%%%.tmp").string();
+    {
+        std::ofstream out(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out)
+        {
+            throw config_error("Could not write compiled stylesheet", 0, tmp_filename);
+        }
+        compiled_xml_writer writer(out);
+        out.write(compiled_xml_magic, sizeof(compiled_xml_magic));
+        writer.write(compiled_xml_format);
+        writer.write(static_cast<boost::uint32_t>(MAPNIK_VERSION));
+        writer.write(compiled_xml_byte_order);
+        writer.write(static_cast<boost::uint32_t>(0));
+        writer.write(static_cast<boost::uint32_t>(sources.size()));
+        for (std::vector<std::string>::const_iterator itr = sources.begin(); itr != sources.end(); ++itr)
+        {
+            source_stamp stamp = stamp_of(*itr);
+            writer.write(*itr);
+            writer.write(stamp.size);
+            writer.write(stamp.mtime);
+        }
+        writer.write_children(node);
+        out.flush();
+        if (!out)
+        {
+            throw config_error("Could not write compiled stylesheet", 0, tmp_filename);
+        }
+    }
+    if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tmp_filename.c_str());
+        throw config_error("Could not write compiled stylesheet", 0, filename);
+    }
+}
+
+bool read_compiled_xml(std::string const & filename, xml_node &node, std::string const & source)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(filename, ec)) return false;
+    try
+    {
+        boost::interprocess::file_mapping mapping(filename.c_str(), boost::interprocess::read_only);
+        boost::interprocess::mapped_region region(mapping, boost::interprocess::read_only);
+        char const* data = static_cast<char const*>(region.get_address());
+        std::size_t size = region.get_size();
+
+        if (size < sizeof(compiled_xml_magic) ||
+            std::memcmp(data, compiled_xml_magic, sizeof(compiled_xml_magic)) != 0)
+        {
+            MAPNIK_LOG_DEBUG(compiled_xml) << "compiled_xml: '" << filename << "' is not a compiled stylesheet";
+            return false;
+        }
+        compiled_xml_reader reader(data + sizeof(compiled_xml_magic), size - sizeof(compiled_xml_magic));
+        boost::uint32_t format, version, byte_order, reserved;
+        if (!reader.read(format) || !reader.read(version) ||
+            !reader.read(byte_order) || !reader.read(reserved))
+        {
+            return false;
+        }
+        if (format != compiled_xml_format ||
+            version != static_cast<boost::uint32_t>(MAPNIK_VERSION) ||
+            byte_order != compiled_xml_byte_order)
+        {
+            MAPNIK_LOG_DEBUG(compiled_xml) << "compiled_xml: '" << filename << "' was written by another version";
+            return false;
+        }
+        boost::uint32_t source_count;
+        if (!reader.read(source_count)) return false;
+        if (source_count == 0 && !source.empty()) return false;
+        for (boost::uint32_t i = 0; i < source_count; ++i)
+        {
+            std::string path;
+            source_stamp stamp;
+            if (!reader.read(path) || !reader.read(stamp.size) || !reader.read(stamp.mtime)) return false;
+            if (i == 0 && path != source)
+            {
+                MAPNIK_LOG_DEBUG(compiled_xml) << "compiled_xml: '" << filename << "' was compiled from '" << path << "'";
+                return false;
+            }
+            source_stamp current = stamp_of(path);
+            if (current.size != stamp.size || current.mtime != stamp.mtime)
+            {
+                MAPNIK_LOG_DEBUG(compiled_xml) << "compiled_xml: '" << filename << "' is older than '" << path << "'";
+                return false;
+            }
+        }
+
+        compiled_xml_reader validator(reader);
+        if (!validator.read_children(0, 0) || !validator.at_end())
+        {
+            MAPNIK_LOG_ERROR(compiled_xml) << "compiled_xml: '" << filename << "' is corrupt, ignoring it";
+            return false;
+        }
+        return reader.read_children(&node, 0);
+    }
+    catch (boost::interprocess::interprocess_exception const& ex)
+    {
+        MAPNIK_LOG_ERROR(compiled_xml) << "compiled_xml: could not map '" << filename << "': " << ex.what();
+        return false;
+    }
+}
+
+}
@@ -57,7 +57,7 @@ datasource_cache::~datasource_cache()
     lt_dlexit();
 }
 
-datasource_ptr datasource_cache::create(const parameters& params, bool bind)
+datasource_ptr datasource_cache::create(const parameters& params, bool bind, bool concurrent)
 {
     boost::optional<std::string> type = params.get<std::string>("type");
     if ( ! type)
@@ -106,6 +106,24 @@ datasource_ptr datasource_cache::create(const parameters& params, bool bind)
                                  lt_dlerror());
     }
 
+#ifdef MAPNIK_THREADSAFE
+    // plugins are not required to be thread safe, so construction stays
+    // serialized unless the caller asked to bind several at once and the
+    // plugin declared it can be (DATASOURCE_PLUGIN_THREAD_SAFE)
+    if (concurrent)
+    {
+#ifdef __GNUC__
+        __extension__
+#endif
+            datasource_thread_safe* thread_safe =
+            reinterpret_cast<datasource_thread_safe*>(lt_dlsym(itr->second->handle(), "datasource_thread_safe"));
+        if (thread_safe && thread_safe())
+        {
+            lock.unlock();
+        }
+    }
+#endif
+
 #ifdef MAPNIK_LOG
     MAPNIK_LOG_DEBUG(datasource_cache) << "datasource_cache: Size=" << params.size();
 
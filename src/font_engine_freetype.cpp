@@ -27,6 +27,7 @@
 #include <mapnik/graphics.hpp>
 #include <mapnik/grid/grid.hpp>
 #include <mapnik/text_path.hpp>
+#include <mapnik/text_shaping_cache.hpp>
 
 // boost
 #include <boost/algorithm/string.hpp>
@@ -210,7 +211,7 @@ face_ptr freetype_engine::create_face(std::string const& family_name)
                                       &face);
         if (!error)
         {
-            return boost::make_shared<font_face>(face);
+            return boost::make_shared<font_face>(face, itr->second.second);
         }
     }
     return face_ptr();
@@ -275,8 +276,52 @@ char_info font_face_set::character_dimensions(const unsigned c)
 }
 
 
+std::string font_face_set::key()
+{
+    if (faces_key_.empty())
+    {
+        BOOST_FOREACH ( face_ptr const& face, faces_)
+        {
+            faces_key_ += face->family_name();
+            faces_key_ += ' ';
+            faces_key_ += face->style_name();
+            faces_key_ += ' ';
+            faces_key_ += face->file_name();
+            append_key(faces_key_, face->face_index());
+            faces_key_ += '\n';
+        }
+    }
+    std::string result(faces_key_);
+    append_key(result, size_);
+    return result;
+}
+
 void font_face_set::get_string_info(string_info & info, UnicodeString const& ustr, char_properties *format)
 {
+    std::string cache_key = key();
+    cache_key.append(reinterpret_cast<char const*>(ustr.getBuffer()), ustr.length() * sizeof(UChar));
+    shaped_text_ptr cached = text_shaping_cache::instance().find_shaped(cache_key);
+    if (!cached)
+    {
+        boost::shared_ptr<shaped_text> text = boost::make_shared<shaped_text>();
+        shape_string(*text, ustr);
+        text_shaping_cache::instance().insert_shaped(cache_key, text);
+        cached = text;
+    }
+    BOOST_FOREACH ( char_info char_dim, cached->glyphs)
+    {
+        char_dim.format = format;
+        info.add_info(char_dim);
+    }
+    if (cached->rtl)
+    {
+        info.set_rtl(true);
+    }
+}
+
+void font_face_set::shape_string(shaped_text & text, UnicodeString const& ustr)
+{
+    text.rtl = false;
     double avg_height = character_dimensions('X').height();
     UErrorCode err = U_ZERO_ERROR;
     UnicodeString reordered;
@@ -301,12 +346,12 @@ void font_face_set::get_string_info(string_info & info, UnicodeString const& ust
 
     if (U_SUCCESS(err)) {
         StringCharacterIterator iter(shaped);
+        text.glyphs.reserve(length);
         for (iter.setToStart(); iter.hasNext();) {
             UChar ch = iter.nextPostInc();
             char_info char_dim = character_dimensions(ch);
-            char_dim.format = format;
             char_dim.avg_height = avg_height;
-            info.add_info(char_dim);
+            text.glyphs.push_back(char_dim);
         }
     }
 
@@ -314,7 +359,7 @@ void font_face_set::get_string_info(string_info & info, UnicodeString const& ust
 #if (U_ICU_VERSION_MAJOR_NUM*100 + U_ICU_VERSION_MINOR_NUM >= 406)
     if (ubidi_getBaseDirection(ustr.getBuffer(), length) == UBIDI_RTL)
     {
-        info.set_rtl(true);
+        text.rtl = true;
     }
 #endif
 
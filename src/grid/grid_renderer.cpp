@@ -26,6 +26,7 @@
 #include <mapnik/grid/grid_pixfmt.hpp>
 #include <mapnik/grid/grid_pixel.hpp>
 #include <mapnik/grid/grid.hpp>
+#include <mapnik/stroke_outline.hpp>
 
 #include <mapnik/debug.hpp>
 #include <mapnik/layer.hpp>
@@ -62,8 +63,14 @@ grid_renderer<T>::grid_renderer(Map const& m, T & pixmap, double scale_factor, u
       t_(pixmap_.width(),pixmap_.height(),m.get_current_extent(),offset_x,offset_y),
       font_engine_(),
       font_manager_(font_engine_),
-      detector_(boost::make_shared<label_collision_detector4>(box2d<double>(-m.buffer_size(), -m.buffer_size(), m.width() + m.buffer_size() ,m.height() + m.buffer_size()))),
-      ras_ptr(new grid_rasterizer)
+      // the detector works in grid pixels, which are `resolution` map pixels wide
+      detector_(boost::make_shared<label_collision_detector4>(
+                    box2d<double>(-static_cast<double>(m.buffer_size()) / pixmap_.get_resolution(),
+                                  -static_cast<double>(m.buffer_size()) / pixmap_.get_resolution(),
+                                  pixmap_.width() + static_cast<double>(m.buffer_size()) / pixmap_.get_resolution(),
+                                  pixmap_.height() + static_cast<double>(m.buffer_size()) / pixmap_.get_resolution()))),
+      ras_ptr(new grid_rasterizer),
+      outline_ptr(new stroke_outline)
 {
     setup(m);
 }
@@ -107,7 +114,8 @@ void grid_renderer<T>::start_layer_processing(layer const& lay, box2d<double> co
     int buffer_size = lay.buffer_size();
     if (buffer_size != 0 )
     {
-        double padding = buffer_size * (double)(query_extent.width()/pixmap_.width());
+        // buffer_size is in map pixels, the grid may be rendered at reduced resolution
+        double padding = buffer_size * (double)(query_extent.width()/(pixmap_.width() * pixmap_.get_resolution()));
         double x0 = query_extent_.minx();
         double y0 = query_extent_.miny();
         double x1 = query_extent_.maxx();
@@ -0,0 +1,275 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/grid/grid_utf.hpp>
+#include <mapnik/grid/grid.hpp>
+#include <mapnik/grid/grid_view.hpp>
+#include <mapnik/grid/grid_util.hpp>
+#include <mapnik/value.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/util/conversions.hpp>
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/foreach.hpp>
+#include <boost/unordered_map.hpp>
+#include <boost/variant/static_visitor.hpp>
+#include <boost/variant/apply_visitor.hpp>
+
+// stl
+#include <vector>
+#include <stdexcept>
+
+namespace mapnik {
+
+namespace {
+
+void append_utf8(std::string & out, boost::uint32_t cp)
+{
+    if (cp < 0x80)
+    {
+        out.push_back(static_cast<char>(cp));
+    }
+    else if (cp < 0x800)
+    {
+        out.push_back(static_cast<char>(0xc0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+    else
+    {
+        out.push_back(static_cast<char>(0xe0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3f)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3f)));
+    }
+}
+
+void append_json_string(std::string & out, std::string const& str)
+{
+    static char const* hex = "0123456789abcdef";
+    out.push_back('"');
+    BOOST_FOREACH(char c, str)
+    {
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                out += "\\u00";
+                out.push_back(hex[(c >> 4) & 0xf]);
+                out.push_back(hex[c & 0xf]);
+            }
+            else
+            {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+struct json_value_appender : public boost::static_visitor<>
+{
+    explicit json_value_appender(std::string & out)
+        : out_(out) {}
+
+    void operator() (value_null const&) const
+    {
+        out_ += "null";
+    }
+
+    void operator() (bool val) const
+    {
+        out_ += val ? "true" : "false";
+    }
+
+    void operator() (int val) const
+    {
+        util::to_string(out_, val);
+    }
+
+    void operator() (double val) const
+    {
+        util::to_string(out_, val);
+    }
+
+    void operator() (UnicodeString const& val) const
+    {
+        std::string utf8;
+        to_utf8(val, utf8);
+        append_json_string(out_, utf8);
+    }
+
+    std::string & out_;
+};
+
+}
+
+template <typename T>
+void grid_encode_utf_json(T const& grid,
+                          std::string & json,
+                          bool add_features,
+                          unsigned int resolution)
+{
+    typedef typename T::value_type value_type;
+    typedef typename T::lookup_type lookup_type;
+    typedef boost::unordered_map<value_type, boost::uint32_t> id_table;
+    typedef boost::unordered_map<lookup_type, boost::uint32_t> key_table;
+
+    if (resolution == 0)
+    {
+        throw std::runtime_error("grid resolution must be greater than zero");
+    }
+    unsigned step = grid_sample_step(grid.get_resolution(), resolution);
+
+    typename T::feature_key_type const& feature_keys = grid.get_feature_keys();
+    // pixel ids resolve straight to codepoints; several ids may share a key
+    id_table ids;
+    key_table keys;
+    std::vector<lookup_type const*> key_order;
+    // start counting at utf8 codepoint 32, aka space character
+    boost::uint32_t codepoint = 32;
+
+    unsigned cols = grid.width() / step;
+    json += "{\"grid\":[";
+    for (unsigned y = 0; y < grid.height(); y += step)
+    {
+        if (y > 0) json.push_back(',');
+        json.push_back('"');
+        value_type const* row = grid.getRow(y);
+        bool have_last = false;
+        value_type last_id = value_type();
+        std::string last_char;
+        for (unsigned i = 0; i < cols; ++i)
+        {
+            value_type feature_id = row[i * step];
+            if (have_last && feature_id == last_id)
+            {
+                // runs of the same feature repeat the previous encoding
+                json += last_char;
+                continue;
+            }
+            boost::uint32_t cp = 0;
+            typename id_table::const_iterator id_pos = ids.find(feature_id);
+            if (id_pos != ids.end())
+            {
+                cp = id_pos->second;
+            }
+            else
+            {
+                typename T::feature_key_type::const_iterator feature_pos = feature_keys.find(feature_id);
+                if (feature_pos == feature_keys.end())
+                {
+                    // should not get here, the binding leaves such pixels out as well
+                    have_last = false;
+                    continue;
+                }
+                std::pair<typename key_table::iterator, bool> inserted =
+                    keys.insert(std::make_pair(feature_pos->second, codepoint));
+                if (inserted.second)
+                {
+                    // Skip the codepoints that can't be encoded directly in JSON.
+                    if (codepoint == 34) ++codepoint;      // Skip "
+                    else if (codepoint == 92) ++codepoint; // Skip backslash
+                    inserted.first->second = codepoint;
+                    key_order.push_back(&inserted.first->first);
+                    ++codepoint;
+                }
+                cp = inserted.first->second;
+                ids.insert(std::make_pair(feature_id, cp));
+            }
+            last_char.clear();
+            append_utf8(last_char, cp);
+            json += last_char;
+            last_id = feature_id;
+            have_last = true;
+        }
+        json.push_back('"');
+    }
+
+    json += "],\"keys\":[";
+    for (std::size_t i = 0; i < key_order.size(); ++i)
+    {
+        if (i > 0) json.push_back(',');
+        append_json_string(json, *key_order[i]);
+    }
+
+    json += "],\"data\":{";
+    typename T::feature_type const& features = grid.get_grid_features();
+    if (add_features && !features.empty())
+    {
+        std::set<std::string> const& attributes = grid.property_names();
+        bool first_feature = true;
+        std::string feat;
+        BOOST_FOREACH(lookup_type const* key, key_order)
+        {
+            if (key->empty()) continue;
+            typename T::feature_type::const_iterator feat_itr = features.find(*key);
+            if (feat_itr == features.end()) continue;
+
+            mapnik::feature_ptr feature = feat_itr->second;
+            bool found = false;
+            feat.clear();
+            BOOST_FOREACH(std::string const& attr, attributes)
+            {
+                if (attr == "__id__")
+                {
+                    if (!feat.empty()) feat.push_back(',');
+                    append_json_string(feat, attr);
+                    feat.push_back(':');
+                    util::to_string(feat, feature->id());
+                }
+                else if (feature->has_key(attr))
+                {
+                    found = true;
+                    if (!feat.empty()) feat.push_back(',');
+                    append_json_string(feat, attr);
+                    feat.push_back(':');
+                    boost::apply_visitor(json_value_appender(feat), feature->get(attr).base());
+                }
+            }
+            if (found)
+            {
+                if (!first_feature) json.push_back(',');
+                first_feature = false;
+                append_json_string(json, *key);
+                json += ":{";
+                json += feat;
+                json.push_back('}');
+            }
+        }
+    }
+    json += "}}";
+}
+
+template MAPNIK_DECL void grid_encode_utf_json(grid const&, std::string &, bool, unsigned int);
+template MAPNIK_DECL void grid_encode_utf_json(grid_view const&, std::string &, bool, unsigned int);
+
+}
@@ -67,7 +67,7 @@ void grid_renderer<T>::process(building_symbolizer const& sym,
     if (height_expr)
     {
         value_type result = boost::apply_visitor(evaluate<Feature,value_type>(feature), *height_expr);
-        height = result.to_double() * scale_factor_;
+        height = result.to_double() * scale_factor_ / pixmap_.get_resolution();
     }
 
     for (unsigned i=0;i<feature.num_geometries();++i)
@@ -69,7 +69,7 @@ void grid_renderer<T>::process(line_pattern_symbolizer const& sym,
             path_type path(t_,geom,prj_trans);
             agg::conv_stroke<path_type> stroke(path);
             stroke.generator().miter_limit(4.0);
-            stroke.generator().width(stroke_width * scale_factor_);
+            stroke.generator().width(stroke_width * scale_factor_ / pixmap_.get_resolution());
             ras_ptr->add_path(stroke);
         }
     }
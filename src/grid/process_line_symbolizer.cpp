@@ -29,13 +29,12 @@
 
 #include <mapnik/line_symbolizer.hpp>
 #include <mapnik/vertex_converters.hpp>
+#include <mapnik/stroke_outline.hpp>
 
 // agg
 #include "agg_rasterizer_scanline_aa.h"
 #include "agg_renderer_scanline.h"
 #include "agg_scanline_bin.h"
-#include "agg_conv_stroke.h"
-#include "agg_conv_dash.h"
 
 // boost
 #include <boost/foreach.hpp>
@@ -54,7 +53,7 @@ void grid_renderer<T>::process(line_symbolizer const& sym,
     typedef agg::renderer_scanline_bin_solid<renderer_base> renderer_type;
     typedef boost::mpl::vector<clip_line_tag, transform_tag,
                                offset_transform_tag, affine_transform_tag,
-                               simplify_tag, smooth_tag, dash_tag, stroke_tag> conv_types;
+                               simplify_tag, smooth_tag> conv_types;
     agg::scanline_bin sl;
 
     grid_rendering_buffer buf(pixmap_.raw_data(), width_, height_, width_);
@@ -74,7 +73,7 @@ void grid_renderer<T>::process(line_symbolizer const& sym,
     if (sym.clip())
     {
         double padding = (double)(query_extent_.width()/pixmap_.width());
-        float half_stroke = stroke_.get_width()/2.0;
+        float half_stroke = stroke_.get_width()/(2.0 * pixmap_.get_resolution());
         if (half_stroke > 1)
             padding *= half_stroke;
         if (fabs(sym.offset()) > 0)
@@ -86,17 +85,20 @@ void grid_renderer<T>::process(line_symbolizer const& sym,
         clipping_extent.init(x0 - padding, y0 - padding, x1 + padding , y1 + padding);
     }
 
-    vertex_converter<box2d<double>, grid_rasterizer, line_symbolizer,
+    // the converters stop short of dashing and stroking, the outline
+    // does both for all the paths of the feature at once
+    double scale_factor = scale_factor_/pixmap_.get_resolution();
+    outline_ptr->setup(stroke_params(stroke_, scale_factor));
+
+    vertex_converter<box2d<double>, stroke_outline, line_symbolizer,
                      CoordTransform, proj_transform, agg::trans_affine, conv_types>
-        converter(clipping_extent,*ras_ptr,sym,t_,prj_trans,tr,scale_factor_);
+        converter(clipping_extent,*outline_ptr,sym,t_,prj_trans,tr,scale_factor);
     if (sym.clip()) converter.set<clip_line_tag>(); // optional clip (default: true)
     converter.set<transform_tag>(); // always transform
     if (fabs(sym.offset()) > 0.0) converter.set<offset_transform_tag>(); // parallel offset
     converter.set<affine_transform_tag>(); // optional affine transform
     if (sym.simplify_tolerance() > 0.0) converter.set<simplify_tag>(); // optional simplify converter
     if (sym.smooth() > 0.0) converter.set<smooth_tag>(); // optional smooth converter
-    if (stroke_.has_dash()) converter.set<dash_tag>();
-    converter.set<stroke_tag>(); //always stroke
 
     BOOST_FOREACH( geometry_type & geom, feature.paths())
     {
@@ -105,6 +107,7 @@ void grid_renderer<T>::process(line_symbolizer const& sym,
             converter.apply(geom);
         }
     }
+    ras_ptr->add_path(*outline_ptr);
 
     // render id
     ren.color(mapnik::gray32(feature.id()));
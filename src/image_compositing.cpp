@@ -35,6 +35,9 @@
 #include "agg_renderer_scanline.h"
 #include "agg_pixfmt_rgba.h"
 
+// stl
+#include <algorithm>
+
 namespace mapnik
 {
 
@@ -114,6 +117,104 @@ For example, if you generate some pattern with AGG (premultiplied) and would lik
 */
 
 
+namespace {
+
+typedef agg::rgba8 color_type;
+typedef agg::order_rgba order_type;
+typedef color_type::value_type value_type;
+typedef void (*row_blend_func)(value_type * dst, value_type const* src, unsigned len, unsigned cover);
+
+// Blends one row with a single comp-op, inlining the AGG blender instead of
+// going through comp_op_table_rgba for every pixel. When SkipEmpty is set the
+// mode leaves the destination untouched for a fully transparent source pixel
+// (for any cover), so those pixels are skipped - layer buffers are mostly empty.
+template <typename Op, bool SkipEmpty>
+void blend_row(value_type * dst, value_type const* src, unsigned len, unsigned cover)
+{
+    for (; len > 0; --len, dst += 4, src += 4)
+    {
+        unsigned r = src[order_type::R];
+        unsigned g = src[order_type::G];
+        unsigned b = src[order_type::B];
+        unsigned a = src[order_type::A];
+        if (SkipEmpty && (r | g | b | a) == 0) continue;
+        Op::blend_pix(dst, r, g, b, a, cover);
+    }
+}
+
+// src-over at full cover is a plain copy for opaque source pixels
+void blend_row_src_over(value_type * dst, value_type const* src, unsigned len, unsigned cover)
+{
+    typedef agg::comp_op_rgba_src_over<color_type, order_type> op_type;
+    for (; len > 0; --len, dst += 4, src += 4)
+    {
+        unsigned r = src[order_type::R];
+        unsigned g = src[order_type::G];
+        unsigned b = src[order_type::B];
+        unsigned a = src[order_type::A];
+        if ((r | g | b | a) == 0) continue;
+        if (a == color_type::base_mask && cover == agg::cover_full)
+        {
+            dst[order_type::R] = static_cast<value_type>(r);
+            dst[order_type::G] = static_cast<value_type>(g);
+            dst[order_type::B] = static_cast<value_type>(b);
+            dst[order_type::A] = static_cast<value_type>(a);
+            continue;
+        }
+        op_type::blend_pix(dst, r, g, b, a, cover);
+    }
+}
+
+row_blend_func row_blender(composite_mode_e mode)
+{
+#define MAPNIK_ROW_BLENDER(op, skip_empty) \
+    &blend_row<agg::comp_op_rgba_##op<color_type, order_type>, skip_empty>
+
+    switch (mode)
+    {
+    case clear:         return MAPNIK_ROW_BLENDER(clear, false);
+    case src:           return MAPNIK_ROW_BLENDER(src, false);
+    case dst:           return 0;
+    case src_over:      return &blend_row_src_over;
+    case dst_over:      return MAPNIK_ROW_BLENDER(dst_over, true);
+    case src_in:        return MAPNIK_ROW_BLENDER(src_in, false);
+    case dst_in:        return MAPNIK_ROW_BLENDER(dst_in, false);
+    case src_out:       return MAPNIK_ROW_BLENDER(src_out, false);
+    case dst_out:       return MAPNIK_ROW_BLENDER(dst_out, false);
+    case src_atop:      return MAPNIK_ROW_BLENDER(src_atop, true);
+    case dst_atop:      return MAPNIK_ROW_BLENDER(dst_atop, false);
+    case _xor:          return MAPNIK_ROW_BLENDER(xor, true);
+    case plus:          return MAPNIK_ROW_BLENDER(plus, true);
+    case minus:         return MAPNIK_ROW_BLENDER(minus, true);
+    case multiply:      return MAPNIK_ROW_BLENDER(multiply, true);
+    case screen:        return MAPNIK_ROW_BLENDER(screen, true);
+    case overlay:       return MAPNIK_ROW_BLENDER(overlay, true);
+    case darken:        return MAPNIK_ROW_BLENDER(darken, true);
+    case lighten:       return MAPNIK_ROW_BLENDER(lighten, true);
+    case color_dodge:   return MAPNIK_ROW_BLENDER(color_dodge, true);
+    case color_burn:    return MAPNIK_ROW_BLENDER(color_burn, true);
+    case hard_light:    return MAPNIK_ROW_BLENDER(hard_light, true);
+    case soft_light:    return MAPNIK_ROW_BLENDER(soft_light, true);
+    case difference:    return MAPNIK_ROW_BLENDER(difference, true);
+    case exclusion:     return MAPNIK_ROW_BLENDER(exclusion, true);
+    case contrast:      return MAPNIK_ROW_BLENDER(contrast, false);
+    case invert:        return MAPNIK_ROW_BLENDER(invert, true);
+    case invert_rgb:    return MAPNIK_ROW_BLENDER(invert_rgb, true);
+    case grain_merge:   return MAPNIK_ROW_BLENDER(grain_merge, true);
+    case grain_extract: return MAPNIK_ROW_BLENDER(grain_extract, false);
+    case hue:           return MAPNIK_ROW_BLENDER(hue, false);
+    case saturation:    return MAPNIK_ROW_BLENDER(saturation, false);
+    case _color:        return MAPNIK_ROW_BLENDER(color, false);
+    case _value:        return MAPNIK_ROW_BLENDER(value, false);
+    }
+#undef MAPNIK_ROW_BLENDER
+    return 0;
+}
+
+}
+
+// Equivalent to blending with agg::comp_op_adaptor_rgba_pre through
+// renderer_base::blend_from, but the comp-op is resolved once per call.
 template <typename T1, typename T2>
 void composite(T1 & dst, T2 & src, composite_mode_e mode,
                float opacity,
@@ -121,22 +222,32 @@ void composite(T1 & dst, T2 & src, composite_mode_e mode,
                int dy,
                bool premultiply_src)
 {
-    typedef agg::rgba8 color;
-    typedef agg::order_rgba order;
-    typedef agg::comp_op_adaptor_rgba_pre<color, order> blender_type;
-    typedef agg::pixfmt_custom_blend_rgba<blender_type, agg::rendering_buffer> pixfmt_type;
-    typedef agg::renderer_base<pixfmt_type> renderer_type;
-
-    agg::rendering_buffer dst_buffer(dst.getBytes(),dst.width(),dst.height(),dst.width() * 4);
-    agg::rendering_buffer src_buffer(src.getBytes(),src.width(),src.height(),src.width() * 4);
-
-    pixfmt_type pixf(dst_buffer);
-    pixf.comp_op(static_cast<agg::comp_op_e>(mode));
-    
-    agg::pixfmt_rgba32 pixf_mask(src_buffer);
-    if (premultiply_src)  pixf_mask.premultiply();
-    renderer_type ren(pixf);
-    ren.blend_from(pixf_mask,0,dx,dy,unsigned(255*opacity));
+    if (premultiply_src)
+    {
+        // callers rely on src being premultiplied afterwards, as it always was
+        agg::rendering_buffer src_buffer(src.getBytes(),src.width(),src.height(),src.width() * 4);
+        agg::pixfmt_rgba32 pixf_src(src_buffer);
+        pixf_src.premultiply();
+    }
+    row_blend_func blend = row_blender(mode);
+    if (!blend) return;
+
+    // clip the source, placed at dx,dy, to the destination
+    int x0 = std::max(0, dx);
+    int y0 = std::max(0, dy);
+    int x1 = std::min(static_cast<int>(dst.width()), dx + static_cast<int>(src.width()));
+    int y1 = std::min(static_cast<int>(dst.height()), dy + static_cast<int>(src.height()));
+    if (x0 >= x1 || y0 >= y1) return;
+
+    // same truncation as passing the cover to blend_from
+    unsigned cover = static_cast<agg::cover_type>(unsigned(255*opacity));
+    unsigned len = static_cast<unsigned>(x1 - x0);
+    for (int y = y0; y < y1; ++y)
+    {
+        value_type * dst_row = reinterpret_cast<value_type*>(dst.getRow(y) + x0);
+        value_type const* src_row = reinterpret_cast<value_type const*>(src.getRow(y - dy) + (x0 - dx));
+        blend(dst_row, src_row, len, cover);
+    }
 }
 
 template void composite<mapnik::image_data_32,mapnik::image_data_32>(mapnik::image_data_32&, mapnik::image_data_32& ,composite_mode_e, float, int, int, bool);
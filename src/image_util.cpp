@@ -49,34 +49,87 @@ extern "C"
 // boost
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
+#include <boost/thread.hpp>
 
 // stl
 #include <string>
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <streambuf>
+#include <algorithm>
 
 namespace mapnik
 {
 
 
+namespace {
+
+// streambuf appending straight into a caller owned string so encoders
+// don't go through an intermediate std::ostringstream copy
+class string_append_buf : public std::streambuf
+{
+public:
+    explicit string_append_buf(std::string & buffer)
+        : buffer_(buffer) {}
+protected:
+    virtual std::streamsize xsputn(char const* s, std::streamsize n)
+    {
+        buffer_.append(s, static_cast<std::size_t>(n));
+        return n;
+    }
+    virtual int_type overflow(int_type c)
+    {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+        {
+            buffer_.push_back(traits_type::to_char_type(c));
+        }
+        return traits_type::not_eof(c);
+    }
+private:
+    std::string & buffer_;
+};
+
+}
+
+template <typename T>
+void save_to_buffer(T const& image,
+                    std::string const& type,
+                    rgba_palette const& palette,
+                    std::string & buffer)
+{
+    string_append_buf buf(buffer);
+    std::ostream stream(&buf);
+    save_to_stream(image, stream, type, palette);
+}
+
+template <typename T>
+void save_to_buffer(T const& image,
+                    std::string const& type,
+                    std::string & buffer)
+{
+    string_append_buf buf(buffer);
+    std::ostream stream(&buf);
+    save_to_stream(image, stream, type);
+}
+
 template <typename T>
 std::string save_to_string(T const& image,
                            std::string const& type,
                            rgba_palette const& palette)
 {
-    std::ostringstream ss(std::ios::out|std::ios::binary);
-    save_to_stream(image, ss, type, palette);
-    return ss.str();
+    std::string buffer;
+    save_to_buffer(image, type, palette, buffer);
+    return buffer;
 }
 
 template <typename T>
 std::string save_to_string(T const& image,
                            std::string const& type)
 {
-    std::ostringstream ss(std::ios::out|std::ios::binary);
-    save_to_stream(image, ss, type);
-    return ss.str();
+    std::string buffer;
+    save_to_buffer(image, type, buffer);
+    return buffer;
 }
 
 template <typename T>
@@ -113,7 +166,8 @@ void handle_png_options(std::string const& type,
                         int * trans_mode,
                         double * gamma,
                         bool * use_octree,
-                        bool * use_miniz)
+                        bool * use_miniz,
+                        int * threads)
 {
     if (type == "png" || type == "png24" || type == "png32")
     {
@@ -144,6 +198,20 @@ void handle_png_options(std::string const& type,
             {
                 *use_miniz = true;
             }
+            else if (t == "e=zlib")
+            {
+                *use_miniz = false;
+            }
+            else if (boost::algorithm::starts_with(t, "p="))
+            {
+                // number of row bands deflated concurrently, 0 means one per core
+                if (!mapnik::util::string2int(t.substr(2),*threads) || *threads < 0 || *threads > 256)
+                    throw ImageWriterException("invalid parallel encoding parameter: " + t.substr(2) + " (only 0 through 256 are valid)");
+                if (*threads == 0)
+                {
+                    *threads = std::max(1u, boost::thread::hardware_concurrency());
+                }
+            }
             else if (boost::algorithm::starts_with(t, "c="))
             {
                 if (*colors < 0)
@@ -214,6 +282,10 @@ void handle_png_options(std::string const& type,
         {
             throw ImageWriterException("invalid compression value: (only -1 through 9 are valid)");
         }
+        if (*use_miniz && *threads > 1)
+        {
+            throw ImageWriterException("parallel encoding (p=) is only supported by the zlib backend");
+        }
     }
 }
 
@@ -236,6 +308,7 @@ void save_to_stream(T const& image,
             double gamma = -1;
             bool use_octree = true;
             bool use_miniz = false;
+            int threads = 1;
 
             handle_png_options(t,
                                &colors,
@@ -244,12 +317,17 @@ void save_to_stream(T const& image,
                                &trans_mode,
                                &gamma,
                                &use_octree,
-                               &use_miniz);
+                               &use_miniz,
+                               &threads);
 
             if (palette.valid())
             {
                 save_as_png8_pal(stream, image, palette, compression, strategy, use_miniz);
             }
+            else if (colors < 0 && threads > 1)
+            {
+                save_as_png_parallel(stream, image, threads, compression, strategy, trans_mode);
+            }
             else if (colors < 0)
             {
                 save_as_png(stream, image, compression, strategy, trans_mode, use_miniz);
@@ -297,6 +375,7 @@ void save_to_stream(T const& image,
             double gamma = -1;
             bool use_octree = true;
             bool use_miniz = false;
+            int threads = 1;
 
             handle_png_options(t,
                                &colors,
@@ -305,9 +384,14 @@ void save_to_stream(T const& image,
                                &trans_mode,
                                &gamma,
                                &use_octree,
-                               &use_miniz);
+                               &use_miniz,
+                               &threads);
 
-            if (colors < 0)
+            if (colors < 0 && threads > 1)
+            {
+                save_as_png_parallel(stream, image, threads, compression, strategy, trans_mode);
+            }
+            else if (colors < 0)
             {
                 save_as_png(stream, image, compression, strategy, trans_mode, use_miniz);
             }
@@ -461,6 +545,24 @@ template void save_to_file<image_data_32>(image_data_32 const&,
                                           std::string const&,
                                           rgba_palette const& palette);
 
+template void save_to_buffer<image_data_32>(image_data_32 const&,
+                                            std::string const&,
+                                            std::string &);
+
+template void save_to_buffer<image_data_32>(image_data_32 const&,
+                                            std::string const&,
+                                            rgba_palette const& palette,
+                                            std::string &);
+
+template void save_to_buffer<image_view<image_data_32> > (image_view<image_data_32> const&,
+                                                          std::string const&,
+                                                          std::string &);
+
+template void save_to_buffer<image_view<image_data_32> > (image_view<image_data_32> const&,
+                                                          std::string const&,
+                                                          rgba_palette const& palette,
+                                                          std::string &);
+
 template std::string save_to_string<image_data_32>(image_data_32 const&,
                                                    std::string const&);
 
@@ -511,6 +613,21 @@ void save_to_file (image_32 const& image,
     save_to_file<image_data_32>(image.data(), file, type, palette);
 }
 
+void save_to_buffer(image_32 const& image,
+                    std::string const& type,
+                    std::string & buffer)
+{
+    save_to_buffer<image_data_32>(image.data(), type, buffer);
+}
+
+void save_to_buffer(image_32 const& image,
+                    std::string const& type,
+                    rgba_palette const& palette,
+                    std::string & buffer)
+{
+    save_to_buffer<image_data_32>(image.data(), type, palette, buffer);
+}
+
 std::string save_to_string(image_32 const& image,
                            std::string const& type)
 {
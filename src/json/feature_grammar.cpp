@@ -151,6 +151,7 @@ feature_grammar<Iterator,FeatureType>::feature_grammar(mapnik::transcoder const&
 
 template struct mapnik::json::feature_grammar<std::string::const_iterator,mapnik::Feature>;
 template struct mapnik::json::feature_grammar<boost::spirit::multi_pass<std::istreambuf_iterator<char> >,mapnik::Feature>;
+template struct mapnik::json::feature_grammar<char const*,mapnik::Feature>;
 
 }}
 
@@ -155,6 +155,7 @@ geometry_grammar<Iterator>::geometry_grammar()
 
 template struct mapnik::json::geometry_grammar<std::string::const_iterator>;
 template struct mapnik::json::geometry_grammar<boost::spirit::multi_pass<std::istreambuf_iterator<char> > >;
+template struct mapnik::json::geometry_grammar<char const*>;
 
 }}
 
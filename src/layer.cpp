@@ -32,6 +32,16 @@
 
 namespace mapnik
 {
+
+static const char * reprojection_cache_strings[] = {
+    "none",
+    "memory",
+    "file",
+    ""
+};
+
+IMPLEMENT_ENUM( reprojection_cache_e, reprojection_cache_strings )
+
 layer::layer(std::string const& name, std::string const& srs)
     : name_(name),
       srs_(srs),
@@ -41,6 +51,7 @@ layer::layer(std::string const& name, std::string const& srs)
       queryable_(false),
       clear_label_cache_(false),
       cache_features_(false),
+      reprojection_cache_(REPROJECTION_CACHE_NONE),
       group_by_(""),
       ds_(),
       buffer_size_(0) {}
@@ -54,6 +65,7 @@ layer::layer(const layer& rhs)
       queryable_(rhs.queryable_),
       clear_label_cache_(rhs.clear_label_cache_),
       cache_features_(rhs.cache_features_),
+      reprojection_cache_(rhs.reprojection_cache_),
       group_by_(rhs.group_by_),
       styles_(rhs.styles_),
       ds_(rhs.ds_),
@@ -82,6 +94,7 @@ void layer::swap(const layer& rhs)
     queryable_=rhs.queryable_;
     clear_label_cache_ = rhs.clear_label_cache_;
     cache_features_ = rhs.cache_features_;
+    reprojection_cache_ = rhs.reprojection_cache_;
     group_by_ = rhs.group_by_;
     styles_=rhs.styles_;
     ds_=rhs.ds_;
@@ -232,6 +245,16 @@ bool layer::cache_features() const
     return cache_features_;
 }
 
+void layer::set_reprojection_cache(reprojection_cache_e mode)
+{
+    reprojection_cache_ = mode;
+}
+
+reprojection_cache_e layer::reprojection_cache() const
+{
+    return reprojection_cache_;
+}
+
 void layer::set_group_by(std::string column)
 {
     group_by_ = column;
@@ -38,9 +38,11 @@
 #include <libxml/tree.h>
 #include <libxml/parserInternals.h>
 #include <libxml/xinclude.h>
+#include <libxml/uri.h>
 
 // stl
 #include <iostream>
+#include <algorithm>
 
 using namespace std;
 
@@ -73,7 +75,7 @@ public:
         }
     }
 
-    void load(std::string const& filename, xml_node &node)
+    void load(std::string const& filename, xml_node &node, std::vector<std::string> * files = 0)
     {
         boost::filesystem::path path(filename);
         if (!boost::filesystem::exists(path))
@@ -103,7 +105,7 @@ public:
             MAPNIK_LOG_WARN(libxml2_loader) << "libxml2_loader: Failed to validate DTD.";
           }
         */
-        load(doc, node);
+        load(doc, node, files);
     }
 
     void load(const int fd, xml_node &node)
@@ -128,7 +130,7 @@ public:
         load(doc, node);
     }
 
-    void load(const xmlDocPtr doc, xml_node &node)
+    void load(const xmlDocPtr doc, xml_node &node, std::vector<std::string> * files = 0)
     {
         if (!doc)
         {
@@ -161,10 +163,93 @@ public:
         }
 
         populate_tree(root, node);
+        if (files)
+        {
+            collect_files(doc, *files);
+        }
         xmlFreeDoc(doc);
     }
 
 private:
+    // Adds every file the document pulled in besides itself: the external DTD,
+    // external entities and XIncluded documents, resolved like libxml2 did.
+    void collect_files(xmlDocPtr doc, std::vector<std::string> & files)
+    {
+        if (doc->extSubset && doc->extSubset->SystemID)
+        {
+            add_file(doc->extSubset->SystemID, doc->URL, files);
+        }
+        collect_entities(doc->intSubset, files);
+        collect_entities(doc->extSubset, files);
+        collect_xincludes(doc, xmlDocGetRootElement(doc), files);
+    }
+
+    void collect_entities(xmlDtdPtr dtd, std::vector<std::string> & files)
+    {
+        if (!dtd) return;
+        for (xmlNodePtr cur = dtd->children; cur; cur = cur->next)
+        {
+            if (cur->type != XML_ENTITY_DECL) continue;
+            xmlEntityPtr entity = reinterpret_cast<xmlEntityPtr>(cur);
+            if (entity->etype != XML_EXTERNAL_GENERAL_PARSED_ENTITY &&
+                entity->etype != XML_EXTERNAL_PARAMETER_ENTITY) continue;
+            if (entity->URI)
+            {
+                add_file(entity->URI, NULL, files);
+            }
+            else if (entity->SystemID)
+            {
+                add_file(entity->SystemID, dtd->doc ? dtd->doc->URL : NULL, files);
+            }
+        }
+    }
+
+    void collect_xincludes(xmlDocPtr doc, xmlNodePtr cur, std::vector<std::string> & files)
+    {
+        for (; cur; cur = cur->next)
+        {
+            if (cur->type == XML_XINCLUDE_START)
+            {
+                // xmlGetProp() only looks at elements, so read href off the marker by hand
+                for (xmlAttr * attr = cur->properties; attr; attr = attr->next)
+                {
+                    if (!xmlStrEqual(attr->name, (const xmlChar *)"href")) continue;
+                    xmlChar * href = xmlNodeListGetString(doc, attr->children, 1);
+                    if (href)
+                    {
+                        xmlChar * base = xmlNodeGetBase(doc, cur);
+                        add_file(href, base, files);
+                        if (base) xmlFree(base);
+                        xmlFree(href);
+                    }
+                }
+            }
+            else if (cur->type == XML_ELEMENT_NODE)
+            {
+                collect_xincludes(doc, cur->children, files);
+            }
+        }
+    }
+
+    void add_file(const xmlChar * uri, const xmlChar * base, std::vector<std::string> & files)
+    {
+        xmlChar * resolved = base ? xmlBuildURI(uri, base) : xmlStrdup(uri);
+        if (!resolved) return;
+        char * unescaped = xmlURIUnescapeString((const char *)resolved, 0, NULL);
+        xmlFree(resolved);
+        if (!unescaped) return;
+        std::string path(unescaped);
+        xmlFree(unescaped);
+        if (path.compare(0, 7, "file://") == 0)
+        {
+            path.erase(0, 7);
+        }
+        if (std::find(files.begin(), files.end(), path) == files.end())
+        {
+            files.push_back(path);
+        }
+    }
+
     void append_attributes(xmlAttr *attributes, xml_node &node)
     {
         for (; attributes; attributes = attributes->next )
@@ -210,10 +295,10 @@ private:
     const char *url_;
 };
 
-void read_xml(std::string const & filename, xml_node &node)
+void read_xml(std::string const & filename, xml_node &node, std::vector<std::string> * files)
 {
     libxml2_loader loader;
-    loader.load(filename, node);
+    loader.load(filename, node, files);
 }
 void read_xml_string(std::string const & str, xml_node &node, std::string const & base_path)
 {
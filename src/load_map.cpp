@@ -58,6 +58,9 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/static_assert.hpp>
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
 #include <boost/filesystem/operations.hpp>
 
 // agg
@@ -66,6 +69,8 @@
 // stl
 #include <iostream>
 #include <sstream>
+#include <algorithm>
+#include <vector>
 
 using boost::tokenizer;
 
@@ -81,7 +86,8 @@ public:
         strict_(strict),
         filename_(filename),
         relative_to_xml_(true),
-        font_manager_(font_engine_)
+        font_manager_(font_engine_),
+        load_threads_(1)
     {}
 
     void parse_map(Map & map, xml_node const& sty, std::string const& base_path);
@@ -116,6 +122,8 @@ private:
     void find_unused_nodes_recursive(xml_node const& node, std::stringstream &error_text);
 
 
+    void create_datasources(Map & map);
+
     std::string ensure_relative_to_xml(boost::optional<std::string> opt_path);
     void ensure_exists(std::string const& file_path);
     boost::optional<color> get_opt_color_attr(boost::property_tree::ptree const& node,
@@ -129,6 +137,20 @@ private:
     face_manager<freetype_engine> font_manager_;
     std::map<std::string,std::string> file_sources_;
     std::map<std::string,font_set> fontsets_;
+
+    // datasources are created after parsing when loading with more than one thread
+    struct datasource_job
+    {
+        std::size_t layer_index;
+        std::string layer_name;
+        parameters params;
+        xml_node const* node;
+        datasource_ptr ds;
+        std::string error;
+    };
+    static void run_datasource_jobs(std::vector<datasource_job> & jobs, std::size_t & next, boost::mutex & mutex);
+    unsigned load_threads_;
+    std::vector<datasource_job> datasource_jobs_;
 };
 
 //#include <mapnik/internal/dump_xml.hpp>
@@ -143,6 +165,33 @@ void load_map(Map & map, std::string const& filename, bool strict)
     //dump_xml(tree.root());
 }
 
+void load_map_cached(Map & map, std::string const& filename, std::string const& cache_filename, bool strict)
+{
+    xml_tree tree("utf8");
+    tree.set_filename(filename);
+    bool cached = read_compiled_xml(cache_filename, tree.root(), filename);
+    // the stylesheet itself, then every file it pulled in, for the staleness check
+    std::vector<std::string> sources(1, filename);
+    if (!cached)
+    {
+        read_xml(filename, tree.root(), &sources);
+    }
+    map_parser parser(strict, filename);
+    parser.parse_map(map, tree.root(), "");
+    if (!cached)
+    {
+        // only stylesheets that parsed cleanly are cached, a failure to write is not fatal
+        try
+        {
+            write_compiled_xml(cache_filename, tree.root(), sources);
+        }
+        catch (std::exception const& ex)
+        {
+            MAPNIK_LOG_ERROR(load_map) << "load_map_cached: " << ex.what();
+        }
+    }
+}
+
 void load_map_string(Map & map, std::string const& str, bool strict, std::string base_path)
 {
     // TODO - use xml encoding?
@@ -157,6 +206,14 @@ void load_map_string(Map & map, std::string const& str, bool strict, std::string
 
 void map_parser::parse_map(Map & map, xml_node const& pt, std::string const& base_path)
 {
+#ifdef MAPNIK_THREADSAFE
+    // optional <Parameter name="load-threads"> set on the map before loading, 0 for one thread per core
+    boost::optional<int> load_threads = map.get_extra_parameters().get<int>("load-threads");
+    if (load_threads && *load_threads >= 0)
+    {
+        load_threads_ = *load_threads > 0 ? *load_threads : std::max(1u, boost::thread::hardware_concurrency());
+    }
+#endif
     try
     {
         xml_node const& map_node = pt.get_child("Map");
@@ -293,7 +350,18 @@ void map_parser::parse_map(Map & map, xml_node const& pt, std::string const& bas
             throw;
         }
 
-        parse_map_include(map, map_node);
+        try
+        {
+            parse_map_include(map, map_node);
+        }
+        catch (...)
+        {
+            // a serial load stops at the first failing datasource, so a failure
+            // queued before this error is the one to report
+            create_datasources(map);
+            throw;
+        }
+        create_datasources(map);
     }
     catch (node_not_found const&)
     {
@@ -599,6 +667,13 @@ void map_parser::parse_layer(Map & map, xml_node const& node)
             lyr.set_cache_features(* cache_features);
         }
 
+        optional<reprojection_cache_e> reprojection_cache =
+            node.get_opt_attr<reprojection_cache_e>("reprojection-cache");
+        if (reprojection_cache)
+        {
+            lyr.set_reprojection_cache(* reprojection_cache);
+        }
+
         optional<std::string> group_by =
             node.get_opt_attr<std::string>("group-by");
         if (group_by)
@@ -703,6 +778,17 @@ void map_parser::parse_layer(Map & map, xml_node const& node)
                     params["file"] = ensure_relative_to_xml(file_param);
                 }
 
+                if (load_threads_ > 1)
+                {
+                    datasource_job job;
+                    job.layer_index = map.layer_count();
+                    job.layer_name = lyr.name();
+                    job.params = params;
+                    job.node = &node;
+                    datasource_jobs_.push_back(job);
+                    continue;
+                }
+
                 //now we are ready to create datasource
                 try
                 {
@@ -732,6 +818,67 @@ void map_parser::parse_layer(Map & map, xml_node const& node)
     }
 }
 
+void map_parser::run_datasource_jobs(std::vector<datasource_job> & jobs, std::size_t & next, boost::mutex & mutex)
+{
+    for (;;)
+    {
+        std::size_t i;
+        {
+            boost::mutex::scoped_lock lock(mutex);
+            if (next >= jobs.size()) return;
+            i = next++;
+        }
+        datasource_job & job = jobs[i];
+        try
+        {
+            job.ds = datasource_cache::instance().create(job.params, true, true);
+        }
+        catch (std::exception const& ex)
+        {
+            job.error = ex.what();
+        }
+        catch (...)
+        {
+            job.error = "Unknown exception occured attempting to create datasoure for layer '" + job.layer_name + "'";
+        }
+    }
+}
+
+void map_parser::create_datasources(Map & map)
+{
+    if (datasource_jobs_.empty()) return;
+
+    std::size_t next = 0;
+    boost::mutex mutex;
+    boost::thread_group workers;
+    unsigned threads = std::min<std::size_t>(load_threads_, datasource_jobs_.size());
+    for (unsigned i = 0; i < threads; ++i)
+    {
+        workers.create_thread(boost::bind(&map_parser::run_datasource_jobs,
+                                          boost::ref(datasource_jobs_), boost::ref(next), boost::ref(mutex)));
+    }
+    workers.join_all();
+
+    // assign in document order, so the first failing layer is reported just like a serial load
+    for (std::size_t i = 0; i < datasource_jobs_.size(); ++i)
+    {
+        datasource_job const& job = datasource_jobs_[i];
+        if (!job.error.empty())
+        {
+            config_error ex(job.error);
+            ex.append_context(std::string(" encountered during parsing of layer '") + job.layer_name + "'", *job.node);
+            datasource_jobs_.clear();
+            throw ex;
+        }
+        // the layer is missing when parsing failed after its datasource was queued
+        if (job.layer_index < map.layer_count())
+        {
+            map.getLayer(job.layer_index).set_datasource(job.ds);
+        }
+    }
+    datasource_jobs_.clear();
+}
+
 void map_parser::parse_rule(feature_type_style & style, xml_node const& r)
 {
     std::string name;
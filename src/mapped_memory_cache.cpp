@@ -49,6 +49,14 @@ bool mapped_memory_cache::insert(std::string const& uri, mapped_region_ptr mem)
     return cache_.insert(std::make_pair(uri,mem)).second;
 }
 
+bool mapped_memory_cache::remove(std::string const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    return cache_.erase(key) > 0;
+}
+
 boost::optional<mapped_region_ptr> mapped_memory_cache::find(std::string const& uri, bool update_cache)
 {
 #ifdef MAPNIK_THREADSAFE
@@ -0,0 +1,237 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/marker_sprite_cache.hpp>
+#include <mapnik/svg/svg_renderer_agg.hpp>
+#include <mapnik/svg/svg_path_adapter.hpp>
+
+// agg
+#include "agg_basics.h"
+#include "agg_rendering_buffer.h"
+#include "agg_pixfmt_rgba.h"
+#include "agg_renderer_base.h"
+#include "agg_renderer_scanline.h"
+#include "agg_rasterizer_scanline_aa.h"
+#include "agg_scanline_u.h"
+
+// boost
+#include <boost/make_shared.hpp>
+
+// stl
+#include <cmath>
+#include <algorithm>
+
+namespace mapnik
+{
+
+const double marker_sprite_cache::rotation_step = 1.0;
+
+namespace {
+
+// matrix elements are keyed at 1/1024 resolution so values that differ only
+// by rounding noise share a sprite
+void append_matrix(std::string & key, agg::trans_affine const& mtx)
+{
+    double const elements[6] = { mtx.sx, mtx.shy, mtx.shx, mtx.sy, mtx.tx, mtx.ty };
+    for (unsigned i = 0; i < 6; ++i)
+    {
+        boost::int32_t value = static_cast<boost::int32_t>(std::floor(elements[i] * 1024.0 + 0.5));
+        key.append(reinterpret_cast<char const*>(&value), sizeof(value));
+    }
+}
+
+// rotates mtx about the anchor so its rotation is a multiple of rotation_step
+agg::trans_affine quantize_rotation(agg::trans_affine const& mtx)
+{
+    double angle = std::atan2(mtx.shy, mtx.sx);
+    double step = marker_sprite_cache::rotation_step * M_PI / 180.0;
+    double quantized = std::floor(angle / step + 0.5) * step;
+    agg::trans_affine result = mtx;
+    result *= agg::trans_affine_rotation(quantized - angle);
+    return result;
+}
+
+marker_sprite_ptr rasterize(svg_storage_type & svg, agg::trans_affine const& mtx,
+                            attr_storage const& attributes)
+{
+    typedef agg::pixfmt_rgba32_pre pixfmt_type;
+    typedef agg::renderer_base<pixfmt_type> renderer_base;
+    typedef agg::renderer_scanline_aa_solid<renderer_base> renderer_type;
+    typedef svg::svg_renderer_agg<svg::svg_path_adapter,
+                                  attr_storage,
+                                  renderer_type,
+                                  pixfmt_type> svg_renderer_type;
+
+    box2d<double> const& bbox = svg.bounding_box();
+    box2d<double> extent = bbox * mtx;
+    // strokes reach past the path bounding box
+    double half_stroke = 0.0;
+    for (unsigned i = 0; i < attributes.size(); ++i)
+    {
+        if (attributes[i].stroke_flag)
+        {
+            half_stroke = std::max(half_stroke, 0.5 * attributes[i].stroke_width);
+        }
+    }
+    half_stroke *= mtx.scale();
+    int x0 = static_cast<int>(std::floor(extent.minx() - half_stroke)) - 1;
+    int y0 = static_cast<int>(std::floor(extent.miny() - half_stroke)) - 1;
+    int x1 = static_cast<int>(std::ceil(extent.maxx() + half_stroke)) + 1;
+    int y1 = static_cast<int>(std::ceil(extent.maxy() + half_stroke)) + 1;
+
+    marker_sprite_ptr sprite = boost::make_shared<marker_sprite>(x1 - x0, y1 - y0, x0, y0);
+    agg::rendering_buffer buf(sprite->image.getBytes(), sprite->image.width(),
+                              sprite->image.height(), sprite->image.width() * 4);
+    pixfmt_type pixf(buf);
+    renderer_base renb(pixf);
+    agg::rasterizer_scanline_aa<> ras;
+    agg::scanline_u8 sl;
+    svg::vertex_stl_adapter<svg::svg_path_storage> stl_storage(svg.source());
+    svg::svg_path_adapter svg_path(stl_storage);
+    svg_renderer_type svg_renderer(svg_path, attributes);
+    agg::trans_affine sprite_mtx = mtx;
+    sprite_mtx.translate(-x0, -y0);
+    svg_renderer.render(ras, sl, renb, sprite_mtx, 1.0, bbox);
+    return sprite;
+}
+
+}
+
+marker_sprite_cache::marker_sprite_cache()
+    : sprites_(),
+      order_(),
+      max_bytes_(32 * 1024 * 1024)
+{
+    stats_ = stats();
+}
+
+marker_sprite_cache::~marker_sprite_cache() {}
+
+marker_sprite_ptr marker_sprite_cache::get(std::string const& uri,
+                                           marker const& mark,
+                                           agg::trans_affine const& mtx,
+                                           attr_storage const* attributes,
+                                           std::string const& style_key)
+{
+    if (!mark.is_vector())
+    {
+        return marker_sprite_ptr();
+    }
+    agg::trans_affine sprite_mtx = quantize_rotation(mtx);
+    std::string key(uri);
+    key.push_back('\0');
+    key.append(style_key);
+    key.push_back('\0');
+    append_matrix(key, sprite_mtx);
+
+    std::size_t max_bytes;
+    {
+#ifdef MAPNIK_THREADSAFE
+        mutex::scoped_lock lock(mutex_);
+#endif
+        map_type::iterator itr = sprites_.find(key);
+        if (itr != sprites_.end())
+        {
+            ++stats_.hits;
+            // move to the front of the recently used list
+            order_.splice(order_.begin(), order_, itr->second.second);
+            return itr->second.first;
+        }
+        ++stats_.misses;
+        max_bytes = max_bytes_;
+    }
+
+    // rasterized without the lock held; a concurrent miss on the same key
+    // only costs a duplicate rasterization
+    svg_storage_type & svg = **mark.get_vector_data();
+    marker_sprite_ptr sprite = rasterize(svg, sprite_mtx, attributes ? *attributes : svg.attributes());
+    std::size_t bytes = sprite->image.width() * sprite->image.height() * 4;
+    if (bytes > max_bytes)
+    {
+        // too big to keep, still good to draw this once
+        return sprite;
+    }
+
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    map_type::iterator itr = sprites_.find(key);
+    if (itr != sprites_.end())
+    {
+        return itr->second.first;
+    }
+    trim(max_bytes_ > bytes ? max_bytes_ - bytes : 0);
+    order_.push_front(key);
+    sprites_.insert(std::make_pair(key, std::make_pair(sprite, order_.begin())));
+    stats_.bytes += bytes;
+    return sprite;
+}
+
+void marker_sprite_cache::trim(std::size_t max_bytes)
+{
+    while (stats_.bytes > max_bytes && !order_.empty())
+    {
+        map_type::iterator itr = sprites_.find(order_.back());
+        image_data_32 const& image = itr->second.first->image;
+        stats_.bytes -= image.width() * image.height() * 4;
+        sprites_.erase(itr);
+        order_.pop_back();
+        ++stats_.evictions;
+    }
+}
+
+void marker_sprite_cache::set_max_bytes(std::size_t max_bytes)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    max_bytes_ = max_bytes;
+    trim(max_bytes_);
+}
+
+std::size_t marker_sprite_cache::max_bytes() const
+{
+    return max_bytes_;
+}
+
+marker_sprite_cache::stats marker_sprite_cache::get_stats() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    stats result = stats_;
+    result.entries = sprites_.size();
+    return result;
+}
+
+void marker_sprite_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    sprites_.clear();
+    order_.clear();
+    stats_ = stats();
+}
+
+}
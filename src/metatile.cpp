@@ -0,0 +1,162 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2012 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+
+// mapnik
+#include <mapnik/metatile.hpp>
+#include <mapnik/map.hpp>
+#include <mapnik/agg_renderer.hpp>
+#include <mapnik/image_util.hpp>
+#include <mapnik/hextree.hpp>
+#include <mapnik/util/conversions.hpp>
+
+// boost
+#include <boost/foreach.hpp>
+#include <boost/tokenizer.hpp>
+#include <boost/algorithm/string.hpp>
+
+// stl
+#include <stdexcept>
+#include <sstream>
+
+namespace mapnik {
+
+namespace {
+
+// colors requested by a paletted png format string, or -1 for other formats
+int palette_colors(std::string const& format)
+{
+    std::string t = boost::algorithm::to_lower_copy(format);
+    if (!boost::algorithm::starts_with(t, "png8") && !boost::algorithm::starts_with(t, "png256"))
+    {
+        return -1;
+    }
+    int colors = 256;
+    boost::char_separator<char> sep(":");
+    boost::tokenizer< boost::char_separator<char> > tokens(t, sep);
+    BOOST_FOREACH(std::string const& token, tokens)
+    {
+        if (boost::algorithm::starts_with(token, "c="))
+        {
+            if (!mapnik::util::string2int(token.substr(2), colors) || colors < 1 || colors > 256)
+            {
+                throw ImageWriterException("invalid color parameter: " + token.substr(2));
+            }
+        }
+    }
+    return colors;
+}
+
+}
+
+metatile_renderer::metatile_renderer(unsigned tiles, unsigned tile_size)
+    : tiles_(tiles),
+      tile_size_(tile_size),
+      image_(tiles * tile_size, tiles * tile_size),
+      buffers_(tiles * tiles)
+{
+    if (tiles == 0 || tile_size == 0)
+    {
+        throw std::runtime_error("metatile must contain at least one tile");
+    }
+}
+
+void metatile_renderer::render(Map const& map, double scale_factor)
+{
+    unsigned size = tiles_ * tile_size_;
+    if (map.width() != size || map.height() != size)
+    {
+        std::ostringstream s;
+        s << "map size " << map.width() << "x" << map.height()
+          << " does not match metatile size " << size << "x" << size;
+        throw std::runtime_error(s.str());
+    }
+    image_.clear();
+    agg_renderer<image_32> ren(map, image_, scale_factor);
+    ren.apply();
+}
+
+image_view<image_data_32> metatile_renderer::view(unsigned x, unsigned y) const
+{
+    return image_view<image_data_32>(x * tile_size_, y * tile_size_,
+                                     tile_size_, tile_size_, image_.data());
+}
+
+std::vector<std::string> const& metatile_renderer::encode(std::string const& format)
+{
+    int colors = palette_colors(format);
+    if (colors < 0)
+    {
+        for (unsigned y = 0; y < tiles_; ++y)
+        {
+            for (unsigned x = 0; x < tiles_; ++x)
+            {
+                std::string & buffer = buffers_[y * tiles_ + x];
+                buffer.clear();
+                save_to_buffer(view(x, y), format, buffer);
+            }
+        }
+        return buffers_;
+    }
+
+    image_data_32 const& data = image_.data();
+    hextree<mapnik::rgba> tree(colors);
+    for (unsigned y = 0; y < data.height(); ++y)
+    {
+        image_data_32::pixel_type const* row = data.getRow(y);
+        for (unsigned x = 0; x < data.width(); ++x)
+        {
+            unsigned val = row[x];
+            tree.insert(mapnik::rgba(U2RED(val), U2GREEN(val), U2BLUE(val), U2ALPHA(val)));
+        }
+    }
+    std::vector<mapnik::rgba> pal;
+    tree.create_palette(pal);
+    std::string pal_str;
+    pal_str.reserve(pal.size() * 4);
+    BOOST_FOREACH(mapnik::rgba const& c, pal)
+    {
+        pal_str.push_back(c.r);
+        pal_str.push_back(c.g);
+        pal_str.push_back(c.b);
+        pal_str.push_back(c.a);
+    }
+    rgba_palette palette(pal_str, rgba_palette::PALETTE_RGBA);
+    return encode(format, palette);
+}
+
+std::vector<std::string> const& metatile_renderer::encode(std::string const& format,
+                                                          rgba_palette const& palette)
+{
+    for (unsigned y = 0; y < tiles_; ++y)
+    {
+        for (unsigned x = 0; x < tiles_; ++x)
+        {
+            std::string & buffer = buffers_[y * tiles_ + x];
+            buffer.clear();
+            save_to_buffer(view(x, y), format, palette, buffer);
+        }
+    }
+    return buffers_;
+}
+
+}
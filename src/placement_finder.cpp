@@ -26,12 +26,14 @@
 #include <mapnik/text_path.hpp>
 #include <mapnik/fastmath.hpp>
 #include <mapnik/text_placements/base.hpp>
+#include <mapnik/text_shaping_cache.hpp>
 
 // agg
 #include "agg_path_length.h"
 
 // boost
 #include <boost/shared_ptr.hpp>
+#include <boost/make_shared.hpp>
 #include <boost/utility.hpp>
 #include <boost/ptr_container/ptr_vector.hpp>
 #include <boost/tuple/tuple.hpp>
@@ -40,6 +42,7 @@
 //stl
 #include <string>
 #include <vector>
+#include <algorithm>
 
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
@@ -208,6 +211,25 @@ template <typename DetectorT>
 void placement_finder<DetectorT>::find_line_breaks()
 {
     if (!line_sizes_.empty()) return;
+
+    std::string layout_key;
+    if (!info_.layout_key().empty())
+    {
+        layout_key = info_.layout_key();
+        append_key(layout_key, p.wrap_width);
+        append_key(layout_key, p.text_ratio);
+        text_layout_ptr layout = text_shaping_cache::instance().find_layout(layout_key);
+        if (layout)
+        {
+            line_breaks_ = layout->line_breaks;
+            line_sizes_ = layout->line_sizes;
+            string_width_ = layout->width;
+            string_height_ = layout->height;
+            first_line_space_ = layout->first_line_space;
+            return;
+        }
+    }
+
     bool first_line = true;
     // check if we need to wrap the string
     double wrap_at = string_width_ + 1.0;
@@ -285,6 +307,17 @@ void placement_finder<DetectorT>::find_line_breaks()
         line_sizes_.push_back(std::make_pair(string_width_, string_height_));
     }
     line_breaks_.push_back(info_.num_characters());
+
+    if (!layout_key.empty())
+    {
+        boost::shared_ptr<text_layout> layout = boost::make_shared<text_layout>();
+        layout->line_breaks = line_breaks_;
+        layout->line_sizes = line_sizes_;
+        layout->width = string_width_;
+        layout->height = string_height_;
+        layout->first_line_space = first_line_space_;
+        text_shaping_cache::instance().insert_layout(layout_key, layout);
+    }
 }
 
 template <typename DetectorT>
@@ -550,6 +583,7 @@ void placement_finder<DetectorT>::find_line_placements(PathT & shape_path)
     // and lets us know how many points are in the shape.
     std::vector<vertex2d> path_positions;
     std::vector<double> path_distances; // distance from node x-1 to node x
+    std::vector<double> path_offsets; // distance from the first node to node x
     double total_distance = 0;
 
     shape_path.rewind(0);
@@ -567,6 +601,7 @@ void placement_finder<DetectorT>::find_line_placements(PathT & shape_path)
         {
             path_distances.push_back(0);
         }
+        path_offsets.push_back(total_distance);
         first = false;
         path_positions.push_back(vertex2d(new_x, new_y, cmd));
         old_x = new_x;
@@ -615,6 +650,9 @@ void placement_finder<DetectorT>::find_line_placements(PathT & shape_path)
     }
 
 
+    //Candidates are laid out into one text_path whose storage is reused until a placement succeeds
+    std::auto_ptr<text_path> current_placement;
+
     first = true;
     for (unsigned index = 0; index < path_positions.size(); index++) //For each node in the shape
     {
@@ -641,10 +679,12 @@ void placement_finder<DetectorT>::find_line_placements(PathT & shape_path)
                     {
                         //Record details for the start of the string placement
                         int orientation = 0;
-                        std::auto_ptr<text_path> current_placement = get_placement_offset(path_positions, path_distances, orientation, index, segment_length - (distance - target_distance) + (diff*dir));
+                        if (current_placement.get() == NULL)
+                            current_placement.reset(new text_path(0, 0));
 
                         //We were unable to place here
-                        if (current_placement.get() == NULL)
+                        if (!get_placement_offset(path_positions, path_distances, path_offsets, *current_placement,
+                                                  orientation, index, segment_length - (distance - target_distance) + (diff*dir)))
                             continue;
 
                         //Apply displacement
@@ -676,7 +716,7 @@ void placement_finder<DetectorT>::find_line_placements(PathT & shape_path)
                             }
                         }
 
-                        bool status = test_placement(current_placement, orientation);
+                        bool status = test_placement(*current_placement, orientation);
 
                         if (status) //We have successfully placed one
                         {
@@ -711,29 +751,40 @@ void placement_finder<DetectorT>::find_line_placements(PathT & shape_path)
 }
 
 template <typename DetectorT>
-std::auto_ptr<text_path> placement_finder<DetectorT>::get_placement_offset(std::vector<vertex2d> const& path_positions,
-                                                                           std::vector<double> const& path_distances,
-                                                                           int & orientation,
-                                                                           unsigned index,
-                                                                           double distance)
+bool placement_finder<DetectorT>::get_placement_offset(std::vector<vertex2d> const& path_positions,
+                                                       std::vector<double> const& path_distances,
+                                                       std::vector<double> const& path_offsets,
+                                                       text_path & current_placement,
+                                                       int & orientation,
+                                                       unsigned index,
+                                                       double distance)
 {
-    //Check that the given distance is on the given index and find the correct index and distance if not
-    while (distance < 0 && index > 1)
+    //Check that the given distance is on the given index and find the correct index and distance if not.
+    //The cumulative offsets let us binary search instead of walking the segments one by one.
+    if (index >= path_distances.size())
+        return false;
+    if (distance < 0)
     {
-        index--;
-        distance += path_distances[index];
+        //Last node at or before the start of the placement
+        double position = path_offsets[index-1] + distance;
+        std::vector<double>::const_iterator itr =
+            std::upper_bound(path_offsets.begin(), path_offsets.begin() + index, position);
+        if (itr == path_offsets.begin()) //We've gone off the start, fail out
+            return false;
+        index = itr - path_offsets.begin();
+        distance = position - path_offsets[index-1];
     }
-    if (index <= 1 && distance < 0) //We've gone off the start, fail out
-        return std::auto_ptr<text_path>(NULL);
-
-    //Same thing, checking if we go off the end
-    while (index < path_distances.size() && distance > path_distances[index])
+    else if (distance > path_distances[index])
     {
-        distance -= path_distances[index];
-        index++;
+        //Same thing, checking if we go off the end
+        double position = path_offsets[index-1] + distance;
+        std::vector<double>::const_iterator itr =
+            std::lower_bound(path_offsets.begin() + index, path_offsets.end(), position);
+        if (itr == path_offsets.end())
+            return false;
+        index = itr - path_offsets.begin();
+        distance = position - path_offsets[index-1];
     }
-    if (index >= path_distances.size())
-        return std::auto_ptr<text_path>(NULL);
 
     //Keep track of the initial index,distance incase we need to re-call get_placement_offset
     const unsigned initial_index = index;
@@ -751,14 +802,11 @@ std::auto_ptr<text_path> placement_finder<DetectorT>::get_placement_offset(std::
     double segment_length = path_distances[index];
     if (segment_length == 0) {
         // Not allowed to place across on 0 length segments or discontinuities
-        return std::auto_ptr<text_path>(NULL);
+        return false;
     }
 
-    std::auto_ptr<text_path> current_placement(
-        new text_path((old_x + dx*distance/segment_length),
-                      (old_y + dy*distance/segment_length)
-            )
-        );
+    current_placement.reset(old_x + dx*distance/segment_length,
+                            old_y + dy*distance/segment_length);
 
     double angle = atan2(-dy, dx);
 
@@ -779,7 +827,7 @@ std::auto_ptr<text_path> placement_finder<DetectorT>::get_placement_offset(std::
         //Coordinates this character will start at
         if (segment_length == 0) {
             // Not allowed to place across on 0 length segments or discontinuities
-            return std::auto_ptr<text_path>(NULL);
+            return false;
         }
         double start_x = old_x + dx*distance/segment_length;
         double start_y = old_y + dy*distance/segment_length;
@@ -807,7 +855,7 @@ std::auto_ptr<text_path> placement_finder<DetectorT>::get_placement_offset(std::
                 if (index >= path_positions.size()) //Bail out if we run off the end of the shape
                 {
                     //MAPNIK_LOG_ERROR(placement_finder) << "FAIL: Out of space";
-                    return std::auto_ptr<text_path>(NULL);
+                    return false;
                 }
                 new_x = path_positions[index].x;
                 new_y = path_positions[index].y;
@@ -844,7 +892,7 @@ std::auto_ptr<text_path> placement_finder<DetectorT>::get_placement_offset(std::
             fabs(angle_delta) > p.max_char_angle_delta)
         {
             //MAPNIK_LOG_ERROR(placement_finder) << "FAIL: Too Bendy!";
-            return std::auto_ptr<text_path>(NULL);
+            return false;
         }
 
         double render_angle = angle;
@@ -866,10 +914,10 @@ std::auto_ptr<text_path> placement_finder<DetectorT>::get_placement_offset(std::
             render_y -= cwidth*sina + char_height*cosa;
             render_angle += M_PI;
         }
-        current_placement->add_node(&ci,
-                                    render_x - current_placement->center.x,
-                                    -render_y + current_placement->center.y,
-                                    render_angle);
+        current_placement.add_node(&ci,
+                                   render_x - current_placement.center.x,
+                                   -render_y + current_placement.center.y,
+                                   render_angle);
 
         //Normalise to 0 <= angle < 2PI
         while (render_angle >= 2*M_PI)
@@ -888,25 +936,27 @@ std::auto_ptr<text_path> placement_finder<DetectorT>::get_placement_offset(std::
         if (!orientation_forced)
         {
             orientation = -orientation;
-            current_placement = get_placement_offset(path_positions,
-                                                     path_distances,
-                                                     orientation,
-                                                     initial_index,
-                                                     initial_distance);
+            return get_placement_offset(path_positions,
+                                        path_distances,
+                                        path_offsets,
+                                        current_placement,
+                                        orientation,
+                                        initial_index,
+                                        initial_distance);
         }
         else
         {
             //Otherwise we have failed to find a placement
             //MAPNIK_LOG_ERROR(placement_finder) << "FAIL: Double upside-down!";
-            return std::auto_ptr<text_path>(NULL);
+            return false;
         }
     }
 
-    return current_placement;
+    return true;
 }
 
 template <typename DetectorT>
-bool placement_finder<DetectorT>::test_placement(std::auto_ptr<text_path> const& current_placement,
+bool placement_finder<DetectorT>::test_placement(text_path const& current_placement,
                                                  int orientation)
 {
     //Create and test envelopes
@@ -919,9 +969,9 @@ bool placement_finder<DetectorT>::test_placement(std::auto_ptr<text_path> const&
         double cwidth = ci.width + ci.format->character_spacing;
         char_info_ptr c;
         double x, y, angle;
-        current_placement->vertex(&c, &x, &y, &angle);
-        x = current_placement->center.x + x;
-        y = current_placement->center.y - y;
+        current_placement.vertex(&c, &x, &y, &angle);
+        x = current_placement.center.x + x;
+        y = current_placement.center.y - y;
 
         double sina = fast_sin(angle);
         double cosa = fast_cos(angle);
@@ -977,7 +1027,7 @@ bool placement_finder<DetectorT>::test_placement(std::auto_ptr<text_path> const&
         envelopes_.push(e);
     }
 
-    current_placement->rewind();
+    current_placement.rewind();
 
     return status;
 }
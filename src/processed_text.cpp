@@ -22,6 +22,7 @@
 
 #include <mapnik/processed_text.hpp>
 #include <mapnik/config_error.hpp>
+#include <mapnik/text_shaping_cache.hpp>
 
 namespace mapnik
 {
@@ -95,6 +96,16 @@ string_info &processed_text::get_string_info()
         faces->set_character_sizes(p.text_size * scale_factor_);
         faces->get_string_info(info_, itr->str, &(itr->p));
         info_.add_text(itr->str);
+
+        // everything find_line_breaks looks at, apart from the symbolizer's wrap settings
+        std::string & key = info_.layout_key();
+        key += faces->key();
+        append_key(key, itr->str.length());
+        key.append(reinterpret_cast<char const*>(itr->str.getBuffer()), itr->str.length() * sizeof(UChar));
+        append_key(key, p.character_spacing);
+        append_key(key, p.line_spacing);
+        append_key(key, p.wrap_char);
+        append_key(key, p.wrap_before);
     }
     return info_;
 }
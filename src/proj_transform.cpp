@@ -25,6 +25,7 @@
 #include <mapnik/proj_transform.hpp>
 #include <mapnik/coord.hpp>
 #include <mapnik/utils.hpp>
+#include <mapnik/well_known_srs.hpp>
 
 // proj4
 #include <proj_api.h>
@@ -32,30 +33,34 @@
 // stl
 #include <vector>
 
-static const float MAXEXTENT = 20037508.34;
-static const float M_PI_by2 = M_PI / 2;
-static const float D2R = M_PI / 180;
-static const float R2D = 180 / M_PI;
-static const float M_PIby360 = M_PI / 360;
-static const float MAXEXTENTby180 = MAXEXTENT/180;
-
 namespace mapnik {
 
 proj_transform::proj_transform(projection const& source,
                                projection const& dest)
     : source_(source),
-      dest_(dest)
+      dest_(dest),
+      wgs84_to_merc_(false),
+      merc_to_wgs84_(false)
 {
     is_source_longlat_ = source_.is_geographic();
     is_dest_longlat_ = dest_.is_geographic();
     is_source_equal_dest_ = (source_ == dest_);
-    if (source.params() == "+init=epsg:3857" && dest.params() == "+init=epsg:4326")
-    {
-        wgs84_to_merc_ = true;
-    }
-    else
+    if (!is_source_equal_dest_)
     {
-        wgs84_to_merc_ = false;
+        boost::optional<well_known_srs_enum> known_src = is_well_known_srs(source_.params());
+        boost::optional<well_known_srs_enum> known_dst = is_well_known_srs(dest_.params());
+        if (known_src && known_dst)
+        {
+            if (*known_src == *known_dst)
+            {
+                is_source_equal_dest_ = true;
+            }
+            else
+            {
+                wgs84_to_merc_ = (*known_src == WGS_84);
+                merc_to_wgs84_ = (*known_src == G_MERC);
+            }
+        }
     }
 }
 
@@ -70,41 +75,37 @@ bool proj_transform::forward (double & x, double & y , double & z) const
     return forward(&x, &y, &z, 1);
 }
 
-bool proj_transform::forward (double * x, double * y , double * z, int point_count) const
+bool proj_transform::forward (double * x, double * y , double * z, int point_count, int offset) const
 {
 
     if (is_source_equal_dest_)
         return true;
 
-    if (wgs84_to_merc_) {
-        int i;
-        for(i=0; i<point_count; i++) {
-            x[i] = (x[i] / MAXEXTENT) * 180;
-            y[i] = (y[i] / MAXEXTENT) * 180;
-            y[i] = R2D * (2 * atan(exp(y[i] * D2R)) - M_PI_by2);
-            if (x[i] > 180) x[i] = 180;
-            if (x[i] < -180) x[i] = -180;
-            if (y[i] > 85.0511) y[i] = 85.0511;
-            if (y[i] < -85.0511) y[i] = -85.0511;
-        }
-        return true;
-    }
+    if (wgs84_to_merc_)
+        return lonlat2merc(x, y, point_count, offset);
+    if (merc_to_wgs84_)
+        return merc2lonlat(x, y, point_count, offset);
+
+    if (offset < 1) offset = 1;
 
     if (is_source_longlat_)
     {
         int i;
-        for(i=0; i<point_count; i++) {
+        for(i=0; i<point_count*offset; i+=offset) {
             x[i] *= DEG_TO_RAD;
             y[i] *= DEG_TO_RAD;
         }
     }
 
     do {
+        // resolve the handles first, a cache miss takes the mutex itself
+        projPJ source = source_.proj();
+        projPJ dest = dest_.proj();
 #if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
         mutex::scoped_lock lock(projection::mutex_);
 #endif
-        if (pj_transform( source_.proj_, dest_.proj_, point_count,
-                          0, x,y,z) != 0)
+        if (pj_transform( source, dest, point_count,
+                          offset, x,y,z) != 0)
         {
             return false;
         }
@@ -113,7 +114,7 @@ bool proj_transform::forward (double * x, double * y , double * z, int point_cou
     if (is_dest_longlat_)
     {
         int i;
-        for(i=0; i<point_count; i++) {
+        for(i=0; i<point_count*offset; i+=offset) {
             x[i] *= RAD_TO_DEG;
             y[i] *= RAD_TO_DEG;
         }
@@ -122,41 +123,37 @@ bool proj_transform::forward (double * x, double * y , double * z, int point_cou
     return true;
 }
 
-bool proj_transform::backward (double * x, double * y , double * z, int point_count) const
+bool proj_transform::backward (double * x, double * y , double * z, int point_count, int offset) const
 {
     if (is_source_equal_dest_)
         return true;
 
-    if (wgs84_to_merc_) {
-        int i;
-        for(i=0; i<point_count; i++) {
-            x[i] = x[i] * MAXEXTENTby180;
-            y[i] = std::log(tan((90 + y[i]) * M_PIby360)) / D2R;
-            y[i] = y[i] * MAXEXTENTby180;
-            if (x[i] > MAXEXTENT) x[i] = MAXEXTENT;
-            if (x[i] < -MAXEXTENT) x[i] = -MAXEXTENT;
-            if (y[i] > MAXEXTENT) y[i] = MAXEXTENT;
-            if (y[i] < -MAXEXTENT) y[i] = -MAXEXTENT;
-        }
-        return true;
-    }
+    if (wgs84_to_merc_)
+        return merc2lonlat(x, y, point_count, offset);
+    if (merc_to_wgs84_)
+        return lonlat2merc(x, y, point_count, offset);
+
+    if (offset < 1) offset = 1;
 
     if (is_dest_longlat_)
     {
         int i;
-        for(i=0; i<point_count; i++) {
+        for(i=0; i<point_count*offset; i+=offset) {
             x[i] *= DEG_TO_RAD;
             y[i] *= DEG_TO_RAD;
         }
     }
 
     {
+        // resolve the handles first, a cache miss takes the mutex itself
+        projPJ source = source_.proj();
+        projPJ dest = dest_.proj();
 #if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
         mutex::scoped_lock lock(projection::mutex_);
 #endif
 
-        if (pj_transform( dest_.proj_, source_.proj_, point_count,
-                          0, x,y,z) != 0)
+        if (pj_transform( dest, source, point_count,
+                          offset, x,y,z) != 0)
         {
             return false;
         }
@@ -165,7 +162,7 @@ bool proj_transform::backward (double * x, double * y , double * z, int point_co
     if (is_source_longlat_)
     {
         int i;
-        for(i=0; i<point_count; i++) {
+        for(i=0; i<point_count*offset; i+=offset) {
             x[i] *= RAD_TO_DEG;
             y[i] *= RAD_TO_DEG;
         }
@@ -180,6 +177,50 @@ bool proj_transform::backward (double & x, double & y , double & z) const
 }
 
 
+namespace {
+
+struct forward_block
+{
+    explicit forward_block(proj_transform const& tr)
+        : tr_(tr) {}
+
+    bool operator() (double * xy, unsigned count) const
+    {
+        return tr_.forward(xy, xy + 1, 0, count, 2);
+    }
+
+    proj_transform const& tr_;
+};
+
+struct backward_block
+{
+    explicit backward_block(proj_transform const& tr)
+        : tr_(tr) {}
+
+    bool operator() (double * xy, unsigned count) const
+    {
+        return tr_.backward(xy, xy + 1, 0, count, 2);
+    }
+
+    proj_transform const& tr_;
+};
+
+}
+
+bool proj_transform::forward (geometry_type & geom) const
+{
+    if (is_source_equal_dest_)
+        return true;
+    return geom.data().transform_blocks(forward_block(*this));
+}
+
+bool proj_transform::backward (geometry_type & geom) const
+{
+    if (is_source_equal_dest_)
+        return true;
+    return geom.data().transform_blocks(backward_block(*this));
+}
+
 bool proj_transform::forward (box2d<double> & box) const
 {
     if (is_source_equal_dest_)
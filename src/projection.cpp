@@ -26,10 +26,17 @@
 
 // boost
 #include <boost/algorithm/string.hpp>
+#ifdef MAPNIK_THREADSAFE
+#include <boost/thread/tss.hpp>
+#endif
 
 // proj4
 #include <proj_api.h>
 
+// stl
+#include <list>
+#include <map>
+
 namespace mapnik {
 
 #if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
@@ -37,6 +44,132 @@ namespace mapnik {
 boost::mutex projection::mutex_;
 #endif
 
+// proj4 handles must not be used by two threads at once, so every thread
+// keeps its own context and initialized handles per definition. Handles are
+// shared by all projections of the thread and kept in most recently used
+// order, so the definitions a transform alternates between are found without
+// a map lookup and a thread that sees many definitions holds a bounded number.
+class proj_cache : private boost::noncopyable
+{
+    struct entry
+    {
+        std::string params;
+        projPJ proj;
+    };
+    typedef std::list<entry> entry_list;
+    typedef std::map<std::string, entry_list::iterator> handle_map;
+    // more than a transform needs at once (two), so a handle just handed
+    // out is never the one evicted
+    static std::size_t const max_handles = 32;
+public:
+    proj_cache()
+#if PJ_VERSION >= 480
+        : ctx_(pj_ctx_alloc())
+#endif
+    {
+    }
+
+    ~proj_cache()
+    {
+        for (entry_list::iterator itr = entries_.begin(); itr != entries_.end(); ++itr)
+        {
+            free_locked(itr->proj);
+        }
+#if PJ_VERSION >= 480
+        if (ctx_) pj_ctx_free(ctx_);
+#endif
+    }
+
+    projPJ get(std::string const& params)
+    {
+        // source and destination of the transform in use are at the front
+        entry_list::iterator itr = entries_.begin();
+        for (unsigned i = 0; i < 2 && itr != entries_.end(); ++i, ++itr)
+        {
+            if (itr->params == params) return touch(itr);
+        }
+        handle_map::iterator found = handles_.find(params);
+        if (found != handles_.end()) return touch(found->second);
+#if PJ_VERSION >= 480
+        projPJ proj = pj_init_plus_ctx(ctx_, params.c_str());
+#else
+        projPJ proj = init_locked(params);
+#endif
+        if (!proj) throw proj_init_error(params);
+        if (entries_.size() >= max_handles)
+        {
+            handles_.erase(entries_.back().params);
+            free_locked(entries_.back().proj);
+            entries_.pop_back();
+        }
+        entry e;
+        e.params = params;
+        e.proj = proj;
+        entries_.push_front(e);
+        handles_.insert(std::make_pair(params, entries_.begin()));
+        return proj;
+    }
+
+private:
+    projPJ touch(entry_list::iterator itr)
+    {
+        if (itr != entries_.begin())
+        {
+            entries_.splice(entries_.begin(), entries_, itr);
+        }
+        return itr->proj;
+    }
+
+    static void free_locked(projPJ proj)
+    {
+#if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
+        mutex::scoped_lock lock(projection::mutex_);
+#endif
+        pj_free(proj);
+    }
+
+#if PJ_VERSION < 480
+    static projPJ init_locked(std::string const& params)
+    {
+#ifdef MAPNIK_THREADSAFE
+        mutex::scoped_lock lock(projection::mutex_);
+#endif
+        return pj_init_plus(params.c_str());
+    }
+#endif
+
+#if PJ_VERSION >= 480
+    projCtx ctx_;
+#endif
+    entry_list entries_;
+    handle_map handles_;
+};
+
+namespace {
+
+#ifdef MAPNIK_THREADSAFE
+boost::thread_specific_ptr<proj_cache> local_caches;
+
+proj_cache & local_cache()
+{
+    proj_cache * cache = local_caches.get();
+    if (!cache)
+    {
+        cache = new proj_cache;
+        local_caches.reset(cache);
+    }
+    return *cache;
+}
+#else
+proj_cache & local_cache()
+{
+    static proj_cache cache;
+    return cache;
+}
+#endif
+
+}
+
 projection::projection(std::string const& params)
     : params_(params)
 {
@@ -44,9 +177,9 @@ projection::projection(std::string const& params)
 }
 
 projection::projection(projection const& rhs)
-    : params_(rhs.params_)
+    : params_(rhs.params_),
+      is_geographic_(rhs.is_geographic_)
 {
-    init();
 }
 
 projection& projection::operator=(projection const& rhs)
@@ -68,7 +201,7 @@ bool projection::operator!=(const projection& other) const
 
 bool projection::is_initialized() const
 {
-    return proj_ ? true : false;
+    return proj() ? true : false;
 }
 
 bool projection::is_geographic() const
@@ -83,13 +216,14 @@ std::string const& projection::params() const
 
 void projection::forward(double & x, double &y ) const
 {
+    projPJ proj = this->proj();
 #if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
     mutex::scoped_lock lock(mutex_);
 #endif
     projUV p;
     p.u = x * DEG_TO_RAD;
     p.v = y * DEG_TO_RAD;
-    p = pj_fwd(p,proj_);
+    p = pj_fwd(p,proj);
     x = p.u;
     y = p.v;
     if (is_geographic_)
@@ -101,6 +235,7 @@ void projection::forward(double & x, double &y ) const
 
 void projection::inverse(double & x,double & y) const
 {
+    projPJ proj = this->proj();
 #if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
     mutex::scoped_lock lock(mutex_);
 #endif
@@ -112,46 +247,32 @@ void projection::inverse(double & x,double & y) const
     projUV p;
     p.u = x;
     p.v = y;
-    p = pj_inv(p,proj_);
+    p = pj_inv(p,proj);
     x = RAD_TO_DEG * p.u;
     y = RAD_TO_DEG * p.v;
 }
 
 projection::~projection()
 {
-#if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
-    mutex::scoped_lock lock(mutex_);
-#endif
-    if (proj_) pj_free(proj_);
-#if PJ_VERSION >= 480
-    if (proj_ctx_) pj_ctx_free(proj_ctx_);
-#endif
 }
 
 void projection::init()
 {
-#if defined(MAPNIK_THREADSAFE) && PJ_VERSION < 480
-    mutex::scoped_lock lock(mutex_);
-#endif
-#if PJ_VERSION >= 480
-    proj_ctx_ = pj_ctx_alloc();
-    proj_ = pj_init_plus_ctx(proj_ctx_, params_.c_str());
-    if (!proj_)
-    {
-        if (proj_ctx_) pj_ctx_free(proj_ctx_);
-        throw proj_init_error(params_);
-    }
-#else
-    proj_ = pj_init_plus(params_.c_str());
-    if (!proj_) throw proj_init_error(params_);
-#endif
-    is_geographic_ = pj_is_latlong(proj_) ? true : false;
+    is_geographic_ = pj_is_latlong(proj()) ? true : false;
+}
+
+// Not memoized in the projection: one projection may be used by several
+// threads at once and each of them must get its own handle.
+projPJ projection::proj() const
+{
+    return local_cache().get(params_);
 }
 
 std::string projection::expanded() const
 {
-    if (proj_) {
-        std::string def(pj_get_def( proj_, 0 ));
+    projPJ proj = this->proj();
+    if (proj) {
+        std::string def(pj_get_def( proj, 0 ));
         //boost::algorithm::ireplace_first(def,params_,"");
         boost::trim(def);
         return def;
@@ -162,6 +283,6 @@ std::string projection::expanded() const
 void projection::swap(projection& rhs)
 {
     std::swap(params_,rhs.params_);
-    init();
+    std::swap(is_geographic_,rhs.is_geographic_);
 }
 }
@@ -158,8 +158,9 @@ private:
     std::string filename_;
 };
 
-void read_xml(std::string const & filename, xml_node &node)
+void read_xml(std::string const & filename, xml_node &node, std::vector<std::string> * /*files*/)
 {
+    // rapidxml neither loads external entities nor processes XIncludes
     rapidxml_loader loader;
     loader.load(filename, node);
 }
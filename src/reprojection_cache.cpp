@@ -0,0 +1,584 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/reprojection_cache.hpp>
+#include <mapnik/debug.hpp>
+
+// boost
+#include <boost/make_shared.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// stl
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace mapnik
+{
+
+/* Layout of a reprojection sidecar, all integers in native byte order:
+ *
+ *   header:  magic[8] format_version:u32 byte_order:u32
+ *            source_size:u64 source_mtime:i64 key:str feature_count:u64
+ *   index:   (id:i64 offset:u64 size:u64)*  sorted by id
+ *   body:    feature*  offsets are relative to the start of the body
+ *   feature: geometry_count:u32 (type:u32 vertex_count:u32 (x:f64 y:f64)* command:u8*)*
+ *   str:     length:u32 bytes
+ *
+ * Memory caches keep each feature in the same encoding.
+ */
+
+namespace {
+
+char const sidecar_magic[8] = { 'M', 'A', 'P', 'N', 'I', 'K', 'R', '\0' };
+boost::uint32_t const sidecar_format = 1;
+boost::uint32_t const sidecar_byte_order = 0x01020304;
+std::size_t const index_entry_size = 3 * sizeof(boost::uint64_t);
+
+struct source_stamp
+{
+    boost::uint64_t size;
+    boost::int64_t mtime;
+};
+
+source_stamp stamp_of(std::string const& filename)
+{
+    source_stamp stamp = { 0, 0 };
+    boost::system::error_code ec;
+    stamp.size = static_cast<boost::uint64_t>(boost::filesystem::file_size(filename, ec));
+    stamp.mtime = static_cast<boost::int64_t>(boost::filesystem::last_write_time(filename, ec));
+    return stamp;
+}
+
+// the file the datasource reads, resolved the way the file based plugins do
+std::string data_file(parameters const& params)
+{
+    boost::optional<std::string> file = params.get<std::string>("file");
+    if (!file || file->empty()) return std::string();
+    boost::optional<std::string> base = params.get<std::string>("base");
+    std::string filename = base ? *base + "/" + *file : *file;
+    boost::system::error_code ec;
+    if (boost::filesystem::is_regular_file(filename, ec)) return filename;
+    // the shape plugin accepts names without extension
+    if (boost::filesystem::is_regular_file(filename + ".shp", ec)) return filename + ".shp";
+    return std::string();
+}
+
+std::string make_key(parameters const& params, proj_transform const& prj_trans)
+{
+    std::ostringstream s;
+    s << prj_trans.dest().params() << '\n' << prj_trans.source().params() << '\n';
+    for (parameters::const_iterator itr = params.begin(); itr != params.end(); ++itr)
+    {
+        s << itr->first << '=' << *params.get<std::string>(itr->first, "") << '\n';
+    }
+    return s.str();
+}
+
+// FNV-1a, stable across platforms and builds so sidecar names are too
+std::string key_hash(std::string const& key)
+{
+    boost::uint64_t hash = 14695981039346656037ULL;
+    for (std::string::const_iterator itr = key.begin(); itr != key.end(); ++itr)
+    {
+        hash ^= static_cast<unsigned char>(*itr);
+        hash *= 1099511628211ULL;
+    }
+    std::ostringstream s;
+    s << std::hex << hash;
+    return s.str();
+}
+
+template <typename T>
+void append(std::string & out, T value)
+{
+    out.append(reinterpret_cast<char const*>(&value), sizeof(T));
+}
+
+void encode(feature_impl const& feature, std::string & out)
+{
+    boost::ptr_vector<geometry_type> const& paths = feature.paths();
+    append(out, static_cast<boost::uint32_t>(paths.size()));
+    for (boost::ptr_vector<geometry_type>::const_iterator itr = paths.begin(); itr != paths.end(); ++itr)
+    {
+        unsigned count = itr->size();
+        append(out, static_cast<boost::uint32_t>(itr->type()));
+        append(out, static_cast<boost::uint32_t>(count));
+        std::string commands;
+        commands.reserve(count);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            double x, y;
+            commands.push_back(static_cast<char>(itr->vertex(i, &x, &y)));
+            append(out, x);
+            append(out, y);
+        }
+        out.append(commands);
+    }
+}
+
+template <typename T>
+bool read(char const*& pos, char const* end, T & value)
+{
+    if (static_cast<std::size_t>(end - pos) < sizeof(T)) return false;
+    std::memcpy(&value, pos, sizeof(T));
+    pos += sizeof(T);
+    return true;
+}
+
+bool decode(char const* pos, std::size_t size, feature_impl & feature)
+{
+    char const* end = pos + size;
+    boost::uint32_t geometry_count;
+    if (!read(pos, end, geometry_count)) return false;
+    boost::ptr_vector<geometry_type> paths;
+    for (boost::uint32_t n = 0; n < geometry_count; ++n)
+    {
+        boost::uint32_t type, count;
+        if (!read(pos, end, type) || !read(pos, end, count)) return false;
+        if (static_cast<std::size_t>(end - pos) / (2 * sizeof(double) + 1) < count) return false;
+        std::auto_ptr<geometry_type> geom(new geometry_type(static_cast<eGeomType>(type)));
+        char const* commands = pos + count * 2 * sizeof(double);
+        for (boost::uint32_t i = 0; i < count; ++i)
+        {
+            double x, y;
+            read(pos, end, x);
+            read(pos, end, y);
+            geom->push_vertex(x, y, static_cast<CommandType>(static_cast<unsigned char>(commands[i])));
+        }
+        pos = commands + count;
+        paths.push_back(geom.release());
+    }
+    feature.paths().swap(paths);
+    return true;
+}
+
+// Reprojects the geometries of feature from the layer to the map srs. As
+// when rendering without the cache, a geometry ends at the first vertex
+// that fails to reproject, and is dropped if that leaves it empty.
+void reproject(feature_impl & feature, proj_transform const& prj_trans)
+{
+    boost::ptr_vector<geometry_type> paths;
+    std::vector<double> coords;
+    boost::ptr_vector<geometry_type> const& source = feature.paths();
+    for (boost::ptr_vector<geometry_type>::const_iterator itr = source.begin(); itr != source.end(); ++itr)
+    {
+        unsigned count = itr->size();
+        if (count == 0) continue;
+        coords.resize(count * 2);
+        for (unsigned i = 0; i < count; ++i)
+        {
+            itr->vertex(i, &coords[i * 2], &coords[i * 2 + 1]);
+        }
+        unsigned valid = 0;
+        if (prj_trans.backward(&coords[0], &coords[1], 0, count, 2))
+        {
+            while (valid < count && coords[valid * 2] != HUGE_VAL && coords[valid * 2 + 1] != HUGE_VAL)
+            {
+                ++valid;
+            }
+        }
+        else
+        {
+            for (; valid < count; ++valid)
+            {
+                double z = 0;
+                itr->vertex(valid, &coords[valid * 2], &coords[valid * 2 + 1]);
+                if (!prj_trans.backward(coords[valid * 2], coords[valid * 2 + 1], z)) break;
+            }
+        }
+        if (valid == 0) continue;
+        std::auto_ptr<geometry_type> geom(new geometry_type(itr->type()));
+        for (unsigned i = 0; i < valid; ++i)
+        {
+            double x, y;
+            unsigned command = itr->vertex(i, &x, &y);
+            geom->push_vertex(coords[i * 2], coords[i * 2 + 1], static_cast<CommandType>(command));
+        }
+        paths.push_back(geom.release());
+    }
+    feature.paths().swap(paths);
+}
+
+class memory_geometries : public reprojected_geometries
+{
+    typedef boost::shared_ptr<std::string const> blob_ptr;
+public:
+    bool restore(feature_impl & feature) const
+    {
+        blob_ptr blob;
+        {
+#ifdef MAPNIK_THREADSAFE
+            mutex::scoped_lock lock(mutex_);
+#endif
+            boost::unordered_map<int, blob_ptr>::const_iterator itr = features_.find(feature.id());
+            if (itr == features_.end()) return false;
+            blob = itr->second;
+        }
+        return decode(blob->data(), blob->size(), feature);
+    }
+
+    void store(feature_impl const& feature)
+    {
+        boost::shared_ptr<std::string> blob = boost::make_shared<std::string>();
+        encode(feature, *blob);
+#ifdef MAPNIK_THREADSAFE
+        mutex::scoped_lock lock(mutex_);
+#endif
+        features_[feature.id()] = blob;
+    }
+
+    std::size_t size() const
+    {
+#ifdef MAPNIK_THREADSAFE
+        mutex::scoped_lock lock(mutex_);
+#endif
+        return features_.size();
+    }
+
+private:
+    boost::unordered_map<int, blob_ptr> features_;
+#ifdef MAPNIK_THREADSAFE
+    mutable mutex mutex_;
+#endif
+};
+
+// Read only view of a sidecar. Features missing from it are reprojected
+// on every render but never written back.
+class file_geometries : public reprojected_geometries
+{
+public:
+    explicit file_geometries(std::string const& filename)
+        : mapping_(filename.c_str(), boost::interprocess::read_only),
+          region_(mapping_, boost::interprocess::read_only),
+          index_(0),
+          body_(0),
+          end_(0),
+          count_(0) {}
+
+    // checks the header, returns false when the sidecar must be rebuilt
+    bool open(std::string const& key, source_stamp const& stamp)
+    {
+        char const* pos = static_cast<char const*>(region_.get_address());
+        char const* end = pos + region_.get_size();
+        if (static_cast<std::size_t>(end - pos) < sizeof(sidecar_magic) ||
+            std::memcmp(pos, sidecar_magic, sizeof(sidecar_magic)) != 0) return false;
+        pos += sizeof(sidecar_magic);
+        boost::uint32_t format, byte_order, key_length;
+        source_stamp file_stamp;
+        boost::uint64_t count;
+        if (!read(pos, end, format) || !read(pos, end, byte_order) ||
+            format != sidecar_format || byte_order != sidecar_byte_order) return false;
+        if (!read(pos, end, file_stamp.size) || !read(pos, end, file_stamp.mtime) ||
+            file_stamp.size != stamp.size || file_stamp.mtime != stamp.mtime) return false;
+        if (!read(pos, end, key_length) || static_cast<std::size_t>(end - pos) < key_length ||
+            key.compare(0, std::string::npos, pos, key_length) != 0) return false;
+        pos += key_length;
+        if (!read(pos, end, count) || static_cast<boost::uint64_t>(end - pos) / index_entry_size < count) return false;
+        index_ = pos;
+        body_ = pos + count * index_entry_size;
+        end_ = end;
+        count_ = static_cast<std::size_t>(count);
+        return true;
+    }
+
+    bool restore(feature_impl & feature) const
+    {
+        boost::int64_t id = feature.id();
+        std::size_t first = 0;
+        std::size_t last = count_;
+        while (first < last)
+        {
+            std::size_t middle = first + (last - first) / 2;
+            if (id_at(middle) < id) first = middle + 1;
+            else last = middle;
+        }
+        if (first == count_ || id_at(first) != id) return false;
+        boost::uint64_t offset, size;
+        char const* entry = index_ + first * index_entry_size + sizeof(boost::int64_t);
+        std::memcpy(&offset, entry, sizeof(offset));
+        std::memcpy(&size, entry + sizeof(offset), sizeof(size));
+        boost::uint64_t available = static_cast<boost::uint64_t>(end_ - body_);
+        if (offset > available || size > available - offset)
+        {
+            MAPNIK_LOG_ERROR(reprojection_cache) << "reprojection_cache: corrupt entry for feature " << id;
+            return false;
+        }
+        return decode(body_ + offset, static_cast<std::size_t>(size), feature);
+    }
+
+    void store(feature_impl const&) {}
+
+    std::size_t size() const
+    {
+        return count_;
+    }
+
+private:
+    boost::int64_t id_at(std::size_t index) const
+    {
+        boost::int64_t id;
+        std::memcpy(&id, index_ + index * index_entry_size, sizeof(id));
+        return id;
+    }
+
+    boost::interprocess::file_mapping mapping_;
+    boost::interprocess::mapped_region region_;
+    char const* index_;
+    char const* body_;
+    char const* end_;
+    std::size_t count_;
+};
+
+struct index_entry
+{
+    boost::int64_t id;
+    boost::uint64_t offset;
+    boost::uint64_t size;
+
+    bool operator<(index_entry const& rhs) const
+    {
+        return id < rhs.id;
+    }
+};
+
+// reprojects every feature of the datasource into a new sidecar
+bool write_sidecar(std::string const& filename, std::string const& key, source_stamp const& stamp,
+                   datasource const& ds, proj_transform const& prj_trans)
+{
+    std::vector<index_entry> index;
+    std::string body;
+    featureset_ptr features = ds.features(query(ds.envelope()));
+    if (features)
+    {
+        feature_ptr feature;
+        while ((feature = features->next()))
+        {
+            reproject(*feature, prj_trans);
+            index_entry entry;
+            entry.id = feature->id();
+            entry.offset = body.size();
+            encode(*feature, body);
+            entry.size = body.size() - entry.offset;
+            index.push_back(entry);
+        }
+    }
+    std::stable_sort(index.begin(), index.end());
+
+    // renders from other processes may build the same sidecar, so every writer
+    // gets its own temporary name and the last complete rename wins
+    std::string tmp_filename = boost::filesystem::unique_path(filename + ".%%%%-%%%%-%%%%.tmp").string();
+    {
+        std::ofstream out(tmp_filename.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!out) return false;
+        std::string header(sidecar_magic, sizeof(sidecar_magic));
+        append(header, sidecar_format);
+        append(header, sidecar_byte_order);
+        append(header, stamp.size);
+        append(header, stamp.mtime);
+        append(header, static_cast<boost::uint32_t>(key.size()));
+        header.append(key);
+        append(header, static_cast<boost::uint64_t>(index.size()));
+        for (std::vector<index_entry>::const_iterator itr = index.begin(); itr != index.end(); ++itr)
+        {
+            append(header, itr->id);
+            append(header, itr->offset);
+            append(header, itr->size);
+        }
+        out.write(header.data(), header.size());
+        out.write(body.data(), body.size());
+        out.flush();
+        if (!out)
+        {
+            out.close();
+            std::remove(tmp_filename.c_str());
+            return false;
+        }
+    }
+    if (std::rename(tmp_filename.c_str(), filename.c_str()) != 0)
+    {
+        std::remove(tmp_filename.c_str());
+        return false;
+    }
+    return true;
+}
+
+reprojected_geometries_ptr open_sidecar(std::string const& filename, std::string const& key,
+                                        source_stamp const& stamp)
+{
+    boost::system::error_code ec;
+    if (!boost::filesystem::exists(filename, ec)) return reprojected_geometries_ptr();
+    try
+    {
+        boost::shared_ptr<file_geometries> geometries = boost::make_shared<file_geometries>(filename);
+        if (geometries->open(key, stamp)) return geometries;
+    }
+    catch (boost::interprocess::interprocess_exception const& ex)
+    {
+        MAPNIK_LOG_ERROR(reprojection_cache) << "reprojection_cache: could not map '" << filename << "': " << ex.what();
+    }
+    return reprojected_geometries_ptr();
+}
+
+}
+
+reprojection_cache::reprojection_cache() {}
+
+reprojection_cache::~reprojection_cache() {}
+
+reprojected_geometries_ptr reprojection_cache::get(layer const& lay, proj_transform const& prj_trans)
+{
+    if (lay.reprojection_cache() == REPROJECTION_CACHE_NONE || prj_trans.equal())
+    {
+        return reprojected_geometries_ptr();
+    }
+    datasource_ptr ds = lay.datasource();
+    if (!ds || ds->type() != datasource::Vector)
+    {
+        return reprojected_geometries_ptr();
+    }
+    std::string filename = data_file(ds->params());
+    if (filename.empty())
+    {
+        MAPNIK_LOG_DEBUG(reprojection_cache) << "reprojection_cache: layer '" << lay.name() << "' is not backed by a file, not caching";
+        return reprojected_geometries_ptr();
+    }
+    source_stamp stamp = stamp_of(filename);
+    std::string key = make_key(ds->params(), prj_trans);
+    std::string entry_key = key + (lay.reprojection_cache() == REPROJECTION_CACHE_FILE ? "file" : "memory");
+
+    {
+#ifdef MAPNIK_THREADSAFE
+        mutex::scoped_lock lock(mutex_);
+#endif
+        for (;;)
+        {
+            boost::unordered_map<std::string, entry>::const_iterator itr = entries_.find(entry_key);
+            if (itr != entries_.end() && itr->second.size == stamp.size && itr->second.mtime == stamp.mtime)
+            {
+                return itr->second.geometries;
+            }
+#ifdef MAPNIK_THREADSAFE
+            // another thread is building this entry, wait for it instead of building it twice
+            if (building_.find(entry_key) != building_.end())
+            {
+                built_.wait(lock);
+                continue;
+            }
+            building_.insert(entry_key);
+#endif
+            break;
+        }
+    }
+
+    // building a sidecar reprojects the whole datasource, so it runs unlocked
+    // and other layers keep using the cache meanwhile
+    entry e;
+    e.size = stamp.size;
+    e.mtime = stamp.mtime;
+    try
+    {
+        if (lay.reprojection_cache() == REPROJECTION_CACHE_FILE)
+        {
+            std::string sidecar = filename + "." + key_hash(key) + ".reproj";
+            e.geometries = open_sidecar(sidecar, key, stamp);
+            if (!e.geometries)
+            {
+                if (write_sidecar(sidecar, key, stamp, *ds, prj_trans))
+                {
+                    e.geometries = open_sidecar(sidecar, key, stamp);
+                }
+                else
+                {
+                    MAPNIK_LOG_ERROR(reprojection_cache) << "reprojection_cache: could not write '" << sidecar << "', caching in memory";
+                }
+            }
+        }
+        if (!e.geometries)
+        {
+            e.geometries = boost::make_shared<memory_geometries>();
+        }
+    }
+    catch (...)
+    {
+        publish(entry_key, 0);
+        throw;
+    }
+    publish(entry_key, &e);
+    return e.geometries;
+}
+
+void reprojection_cache::publish(std::string const& entry_key, entry const* e)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+    building_.erase(entry_key);
+    built_.notify_all();
+#endif
+    if (e)
+    {
+        entries_[entry_key] = *e;
+    }
+}
+
+std::size_t reprojection_cache::size() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    return entries_.size();
+}
+
+void reprojection_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    entries_.clear();
+}
+
+reprojected_featureset::reprojected_featureset(featureset_ptr const& fs,
+                                               reprojected_geometries_ptr const& geometries,
+                                               proj_transform const& prj_trans)
+    : fs_(fs),
+      geometries_(geometries),
+      prj_trans_(prj_trans) {}
+
+feature_ptr reprojected_featureset::next()
+{
+    feature_ptr feature = fs_->next();
+    if (feature && !geometries_->restore(*feature))
+    {
+        reproject(*feature, prj_trans_);
+        geometries_->store(*feature);
+    }
+    return feature;
+}
+
+}
@@ -745,6 +745,11 @@ void serialize_layer( ptree & map_node, const layer & layer, bool explicit_defau
         set_attr/*<bool>*/( layer_node, "cache-features", layer.cache_features() );
     }
 
+    if ( layer.reprojection_cache() != REPROJECTION_CACHE_NONE || explicit_defaults )
+    {
+        set_attr( layer_node, "reprojection-cache", layer.reprojection_cache() );
+    }
+
     if ( layer.group_by() != "" || explicit_defaults )
     {
         set_attr( layer_node, "group-by", layer.group_by() );
@@ -0,0 +1,172 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/text_shaping_cache.hpp>
+
+namespace mapnik
+{
+
+template <typename T>
+bool text_shaping_cache::lru_table<T>::find(std::string const& key, T & value)
+{
+    typename map_type::iterator itr = map_.find(key);
+    if (itr == map_.end())
+    {
+        return false;
+    }
+    // move to the front of the recently used list
+    order_.splice(order_.begin(), order_, itr->second.second);
+    value = itr->second.first;
+    return true;
+}
+
+template <typename T>
+std::size_t text_shaping_cache::lru_table<T>::insert(std::string const& key, T const& value, std::size_t max_entries)
+{
+    if (max_entries == 0)
+    {
+        return 0;
+    }
+    typename map_type::iterator itr = map_.find(key);
+    if (itr != map_.end())
+    {
+        itr->second.first = value;
+        order_.splice(order_.begin(), order_, itr->second.second);
+        return 0;
+    }
+    std::size_t evicted = trim(max_entries - 1);
+    order_.push_front(key);
+    map_.insert(std::make_pair(key, std::make_pair(value, order_.begin())));
+    return evicted;
+}
+
+template <typename T>
+std::size_t text_shaping_cache::lru_table<T>::trim(std::size_t max_entries)
+{
+    std::size_t evicted = 0;
+    while (map_.size() > max_entries)
+    {
+        map_.erase(order_.back());
+        order_.pop_back();
+        ++evicted;
+    }
+    return evicted;
+}
+
+text_shaping_cache::text_shaping_cache()
+    : shaped_(),
+      layouts_(),
+      max_entries_(10000)
+{
+    stats_ = stats();
+}
+
+text_shaping_cache::~text_shaping_cache() {}
+
+shaped_text_ptr text_shaping_cache::find_shaped(std::string const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    shaped_text_ptr text;
+    if (shaped_.find(key, text))
+    {
+        ++stats_.shaped_hits;
+    }
+    else
+    {
+        ++stats_.shaped_misses;
+    }
+    return text;
+}
+
+void text_shaping_cache::insert_shaped(std::string const& key, shaped_text_ptr const& text)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    stats_.evictions += shaped_.insert(key, text, max_entries_);
+}
+
+text_layout_ptr text_shaping_cache::find_layout(std::string const& key)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    text_layout_ptr layout;
+    if (layouts_.find(key, layout))
+    {
+        ++stats_.layout_hits;
+    }
+    else
+    {
+        ++stats_.layout_misses;
+    }
+    return layout;
+}
+
+void text_shaping_cache::insert_layout(std::string const& key, text_layout_ptr const& layout)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    stats_.evictions += layouts_.insert(key, layout, max_entries_);
+}
+
+void text_shaping_cache::set_max_entries(std::size_t max_entries)
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    max_entries_ = max_entries;
+    stats_.evictions += shaped_.trim(max_entries_);
+    stats_.evictions += layouts_.trim(max_entries_);
+}
+
+std::size_t text_shaping_cache::max_entries() const
+{
+    return max_entries_;
+}
+
+text_shaping_cache::stats text_shaping_cache::get_stats() const
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    stats result = stats_;
+    result.shaped_entries = shaped_.size();
+    result.layout_entries = layouts_.size();
+    return result;
+}
+
+void text_shaping_cache::clear()
+{
+#ifdef MAPNIK_THREADSAFE
+    mutex::scoped_lock lock(mutex_);
+#endif
+    shaped_.clear();
+    layouts_.clear();
+    stats_ = stats();
+}
+
+}
@@ -0,0 +1,196 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// mapnik
+#include <mapnik/well_known_srs.hpp>
+#include <mapnik/global.hpp>
+
+// boost
+#include <boost/algorithm/string.hpp>
+
+// stl
+#include <cmath>
+#include <cstdlib>
+#include <map>
+#include <vector>
+
+namespace mapnik {
+
+namespace {
+
+double const EARTH_RADIUS = 6378137.0;
+double const MAXEXTENT = M_PI * EARTH_RADIUS;
+double const MAXEXTENTby180 = MAXEXTENT / 180.0;
+double const M_PI_by2 = M_PI / 2.0;
+double const M_PIby360 = M_PI / 360.0;
+double const D2R = M_PI / 180.0;
+double const R2D = 180.0 / M_PI;
+double const MAXLAT = 85.0511;
+
+typedef std::map<std::string, std::string> proj_params;
+
+// splits "+key=value +flag" definitions, returns false on anything else
+bool parse_params(std::string const& srs, proj_params & params)
+{
+    std::vector<std::string> tokens;
+    boost::algorithm::split(tokens, srs, boost::algorithm::is_space(), boost::algorithm::token_compress_on);
+    for (std::vector<std::string>::const_iterator itr = tokens.begin(); itr != tokens.end(); ++itr)
+    {
+        if (itr->empty()) continue;
+        if ((*itr)[0] != '+') return false;
+        std::string::size_type eq = itr->find('=');
+        std::string key = itr->substr(1, eq == std::string::npos ? std::string::npos : eq - 1);
+        std::string value = eq == std::string::npos ? std::string() : itr->substr(eq + 1);
+        if (key.empty() || params.count(key)) return false;
+        params[key] = value;
+    }
+    return !params.empty();
+}
+
+bool has_number(proj_params const& params, std::string const& key, double expected, bool required)
+{
+    proj_params::const_iterator itr = params.find(key);
+    if (itr == params.end()) return !required;
+    char * end = 0;
+    double value = std::strtod(itr->second.c_str(), &end);
+    return end != itr->second.c_str() && *end == '\0' && value == expected;
+}
+
+bool has_value(proj_params const& params, std::string const& key, std::string const& expected)
+{
+    proj_params::const_iterator itr = params.find(key);
+    return itr != params.end() && boost::algorithm::iequals(itr->second, expected);
+}
+
+// parameters that do not change the coordinates of either definition
+bool is_harmless(std::string const& key)
+{
+    return key == "no_defs" || key == "wktext" || key == "over" || key == "type";
+}
+
+bool is_null_towgs84(std::string const& value)
+{
+    std::vector<std::string> parts;
+    boost::algorithm::split(parts, value, boost::algorithm::is_any_of(","));
+    for (std::vector<std::string>::const_iterator itr = parts.begin(); itr != parts.end(); ++itr)
+    {
+        char * end = 0;
+        double v = std::strtod(itr->c_str(), &end);
+        if (end == itr->c_str() || *end != '\0' || v != 0.0) return false;
+    }
+    return true;
+}
+
+boost::optional<well_known_srs_enum> classify_init(std::string const& init)
+{
+    std::string code = boost::algorithm::to_lower_copy(init);
+    if (code == "epsg:4326") return boost::optional<well_known_srs_enum>(WGS_84);
+    if (code == "epsg:3857" || code == "epsg:900913" || code == "epsg:3785")
+        return boost::optional<well_known_srs_enum>(G_MERC);
+    return boost::optional<well_known_srs_enum>();
+}
+
+bool is_wgs84_longlat(proj_params const& params)
+{
+    if (!has_value(params, "proj", "longlat") && !has_value(params, "proj", "latlong") &&
+        !has_value(params, "proj", "lonlat") && !has_value(params, "proj", "latlon"))
+        return false;
+    if (!has_value(params, "datum", "WGS84") && !has_value(params, "ellps", "WGS84"))
+        return false;
+    for (proj_params::const_iterator itr = params.begin(); itr != params.end(); ++itr)
+    {
+        std::string const& key = itr->first;
+        if (key == "proj" || is_harmless(key)) continue;
+        if ((key == "datum" || key == "ellps") && boost::algorithm::iequals(itr->second, "WGS84")) continue;
+        if (key == "towgs84" && is_null_towgs84(itr->second)) continue;
+        return false;
+    }
+    return true;
+}
+
+bool is_spherical_mercator(proj_params const& params)
+{
+    if (!has_value(params, "proj", "merc")) return false;
+    bool sphere = (has_number(params, "a", EARTH_RADIUS, true) && has_number(params, "b", EARTH_RADIUS, true)) ||
+        (has_number(params, "R", EARTH_RADIUS, true) && !params.count("a") && !params.count("b"));
+    if (!sphere) return false;
+    for (proj_params::const_iterator itr = params.begin(); itr != params.end(); ++itr)
+    {
+        std::string const& key = itr->first;
+        if (key == "proj" || key == "a" || key == "b" || key == "R" || is_harmless(key)) continue;
+        if ((key == "lat_ts" || key == "lon_0" || key == "x_0" || key == "y_0") &&
+            has_number(params, key, 0.0, true)) continue;
+        if ((key == "k" || key == "k_0") && has_number(params, key, 1.0, true)) continue;
+        if (key == "units" && itr->second == "m") continue;
+        if (key == "nadgrids" && itr->second == "@null") continue;
+        return false;
+    }
+    return true;
+}
+
+}
+
+boost::optional<well_known_srs_enum> is_well_known_srs(std::string const& srs)
+{
+    proj_params params;
+    if (!parse_params(srs, params)) return boost::optional<well_known_srs_enum>();
+
+    proj_params::const_iterator init = params.find("init");
+    if (init != params.end())
+    {
+        // anything besides harmless flags could override the init file
+        for (proj_params::const_iterator itr = params.begin(); itr != params.end(); ++itr)
+        {
+            if (itr != init && !is_harmless(itr->first)) return boost::optional<well_known_srs_enum>();
+        }
+        return classify_init(init->second);
+    }
+    if (is_wgs84_longlat(params)) return boost::optional<well_known_srs_enum>(WGS_84);
+    if (is_spherical_mercator(params)) return boost::optional<well_known_srs_enum>(G_MERC);
+    return boost::optional<well_known_srs_enum>();
+}
+
+bool lonlat2merc(double * x, double * y, int point_count, int offset)
+{
+    for (int i = 0; i < point_count; ++i, x += offset, y += offset)
+    {
+        double px = *x * MAXEXTENTby180;
+        double py = std::log(std::tan((90.0 + *y) * M_PIby360)) * R2D * MAXEXTENTby180;
+        *x = px > MAXEXTENT ? MAXEXTENT : (px < -MAXEXTENT ? -MAXEXTENT : px);
+        *y = py > MAXEXTENT ? MAXEXTENT : (py < -MAXEXTENT ? -MAXEXTENT : py);
+    }
+    return true;
+}
+
+bool merc2lonlat(double * x, double * y, int point_count, int offset)
+{
+    for (int i = 0; i < point_count; ++i, x += offset, y += offset)
+    {
+        double px = (*x / MAXEXTENT) * 180.0;
+        double py = R2D * (2.0 * std::atan(std::exp((*y / MAXEXTENT) * M_PI)) - M_PI_by2);
+        *x = px > 180.0 ? 180.0 : (px < -180.0 ? -180.0 : px);
+        *y = py > MAXLAT ? MAXLAT : (py < -MAXLAT ? -MAXLAT : py);
+    }
+    return true;
+}
+
+}
@@ -19,12 +19,10 @@
  * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
  *
  *****************************************************************************/
-
 // mapnik
 #include <mapnik/debug.hpp>
 #include <mapnik/global.hpp>
 #include <mapnik/wkb.hpp>
-#include <mapnik/coord_array.hpp>
 #include <mapnik/geom_util.hpp>
 #include <mapnik/feature.hpp>
 
@@ -32,11 +30,12 @@
 #include <boost/utility.hpp>
 #include <boost/format.hpp>
 
+// stl
+#include <cmath>
+
 namespace mapnik
 {
 
-typedef coord_array<coord2d> CoordinateArray;
-
 struct wkb_reader : boost::noncopyable
 {
 private:
@@ -75,6 +74,7 @@ public:
         : wkb_(wkb),
           size_(size),
           pos_(0),
+          byteOrder_(wkbNDR),
           format_(format)
     {
         // try to determine WKB format automatically
@@ -95,13 +95,13 @@ public:
         switch (format_)
         {
         case wkbSpatiaLite:
-            byteOrder_ = (wkbByteOrder) wkb_[1];
+            if (size_ >= 39) byteOrder_ = (wkbByteOrder) wkb_[1];
             pos_ = 39;
             break;
 
         case wkbGeneric:
         default:
-            byteOrder_ = (wkbByteOrder) wkb_[0];
+            if (size_ >= 1) byteOrder_ = (wkbByteOrder) wkb_[0];
             pos_ = 1;
             break;
         }
@@ -115,48 +115,49 @@ public:
 
     void read(boost::ptr_vector<geometry_type> & paths)
     {
+        if (!has(4)) return;
         int type = read_integer();
 
         switch (type)
         {
         case wkbPoint:
-            read_point(paths);
+            read_point(paths, 2);
             break;
         case wkbLineString:
-            read_linestring(paths);
+            read_linestring(paths, 2);
             break;
         case wkbPolygon:
-            read_polygon(paths);
+            read_polygon(paths, 2);
             break;
         case wkbMultiPoint:
-            read_multipoint(paths);
+            read_multi(paths, &wkb_reader::read_point, 2);
             break;
         case wkbMultiLineString:
-            read_multilinestring(paths);
+            read_multi(paths, &wkb_reader::read_linestring, 2);
             break;
         case wkbMultiPolygon:
-            read_multipolygon(paths);
+            read_multi(paths, &wkb_reader::read_polygon, 2);
             break;
         case wkbGeometryCollection:
             read_collection(paths);
             break;
         case wkbPointZ:
-            read_point_xyz(paths);
+            read_point(paths, 3);
             break;
         case wkbLineStringZ:
-            read_linestring_xyz(paths);
+            read_linestring(paths, 3);
             break;
         case wkbPolygonZ:
-            read_polygon_xyz(paths);
+            read_polygon(paths, 3);
             break;
         case wkbMultiPointZ:
-            read_multipoint_xyz(paths);
+            read_multi(paths, &wkb_reader::read_point, 3);
             break;
         case wkbMultiLineStringZ:
-            read_multilinestring_xyz(paths);
+            read_multi(paths, &wkb_reader::read_linestring, 3);
             break;
         case wkbMultiPolygonZ:
-            read_multipolygon_xyz(paths);
+            read_multi(paths, &wkb_reader::read_polygon, 3);
             break;
         case wkbGeometryCollectionZ:
             read_collection(paths);
@@ -168,6 +169,13 @@ public:
 
 private:
 
+    typedef void (wkb_reader::*part_reader)(boost::ptr_vector<geometry_type> &, unsigned);
+
+    bool has(std::size_t bytes) const
+    {
+        return pos_ <= size_ && bytes <= size_ - pos_;
+    }
+
     int read_integer()
     {
         boost::int32_t n;
@@ -200,200 +208,94 @@ private:
         return d;
     }
 
-    void read_coords(CoordinateArray& ar)
+    // Reads a count of items that are item_size bytes each. Counts that are
+    // negative or need more data than is left read as 0 and end the input,
+    // so every later read can skip its own bounds check.
+    unsigned read_count(std::size_t item_size)
     {
-        if (! needSwap_)
-        {
-            for (unsigned i = 0; i < ar.size(); ++i)
-            {
-                read_double_ndr(wkb_ + pos_, ar[i].x);
-                read_double_ndr(wkb_ + pos_ + 8, ar[i].y);
-                pos_ += 16; // skip XY
-            }
-        }
-        else
+        if (!has(4)) return 0;
+        int count = read_integer();
+        if (count <= 0) return 0;
+        if (!has(static_cast<std::size_t>(count) * item_size))
         {
-            for (unsigned i=0;i<ar.size();++i)
-            {
-                read_double_xdr(wkb_ + pos_, ar[i].x);
-                read_double_xdr(wkb_ + pos_ + 8, ar[i].y);
-                pos_ += 16; // skip XY
-            }
+            pos_ = size_;
+            return 0;
         }
+        return static_cast<unsigned>(count);
     }
 
-    void read_coords_xyz(CoordinateArray& ar)
+    // Appends num_points vertices of dims doubles each, the first with
+    // first_command and the others with command. Native XY coordinates are
+    // copied straight into the geometry's storage.
+    void read_vertices(geometry_type & geom, unsigned num_points, unsigned dims,
+                       CommandType first_command, CommandType command)
     {
-        if (! needSwap_)
+        unsigned start = geom.size();
+        if (!needSwap_ && dims == 2)
         {
-            for (unsigned i = 0; i < ar.size(); ++i)
-            {
-                read_double_ndr(wkb_ + pos_, ar[i].x);
-                read_double_ndr(wkb_ + pos_ + 8, ar[i].y);
-                pos_ += 24; // skip XYZ
-            }
+            geom.data().append_packed(wkb_ + pos_, num_points, command);
+            pos_ += num_points * 16;
         }
         else
         {
-            for (unsigned i = 0; i < ar.size(); ++i)
+            geom.reserve(start + num_points);
+            for (unsigned i = 0; i < num_points; ++i)
             {
-                read_double_xdr(wkb_ + pos_, ar[i].x);
-                read_double_xdr(wkb_ + pos_ + 8, ar[i].y);
-                pos_ += 24; // skip XYZ
+                double x = read_double();
+                double y = read_double();
+                pos_ += 8 * (dims - 2); // skip Z
+                geom.push_vertex(x, y, command);
             }
         }
+        geom.data().set_command(start, first_command);
     }
 
-
-    void read_point(boost::ptr_vector<geometry_type> & paths)
-    {
-        double x = read_double();
-        double y = read_double();
-        std::auto_ptr<geometry_type> pt(new geometry_type(Point));
-        pt->move_to(x, y);
-        paths.push_back(pt);
-    }
-
-    void read_multipoint(boost::ptr_vector<geometry_type> & paths)
+    void read_point(boost::ptr_vector<geometry_type> & paths, unsigned dims)
     {
-        int num_points = read_integer();
-        for (int i = 0; i < num_points; ++i)
+        if (!has(8 * dims))
         {
-            pos_ += 5;
-            read_point(paths);
+            pos_ = size_;
+            return;
         }
-    }
-
-    void read_point_xyz(boost::ptr_vector<geometry_type> & paths)
-    {
-        double x = read_double();
-        double y = read_double();
         std::auto_ptr<geometry_type> pt(new geometry_type(Point));
-        pos_ += 8; // double z = read_double();
-        pt->move_to(x, y);
+        read_vertices(*pt, 1, dims, SEG_MOVETO, SEG_MOVETO);
         paths.push_back(pt);
     }
 
-    void read_multipoint_xyz(boost::ptr_vector<geometry_type> & paths)
-    {
-        int num_points = read_integer();
-        for (int i = 0; i < num_points; ++i)
-        {
-            pos_ += 5;
-            read_point_xyz(paths);
-        }
-    }
-
-    void read_linestring(boost::ptr_vector<geometry_type> & paths)
-    {
-        int num_points = read_integer();
-        if (num_points > 0)
-        {
-            CoordinateArray ar(num_points);
-            read_coords(ar);
-            std::auto_ptr<geometry_type> line(new geometry_type(LineString));
-            line->move_to(ar[0].x, ar[0].y);
-            for (int i = 1; i < num_points; ++i)
-            {
-                line->line_to(ar[i].x, ar[i].y);
-            }
-            paths.push_back(line);
-        }
-    }
-
-    void read_multilinestring(boost::ptr_vector<geometry_type> & paths)
+    void read_linestring(boost::ptr_vector<geometry_type> & paths, unsigned dims)
     {
-        int num_lines = read_integer();
-        for (int i = 0; i < num_lines; ++i)
-        {
-            pos_ += 5;
-            read_linestring(paths);
-        }
-    }
-
-    void read_linestring_xyz(boost::ptr_vector<geometry_type> & paths)
-    {
-        int num_points = read_integer();
+        unsigned num_points = read_count(8 * dims);
         if (num_points > 0)
         {
-            CoordinateArray ar(num_points);
-            read_coords_xyz(ar);
             std::auto_ptr<geometry_type> line(new geometry_type(LineString));
-            line->move_to(ar[0].x, ar[0].y);
-            for (int i = 1; i < num_points; ++i)
-            {
-                line->line_to(ar[i].x, ar[i].y);
-            }
+            read_vertices(*line, num_points, dims, SEG_MOVETO, SEG_LINETO);
             paths.push_back(line);
         }
     }
 
-    void read_multilinestring_xyz(boost::ptr_vector<geometry_type> & paths)
-    {
-        int num_lines = read_integer();
-        for (int i = 0; i < num_lines; ++i)
-        {
-            pos_ += 5;
-            read_linestring_xyz(paths);
-        }
-    }
-
-
-    void read_polygon(boost::ptr_vector<geometry_type> & paths)
+    void read_polygon(boost::ptr_vector<geometry_type> & paths, unsigned dims)
     {
-        int num_rings = read_integer();
+        unsigned num_rings = read_count(4);
         if (num_rings > 0)
         {
             std::auto_ptr<geometry_type> poly(new geometry_type(Polygon));
-            for (int i = 0; i < num_rings; ++i)
+            for (unsigned i = 0; i < num_rings; ++i)
             {
-                int num_points = read_integer();
+                unsigned num_points = read_count(8 * dims);
                 if (num_points > 0)
                 {
-                    CoordinateArray ar(num_points);
-                    read_coords(ar);
-                    poly->move_to(ar[0].x, ar[0].y);
-                    for (int j = 1; j < num_points - 1; ++j)
+                    read_vertices(*poly, num_points, dims, SEG_MOVETO, SEG_LINETO);
+                    if (num_points > 1)
                     {
-                        poly->line_to(ar[j].x, ar[j].y);
+                        poly->data().set_command(poly->size() - 1, SEG_CLOSE);
                     }
-                    poly->close(ar[num_points-1].x, ar[num_points-1].y);
-                }
-            }
-            if (poly->size() > 2) // ignore if polygon has less than 3 vertices
-                paths.push_back(poly);
-        }
-    }
-
-    void read_multipolygon(boost::ptr_vector<geometry_type> & paths)
-    {
-        int num_polys = read_integer();
-        for (int i = 0; i < num_polys; ++i)
-        {
-            pos_ += 5;
-            read_polygon(paths);
-        }
-    }
-
-    void read_polygon_xyz(boost::ptr_vector<geometry_type> & paths)
-    {
-        int num_rings = read_integer();
-        if (num_rings > 0)
-        {
-            std::auto_ptr<geometry_type> poly(new geometry_type(Polygon));
-            for (int i = 0; i < num_rings; ++i)
-            {
-                int num_points = read_integer();
-                if (num_points > 0)
-                {
-                    CoordinateArray ar(num_points);
-                    read_coords_xyz(ar);
-                    poly->move_to(ar[0].x, ar[0].y);
-                    for (int j = 1; j < num_points - 1; ++j)
+                    else
                     {
-                        poly->line_to(ar[j].x, ar[j].y);
+                        // a single point ring still gets its closing vertex
+                        double x, y;
+                        poly->vertex(poly->size() - 1, &x, &y);
+                        poly->close(x, y);
                     }
-                    poly->close(ar[num_points-1].x, ar[num_points-1].y);
                 }
             }
             if (poly->size() > 2) // ignore if polygon has less than 3 vertices
@@ -401,20 +303,21 @@ private:
         }
     }
 
-    void read_multipolygon_xyz(boost::ptr_vector<geometry_type> & paths)
+    // parts of multi geometries repeat the byte order and type, which are skipped
+    void read_multi(boost::ptr_vector<geometry_type> & paths, part_reader read_part, unsigned dims)
     {
-        int num_polys = read_integer();
-        for (int i = 0; i < num_polys; ++i)
+        unsigned num_parts = read_count(5);
+        for (unsigned i = 0; i < num_parts && has(5); ++i)
         {
             pos_ += 5;
-            read_polygon_xyz(paths);
+            (this->*read_part)(paths, dims);
         }
     }
 
     void read_collection(boost::ptr_vector<geometry_type> & paths)
     {
-        int num_geometries = read_integer();
-        for (int i = 0; i < num_geometries; ++i)
+        unsigned num_geometries = read_count(5);
+        for (unsigned i = 0; i < num_geometries && has(1); ++i)
         {
             pos_ += 1; // skip byte order
             read(paths);
@@ -449,14 +352,235 @@ private:
 
 };
 
+/* Reader for Tiny WKB (https://github.com/TWKB/Specification). Every
+ * geometry starts with a type/precision byte and a metadata byte, followed
+ * by optional extended dimensions, size, bounding box and id list.
+ * Coordinates are zigzag varints, each a delta from the previous vertex
+ * and scaled by 10^precision. Only X and Y are kept.
+ */
+struct twkb_reader : boost::noncopyable
+{
+private:
+    enum twkbGeometryType {
+        twkbPoint=1,
+        twkbLineString=2,
+        twkbPolygon=3,
+        twkbMultiPoint=4,
+        twkbMultiLineString=5,
+        twkbMultiPolygon=6,
+        twkbGeometryCollection=7
+    };
+
+    enum twkbMetadata {
+        twkbHasBBox=0x01,
+        twkbHasSize=0x02,
+        twkbHasIdList=0x04,
+        twkbHasExtendedDims=0x08,
+        twkbIsEmpty=0x10
+    };
+
+    const char* twkb_;
+    unsigned size_;
+    unsigned pos_;
+    bool error_;
+    // state of the geometry being read
+    double factor_;
+    unsigned dims_;
+    boost::int64_t last_[4];
+
+public:
+    twkb_reader(const char* twkb, unsigned size)
+        : twkb_(twkb),
+          size_(size),
+          pos_(0),
+          error_(false),
+          factor_(1.0),
+          dims_(2) {}
+
+    void read(boost::ptr_vector<geometry_type> & paths)
+    {
+        if (pos_ + 2 > size_) return;
+        unsigned char type_precision = twkb_[pos_++];
+        unsigned char metadata = twkb_[pos_++];
+        unsigned type = type_precision & 0x0f;
+        factor_ = std::pow(10.0, -static_cast<double>(unzigzag(type_precision >> 4)));
+        dims_ = 2;
+        if (metadata & twkbHasExtendedDims)
+        {
+            if (pos_ >= size_) return;
+            unsigned char extended = twkb_[pos_++];
+            dims_ += (extended & 0x01) + ((extended >> 1) & 0x01);
+        }
+        if (metadata & twkbHasSize)
+        {
+            read_uvarint();
+        }
+        if (metadata & twkbHasBBox)
+        {
+            for (unsigned i = 0; i < 2 * dims_; ++i) read_uvarint();
+        }
+        if (metadata & twkbIsEmpty) return;
+        for (unsigned i = 0; i < 4; ++i) last_[i] = 0;
+
+        bool has_ids = (metadata & twkbHasIdList) != 0;
+        switch (type)
+        {
+        case twkbPoint:
+            read_point(paths);
+            break;
+        case twkbLineString:
+            read_linestring(paths);
+            break;
+        case twkbPolygon:
+            read_polygon(paths);
+            break;
+        case twkbMultiPoint:
+            read_multi(paths, &twkb_reader::read_point, has_ids);
+            break;
+        case twkbMultiLineString:
+            read_multi(paths, &twkb_reader::read_linestring, has_ids);
+            break;
+        case twkbMultiPolygon:
+            read_multi(paths, &twkb_reader::read_polygon, has_ids);
+            break;
+        case twkbGeometryCollection:
+        {
+            unsigned num_geometries = read_count();
+            skip_ids(has_ids, num_geometries);
+            for (unsigned i = 0; i < num_geometries && !error_; ++i)
+            {
+                read(paths);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
+private:
+    typedef void (twkb_reader::*part_reader)(boost::ptr_vector<geometry_type> &);
+
+    static boost::int64_t unzigzag(boost::uint64_t n)
+    {
+        return static_cast<boost::int64_t>(n >> 1) ^ -static_cast<boost::int64_t>(n & 1);
+    }
+
+    boost::uint64_t read_uvarint()
+    {
+        boost::uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (pos_ >= size_) break;
+            unsigned char byte = twkb_[pos_++];
+            value |= static_cast<boost::uint64_t>(byte & 0x7f) << shift;
+            if (!(byte & 0x80)) return value;
+        }
+        error_ = true;
+        return 0;
+    }
+
+    // every vertex takes at least one byte per dimension
+    unsigned read_count()
+    {
+        boost::uint64_t count = read_uvarint();
+        if (error_ || count > (size_ - pos_))
+        {
+            error_ = true;
+            return 0;
+        }
+        return static_cast<unsigned>(count);
+    }
+
+    void skip_ids(bool has_ids, unsigned count)
+    {
+        if (!has_ids) return;
+        for (unsigned i = 0; i < count && !error_; ++i) read_uvarint();
+    }
+
+    void read_vertices(geometry_type & geom, unsigned num_points,
+                       CommandType first_command, CommandType command)
+    {
+        geom.reserve(geom.size() + num_points);
+        for (unsigned i = 0; i < num_points && !error_; ++i)
+        {
+            for (unsigned d = 0; d < dims_; ++d)
+            {
+                last_[d] += unzigzag(read_uvarint());
+            }
+            geom.push_vertex(last_[0] * factor_, last_[1] * factor_, i == 0 ? first_command : command);
+        }
+    }
+
+    void read_point(boost::ptr_vector<geometry_type> & paths)
+    {
+        std::auto_ptr<geometry_type> pt(new geometry_type(Point));
+        read_vertices(*pt, 1, SEG_MOVETO, SEG_MOVETO);
+        if (!error_) paths.push_back(pt);
+    }
+
+    void read_linestring(boost::ptr_vector<geometry_type> & paths)
+    {
+        unsigned num_points = read_count();
+        if (num_points > 0)
+        {
+            std::auto_ptr<geometry_type> line(new geometry_type(LineString));
+            read_vertices(*line, num_points, SEG_MOVETO, SEG_LINETO);
+            if (!error_) paths.push_back(line);
+        }
+    }
+
+    void read_polygon(boost::ptr_vector<geometry_type> & paths)
+    {
+        unsigned num_rings = read_count();
+        if (num_rings > 0)
+        {
+            std::auto_ptr<geometry_type> poly(new geometry_type(Polygon));
+            for (unsigned i = 0; i < num_rings && !error_; ++i)
+            {
+                unsigned num_points = read_count();
+                if (num_points > 1)
+                {
+                    read_vertices(*poly, num_points, SEG_MOVETO, SEG_LINETO);
+                    poly->data().set_command(poly->size() - 1, SEG_CLOSE);
+                }
+                else if (num_points == 1)
+                {
+                    read_vertices(*poly, 1, SEG_MOVETO, SEG_MOVETO);
+                }
+            }
+            if (!error_ && poly->size() > 2) // ignore if polygon has less than 3 vertices
+                paths.push_back(poly);
+        }
+    }
+
+    void read_multi(boost::ptr_vector<geometry_type> & paths, part_reader read_part, bool has_ids)
+    {
+        unsigned num_parts = read_count();
+        skip_ids(has_ids, num_parts);
+        for (unsigned i = 0; i < num_parts && !error_; ++i)
+        {
+            (this->*read_part)(paths);
+        }
+    }
+};
+
 bool geometry_utils::from_wkb(boost::ptr_vector<geometry_type>& paths,
                                const char* wkb,
                                unsigned size,
                                wkbFormat format)
 {
     unsigned geom_count = paths.size();
-    wkb_reader reader(wkb, size, format);
-    reader.read(paths);
+    if (format == wkbTWKB)
+    {
+        twkb_reader reader(wkb, size);
+        reader.read(paths);
+    }
+    else
+    {
+        wkb_reader reader(wkb, size, format);
+        reader.read(paths);
+    }
     if (paths.size() > geom_count)
         return true;
     return false;
@@ -0,0 +1,99 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/geometry.hpp>
+#include <mapnik/building_extrusion.hpp>
+
+namespace {
+
+unsigned count(mapnik::building_extrusion::path const& path)
+{
+    unsigned n = 0;
+    double x, y;
+    path.rewind(0);
+    while (path.vertex(&x, &y) != mapnik::SEG_END) ++n;
+    return n;
+}
+
+}
+
+int main( int, char*[] )
+{
+    mapnik::building_extrusion extrusion;
+
+    // a 10x5 box, 2 high
+    mapnik::geometry_type box(mapnik::Polygon);
+    box.move_to(0, 0);
+    box.line_to(10, 0);
+    box.line_to(10, 5);
+    box.line_to(0, 5);
+    box.close(0, 0);
+    BOOST_TEST( extrusion.add(box, 2) );
+    BOOST_TEST_EQ( extrusion.size(), 1u );
+
+    // a quad per edge, the outline twice plus a vertical per edge, the top outline
+    mapnik::building_extrusion::path faces = extrusion.faces(0);
+    BOOST_TEST_EQ( count(faces), 16u );
+    BOOST_TEST_EQ( count(extrusion.frame(0)), 18u );
+    BOOST_TEST_EQ( count(extrusion.roof(0)), 5u );
+    BOOST_TEST_EQ( extrusion.vertices(), 34u );
+    BOOST_TEST( extrusion.extent(0) == mapnik::box2d<double>(0, 0, 10, 7) );
+
+    // faces come back to front: the edge along y=5 first
+    double x, y;
+    faces.rewind(0);
+    BOOST_TEST_EQ( faces.vertex(&x, &y), mapnik::SEG_MOVETO );
+    BOOST_TEST_EQ( y, 5 );
+    BOOST_TEST_EQ( faces.vertex(&x, &y), mapnik::SEG_LINETO );
+    BOOST_TEST_EQ( faces.vertex(&x, &y), mapnik::SEG_LINETO );
+    BOOST_TEST_EQ( faces.vertex(&x, &y), mapnik::SEG_LINETO );
+    BOOST_TEST_EQ( y, 7 );
+
+    // the roof is lifted by the height
+    mapnik::building_extrusion::path roof = extrusion.roof(0);
+    roof.rewind(0);
+    BOOST_TEST_EQ( roof.vertex(&x, &y), mapnik::SEG_MOVETO );
+    BOOST_TEST_EQ( x, 0 );
+    BOOST_TEST_EQ( y, 2 );
+
+    // a footprint too small to extrude is skipped
+    mapnik::geometry_type line(mapnik::LineString);
+    line.move_to(0, 0);
+    line.line_to(1, 1);
+    BOOST_TEST( !extrusion.add(line, 2) );
+    BOOST_TEST_EQ( extrusion.size(), 1u );
+    BOOST_TEST_EQ( extrusion.vertices(), 34u );
+
+    // buildings of a batch sort back to front, ties keep their order
+    mapnik::geometry_type north(mapnik::Polygon);
+    north.move_to(0, 20);
+    north.line_to(4, 20);
+    north.line_to(4, 24);
+    north.close(0, 20);
+    mapnik::geometry_type twin(mapnik::Polygon);
+    twin.move_to(20, 0);
+    twin.line_to(24, 0);
+    twin.line_to(24, 4);
+    twin.close(20, 0);
+    BOOST_TEST( extrusion.add(north, 1) );
+    BOOST_TEST( extrusion.add(twin, 1) );
+    extrusion.depth_sort();
+    BOOST_TEST_EQ( extrusion.size(), 3u );
+    BOOST_TEST_EQ( extrusion.extent(0).miny(), 20 );
+    BOOST_TEST_EQ( extrusion.extent(1).maxx(), 10 );
+    BOOST_TEST_EQ( extrusion.extent(2).maxx(), 24 );
+
+    // clearing keeps nothing but the storage
+    extrusion.clear();
+    BOOST_TEST( extrusion.empty() );
+    BOOST_TEST_EQ( extrusion.vertices(), 0u );
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ building extrusion: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,89 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <vector>
+#include <mapnik/geometry.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+
+namespace {
+
+// wgs84 -> merc goes through the built-in kernel so this does not need proj4
+std::string const wgs84_srs("+init=epsg:4326");
+std::string const merc_srs("+init=epsg:3857");
+
+// counts the vertices handed to it, block by block
+struct count_block
+{
+    explicit count_block(std::size_t & total)
+        : total_(total) {}
+
+    bool operator() (double *, unsigned count) const
+    {
+        total_ += count;
+        return true;
+    }
+
+    std::size_t & total_;
+};
+
+// reserves room for `reserved` vertices but only adds `count`, then checks the
+// whole-geometry transform against transforming each point on its own
+void check_reproject(mapnik::proj_transform const& tr, unsigned reserved, unsigned count)
+{
+    mapnik::geometry_type geom(mapnik::LineString);
+    geom.reserve(reserved);
+    std::vector<double> xs, ys;
+    for (unsigned i = 0; i < count; ++i)
+    {
+        double x = -170.0 + (i % 340);
+        double y = -80.0 + (i % 160);
+        if (i == 0) geom.move_to(x, y);
+        else geom.line_to(x, y);
+        double z = 0;
+        BOOST_TEST(tr.forward(x, y, z));
+        xs.push_back(x);
+        ys.push_back(y);
+    }
+    std::size_t visited = 0;
+    BOOST_TEST(geom.data().transform_blocks(count_block(visited)));
+    BOOST_TEST_EQ(visited, count);
+    BOOST_TEST(tr.forward(geom));
+    BOOST_TEST_EQ(geom.size(), count);
+    for (unsigned i = 0; i < count; ++i)
+    {
+        double x = 0, y = 0;
+        geom.vertex(i, &x, &y);
+        BOOST_TEST_EQ(x, xs[i]);
+        BOOST_TEST_EQ(y, ys[i]);
+    }
+}
+
+}
+
+int main( int, char*[] )
+{
+    mapnik::projection source(wgs84_srs);
+    mapnik::projection dest(merc_srs);
+    mapnik::proj_transform tr(source, dest);
+
+    // one vertex in the first of several reserved blocks
+    check_reproject(tr, 1000, 1);
+    // exactly one full block, with the next one reserved
+    check_reproject(tr, 1000, 256);
+    // one vertex spilling into the second block
+    check_reproject(tr, 1000, 257);
+    // nothing reserved up front
+    check_reproject(tr, 0, 600);
+    // reserved and empty
+    check_reproject(tr, 1000, 0);
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ geometry reproject: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
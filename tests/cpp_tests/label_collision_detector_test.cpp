@@ -0,0 +1,111 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <mapnik/box2d.hpp>
+#include <mapnik/timer.hpp>
+#include <mapnik/label_collision_detector.hpp>
+
+namespace {
+
+// places candidates in order on a cleared detector, returns how many fit
+std::size_t place_all(mapnik::label_collision_detector4 & detector,
+                      std::vector<mapnik::box2d<double> > const& candidates)
+{
+    detector.clear();
+    std::size_t placed = 0;
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (detector.has_placement(candidates[i]))
+        {
+            detector.insert(candidates[i]);
+            ++placed;
+        }
+    }
+    return placed;
+}
+
+}
+
+int main( int, char*[] )
+{
+    mapnik::box2d<double> extent(-64, -64, 256 + 64, 256 + 64);
+    mapnik::label_collision_detector4 detector(extent);
+
+    // basic collision semantics
+    mapnik::box2d<double> a(10, 10, 50, 20);
+    BOOST_TEST( detector.has_placement(a) );
+    detector.insert(a, UnicodeString("Main Street"));
+    BOOST_TEST( !detector.has_placement(mapnik::box2d<double>(40, 15, 80, 25)) );
+    BOOST_TEST( detector.has_placement(mapnik::box2d<double>(60, 10, 100, 20)) );
+
+    // same text repeated within distance is rejected, other text is not
+    mapnik::box2d<double> b(60, 10, 100, 20);
+    BOOST_TEST( !detector.has_placement(b, UnicodeString("Main Street"), 20) );
+    BOOST_TEST( detector.has_placement(b, UnicodeString("High Street"), 20) );
+    BOOST_TEST( !detector.has_point_placement(b, 20) );
+    BOOST_TEST( detector.has_point_placement(b, 5) );
+
+    // enumerating still sees every label
+    detector.insert(b, UnicodeString("High Street"));
+    unsigned count = 0;
+    for (mapnik::label_collision_detector4::query_iterator itr = detector.begin();
+         itr != detector.end(); ++itr)
+    {
+        ++count;
+    }
+    BOOST_TEST_EQ( count, 2u );
+
+    detector.clear();
+    BOOST_TEST( detector.has_placement(a) );
+    BOOST_TEST( detector.begin() == detector.end() );
+
+    // dense label placement against a brute force reference
+    std::srand(1);
+    std::vector<mapnik::box2d<double> > candidates;
+    for (unsigned i = 0; i < 20000; ++i)
+    {
+        double x = std::rand() % 320 - 32;
+        double y = std::rand() % 320 - 32;
+        candidates.push_back(mapnik::box2d<double>(x, y, x + 4 + std::rand() % 40, y + 4 + std::rand() % 12));
+    }
+    std::vector<mapnik::box2d<double> > reference;
+    for (std::size_t i = 0; i < candidates.size(); ++i)
+    {
+        bool free = true;
+        for (std::size_t j = 0; j < reference.size(); ++j)
+        {
+            if (reference[j].intersects(candidates[i]))
+            {
+                free = false;
+                break;
+            }
+        }
+        if (free) reference.push_back(candidates[i]);
+    }
+    // reusing the detector across tiles must match the reference on every pass
+    for (unsigned tile = 0; tile < 2; ++tile)
+    {
+        BOOST_TEST_EQ( place_all(detector, candidates), reference.size() );
+    }
+
+    // opt-in microbenchmark: the same placement for many tiles
+    if (std::getenv("MAPNIK_BENCHMARK"))
+    {
+        mapnik::progress_timer __stats__(std::clog, "label_collision_detector4: 50 tiles x 20000 candidates");
+        for (unsigned tile = 0; tile < 50; ++tile)
+        {
+            BOOST_TEST_EQ( place_all(detector, candidates), reference.size() );
+        }
+    }
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ label collision detector: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
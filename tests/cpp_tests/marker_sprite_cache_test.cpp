@@ -0,0 +1,98 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/marker.hpp>
+#include <mapnik/marker_cache.hpp>
+#include <mapnik/marker_sprite_cache.hpp>
+
+namespace {
+
+// the transform render_marker passes for a marker drawn at scale and angle
+agg::trans_affine marker_transform(mapnik::marker const& mark, double scale, double angle)
+{
+    mapnik::coord2d c = mark.bounding_box().center();
+    agg::trans_affine mtx = agg::trans_affine_translation(-c.x, -c.y);
+    mtx *= agg::trans_affine_rotation(angle);
+    mtx *= agg::trans_affine_scaling(scale);
+    return mtx;
+}
+
+}
+
+int main( int, char*[] )
+{
+    std::string const uri("shape://ellipse");
+    boost::optional<mapnik::marker_ptr> mark = mapnik::marker_cache::instance().find(uri, true);
+    BOOST_TEST(mark && *mark);
+    if (!mark || !*mark) return ::boost::report_errors();
+
+    mapnik::marker_sprite_cache & cache = mapnik::marker_sprite_cache::instance();
+    std::size_t default_bytes = cache.max_bytes();
+    cache.clear();
+
+    mapnik::marker_sprite_ptr sprite = cache.get(uri, **mark, marker_transform(**mark, 2.0, 0.0));
+    BOOST_TEST(sprite);
+    if (sprite)
+    {
+        // the sprite covers the marker and its anchor is inside it
+        BOOST_TEST(sprite->image.width() >= 20u);
+        BOOST_TEST(sprite->image.height() >= 20u);
+        BOOST_TEST(sprite->x < 0 && -sprite->x < int(sprite->image.width()));
+        BOOST_TEST(sprite->y < 0 && -sprite->y < int(sprite->image.height()));
+        unsigned center = sprite->image(-sprite->x, -sprite->y);
+        BOOST_TEST_EQ(center >> 24, 255u);
+        BOOST_TEST_EQ(sprite->image(0, 0), 0u);
+    }
+
+    // rotations within one step share the sprite, other sizes do not
+    BOOST_TEST(cache.get(uri, **mark, marker_transform(**mark, 2.0, 0.001)) == sprite);
+    mapnik::marker_sprite_ptr larger = cache.get(uri, **mark, marker_transform(**mark, 3.0, 0.0));
+    BOOST_TEST(larger && larger != sprite);
+
+    mapnik::marker_sprite_cache::stats stats = cache.get_stats();
+    BOOST_TEST_EQ(stats.hits, 1u);
+    BOOST_TEST_EQ(stats.misses, 2u);
+    BOOST_TEST_EQ(stats.entries, 2u);
+    if (sprite && larger)
+    {
+        BOOST_TEST_EQ(stats.bytes, 4u * (sprite->image.width() * sprite->image.height()
+                                         + larger->image.width() * larger->image.height()));
+        // shrinking the budget drops the least recently used sprite
+        cache.set_max_bytes(4u * larger->image.width() * larger->image.height());
+        stats = cache.get_stats();
+        BOOST_TEST_EQ(stats.entries, 1u);
+        BOOST_TEST_EQ(stats.evictions, 1u);
+        // and sprites larger than the cache are drawn but not kept
+        cache.set_max_bytes(16);
+        mapnik::marker_sprite_ptr uncached = cache.get(uri, **mark, marker_transform(**mark, 2.0, 0.0));
+        BOOST_TEST(uncached);
+        BOOST_TEST(uncached && uncached->image.width() == sprite->image.width());
+        BOOST_TEST_EQ(cache.get_stats().entries, 0u);
+        // which is what disabling the cache does to every sprite
+        cache.set_max_bytes(0);
+        BOOST_TEST(cache.get(uri, **mark, marker_transform(**mark, 3.0, 0.0)));
+        BOOST_TEST_EQ(cache.get_stats().entries, 0u);
+    }
+
+    cache.set_max_bytes(default_bytes);
+    cache.clear();
+
+    // a dense tile: the same icon at a few rotations is rasterized once each
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        cache.get(uri, **mark, marker_transform(**mark, 2.0, (i % 8) * 0.25));
+    }
+    stats = cache.get_stats();
+    BOOST_TEST_EQ(stats.misses, 8u);
+    BOOST_TEST_EQ(stats.entries, 8u);
+    cache.clear();
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ marker sprite cache: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,114 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/nvpr_path_buffer.hpp>
+#include "agg_path_storage.h"
+#include "agg_conv_stroke.h"
+
+int main( int, char*[] )
+{
+    mapnik::nvpr_path_buffer buffer;
+
+    agg::path_storage square;
+    square.move_to(0, 0);
+    square.line_to(10, 0);
+    square.line_to(10, 5);
+    square.line_to(0, 5);
+    square.close_polygon();
+    buffer.assign(square, square.total_vertices());
+
+    BOOST_TEST_EQ(buffer.num_commands(), 5);
+    BOOST_TEST_EQ(buffer.num_coords(), 8);
+    if (buffer.num_commands() == 5)
+    {
+        BOOST_TEST_EQ(buffer.commands()[0], GL_MOVE_TO_NV);
+        BOOST_TEST_EQ(buffer.commands()[3], GL_LINE_TO_NV);
+        BOOST_TEST_EQ(buffer.commands()[4], GL_CLOSE_PATH_NV);
+        BOOST_TEST_EQ(buffer.coords()[2], 10.0f);
+        BOOST_TEST_EQ(buffer.coords()[5], 5.0f);
+    }
+    BOOST_TEST(buffer.bounds() == mapnik::box2d<double>(0, 0, 10, 5));
+
+    // stroke outlines end their polygons with orientation flags
+    square.rewind(0);
+    agg::conv_stroke<agg::path_storage> stroke(square);
+    stroke.width(2.0);
+    stroke.rewind(0);
+    unsigned size = 0;
+    double x, y;
+    while (!agg::is_stop(stroke.vertex(&x, &y))) ++size;
+    stroke.rewind(0);
+    buffer.assign(stroke, size);
+    unsigned closes = 0;
+    for (GLsizei i = 0; i < buffer.num_commands(); ++i)
+    {
+        if (buffer.commands()[i] == GL_CLOSE_PATH_NV) ++closes;
+    }
+    BOOST_TEST_EQ(closes, 2u);
+    BOOST_TEST_EQ(buffer.num_coords(), 2 * (buffer.num_commands() - 2));
+    BOOST_TEST(buffer.bounds() == mapnik::box2d<double>(-1, -1, 11, 6));
+
+    // a smaller path reuses the storage of the larger one
+    std::size_t capacity = buffer.capacity();
+    GLfloat const* coords = buffer.coords();
+    square.rewind(0);
+    buffer.assign(square, square.total_vertices());
+    BOOST_TEST_EQ(buffer.capacity(), capacity);
+    BOOST_TEST(buffer.coords() == coords);
+    BOOST_TEST_EQ(buffer.num_commands(), 5);
+
+    // an empty path leaves nothing to draw
+    agg::path_storage empty;
+    buffer.assign(empty, empty.total_vertices());
+    BOOST_TEST_EQ(buffer.num_commands(), 0);
+    BOOST_TEST_EQ(buffer.num_coords(), 0);
+    BOOST_TEST(buffer.empty());
+
+    // a rule batch appends one path per feature into a single stream
+    buffer.clear();
+    square.rewind(0);
+    buffer.append(square, square.total_vertices());
+    buffer.append(empty, empty.total_vertices());
+    buffer.append(mapnik::box2d<double>(20, 20, 24, 26));
+    BOOST_TEST_EQ(buffer.size(), 2u);
+    BOOST_TEST_EQ(buffer.num_commands(), 10);
+    BOOST_TEST_EQ(buffer.num_coords(), 16);
+    if (buffer.size() == 2)
+    {
+        mapnik::nvpr_path_buffer::span const& first = buffer.path(0);
+        mapnik::nvpr_path_buffer::span const& quad = buffer.path(1);
+        BOOST_TEST_EQ(first.first_command, 0);
+        BOOST_TEST_EQ(first.num_commands, 5);
+        BOOST_TEST(first.bounds == mapnik::box2d<double>(0, 0, 10, 5));
+        BOOST_TEST_EQ(quad.first_command, 5);
+        BOOST_TEST_EQ(quad.num_commands, 5);
+        BOOST_TEST_EQ(quad.first_coord, 8);
+        BOOST_TEST_EQ(quad.num_coords, 8);
+        BOOST_TEST_EQ(buffer.commands()[quad.first_command], GL_MOVE_TO_NV);
+        BOOST_TEST_EQ(buffer.commands()[quad.first_command + 4], GL_CLOSE_PATH_NV);
+        BOOST_TEST_EQ(buffer.coords()[quad.first_coord + 4], 24.0f);
+        BOOST_TEST_EQ(buffer.coords()[quad.first_coord + 5], 26.0f);
+        BOOST_TEST(quad.bounds == mapnik::box2d<double>(20, 20, 24, 26));
+    }
+    BOOST_TEST(buffer.bounds() == mapnik::box2d<double>(0, 0, 24, 26));
+
+    // appending grows the stream without losing the paths before
+    for (unsigned i = 0; i < 1000; ++i)
+    {
+        buffer.append(mapnik::box2d<double>(i, i, i + 1, i + 1));
+    }
+    BOOST_TEST_EQ(buffer.size(), 1002u);
+    BOOST_TEST_EQ(buffer.num_commands(), 5010);
+    BOOST_TEST_EQ(buffer.coords()[2], 10.0f);
+    BOOST_TEST_EQ(buffer.path(1001).first_coord, 8008);
+    BOOST_TEST_EQ(buffer.coords()[8008], 999.0f);
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ nvpr path buffer: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
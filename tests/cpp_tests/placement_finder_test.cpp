@@ -0,0 +1,105 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <boost/make_shared.hpp>
+#include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <mapnik/datasource.hpp>
+#include <mapnik/feature.hpp>
+#include <mapnik/feature_factory.hpp>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/geometry.hpp>
+#include <mapnik/ctrans.hpp>
+#include <mapnik/timer.hpp>
+#include <mapnik/text_path.hpp>
+#include <mapnik/placement_finder.hpp>
+#include <mapnik/text_placements/dummy.hpp>
+
+
+int main( int, char*[] )
+{
+    mapnik::box2d<double> extent(0, 0, 4096, 4096);
+    mapnik::CoordTransform tr(4096, 4096, extent);
+
+    // a long, gently curving motorway across the whole map
+    mapnik::geometry_type line(mapnik::LineString);
+    for (unsigned i = 0; i <= 8000; ++i)
+    {
+        double x = 16 + i * 0.5;
+        double y = 2048 + 600 * std::sin(x / 400.0);
+        if (i == 0) line.move_to(x, y);
+        else line.line_to(x, y);
+    }
+    mapnik::projection proj("+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +no_defs");
+    mapnik::proj_transform prj_trans(proj, proj);
+    mapnik::PathType path(tr, line, prj_trans);
+
+    mapnik::text_placements_dummy placements;
+    placements.defaults.label_spacing = 100;
+    mapnik::text_placement_info_ptr pi = placements.get_placement_info(1.0);
+    BOOST_TEST( pi->next() );
+
+    // fixed glyph metrics, so no fonts are needed
+    UnicodeString text("Motorway M25 (Junction 10 - Junction 11)");
+    mapnik::string_info info(text);
+    for (int i = 0; i < text.length(); ++i)
+    {
+        mapnik::char_info ci(text[i], 7, 9, -2, 12);
+        ci.format = &pi->properties.format;
+        info.add_info(ci);
+    }
+
+    mapnik::context_ptr ctx = boost::make_shared<mapnik::context_type>();
+    mapnik::feature_ptr feature(mapnik::feature_factory::create(ctx, 1));
+    mapnik::DetectorType detector(extent);
+
+    std::size_t placed = 0;
+    {
+        mapnik::placement_finder<mapnik::DetectorType> finder(*feature, *pi, info, detector, extent);
+        finder.find_line_placements(path);
+        placed = finder.get_results().size();
+        BOOST_TEST( placed > 10 );
+        for (std::size_t i = 0; i < placed; ++i)
+        {
+            BOOST_TEST_EQ( finder.get_results()[i].num_nodes(), text.length() );
+        }
+    }
+
+    // the detector now blocks every candidate, which is the slow path for long lines
+    {
+        mapnik::placement_finder<mapnik::DetectorType> finder(*feature, *pi, info, detector, extent);
+        finder.find_line_placements(path);
+        BOOST_TEST_EQ( finder.get_results().size(), 0u );
+    }
+
+    // a cleared detector places the same labels again
+    {
+        detector.clear();
+        mapnik::placement_finder<mapnik::DetectorType> finder(*feature, *pi, info, detector, extent);
+        finder.find_line_placements(path);
+        BOOST_TEST_EQ( finder.get_results().size(), placed );
+    }
+
+    // opt-in microbenchmark: label the same motorway for many tiles
+    if (std::getenv("MAPNIK_BENCHMARK"))
+    {
+        mapnik::progress_timer __stats__(std::clog, "placement_finder: 100 x find_line_placements on 8000 vertices");
+        for (unsigned tile = 0; tile < 100; ++tile)
+        {
+            detector.clear();
+            mapnik::placement_finder<mapnik::DetectorType> finder(*feature, *pi, info, detector, extent);
+            finder.find_line_placements(path);
+            BOOST_TEST_EQ( finder.get_results().size(), placed );
+        }
+    }
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ placement finder: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
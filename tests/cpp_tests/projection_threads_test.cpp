@@ -0,0 +1,181 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <sstream>
+#include <vector>
+#include <cstdlib>
+#include <mapnik/projection.hpp>
+#include <mapnik/proj_transform.hpp>
+#include <mapnik/timer.hpp>
+
+#ifdef MAPNIK_THREADSAFE
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+#endif
+
+namespace {
+
+// utm is not one of the built-in kernels so this goes through proj4
+std::string const utm_srs("+proj=utm +zone=10 +datum=WGS84 +units=m +no_defs");
+std::string const wgs84_srs("+proj=longlat +ellps=WGS84 +datum=WGS84 +no_defs");
+
+std::size_t const point_count = 4096;
+
+void make_points(std::vector<double> & xs, std::vector<double> & ys)
+{
+    xs.resize(point_count);
+    ys.resize(point_count);
+    for (std::size_t i = 0; i < point_count; ++i)
+    {
+        xs[i] = 400000.0 + (i % 64) * 1000.0;
+        ys[i] = 4000000.0 + (i / 64) * 1000.0;
+    }
+}
+
+// each call builds its own projections, as a render thread does per layer
+void reproject(unsigned iterations, std::vector<double> * result, bool * ok)
+{
+    *ok = true;
+    for (unsigned n = 0; n < iterations; ++n)
+    {
+        mapnik::projection source(wgs84_srs);
+        mapnik::projection dest(utm_srs);
+        mapnik::proj_transform tr(source, dest);
+        std::vector<double> xs, ys;
+        make_points(xs, ys);
+        if (!tr.backward(&xs[0], &ys[0], 0, point_count))
+        {
+            *ok = false;
+            return;
+        }
+        if (result && n == 0)
+        {
+            result->assign(xs.begin(), xs.end());
+            result->insert(result->end(), ys.begin(), ys.end());
+        }
+    }
+}
+
+#ifdef MAPNIK_THREADSAFE
+// a transform built on the main thread and used by all of them, like a
+// map loaded once and rendered by workers
+void reproject_shared(mapnik::proj_transform const* tr, std::vector<double> * result, bool * ok)
+{
+    std::vector<double> xs, ys;
+    make_points(xs, ys);
+    *ok = tr->backward(&xs[0], &ys[0], 0, point_count);
+    result->assign(xs.begin(), xs.end());
+    result->insert(result->end(), ys.begin(), ys.end());
+}
+
+// returns the wall clock time taken, in milliseconds
+double run_threads(unsigned thread_count, unsigned iterations,
+                   std::vector<std::vector<double> > & results, std::vector<char> & ok)
+{
+    results.assign(thread_count, std::vector<double>());
+    bool * status = new bool[thread_count];
+    mapnik::timer t;
+    boost::thread_group threads;
+    for (unsigned i = 0; i < thread_count; ++i)
+    {
+        threads.create_thread(boost::bind(reproject, iterations, &results[i], &status[i]));
+    }
+    threads.join_all();
+    t.stop();
+    ok.assign(status, status + thread_count);
+    delete [] status;
+    return t.wall_clock_elapsed();
+}
+#endif
+
+}
+
+int main( int, char*[] )
+{
+    unsigned const iterations = 50;
+
+    std::vector<double> expected;
+    bool ok = false;
+    reproject(1, &expected, &ok);
+    BOOST_TEST(ok);
+    BOOST_TEST_EQ(expected.size(), point_count * 2);
+
+    // more definitions than a thread keeps handles for, then the first again
+    for (unsigned zone = 1; zone <= 60; ++zone)
+    {
+        std::ostringstream srs;
+        srs << "+proj=utm +zone=" << zone << " +datum=WGS84 +units=m +no_defs";
+        mapnik::projection source(wgs84_srs);
+        mapnik::projection dest(srs.str());
+        mapnik::proj_transform tr(source, dest);
+        double x = 500000.0, y = 4000000.0, z = 0.0;
+        BOOST_TEST(tr.backward(x, y, z));
+    }
+    {
+        std::vector<double> again;
+        reproject(1, &again, &ok);
+        BOOST_TEST(ok);
+        BOOST_TEST(again == expected);
+    }
+
+#ifdef MAPNIK_THREADSAFE
+    unsigned max_threads = boost::thread::hardware_concurrency();
+    if (max_threads < 2) max_threads = 2;
+    for (unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+    {
+        std::vector<std::vector<double> > results;
+        std::vector<char> status;
+        run_threads(thread_count, iterations, results, status);
+        for (unsigned i = 0; i < thread_count; ++i)
+        {
+            BOOST_TEST(status[i]);
+            BOOST_TEST(results[i] == expected);
+        }
+    }
+
+    // opt-in scaling benchmark: with no shared lock the work done per unit
+    // of time should grow with the thread count, up to the number of cores
+    if (std::getenv("MAPNIK_BENCHMARK"))
+    {
+        double base_ms = 0;
+        for (unsigned thread_count = 1; thread_count <= max_threads; thread_count *= 2)
+        {
+            std::vector<std::vector<double> > results;
+            std::vector<char> status;
+            double ms = run_threads(thread_count, iterations, results, status);
+            if (thread_count == 1) base_ms = ms;
+            std::clog << "  reprojection, " << thread_count << " thread(s): "
+                      << ms << "ms, " << (ms > 0 ? base_ms * thread_count / ms : 0) << "x throughput\n";
+        }
+    }
+
+    {
+        mapnik::projection source(wgs84_srs);
+        mapnik::projection dest(utm_srs);
+        mapnik::proj_transform tr(source, dest);
+        unsigned const thread_count = 4;
+        std::vector<std::vector<double> > results(thread_count);
+        bool status[thread_count];
+        boost::thread_group threads;
+        for (unsigned i = 0; i < thread_count; ++i)
+        {
+            threads.create_thread(boost::bind(reproject_shared, &tr, &results[i], &status[i]));
+        }
+        threads.join_all();
+        for (unsigned i = 0; i < thread_count; ++i)
+        {
+            BOOST_TEST(status[i]);
+            BOOST_TEST(results[i] == expected);
+        }
+    }
+#endif
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ projection threads: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -0,0 +1,93 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <iostream>
+#include <mapnik/stroke_outline.hpp>
+#include "agg_path_storage.h"
+#include "agg_conv_stroke.h"
+
+int main( int, char*[] )
+{
+    mapnik::stroke s(mapnik::color(0, 0, 0), 2.0);
+    s.set_line_cap(mapnik::ROUND_CAP);
+    s.set_line_join(mapnik::ROUND_JOIN);
+
+    mapnik::stroke_params params(s, 2.0);
+    BOOST_TEST_EQ( params.get_width(), 4.0 );
+    BOOST_TEST( params.get_line_cap() == mapnik::ROUND_CAP );
+    BOOST_TEST( !params.has_dash() );
+
+    agg::path_storage first;
+    first.move_to(0, 0);
+    first.line_to(10, 0);
+    first.line_to(10, 10);
+    agg::path_storage second;
+    second.move_to(20, 0);
+    second.line_to(30, 5);
+
+    // a batch strokes to the same outline as each path on its own
+    agg::path_storage expected;
+    agg::conv_stroke<agg::path_storage> single_first(first);
+    mapnik::set_join_caps(s, single_first);
+    single_first.width(4.0);
+    expected.concat_path(single_first);
+    agg::conv_stroke<agg::path_storage> single_second(second);
+    mapnik::set_join_caps(s, single_second);
+    single_second.width(4.0);
+    expected.concat_path(single_second);
+
+    mapnik::stroke_outline outline;
+    outline.setup(params);
+    outline.add_path(first);
+    outline.add_path(second);
+    BOOST_TEST_EQ( outline.size(), 5u );
+    agg::path_storage batch;
+    batch.concat_path(outline);
+
+    BOOST_TEST_EQ( batch.total_vertices(), expected.total_vertices() );
+    if (batch.total_vertices() == expected.total_vertices())
+    {
+        unsigned mismatches = 0;
+        for (unsigned i = 0; i < batch.total_vertices(); ++i)
+        {
+            double x0, y0, x1, y1;
+            if (batch.vertex(i, &x0, &y0) != expected.vertex(i, &x1, &y1) ||
+                x0 != x1 || y0 != y1)
+            {
+                ++mismatches;
+            }
+        }
+        BOOST_TEST_EQ( mismatches, 0u );
+    }
+
+    // dashes are scaled once and cut the line before it is stroked
+    s.add_dash(2.0, 3.0);
+    mapnik::stroke_params dashed(s, 2.0);
+    BOOST_TEST( dashed.has_dash() );
+    BOOST_TEST_EQ( dashed.get_dash_array()[0].first, 4.0 );
+    BOOST_TEST_EQ( dashed.get_dash_array()[0].second, 6.0 );
+    outline.setup(dashed);
+    BOOST_TEST_EQ( outline.size(), 0u );
+    agg::path_storage line;
+    line.move_to(0, 0);
+    line.line_to(20, 0);
+    outline.add_path(line);
+    unsigned moves = 0;
+    double x, y;
+    unsigned cmd;
+    outline.rewind(0);
+    while (!agg::is_stop(cmd = outline.vertex(&x, &y)))
+    {
+        if (agg::is_move_to(cmd)) ++moves;
+    }
+    // dashes at 0-4 and 10-14 of a 20 long line
+    BOOST_TEST_EQ( moves, 2u );
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ stroke outline: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
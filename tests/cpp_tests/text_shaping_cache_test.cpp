@@ -0,0 +1,80 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <boost/make_shared.hpp>
+#include <iostream>
+#include <mapnik/text_shaping_cache.hpp>
+
+namespace {
+
+mapnik::shaped_text_ptr make_text(unsigned c)
+{
+    boost::shared_ptr<mapnik::shaped_text> text = boost::make_shared<mapnik::shaped_text>();
+    text->glyphs.push_back(mapnik::char_info(c, 10, 8, -2, 12));
+    text->rtl = false;
+    return text;
+}
+
+}
+
+int main( int, char*[] )
+{
+    mapnik::text_shaping_cache & cache = mapnik::text_shaping_cache::instance();
+    std::size_t default_entries = cache.max_entries();
+    cache.clear();
+    cache.set_max_entries(2);
+
+    cache.insert_shaped("a", make_text('a'));
+    cache.insert_shaped("b", make_text('b'));
+    BOOST_TEST(cache.find_shaped("a"));
+    // "b" is now the least recently used entry
+    cache.insert_shaped("c", make_text('c'));
+    BOOST_TEST(!cache.find_shaped("b"));
+    mapnik::shaped_text_ptr a = cache.find_shaped("a");
+    BOOST_TEST(a);
+    if (a)
+    {
+        BOOST_TEST_EQ(a->glyphs.size(), 1u);
+        BOOST_TEST_EQ(a->glyphs[0].c, unsigned('a'));
+    }
+    BOOST_TEST(cache.find_shaped("c"));
+
+    mapnik::text_shaping_cache::stats stats = cache.get_stats();
+    BOOST_TEST_EQ(stats.shaped_hits, 3u);
+    BOOST_TEST_EQ(stats.shaped_misses, 1u);
+    BOOST_TEST_EQ(stats.shaped_entries, 2u);
+    BOOST_TEST_EQ(stats.evictions, 1u);
+
+    // layouts are kept apart from shaped text
+    boost::shared_ptr<mapnik::text_layout> layout = boost::make_shared<mapnik::text_layout>();
+    layout->line_breaks.push_back(5);
+    layout->line_sizes.push_back(std::make_pair(40.0, 12.0));
+    layout->width = 40.0;
+    layout->height = 12.0;
+    layout->first_line_space = 2.0;
+    cache.insert_layout("a", layout);
+    BOOST_TEST(cache.find_layout("a"));
+    BOOST_TEST(!cache.find_layout("b"));
+    BOOST_TEST_EQ(cache.get_stats().layout_entries, 1u);
+    BOOST_TEST_EQ(cache.get_stats().shaped_entries, 2u);
+
+    // shrinking evicts, zero disables caching
+    cache.set_max_entries(1);
+    BOOST_TEST_EQ(cache.get_stats().shaped_entries, 1u);
+    cache.set_max_entries(0);
+    cache.insert_shaped("d", make_text('d'));
+    BOOST_TEST(!cache.find_shaped("d"));
+    BOOST_TEST_EQ(cache.get_stats().shaped_entries, 0u);
+
+    cache.clear();
+    BOOST_TEST_EQ(cache.get_stats().shaped_hits, 0u);
+    cache.set_max_entries(default_entries);
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ text shaping cache: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
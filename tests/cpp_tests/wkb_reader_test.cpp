@@ -0,0 +1,193 @@
+#include <boost/version.hpp>
+#include <boost/detail/lightweight_test.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/cstdint.hpp>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <mapnik/geometry.hpp>
+#include <mapnik/timer.hpp>
+#include <mapnik/wkb.hpp>
+
+namespace {
+
+typedef boost::ptr_vector<mapnik::geometry_type> paths_type;
+
+bool little_endian()
+{
+    boost::uint16_t one = 1;
+    return *reinterpret_cast<unsigned char*>(&one) == 1;
+}
+
+// appends value in little (ndr) or big (xdr) endian order
+template <typename T>
+void put(std::vector<char> & out, T value, bool ndr)
+{
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &value, sizeof(T));
+    if (ndr != little_endian())
+    {
+        for (unsigned i = 0; i < sizeof(T) / 2; ++i)
+        {
+            std::swap(bytes[i], bytes[sizeof(T) - 1 - i]);
+        }
+    }
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// a closed ring of size points on a circle, with coordinates that survive
+// a round trip through 6 decimal places
+void make_ring(std::vector<double> & xs, std::vector<double> & ys, unsigned size)
+{
+    xs.clear();
+    ys.clear();
+    for (unsigned i = 0; i < size - 1; ++i)
+    {
+        double a = 2 * M_PI * i / (size - 1);
+        xs.push_back(std::floor(std::cos(a) * 1.0e8) / 1.0e6);
+        ys.push_back(std::floor(std::sin(a) * 1.0e8) / 1.0e6);
+    }
+    xs.push_back(xs[0]);
+    ys.push_back(ys[0]);
+}
+
+std::vector<char> polygon_wkb(std::vector<double> const& xs, std::vector<double> const& ys,
+                              bool ndr, bool with_z)
+{
+    std::vector<char> out;
+    out.push_back(ndr ? 1 : 0);
+    put<boost::int32_t>(out, with_z ? 1003 : 3, ndr);
+    put<boost::int32_t>(out, 1, ndr);
+    put<boost::int32_t>(out, xs.size(), ndr);
+    for (unsigned i = 0; i < xs.size(); ++i)
+    {
+        put(out, xs[i], ndr);
+        put(out, ys[i], ndr);
+        if (with_z) put(out, 42.0, ndr);
+    }
+    return out;
+}
+
+void put_varint(std::vector<char> & out, boost::uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+void put_zigzag(std::vector<char> & out, boost::int64_t value)
+{
+    put_varint(out, (static_cast<boost::uint64_t>(value) << 1) ^ static_cast<boost::uint64_t>(value >> 63));
+}
+
+std::vector<char> polygon_twkb(std::vector<double> const& xs, std::vector<double> const& ys)
+{
+    std::vector<char> out;
+    out.push_back(static_cast<char>(0x03 | (12 << 4))); // polygon, precision 6
+    out.push_back(0x00);
+    put_varint(out, 1);
+    put_varint(out, xs.size());
+    boost::int64_t last_x = 0, last_y = 0;
+    for (unsigned i = 0; i < xs.size(); ++i)
+    {
+        boost::int64_t x = static_cast<boost::int64_t>(std::floor(xs[i] * 1.0e6 + 0.5));
+        boost::int64_t y = static_cast<boost::int64_t>(std::floor(ys[i] * 1.0e6 + 0.5));
+        put_zigzag(out, x - last_x);
+        put_zigzag(out, y - last_y);
+        last_x = x;
+        last_y = y;
+    }
+    return out;
+}
+
+bool same_polygon(paths_type const& paths, std::vector<double> const& xs, std::vector<double> const& ys)
+{
+    if (paths.size() != 1 || paths[0].size() != xs.size()) return false;
+    for (unsigned i = 0; i < xs.size(); ++i)
+    {
+        double x, y;
+        unsigned cmd = paths[0].vertex(i, &x, &y);
+        unsigned expected = i == 0 ? mapnik::SEG_MOVETO
+            : (i == xs.size() - 1 ? mapnik::SEG_CLOSE : mapnik::SEG_LINETO);
+        if (cmd != expected || std::fabs(x - xs[i]) > 1e-9 || std::fabs(y - ys[i]) > 1e-9) return false;
+    }
+    return true;
+}
+
+void benchmark_decode(std::vector<char> const& wkb, mapnik::wkbFormat format,
+                      unsigned iterations, std::string const& name)
+{
+    mapnik::progress_timer __stats__(std::clog, name);
+    for (unsigned i = 0; i < iterations; ++i)
+    {
+        paths_type paths;
+        mapnik::geometry_utils::from_wkb(paths, &wkb[0], wkb.size(), format);
+    }
+}
+
+}
+
+int main( int, char*[] )
+{
+    std::vector<double> xs, ys;
+    make_ring(xs, ys, 100000);
+
+    std::vector<char> ndr = polygon_wkb(xs, ys, true, false);
+    std::vector<char> xdr = polygon_wkb(xs, ys, false, false);
+    std::vector<char> ndr_z = polygon_wkb(xs, ys, true, true);
+    std::vector<char> twkb = polygon_twkb(xs, ys);
+
+    {
+        paths_type paths;
+        BOOST_TEST(mapnik::geometry_utils::from_wkb(paths, &ndr[0], ndr.size(), mapnik::wkbGeneric));
+        BOOST_TEST(same_polygon(paths, xs, ys));
+    }
+    {
+        paths_type paths;
+        BOOST_TEST(mapnik::geometry_utils::from_wkb(paths, &xdr[0], xdr.size(), mapnik::wkbAuto));
+        BOOST_TEST(same_polygon(paths, xs, ys));
+    }
+    {
+        paths_type paths;
+        BOOST_TEST(mapnik::geometry_utils::from_wkb(paths, &ndr_z[0], ndr_z.size(), mapnik::wkbGeneric));
+        BOOST_TEST(same_polygon(paths, xs, ys));
+    }
+    {
+        paths_type paths;
+        BOOST_TEST(mapnik::geometry_utils::from_wkb(paths, &twkb[0], twkb.size(), mapnik::wkbTWKB));
+        BOOST_TEST(same_polygon(paths, xs, ys));
+    }
+
+    // truncated input decodes nothing rather than reading past the buffer
+    {
+        paths_type paths;
+        BOOST_TEST(!mapnik::geometry_utils::from_wkb(paths, &ndr[0], ndr.size() - 8, mapnik::wkbGeneric));
+        BOOST_TEST(!mapnik::geometry_utils::from_wkb(paths, &twkb[0], twkb.size() / 2, mapnik::wkbTWKB));
+        BOOST_TEST_EQ(paths.size(), 0u);
+    }
+
+    // opt-in microbenchmark: decode the 100000 vertex polygon in every encoding
+    if (std::getenv("MAPNIK_BENCHMARK"))
+    {
+        unsigned const iterations = 20;
+        benchmark_decode(ndr, mapnik::wkbGeneric, iterations, "wkb reader: 20 x ndr polygon, 100000 vertices");
+        benchmark_decode(xdr, mapnik::wkbGeneric, iterations, "wkb reader: 20 x xdr polygon, 100000 vertices");
+        benchmark_decode(ndr_z, mapnik::wkbGeneric, iterations, "wkb reader: 20 x ndr polygon z, 100000 vertices");
+        benchmark_decode(twkb, mapnik::wkbTWKB, iterations, "wkb reader: 20 x twkb polygon, 100000 vertices");
+    }
+
+    if (!::boost::detail::test_errors()) {
+        std::clog << "C++ wkb reader: \x1b[1;32m✓ \x1b[0m\n";
+#if BOOST_VERSION >= 104600
+        ::boost::detail::report_errors_remind().called_report_errors_function = true;
+#endif
+    } else {
+        return ::boost::report_errors();
+    }
+}
@@ -112,6 +112,17 @@ def test_compare_images():
     #b.save('/tmp/mapnik-comp-op-test-original-mask.png')
     #eq_(b.tostring(),expected_b.tostring(), '/tmp/mapnik-comp-op-test-original-mask.png is no longer equivalent to original mask: ./images/support/b.png')
 
+def test_transparent_source_is_noop():
+    # fully transparent source pixels must leave the destination alone
+    # for the separable modes, whatever the opacity
+    for name in ['src_over','dst_over','src_atop','xor','plus','multiply','screen','overlay','darken','lighten','difference','grain_merge']:
+        for opacity in [1.0,0.5]:
+            a = mapnik.Image.open('./images/support/a.png')
+            a.premultiply()
+            expected = a.tostring()
+            a.composite(mapnik.Image(a.width(),a.height()),getattr(mapnik.CompositeOp,name),opacity)
+            eq_(a.tostring(),expected,'%s with opacity %s modified the destination' % (name,opacity))
+
 def test_pre_multiply_status():
     b = mapnik.Image.open('./images/support/b.png')
     # not premultiplied yet, should appear that way
@@ -192,6 +203,19 @@ if 'shape' in mapnik.DatasourceCache.plugin_names():
         expected_im = mapnik.Image.open(expected)
         eq_(im.tostring(),expected_im.tostring(), 'failed comparing actual (%s) and expected (%s)' % (actual,'tests/python_tests/'+ expected))
 
+    def test_style_level_image_filters_threaded():
+        m = mapnik.Map(512,512)
+        mapnik.load_map(m,'../data/good_maps/style_level_opacity_and_blur.xml')
+        m.parameters.append(mapnik.Parameter('image-filter-threads',4))
+        m.zoom_all()
+        im = mapnik.Image(512,512)
+        mapnik.render(m,im)
+        actual = '/tmp/mapnik-style-level-opacity-threaded.png'
+        expected = 'images/support/mapnik-style-level-opacity.png'
+        im.save(actual)
+        expected_im = mapnik.Image.open(expected)
+        eq_(im.tostring(),expected_im.tostring(), 'failed comparing actual (%s) and expected (%s)' % (actual,'tests/python_tests/'+ expected))
+
 def test_rounding_and_color_expectations():
     m = mapnik.Map(1,1)
     m.background = mapnik.Color('rgba(255,255,255,.4999999)')
@@ -4,7 +4,7 @@
 from nose.tools import *
 from utilities import execution_path
 
-import os, mapnik
+import os, shutil, tempfile, mapnik
 
 def setup():
     # All of the paths used are relative, if we run the tests
@@ -52,6 +52,49 @@ if 'geojson' in mapnik.DatasourceCache.plugin_names():
         eq_(f['spaces'], u'this has spaces')
         eq_(f['description'], u'Test: \u005C')
 
+    def test_geojson_streaming_matches_cached():
+        tmp_dir = tempfile.mkdtemp()
+        try:
+            for name in ['points.json','lines.json','escaped.json']:
+                shutil.copy('../data/json/%s' % name, tmp_dir)
+                filename = os.path.join(tmp_dir,name)
+                cached = mapnik.Datasource(type='geojson',file=filename)
+                streamed = mapnik.Datasource(type='geojson',file=filename,cache_features=False)
+                eq_(os.path.exists(filename + '.index'),True)
+                # a second datasource reuses the index written by the first
+                reopened = mapnik.Datasource(type='geojson',file=filename,cache_features=False)
+                for ds in (streamed, reopened):
+                    eq_(str(ds.envelope()),str(cached.envelope()))
+                    eq_(ds.fields(),cached.fields())
+                    eq_(ds.describe()['geometry_type'],cached.describe()['geometry_type'])
+                    expected = sorted(cached.all_features(), key=lambda f: f.id())
+                    actual = sorted(ds.all_features(), key=lambda f: f.id())
+                    eq_(len(actual),len(expected))
+                    for f1, f2 in zip(expected, actual):
+                        eq_(f1.id(),f2.id())
+                        eq_(f1.attributes,f2.attributes)
+                        eq_(f1.geometries().to_wkt(),f2.geometries().to_wkt())
+        finally:
+            shutil.rmtree(tmp_dir)
+
+    def test_geojson_streaming_keys_missing_from_sample():
+        tmp_dir = tempfile.mkdtemp()
+        try:
+            # only the seventh feature has 'late', bind() samples the first five
+            features = ['{"type":"Feature","geometry":{"type":"Point","coordinates":[%d,0]},"properties":{"n":%d}}' % (i,i) for i in range(6)]
+            features.append('{"type":"Feature","geometry":{"type":"Point","coordinates":[6,0]},"properties":{"n":6,"late":"yes"}}')
+            filename = os.path.join(tmp_dir,'late.json')
+            open(filename,'w').write('{"type":"FeatureCollection","features":[%s]}' % ','.join(features))
+            ds = mapnik.Datasource(type='geojson',file=filename,cache_features=False)
+            eq_(ds.fields(),['n'])
+            for i in range(2):
+                features = sorted(ds.all_features(), key=lambda f: f.id())
+                eq_(len(features),7)
+                eq_(features[6]['late'],u'yes')
+                eq_(features[6]['n'],6)
+        finally:
+            shutil.rmtree(tmp_dir)
+
 #    @raises(RuntimeError)
     def test_that_nonexistant_query_field_throws(**kwargs):
         ds = mapnik.Datasource(type='geojson',file='../data/json/escaped.json')
@@ -0,0 +1,90 @@
+#!/usr/bin/env python
+# -*- coding: utf-8 -*-
+
+import sys
+import os, mapnik
+from timeit import Timer, time
+from nose.tools import *
+from utilities import execution_path
+
+try:
+    import json
+except ImportError:
+    import simplejson as json
+
+def setup():
+    # All of the paths used are relative, if we run the tests
+    # from another directory we need to chdir()
+    os.chdir(execution_path('.'))
+
+iterations = 10
+
+def create_grid(width,height):
+    # dense grid: many small polygons, one distinct key each
+    ds = mapnik.MemoryDatasource()
+    context = mapnik.Context()
+    context.push('Name')
+    fid = 1
+    step = 8
+    for y in range(0,height,step):
+        for x in range(0,width,step):
+            f = mapnik.Feature(context,fid)
+            f['Name'] = 'feature %d' % fid
+            f.add_geometries_from_wkt('POLYGON ((%d %d, %d %d, %d %d, %d %d, %d %d))' %
+                (x,y,x+step,y,x+step,y+step,x,y+step,x,y))
+            ds.add_feature(f)
+            fid += 1
+    s = mapnik.Style()
+    r = mapnik.Rule()
+    r.symbols.append(mapnik.PolygonSymbolizer())
+    s.rules.append(r)
+    lyr = mapnik.Layer('polygons')
+    lyr.datasource = ds
+    lyr.styles.append('polygons')
+    m = mapnik.Map(width,height)
+    m.append_style('polygons',s)
+    m.layers.append(lyr)
+    m.zoom_to_box(mapnik.Box2d(0,0,width,height))
+    grid = mapnik.Grid(width,height,key='Name')
+    mapnik.render_layer(m,grid,layer=0,fields=['Name'])
+    return grid
+
+def do_encoding():
+
+    results = {}
+    sortable = {}
+
+    def run(name, func):
+        t = Timer(func)
+        start = time.time()
+        set = t.repeat(iterations,1)
+        elapsed = (time.time() - start)
+        min_ = min(set)*1000
+        avg = (sum(set)/len(set))*1000
+        results[name] = [min_,avg,elapsed*1000,name,len(func())]
+        sortable[name] = [min_]
+
+    for size in [256,512]:
+        grid = create_grid(size,size)
+        for resolution in [1,4]:
+            def binding():
+                return json.dumps(grid.encode('utf',resolution=resolution))
+            def native():
+                return grid.encode_json(resolution=resolution)
+            run('binding %dpx res=%d' % (size,resolution), binding)
+            run('native %dpx res=%d' % (size,resolution), native)
+
+    for key, value in sorted(sortable.iteritems(), key=lambda (k,v): (v,k)):
+        s = results[key]
+        min_ = str(s[0])[:6]
+        avg = str(s[1])[:6]
+        elapsed = str(s[2])[:6]
+        name = s[3]
+        size = s[4]
+        print 'min: %sms | avg: %sms | total: %sms | len: %s <-- %s' % (min_,avg,elapsed,size,name)
+
+
+if __name__ == "__main__":
+    setup()
+    do_encoding()
+    [eval(run)() for run in dir() if 'test_' in run]
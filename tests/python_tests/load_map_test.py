@@ -54,6 +54,98 @@ def test_good_files():
     for file in good_files:
         yield assert_loads_successfully, file
 
+def assert_cached_load_matches(file):
+    cache = '/tmp/mapnik-load-map-cached-%s.bin' % os.path.basename(file)
+    if os.path.exists(cache):
+        os.unlink(cache)
+    m = mapnik.Map(512, 512)
+    try:
+        mapnik.load_map(m, file, True)
+    except RuntimeError, e:
+        # only test datasources that we have installed
+        if 'Could not create datasource' in str(e):
+            return
+        raise RuntimeError(e)
+    expected = mapnik.save_map_to_string(m)
+    # first load parses the XML and writes the cache, second load reads it
+    for i in range(2):
+        m2 = mapnik.Map(512, 512)
+        mapnik.load_map_cached(m2, file, cache, True)
+        eq_(mapnik.save_map_to_string(m2), expected)
+    eq_(os.path.exists(cache), True)
+    # a cache that is not a compiled stylesheet falls back to the XML
+    open(cache, 'wb').write('not a compiled stylesheet')
+    m3 = mapnik.Map(512, 512)
+    mapnik.load_map_cached(m3, file, cache, True)
+    eq_(mapnik.save_map_to_string(m3), expected)
+    os.unlink(cache)
+
+def assert_threaded_load_matches(file):
+    def load(threads):
+        m = mapnik.Map(512, 512)
+        m.parameters.append(mapnik.Parameter('load-threads', threads))
+        try:
+            mapnik.load_map(m, file, True)
+        except RuntimeError, e:
+            return str(e)
+        return mapnik.save_map_to_string(m)
+    eq_(load(4), load(1))
+
+def test_threaded_loading():
+    files = glob.glob("../data/good_maps/*.xml") + glob.glob("../data/broken_maps/*.xml")
+
+    for file in files:
+        yield assert_threaded_load_matches, file
+
+def test_threaded_load_reports_first_failure():
+    # the layer's datasource fails before the broken style after it is parsed
+    xml = """<Map srs="+proj=latlong +datum=WGS84">
+      <Layer name="first">
+        <Datasource><Parameter name="type">no-such-plugin</Parameter></Datasource>
+      </Layer>
+      <Style name="broken"><Rule><MaxScaleDenominator>not a number</MaxScaleDenominator></Rule></Style>
+    </Map>"""
+    def load(threads):
+        m = mapnik.Map(256, 256)
+        m.parameters.append(mapnik.Parameter('load-threads', threads))
+        try:
+            mapnik.load_map_from_string(m, xml, True)
+        except RuntimeError, e:
+            return str(e)
+        return None
+    serial = load(1)
+    ok_(serial is not None and 'no-such-plugin' in serial)
+    eq_(load(4), serial)
+
+def test_cached_files():
+    good_files = glob.glob("../data/good_maps/*.xml")
+
+    for file in good_files:
+        yield assert_cached_load_matches, file
+
+def test_cached_load_notices_changed_entity():
+    base = '/tmp/mapnik-load-map-cached-entity'
+    if not os.path.exists(base):
+        os.makedirs(base)
+    stylesheet = os.path.join(base, 'map.xml')
+    entity = os.path.join(base, 'styles.ent')
+    cache = os.path.join(base, 'map.bin')
+    open(stylesheet, 'w').write('<!DOCTYPE Map [ <!ENTITY styles SYSTEM "styles.ent"> ]>\n'
+                                '<Map srs="+proj=latlong +datum=WGS84">&styles;</Map>\n')
+    open(entity, 'w').write('<Style name="a"/>')
+    if os.path.exists(cache):
+        os.unlink(cache)
+    m = mapnik.Map(256, 256)
+    mapnik.load_map_cached(m, stylesheet, cache)
+    ok_('name="a"' in mapnik.save_map_to_string(m))
+    # only the entity changes, the stylesheet itself keeps its size and mtime
+    open(entity, 'w').write('<Style name="bb"/>')
+    m2 = mapnik.Map(256, 256)
+    mapnik.load_map_cached(m2, stylesheet, cache)
+    ok_('name="bb"' in mapnik.save_map_to_string(m2))
+    for f in (stylesheet, entity, cache):
+        os.unlink(f)
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
@@ -61,6 +61,44 @@ if 'ogr' in mapnik.DatasourceCache.plugin_names():
         fs = ds.all_features()
         eq_(len(fs),1)
 
+    def test_ogr_index_is_built_and_matches_unindexed_reads():
+        index = '../data/json/points.ogrindex'
+        if os.path.exists(index):
+            os.unlink(index)
+        ds = mapnik.Ogr(file='../data/json/points.json',layer_by_index=0,auto_index=False)
+        eq_(os.path.exists(index),False)
+        query = mapnik.Query(mapnik.Box2d(-1,-1,4,6))
+        query.add_property_name('label')
+        expected = [str(f) for f in ds.features(query).features]
+        eq_(len(expected),3)
+        # a small batch size exercises reads spanning several batches
+        ds = mapnik.Ogr(file='../data/json/points.json',layer_by_index=0,batch_size=1)
+        eq_(os.path.exists(index),True)
+        eq_([str(f) for f in ds.features(query).features],expected)
+        eq_(len(ds.all_features()),5)
+        os.unlink(index)
+
+    def test_ogr_index_from_the_same_second_as_the_data_is_rebuilt():
+        index = '../data/json/points.ogrindex'
+        data = '../data/json/points.json'
+        if os.path.exists(index):
+            os.unlink(index)
+        mapnik.Ogr(file=data,layer_by_index=0)
+        eq_(os.path.exists(index),True)
+        data_time = int(os.path.getmtime(data))
+        os.utime(index,(data_time,data_time))
+        ds = mapnik.Ogr(file=data,layer_by_index=0)
+        ok_(int(os.path.getmtime(index)) > data_time)
+        eq_(len(ds.all_features()),5)
+        os.unlink(index)
+
+    def test_ogr_features_carry_queried_fields():
+        ds = mapnik.Ogr(file='../data/json/points.json',layer_by_index=0,auto_index=False)
+        eq_(len(ds.fields()),3)
+        f = ds.all_features(fields=['label'])[0]
+        eq_(f['label'],u'0,0')
+        eq_(f.has_key('x'),False)
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
@@ -41,6 +41,31 @@ if 'osm' in mapnik.DatasourceCache.plugin_names():
         fs = ds.features(query)
 
 
+    def test_osm_pbf():
+        ds = mapnik.Osm(file='../data/osm/city.osm.pbf')
+        e = ds.envelope()
+        assert_almost_equal(e.minx,2.3)
+        assert_almost_equal(e.miny,48.8)
+        assert_almost_equal(e.maxx,2.4)
+        assert_almost_equal(e.maxy,48.9)
+        eq_(ds.fields(),['amenity', 'building', 'highway', 'name', 'natural'])
+        features = ds.all_features()
+        # tagged nodes, then ways
+        eq_([f.id() for f in features],[3,6,10,11])
+        eq_(features[0]['name'],u'Café')
+        eq_(features[1]['natural'],'tree')
+        eq_(features[1]['name'],'')
+        eq_(features[2]['building'],'yes')
+        eq_(features[2].geometries()[0].type(),mapnik.DataGeometryType.Polygon)
+        eq_(features[3]['name'],'Main St')
+        # node 99 is not in the extract
+        eq_(len(features[3].geometries()[0]),3)
+
+    def test_osm_pbf_spatial_filter():
+        ds = mapnik.Osm(file='../data/osm/city.osm.pbf')
+        fs = ds.features(mapnik.Query(mapnik.Box2d(2.365,48.865,2.39,48.89)))
+        eq_([f.id() for f in fs],[6,11])
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
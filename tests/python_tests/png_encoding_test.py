@@ -132,6 +132,22 @@ def test_transparency_levels_aerial():
     eq_(len(im.tostring('png')),len(im_in.tostring('png')))
     eq_(len(im.tostring('png:t=0')),len(im_in.tostring('png:t=0')))
 
+def test_parallel_encoding_matches_serial():
+    im = mapnik.Image.open('../data/images/12_654_1580.png')
+    for format in ['png','png:t=0','png:z=1','png:s=rle']:
+        serial = os.path.join(tmp_dir,'aerial-serial.png')
+        parallel = os.path.join(tmp_dir,'aerial-parallel.png')
+        im.save(serial,format)
+        im.save(parallel,format + ':p=4')
+        eq_(mapnik.Image.open(parallel).tostring(),
+            mapnik.Image.open(serial).tostring(),
+            '%s with p=4 does not decode to the same pixels' % format)
+
+@raises(RuntimeError)
+def test_parallel_encoding_rejects_miniz():
+    im = mapnik.Image(256,256)
+    im.tostring('png:e=miniz:p=4')
+
 
 if __name__ == "__main__":
     setup()
@@ -46,5 +46,28 @@ def test_wgs84_inverse_forward():
     assert_almost_equal(e.forward(p).center().y, e.center().y)
     assert_almost_equal(e.forward(p).center().x, e.center().x)
 
+# web mercator spelled out in full is recognised like its epsg code
+def test_wgs84_to_merc_equivalent_definitions():
+    wgs84 = mapnik.Projection('+init=epsg:4326')
+    merc_codes = ['+init=epsg:3857', '+init=epsg:900913',
+        '+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs +over']
+    c = mapnik.Coord(-122.4194, 37.7749)
+    for code in merc_codes:
+        tr = mapnik.ProjTransform(wgs84, mapnik.Projection(code))
+        merc = tr.forward(c)
+        assert_almost_equal(merc.x, -13627665.27, places=1)
+        assert_almost_equal(merc.y, 4547675.35, places=1)
+        back = tr.backward(merc)
+        assert_almost_equal(back.x, c.x)
+        assert_almost_equal(back.y, c.y)
+
+def test_equivalent_merc_definitions_are_equal():
+    a = mapnik.Projection('+init=epsg:3857')
+    b = mapnik.Projection('+proj=merc +a=6378137 +b=6378137 +lat_ts=0.0 +lon_0=0.0 +x_0=0.0 +y_0=0 +k=1.0 +units=m +nadgrids=@null +wktext +no_defs +over')
+    tr = mapnik.ProjTransform(a, b)
+    c = mapnik.Coord(-13627665.27, 4547675.35)
+    eq_(tr.forward(c).x, c.x)
+    eq_(tr.forward(c).y, c.y)
+
 if __name__ == "__main__":
     [eval(run)() for run in dir() if 'test_' in run]
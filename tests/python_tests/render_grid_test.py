@@ -196,6 +196,60 @@ grid_feat_id2 = {"data": {"1": {"Name": "South East"}, "2": {"Name": "South West
 
 grid_feat_id3 = {"data": {"1": {"Name": "South East", "__id__": 1}, "2": {"Name": "South West", "__id__": 2}, "3": {"Name": "North West", "__id__": 3}, "4": {"Name": "North East", "__id__": 4}}, "grid": ["                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "          !!                                  ##                ", "         !!!                                 ###                ", "          !!                                  ##                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "          $$                                  %%                ", "         $$$                                  %%                ", "          $                                   %%                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                ", "                                                                "], "keys": ["", "3", "4", "2", "1"]}
 
+def test_native_json_encoding():
+    width,height = 256,256
+    sym = mapnik.MarkersSymbolizer()
+    sym.width = mapnik.Expression('10')
+    sym.height = mapnik.Expression('10')
+    m = create_grid_map(width,height,sym)
+    ul_lonlat = mapnik.Coord(142.30,-38.20)
+    lr_lonlat = mapnik.Coord(143.40,-38.80)
+    m.zoom_to_box(mapnik.Box2d(ul_lonlat,lr_lonlat))
+    grid = mapnik.Grid(m.width,m.height,key='Name')
+    mapnik.render_layer(m,grid,layer=0,fields=['Name'])
+    for resolution in [1,2,4]:
+        utf1 = grid.encode('utf',resolution=resolution)
+        utf2 = json.loads(grid.encode_json(resolution=resolution))
+        eq_(utf2,utf1,show_grids('native-json-%d' % resolution,utf2,utf1))
+        utf3 = json.loads(grid.view(0,0,width,height).encode_json(resolution=resolution))
+        eq_(utf3,utf1)
+    utf4 = json.loads(grid.encode_json(features=False))
+    eq_(utf4['data'],{})
+    eq_(utf4['keys'],grid.encode('utf',features=False)['keys'])
+
+def test_render_grid_native_resolution():
+    """ render directly into a reduced resolution grid """
+    width,height = 256,256
+    sym = mapnik.MarkersSymbolizer()
+    sym.width = mapnik.Expression('10')
+    sym.height = mapnik.Expression('10')
+    m = create_grid_map(width,height,sym)
+    ul_lonlat = mapnik.Coord(142.30,-38.20)
+    lr_lonlat = mapnik.Coord(143.40,-38.80)
+    m.zoom_to_box(mapnik.Box2d(ul_lonlat,lr_lonlat))
+    # full resolution grid, resampled on encode
+    grid = mapnik.Grid(m.width,m.height,key='Name')
+    mapnik.render_layer(m,grid,layer=0,fields=['Name'])
+    utf1 = grid.encode('utf',resolution=4)
+    # grid rendered at 1/4 resolution needs no resampling
+    grid2 = mapnik.Grid(m.width/4,m.height/4,key='Name',resolution=4)
+    mapnik.render_layer(m,grid2,layer=0,fields=['Name'])
+    utf2 = grid2.encode('utf',resolution=4)
+    eq_(len(utf2['grid']),len(utf1['grid']))
+    eq_(len(utf2['grid'][0]),len(utf1['grid'][0]))
+    eq_(utf2['keys'],utf1['keys'])
+    eq_(utf2['data'],utf1['data'])
+    eq_(json.loads(grid2.encode_json(resolution=4)),utf2)
+    eq_(resolve(utf2,0,0),None)
+    eq_(resolve(utf2,25,10),{"Name": "North West"})
+    eq_(resolve(utf2,25,46),{"Name": "North East"})
+    eq_(resolve(utf2,38,10),{"Name": "South West"})
+    eq_(resolve(utf2,38,46),{"Name": "South East"})
+    # coarser encodings still sample the reduced grid
+    utf3 = grid2.encode('utf',resolution=8)
+    eq_(len(utf3['grid']),height/8)
+    eq_(utf3['keys'],grid.encode('utf',resolution=8)['keys'])
+
 def test_render_grid3():
     """ test using feature id"""
     width,height = 256,256
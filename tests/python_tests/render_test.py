@@ -147,6 +147,24 @@ def test_render_points():
         num_points_rendered = svg.count('<image ')
         eq_(num_points_present, num_points_rendered, "Not all points were rendered (%d instead of %d) at projection %s" % (num_points_rendered, num_points_present, projdescr)) 
 
+def test_render_metatile():
+    m = mapnik.Map(512, 512)
+    m.background = mapnik.Color('steelblue')
+    m.zoom_to_box(mapnik.Box2d(-180,-90,180,90))
+    im = mapnik.Image(m.width, m.height)
+    mapnik.render(m, im)
+    tiles = mapnik.render_metatile(m, 2, 256, 'png')
+    eq_(len(tiles), 4)
+    for y in range(2):
+        for x in range(2):
+            expected = im.view(x * 256, y * 256, 256, 256).tostring('png')
+            eq_(tiles[y * 2 + x], expected)
+
+@raises(RuntimeError)
+def test_render_metatile_size_mismatch():
+    m = mapnik.Map(256, 256)
+    mapnik.render_metatile(m, 2, 256, 'png')
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
@@ -1,5 +1,7 @@
 #coding=utf8
 import os
+import shutil
+import tempfile
 import mapnik
 from utilities import execution_path
 from nose.tools import *
@@ -84,6 +86,57 @@ if 'shape' in mapnik.DatasourceCache.plugin_names():
         expected_im = mapnik.Image.open(expected)
         eq_(im.tostring(),expected_im.tostring(), 'failed comparing actual (%s) and expected (%s)' % (actual,'tests/python_tests/'+ expected))
 
+    def render_world(reprojection_cache):
+        m = mapnik.Map(256,256)
+        mapnik.load_map(m,'../data/good_maps/wgs842merc_reprojection.xml')
+        m.layers[0].reprojection_cache = reprojection_cache
+        m.zoom_to_box(mapnik.Box2d(-20037508.34,-20037508.34,20037508.34,20037508.34))
+        im = mapnik.Image(256,256)
+        mapnik.render(m,im)
+        return im.tostring()
+
+    def test_reprojection_cache_matches_uncached_rendering():
+        expected = render_world(mapnik.reprojection_cache.NONE)
+        # the second render of each is served from the cache
+        for i in range(2):
+            eq_(render_world(mapnik.reprojection_cache.MEMORY),expected)
+
+    def test_reprojection_cache_sidecar():
+        tmp_dir = tempfile.mkdtemp()
+        try:
+            for ext in ['shp','shx','dbf']:
+                shutil.copy('../data/shp/ne_110m_admin_0_countries.%s' % ext, tmp_dir)
+            m = mapnik.Map(256,256,'+init=epsg:3857')
+            s = mapnik.Style()
+            r = mapnik.Rule()
+            r.symbols.append(mapnik.PolygonSymbolizer(mapnik.Color('green')))
+            s.rules.append(r)
+            m.append_style('style',s)
+            lyr = mapnik.Layer('world','+init=epsg:4326')
+            lyr.datasource = mapnik.Shapefile(file=os.path.join(tmp_dir,'ne_110m_admin_0_countries.shp'))
+            lyr.styles.append('style')
+            m.layers.append(lyr)
+            m.zoom_to_box(mapnik.Box2d(-20037508.34,-20037508.34,20037508.34,20037508.34))
+            im = mapnik.Image(256,256)
+            mapnik.render(m,im)
+            expected = im.tostring()
+
+            m.layers[0].reprojection_cache = mapnik.reprojection_cache.FILE
+            for i in range(2):
+                im = mapnik.Image(256,256)
+                mapnik.render(m,im)
+                eq_(im.tostring(),expected)
+            sidecars = [f for f in os.listdir(tmp_dir) if f.endswith('.reproj')]
+            eq_(len(sidecars),1)
+        finally:
+            shutil.rmtree(tmp_dir)
+
+    def test_reprojection_cache_save_map():
+        m = mapnik.Map(256,256)
+        mapnik.load_map(m,'../data/good_maps/wgs842merc_reprojection.xml')
+        m.layers[0].reprojection_cache = mapnik.reprojection_cache.FILE
+        eq_('reprojection-cache="file"' in mapnik.save_map_to_string(m),True)
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
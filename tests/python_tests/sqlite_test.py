@@ -360,6 +360,75 @@ if 'sqlite' in mapnik.DatasourceCache.plugin_names():
         eq_(len(feat.geometries()),1)
         eq_(feat.geometries()[0].to_wkt(),'Point(0.0 0.0)')
 
+    def test_repeated_queries_with_spatial_index():
+        # the extent is bound to a reused statement, so alternating extents
+        # and concurrently open featuresets must not see each other's rows
+        ds = mapnik.SQLite(file='../data/sqlite/world.sqlite',
+            table='world_merc',
+            )
+        world = ds.envelope()
+        west = mapnik.Box2d(world.minx,world.miny,world.center().x,world.maxy)
+        def ids(box):
+            query = mapnik.Query(box)
+            query.add_property_name('name')
+            return [f.id() for f in ds.features(query)]
+        all_ids = ids(world)
+        west_ids = ids(west)
+        eq_(len(all_ids),245)
+        ok_(0 < len(west_ids) < len(all_ids))
+        eq_(ids(world),all_ids)
+        eq_(ids(west),west_ids)
+        eq_(all_ids,sorted(all_ids))
+        fs1 = ds.features(mapnik.Query(west))
+        fs2 = ds.features(mapnik.Query(world))
+        eq_(len(list(fs2)),245)
+        eq_(len(list(fs1)),len(west_ids))
+
+    def test_out_of_date_auto_index_is_rebuilt():
+        import shutil, time
+        db = '../data/sqlite/world_copy.sqlite'
+        shutil.copy('../data/sqlite/world.sqlite',db)
+        try:
+            ds = mapnik.SQLite(file=db,table='world_merc')
+            eq_(len(ds.all_features()),245)
+            index_db = db + '.index'
+            ok_(os.path.exists(index_db))
+            built = os.path.getmtime(index_db)
+            # an untouched file keeps its index
+            ds = mapnik.SQLite(file=db,table='world_merc')
+            eq_(os.path.getmtime(index_db),built)
+            # a changed file gets a new one
+            later = int(time.time()) + 60
+            os.utime(db,(later,later))
+            ds = mapnik.SQLite(file=db,table='world_merc')
+            eq_(len(ds.all_features()),245)
+            import sqlite3
+            stamp = sqlite3.connect(index_db).execute('select mtime from mapnik_index_source').fetchone()
+            eq_(stamp[0],int(later))
+        finally:
+            for f in (db,db + '.index'):
+                if os.path.exists(f):
+                    os.unlink(f)
+
+    def test_unreadable_auto_index_is_left_alone():
+        import shutil
+        db = '../data/sqlite/world_copy.sqlite'
+        shutil.copy('../data/sqlite/world.sqlite',db)
+        index_db = db + '.index'
+        garbage = 'not an sqlite database' * 10
+        open(index_db,'wb').write(garbage)
+        try:
+            # reads fall back to the table, and the index is not rebuilt on every bind
+            for i in range(2):
+                ds = mapnik.SQLite(file=db,table='world_merc',
+                    extent='-20037508.34,-20037508.34,20037508.34,20037508.34')
+                eq_(len(ds.all_features()),245)
+                eq_(open(index_db,'rb').read(),garbage)
+        finally:
+            for f in (db,index_db):
+                if os.path.exists(f):
+                    os.unlink(f)
+
 if __name__ == "__main__":
     setup()
     [eval(run)() for run in dir() if 'test_' in run]
@@ -32,7 +32,7 @@ source = Split(
     """
     )
 
-headers = ['#plugins/input/ogr'] + env['CPPPATH'] 
+headers = ['#plugins/input/ogr', '#utils/shapeindex'] + env['CPPPATH'] 
 
 program_env['LIBS'] = [env['PLUGINS']['ogr']['lib']]
 
@@ -40,6 +40,7 @@
 
 #include "ogr_converter.cpp"
 #include "ogr_datasource.cpp"
+#include "ogr_feature_batch.cpp"
 #include "ogr_featureset.cpp"
 #include "ogr_index_featureset.cpp"
 
@@ -131,72 +132,30 @@ int main (int argc,char** argv)
             continue;
         }
 
-        // TODO - layer names don't match dataset name, so this will break for
-        // any layer types of ogr than shapefiles, etc
-        size_t breakpoint = ogrname.find_last_of (".");
-        if (breakpoint == string::npos) breakpoint = ogrname.length();
-        std::string ogrlayername (ogrname.substr(0, breakpoint));
-
-        if (boost::filesystem::exists (ogrlayername + ".ogrindex"))
-        {
-            std::clog << "error : " << ogrlayername << ".ogrindex file already exists for " << ogrname << std::endl;
-            continue;
-        }
-
         mapnik::parameters params;
         params["type"] = "ogr";
         params["file"] = ogrname;
-        //unsigned first = 0;
-        params["layer_by_index"] = 0;//ogrlayername;
+        params["layer_by_index"] = 0;
+        // build the index here, with the requested depth and ratio
+        params["auto_index"] = "false";
 
         try
         {
             ogr_datasource ogr (params);
 
-
-            box2d<double> extent = ogr.envelope();
-            quadtree<int> tree (extent, depth, ratio);
-            int count=0;
-
-            std::clog << "file:" << ogrname << std::endl;
-            std::clog << "layer:" << ogrlayername << std::endl;
-            std::clog << "extent:" << extent << std::endl;
-
-            mapnik::query q (extent, 1.0);
-            mapnik::featureset_ptr itr = ogr.features (q);
-
-            while (true)
+            if (boost::filesystem::exists (ogr.index_name()))
             {
-                mapnik::feature_ptr fp = itr->next();
-                if (!fp)
-                {
-                    break;
-                }
-
-                box2d<double> item_ext = fp->envelope();
-
-                tree.insert (count, item_ext);
-                if (verbose) {
-                    std::clog << "record number " << (count + 1) << " box=" << item_ext << std::endl;
-                }
-
-                ++count;
+                std::clog << "error : " << ogr.index_name() << " file already exists for " << ogrname << std::endl;
+                continue;
             }
 
-            std::clog << " number shapes=" << count << std::endl;
+            std::clog << "file:" << ogrname << std::endl;
+            std::clog << "extent:" << ogr.envelope() << std::endl;
 
-            std::fstream file((ogrlayername+".ogrindex").c_str(),
-                              std::ios::in | std::ios::out | std::ios::trunc | std::ios::binary);
-            if (!file) {
+            if (! ogr.build_index (depth, ratio))
+            {
                 std::clog << "cannot open ogrindex file for writing file \""
-                          << (ogrlayername+".ogrindex") << "\"" << std::endl;
-            } else {
-                tree.trim();
-                std::clog<<" number nodes="<<tree.count()<<std::endl;
-                file.exceptions(std::ios::failbit | std::ios::badbit);
-                tree.write(file);
-                file.flush();
-                file.close();
+                          << ogr.index_name() << "\"" << std::endl;
             }
         }
         // catch problem at the datasource creation
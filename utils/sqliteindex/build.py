@@ -0,0 +1,53 @@
+#
+# This file is part of Mapnik (c++ mapping toolkit)
+#
+# Copyright (C) 2013 Artem Pavlenko
+#
+# Mapnik is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# License as published by the Free Software Foundation; either
+# version 2.1 of the License, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public License for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# License along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+#
+#
+
+import os
+
+Import ('env')
+
+program_env = env.Clone()
+
+source = Split(
+    """
+    sqliteindex.cpp
+    """
+    )
+
+headers = ['#plugins/input/sqlite'] + env['CPPPATH']
+
+libraries = ['sqlite3', 'mapnik', env['ICU_LIB_NAME']]
+libraries.append('boost_program_options%s' % env['BOOST_APPEND'])
+libraries.append('boost_filesystem%s' % env['BOOST_APPEND'])
+libraries.append('boost_system%s' % env['BOOST_APPEND'])
+
+linkflags = env['CUSTOM_LDFLAGS']
+if env['SQLITE_LINKFLAGS']:
+    linkflags.append(env['SQLITE_LINKFLAGS'])
+
+sqliteindex = program_env.Program('sqliteindex', source, CPPPATH=headers, LIBS=libraries, LINKFLAGS=linkflags)
+
+Depends(sqliteindex, env.subst('../../src/%s' % env['MAPNIK_LIB_NAME']))
+
+if 'uninstall' not in COMMAND_LINE_TARGETS:
+    env.Install(os.path.join(env['INSTALL_PREFIX'],'bin'), sqliteindex)
+    env.Alias('install', os.path.join(env['INSTALL_PREFIX'],'bin'))
+
+env['create_uninstall_target'](env, os.path.join(env['INSTALL_PREFIX'],'bin','sqliteindex'))
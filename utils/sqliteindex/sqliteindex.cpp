@@ -0,0 +1,206 @@
+/*****************************************************************************
+ *
+ * This file is part of Mapnik (c++ mapping toolkit)
+ *
+ * Copyright (C) 2013 Artem Pavlenko
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ *****************************************************************************/
+
+// Builds the <file>.index rtree the sqlite plugin otherwise builds with
+// auto_index on the first request against a file.
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/program_options.hpp>
+#include <boost/make_shared.hpp>
+
+#include <mapnik/feature_layer_desc.hpp>
+
+#include "sqlite_utils.hpp"
+
+int main (int argc,char** argv)
+{
+    namespace po = boost::program_options;
+    using std::string;
+    using std::vector;
+    using std::clog;
+    using std::endl;
+
+    bool verbose = false;
+    string table;
+    string geometry_field;
+    string key_field;
+    vector<string> sqlite_files;
+
+    try
+    {
+        po::options_description desc("sqliteindex utility");
+        desc.add_options()
+            ("help,h", "produce usage message")
+            ("version,V","print version string")
+            ("verbose,v","verbose output")
+            ("table,t", po::value<string>(), "table to index (default every table with a geometry column)")
+            ("geometry-field,g", po::value<string>(), "geometry column (default detected)")
+            ("key-field,k", po::value<string>(), "integer key column (default the primary key)")
+            ("sqlite_files",po::value<vector<string> >(),"sqlite files to index: file1 file2 ...fileN")
+            ;
+
+        po::positional_options_description p;
+        p.add("sqlite_files",-1);
+        po::variables_map vm;
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(p).run(), vm);
+        po::notify(vm);
+
+        if (vm.count("version"))
+        {
+            clog << "version 0.1.0" << endl;
+            return 1;
+        }
+
+        if (vm.count("help"))
+        {
+            clog << desc << endl;
+            return 1;
+        }
+        if (vm.count("verbose"))
+        {
+            verbose = true;
+        }
+        if (vm.count("table"))
+        {
+            table = vm["table"].as<string>();
+        }
+        if (vm.count("geometry-field"))
+        {
+            geometry_field = vm["geometry-field"].as<string>();
+        }
+        if (vm.count("key-field"))
+        {
+            key_field = vm["key-field"].as<string>();
+        }
+        if (vm.count("sqlite_files"))
+        {
+            sqlite_files = vm["sqlite_files"].as< vector<string> >();
+        }
+    }
+    catch (std::exception const& ex)
+    {
+        clog << "error : " << ex.what() << endl;
+        return -1;
+    }
+
+    if (sqlite_files.empty())
+    {
+        clog << "no sqlite files to index" << endl;
+        return 0;
+    }
+
+    int status = 0;
+    vector<string>::const_iterator itr = sqlite_files.begin();
+    for ( ; itr != sqlite_files.end(); ++itr)
+    {
+        string const& file = *itr;
+        clog << "processing " << file << endl;
+
+        if (! boost::filesystem::exists(file))
+        {
+            clog << "error : file " << file << " does not exist" << endl;
+            status = 1;
+            continue;
+        }
+
+        try
+        {
+            boost::shared_ptr<sqlite_connection> ds = boost::make_shared<sqlite_connection>(file);
+
+            vector<string> tables;
+            if (! table.empty())
+            {
+                tables.push_back(table);
+            }
+            else
+            {
+                sqlite_utils::get_tables(ds, tables);
+            }
+
+            for (vector<string>::const_iterator name = tables.begin(); name != tables.end(); ++name)
+            {
+                // quoted as the datasource does, so that the index names match
+                string geometry_table = *name;
+                if (sqlite_utils::needs_quoting(geometry_table))
+                {
+                    geometry_table = "[" + geometry_table + "]";
+                }
+
+                string geometry = geometry_field;
+                string key = key_field;
+                mapnik::layer_descriptor desc("sqlite", "utf-8");
+                if (! sqlite_utils::table_info(key, false, geometry, geometry_table, desc, ds)
+                    || geometry.empty())
+                {
+                    if (! table.empty())
+                    {
+                        clog << "error : no geometry column found in table " << *name << endl;
+                        status = 1;
+                    }
+                    else if (verbose)
+                    {
+                        clog << "skipping " << *name << ", no geometry column" << endl;
+                    }
+                    continue;
+                }
+                if (key.empty())
+                {
+                    clog << "error : table " << *name << " has no primary key, pass --key-field" << endl;
+                    status = 1;
+                    continue;
+                }
+
+                string index_db = sqlite_utils::index_for_db(file);
+                string index_table = sqlite_utils::index_for_table(geometry_table, geometry);
+                if (verbose)
+                {
+                    clog << "indexing " << *name << " (" << geometry << ", " << key << ") into "
+                         << index_table << " in " << index_db << endl;
+                }
+
+                std::ostringstream query;
+                query << "SELECT " << geometry << "," << key << " FROM (" << geometry_table << ")";
+                boost::shared_ptr<sqlite_resultset> rs = ds->execute_query(query.str());
+                if (sqlite_utils::create_spatial_index(index_db, index_table, rs, file))
+                {
+                    clog << "indexed " << *name << endl;
+                }
+                else
+                {
+                    clog << "no geometries to index in " << *name << endl;
+                }
+            }
+        }
+        catch (std::exception const& ex)
+        {
+            clog << "error : " << ex.what() << endl;
+            status = 1;
+        }
+    }
+
+    clog << "done!" << endl;
+    return status;
+}